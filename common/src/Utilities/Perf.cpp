@@ -20,6 +20,14 @@
 //#define ProfileWithPerf
 #define MERGE_BLOCK_RESULT
 
+#if defined(__linux__) && defined(ProfileWithPerf)
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
 
 namespace Perf
 {
@@ -51,6 +59,112 @@ namespace Perf
 		fprintf(fp, "%x %x %s\n", m_x86, m_size, m_symbol);
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	// Jitdump file (tools/perf/Documentation/jitdump-specification.txt)
+	//
+	// Unlike the perf map, each record carries a timestamp and a copy of the code,
+	// so blocks which are recompiled at the same address are told apart and perf
+	// can annotate them. Record with "perf record -k mono", then run
+	// "perf inject --jit" on the result.
+	////////////////////////////////////////////////////////////////////////////////
+
+	static const u32 JITDUMP_MAGIC   = 0x4A695444;
+	static const u32 JITDUMP_VERSION = 1;
+	static const u32 JIT_CODE_LOAD   = 0;
+
+	struct JitHeader
+	{
+		u32 magic;
+		u32 version;
+		u32 total_size;
+		u32 elf_mach;
+		u32 pad1;
+		u32 pid;
+		u64 timestamp;
+		u64 flags;
+	};
+
+	struct JitCodeLoad
+	{
+		u32 id;
+		u32 total_size;
+		u64 timestamp;
+		u32 pid;
+		u32 tid;
+		u64 vma;
+		u64 code_addr;
+		u64 code_size;
+		u64 code_index;
+		// followed by the null terminated name and the code
+	};
+
+	static FILE* s_jitdump = NULL;
+	static void* s_jitdump_marker = NULL;
+	static u64 s_jitdump_index = 0;
+
+	static u64 jitdump_timestamp()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+	static bool jitdump_open()
+	{
+		if (s_jitdump)
+			return true;
+
+		char file[256];
+		snprintf(file, 250, "/tmp/jit-%d.dump", getpid());
+		s_jitdump = fopen(file, "w+");
+		if (!s_jitdump)
+			return false;
+
+		// perf only picks up the file when it sees it mapped as executable
+		long page = sysconf(_SC_PAGESIZE);
+		s_jitdump_marker = mmap(NULL, page, PROT_READ | PROT_EXEC, MAP_PRIVATE, fileno(s_jitdump), 0);
+		if (s_jitdump_marker == MAP_FAILED)
+			s_jitdump_marker = NULL;
+
+		JitHeader header = {};
+		header.magic      = JITDUMP_MAGIC;
+		header.version    = JITDUMP_VERSION;
+		header.total_size = sizeof(header);
+#ifdef __x86_64__
+		header.elf_mach   = EM_X86_64;
+#else
+		header.elf_mach   = EM_386;
+#endif
+		header.pid        = getpid();
+		header.timestamp  = jitdump_timestamp();
+		fwrite(&header, sizeof(header), 1, s_jitdump);
+
+		return true;
+	}
+
+	static void jitdump_load(uptr x86, u32 size, const char* symbol)
+	{
+		if (!jitdump_open())
+			return;
+
+		u32 name_size = strlen(symbol) + 1;
+
+		JitCodeLoad rec = {};
+		rec.id         = JIT_CODE_LOAD;
+		rec.total_size = sizeof(rec) + name_size + size;
+		rec.timestamp  = jitdump_timestamp();
+		rec.pid        = getpid();
+		rec.tid        = syscall(SYS_gettid);
+		rec.vma        = x86;
+		rec.code_addr  = x86;
+		rec.code_size  = size;
+		rec.code_index = s_jitdump_index++;
+
+		fwrite(&rec, sizeof(rec), 1, s_jitdump);
+		fwrite(symbol, name_size, 1, s_jitdump);
+		fwrite((void*)x86, size, 1, s_jitdump);
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 	// Implementation of the InfoVector object
 	////////////////////////////////////////////////////////////////////////////////
@@ -77,12 +191,19 @@ namespace Perf
 #else
 		if (size < 8 * _1kb) m_v.emplace_back(x86, size, symbol);
 #endif
+
+		// Only the real code is dumped, not the whole recompiler reservation
+		if (size < 8 * _1kb) jitdump_load(x86, size, symbol);
 	}
 
 	void InfoVector::map(uptr x86, u32 size, u32 pc)
 	{
+		// The jitdump always gets the individual blocks, it copes with reused addresses
+		Info block(x86, size, m_prefix, pc);
+		jitdump_load(x86, size, block.m_symbol);
+
 #ifndef MERGE_BLOCK_RESULT
-		m_v.emplace_back(x86, size, m_prefix, pc);
+		m_v.push_back(block);
 #endif
 	}
 
@@ -109,6 +230,9 @@ namespace Perf
 
 		if (fp)
 			fclose(fp);
+
+		if (s_jitdump)
+			fflush(s_jitdump);
 	}
 
 	void dump_and_reset()
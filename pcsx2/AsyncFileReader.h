@@ -53,6 +53,11 @@ public:
 	virtual void SetBlockSize(uint bytes) {}
 	virtual void SetDataOffset(int bytes) {}
 
+	// Tells where the emulated drive is seeking to and how many sectors it's going to read from
+	// there.  contiguous is set when the target follows the previous read closely enough to not
+	// need a real seek.  Readers which read ahead can start early and size their window from it.
+	virtual void SeekHint(uint sector, uint count, bool contiguous) {}
+
 	uint GetBlockSize() const { return m_blocksize; }
 
 	const wxString& GetFilename() const
@@ -76,6 +81,7 @@ class FlatFileReader : public AsyncFileReader
 #elif defined(__linux__)
 	int m_fd; // FIXME don't know if overlap as an equivalent on linux
 	io_context_t m_aio_context;
+	class FlatFileUring* m_uring; // io_uring backend, libaio is the fallback when it's unavailable
 #elif defined(__POSIX__)
 	int m_fd; // TODO OSX don't know if overlap as an equivalent on OSX
 	struct aiocb m_aiocb;
@@ -102,6 +108,10 @@ public:
 
 	virtual void SetBlockSize(uint bytes) { m_blocksize = bytes; }
 	virtual void SetDataOffset(int bytes) { m_dataoffset = bytes; }
+
+#if defined(__linux__)
+	virtual void SeekHint(uint sector, uint count, bool contiguous);
+#endif
 };
 
 class MultipartFileReader : public AsyncFileReader
@@ -139,6 +149,8 @@ public:
 
 	virtual void SetBlockSize(uint bytes);
 
+	virtual void SeekHint(uint sector, uint count, bool contiguous);
+
 	static AsyncFileReader* DetectMultipart(AsyncFileReader* reader);
 };
 
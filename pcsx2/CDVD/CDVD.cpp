@@ -912,6 +912,7 @@ static uint cdvdStartSeek( uint newsector, CDVD_MODE_TYPE mode )
 
 	uint delta = abs( (s32)(cdvd.SeekToSector - cdvd.Sector) );
 	uint seektime;
+	bool contiguous = false;
 
 	cdvd.Ready = CDVD_NOTREADY;
 	cdvd.Reading = 0;
@@ -945,6 +946,7 @@ static uint cdvdStartSeek( uint newsector, CDVD_MODE_TYPE mode )
 	else
 	{
 		CDVD_LOG( "CdSeek Begin > Contiguous block without seek - delta=%d sectors", delta );
+		contiguous = true;
 
 		// seektime is the time it takes to read to the destination block:
 		seektime = delta * cdvd.ReadTime;
@@ -964,6 +966,10 @@ static uint cdvdStartSeek( uint newsector, CDVD_MODE_TYPE mode )
 		}
 	}
 
+	// Let the source start reading while the seek is emulated.  For CdSeek and CdStandby
+	// nSectors is left over from the previous read, which is as good a guess as any.
+	DoCDVDseekHint( cdvd.SeekToSector, cdvd.nSectors, contiguous );
+
 	return seektime;
 }
 
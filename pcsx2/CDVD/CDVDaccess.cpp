@@ -483,6 +483,13 @@ s32 DoCDVDgetBuffer(u8* buffer)
 	return ret;
 }
 
+void DoCDVDseekHint(u32 lsn, u32 count, bool contiguous)
+{
+	CheckNullCDVD();
+	if (CDVD->seekHint != NULL)
+		CDVD->seekHint(lsn, count, contiguous);
+}
+
 s32 DoCDVDdetectDiskType()
 {
 	CheckNullCDVD();
@@ -595,4 +602,5 @@ CDVD_API CDVDapi_NoDisc =
 	NODISCreadSector,
 	NODISCgetBuffer2,
 	NODISCgetDualInfo,
+	NULL, // seekHint
 };
@@ -51,6 +51,9 @@ struct CDVD_API
 	_CDVDreadSector    readSector;
 	_CDVDgetBuffer2    getBuffer2;
 	_CDVDgetDualInfo   getDualInfo;
+
+	// internal only, may be NULL
+	void (CALLBACK *seekHint)(u32 lsn, u32 count, bool contiguous);
 };
 
 // ----------------------------------------------------------------------------
@@ -77,6 +80,7 @@ extern void DoCDVDclose();
 extern s32  DoCDVDreadSector(u8* buffer, u32 lsn, int mode);
 extern s32  DoCDVDreadTrack(u32 lsn, int mode);
 extern s32  DoCDVDgetBuffer(u8* buffer);
+extern void DoCDVDseekHint(u32 lsn, u32 count, bool contiguous);
 extern s32  DoCDVDdetectDiskType();
 extern void DoCDVDresetDiskTypeCache();
 
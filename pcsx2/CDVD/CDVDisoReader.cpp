@@ -371,6 +371,11 @@ s32 CALLBACK ISOreadTrack(u32 lsn, int mode)
 	return 0;
 }
 
+void CALLBACK ISOseekHint(u32 lsn, u32 count, bool contiguous)
+{
+	iso.SeekHint(lsn, count, contiguous);
+}
+
 s32 CALLBACK ISOgetBuffer2(u8* buffer)
 {
 	return iso.FinishRead3(buffer, pmode);
@@ -426,4 +431,5 @@ CDVD_API CDVDapi_Iso =
 	ISOreadSector,
 	ISOgetBuffer2,
 	ISOgetDualInfo,
+	ISOseekHint,
 };
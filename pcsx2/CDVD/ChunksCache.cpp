@@ -16,37 +16,174 @@
 #include "PrecompiledHeader.h"
 #include "ChunksCache.h"
 
+// Slabs are allocated as the cache fills up, each holds this many bytes of chunks (or one chunk).
+static const uint SLAB_SIZE = 1024 * 1024;
+
+ChunksCache::ChunksCache(uint initialLimitMb, uint chunkSize) :
+	m_chunkSize(chunkSize),
+	m_limit((PX_off_t)initialLimitMb * 1024 * 1024) {
+	for (uint i = 0; i < NumShards; i++)
+		memzero(m_shards[i].stats);
+	Clear();
+}
+
 void ChunksCache::SetLimit(uint megabytes) {
 	m_limit = (PX_off_t)megabytes * 1024 * 1024;
-	MatchLimit();
+	Clear();
 }
 
-void ChunksCache::MatchLimit(bool removeAll) {
-	std::list<CacheEntry*>::reverse_iterator rit;
-	while (!m_entries.empty() && (removeAll || m_size > m_limit)) {
-		rit = m_entries.rbegin();
-		m_size -= (*rit)->size;
-		delete(*rit);
-		m_entries.pop_back();
+void ChunksCache::SetChunkSize(uint bytes) {
+	if (bytes != m_chunkSize) {
+		m_chunkSize = bytes;
+		Clear();
 	}
 }
 
-void ChunksCache::Take(void* pMallocedSrc, PX_off_t offset, int length, int coverage) {
-	m_entries.push_front(new CacheEntry(pMallocedSrc, offset, length, coverage));
-	m_size += length;
-	MatchLimit();
+void ChunksCache::Clear() {
+	for (uint i = 0; i < NumShards; i++)
+		ClearShard(m_shards[i]);
+}
+
+void ChunksCache::ClearShard(Shard& shard) {
+	Threading::ScopedLock lock(shard.lock);
+	for (auto it = shard.slabs.begin(); it != shard.slabs.end(); ++it)
+		free(*it);
+
+	shard.slabs.clear();
+	shard.entries.clear();
+	shard.free.clear();
+	shard.index.clear();
+	shard.hand = 0;
+	shard.maxEntries = std::max<u32>(1, (u32)(m_limit / m_chunkSize / NumShards));
+}
+
+// Called with the shard's lock held.
+ChunksCache::CacheEntry* ChunksCache::Find(Shard& shard, PX_off_t offset) {
+	auto it = shard.index.find(offset / m_chunkSize);
+	if (it == shard.index.end())
+		return NULL;
+
+	CacheEntry* e = &shard.entries[it->second];
+	e->referenced = true;
+	return e;
+}
+
+// Called with the shard's lock held.
+// Returns an unused entry, from a new slab while below the limit and otherwise by evicting the
+// first entry not referenced since the clock hand last passed it.
+ChunksCache::CacheEntry* ChunksCache::Allocate(Shard& shard) {
+	if (shard.free.empty() && shard.entries.size() < shard.maxEntries) {
+		u32 count = std::max<u32>(1, SLAB_SIZE / m_chunkSize);
+		count = std::min<u32>(count, shard.maxEntries - shard.entries.size());
+
+		u8* slab = (u8*)malloc((size_t)count * m_chunkSize);
+		if (slab) {
+			shard.slabs.push_back(slab);
+			shard.entries.reserve(shard.maxEntries);
+
+			for (u32 i = 0; i < count; i++) {
+				CacheEntry e = {slab + (size_t)i * m_chunkSize, -1, 0, 0, false};
+				shard.free.push_back(shard.entries.size());
+				shard.entries.push_back(e);
+			}
+		}
+	}
+
+	if (!shard.free.empty()) {
+		CacheEntry* e = &shard.entries[shard.free.back()];
+		shard.free.pop_back();
+		return e;
+	}
+
+	if (shard.entries.empty())
+		return NULL;
+
+	for (;;) {
+		CacheEntry* e = &shard.entries[shard.hand];
+		shard.hand = (shard.hand + 1) % shard.entries.size();
+
+		if (e->referenced) {
+			e->referenced = false;
+			continue;
+		}
+
+		shard.index.erase(e->offset / m_chunkSize);
+		shard.stats.evictions++;
+		return e;
+	}
+}
+
+void ChunksCache::Take(const void* pSrc, PX_off_t offset, int length, int coverage) {
+	pxAssert(offset % m_chunkSize == 0 && length <= (int)m_chunkSize && coverage <= (int)m_chunkSize);
+	if (offset % m_chunkSize != 0)
+		return;
+
+	Shard& shard = GetShard(offset);
+	Threading::ScopedLock lock(shard.lock);
+	CacheEntry* e = Find(shard, offset);
+	if (!e) {
+		e = Allocate(shard);
+		if (!e)
+			return;
+		shard.index[offset / m_chunkSize] = e - &shard.entries[0];
+	}
+
+	memcpy(e->data, pSrc, length);
+	e->offset = offset;
+	e->size = length;
+	e->coverage = coverage;
+	e->referenced = true;
 }
 
 // By design, succeed only if the entire request is in a single cached chunk
 int ChunksCache::Read(void* pDest, PX_off_t offset, int length) {
-	for (auto it = m_entries.begin(); it != m_entries.end(); it++) {
-		CacheEntry* e = *it;
-		if (e && offset >= e->offset && (offset + length) <= (e->offset + e->coverage)) {
-			if (it != m_entries.begin())
-				m_entries.splice(m_entries.begin(), m_entries, it); // Move to top (MRU)
-			return CopyAvailable(e->data, e->offset, e->size, pDest, offset, length);
-		}
+	Shard& shard = GetShard(offset);
+	Threading::ScopedLock lock(shard.lock);
+	CacheEntry* e = Find(shard, offset);
+	if (e && (offset + length) <= (e->offset + e->coverage)) {
+		shard.stats.hits++;
+		return CopyAvailable(e->data, e->offset, e->size, pDest, offset, length);
+	}
+
+	shard.stats.misses++;
+	return -1;
+}
+
+int ChunksCache::ReadChunk(void* pDest, PX_off_t offset) {
+	Shard& shard = GetShard(offset);
+	Threading::ScopedLock lock(shard.lock);
+	CacheEntry* e = Find(shard, offset);
+	if (e && e->offset == offset) {
+		shard.stats.hits++;
+		memcpy(pDest, e->data, e->size);
+		return e->size;
 	}
+
+	shard.stats.misses++;
 	return -1;
 }
 
+bool ChunksCache::Contains(PX_off_t offset) const {
+	const Shard& shard = GetShard(offset);
+	Threading::ScopedLock lock(shard.lock);
+	return shard.index.count(offset / m_chunkSize) != 0;
+}
+
+void ChunksCache::LogStats(const char* name) {
+	u32 hits = 0, misses = 0, evictions = 0, chunks = 0;
+	for (uint i = 0; i < NumShards; i++) {
+		Shard& shard = m_shards[i];
+		Threading::ScopedLock lock(shard.lock);
+		hits += shard.stats.hits;
+		misses += shard.stats.misses;
+		evictions += shard.stats.evictions;
+		chunks += (u32)shard.index.size();
+		memzero(shard.stats);
+	}
+
+	const u32 reads = hits + misses;
+	if (reads) {
+		DevCon.WriteLn("%s: %u chunk reads, %.1f%% hits, %u evictions, %u chunks of %u KB cached",
+			name, reads, hits * 100.0 / reads, evictions, chunks, m_chunkSize / 1024);
+	}
+}
@@ -16,18 +16,39 @@
 #pragma once
 
 #include "zlib_indexed.h"
+#include "Utilities/Threading.h"
+#include <unordered_map>
 
 #define CLAMP(val, minval, maxval) (std::min(maxval, std::max(minval, val)))
 
+// Cache of fixed size chunks which start at multiples of the chunk size.  Chunks are found through
+// a hash index of their offset, their buffers come from slabs which are allocated once and reused,
+// and the least recently used chunks are evicted with the CLOCK algorithm.
+//
+// The cache is split into shards by chunk number, each with its own index, slabs, clock and lock,
+// so the gzip workers filling it and the EE thread reading it only contend on the same chunks.
+// Take, Read, ReadChunk and Contains are thread safe; the limit and chunk size are only changed
+// while nothing else uses the cache.
 class ChunksCache {
 public:
-	ChunksCache(uint initialLimitMb) : m_entries(0), m_size(0), m_limit(initialLimitMb * 1024 * 1024) {};
+	static const uint NumShards = 8;
+
+	ChunksCache(uint initialLimitMb, uint chunkSize);
 	~ChunksCache() { Clear(); };
 	void SetLimit(uint megabytes);
-	void Clear() { MatchLimit(true); };
+	void SetChunkSize(uint bytes);
+	void Clear();
+
+	// length may be shorter than the chunk at EOF, coverage is the part of the file it stands for.
+	void Take(const void* pSrc, PX_off_t offset, int length, int coverage);
+	int  Read(void* pDest,      PX_off_t offset, int length);
+
+	// Copies the whole chunk starting at offset, returns its length or -1 if it is not cached.
+	int  ReadChunk(void* pDest, PX_off_t offset);
 
-	void Take(void* pMallocedSrc, PX_off_t offset, int length, int coverage);
-	int  Read(void* pDest,        PX_off_t offset, int length);
+	bool Contains(PX_off_t offset) const;
+
+	void LogStats(const char* name);
 
 	static int CopyAvailable(void* pSrc, PX_off_t srcOffset, int srcSize,
 							 void* pDst, PX_off_t dstOffset, int maxCopySize) {
@@ -37,26 +58,39 @@ public:
 	};
 
 private:
-	class CacheEntry {
-	public:
-		CacheEntry(void* pMallocedSrc, PX_off_t offset, int length, int coverage) :
-			data(pMallocedSrc),
-			offset(offset),
-			coverage(coverage),
-			size(length)
-		{};
-
-		~CacheEntry() { if (data) free(data); };
-
-		void* data;
+	struct CacheEntry {
+		u8* data;
 		PX_off_t offset;
 		int coverage;
 		int size;
+		bool referenced;
 	};
 
-	std::list<CacheEntry*> m_entries;
-	void MatchLimit(bool removeAll = false);
-	PX_off_t m_size;
+	struct Shard {
+		Threading::Mutex lock;
+		std::unordered_map<PX_off_t, u32> index; // chunk number -> entry
+		std::vector<CacheEntry> entries;
+		std::vector<u8*> slabs;
+		std::vector<u32> free;
+		u32 hand;
+		u32 maxEntries;
+
+		struct {
+			u32 hits;
+			u32 misses;
+			u32 evictions;
+		} stats;
+	};
+
+	Shard& GetShard(PX_off_t offset) { return m_shards[(offset / m_chunkSize) % NumShards]; }
+	const Shard& GetShard(PX_off_t offset) const { return m_shards[(offset / m_chunkSize) % NumShards]; }
+
+	CacheEntry* Find(Shard& shard, PX_off_t offset);
+	CacheEntry* Allocate(Shard& shard);
+	void ClearShard(Shard& shard);
+
+	Shard m_shards[NumShards];
+	uint m_chunkSize;
 	PX_off_t m_limit;
 };
 
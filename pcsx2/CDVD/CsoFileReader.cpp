@@ -38,6 +38,73 @@ struct CsoHeader {
 
 static const u32 CSO_READ_BUFFER_SIZE = 256 * 1024;
 
+static z_stream* CreateZStream() {
+	z_stream* z = new z_stream;
+	z->zalloc = Z_NULL;
+	z->zfree = Z_NULL;
+	z->opaque = Z_NULL;
+	if (inflateInit2(z, -15) != Z_OK) {
+		delete z;
+		return NULL;
+	}
+	return z;
+}
+
+static void DestroyZStream(z_stream* z) {
+	if (z) {
+		inflateEnd(z);
+		delete z;
+	}
+}
+
+// Inflates the frames queued by the EE thread.  Each worker has its own file handle and zlib
+// stream, so they never wait on each other except to pop the queue.
+class CsoFrameThread : public Threading::pxThread
+{
+	typedef Threading::pxThread _parent;
+
+	CsoFileReader& m_reader;
+	FILE* m_src;
+	z_stream* m_z_stream;
+	u8* m_readBuffer;
+
+public:
+	CsoFrameThread(CsoFileReader& reader, FILE* src, z_stream* z, u32 readBufferSize, int id)
+		: m_reader(reader)
+		, m_src(src)
+		, m_z_stream(z)
+		, m_readBuffer(new u8[readBufferSize])
+	{
+		m_name = wxsFormat(L"CSO Worker %d", id);
+	}
+
+	virtual ~CsoFrameThread() throw()
+	{
+		try {
+			// The reader sets m_quit before deleting us, wait for the loop to notice.
+			if (m_running)
+				Block();
+		}
+		DESTRUCTOR_CATCHALL
+
+		fclose(m_src);
+		DestroyZStream(m_z_stream);
+		delete[] m_readBuffer;
+	}
+
+protected:
+	void ExecuteTaskInThread()
+	{
+		u32 frame;
+		while (m_reader.PopFrame(frame)) {
+			CsoFileReader::FrameSlot& slot = m_reader.m_slots[frame & m_reader.m_slotMask];
+			const bool success = m_reader.LoadFrame(m_src, m_z_stream, m_readBuffer, frame, slot);
+			slot.state.store(success ? CsoFileReader::FRAME_READY : CsoFileReader::FRAME_FAILED, std::memory_order_release);
+			m_reader.m_frameDone.Post();
+		}
+	}
+};
+
 bool CsoFileReader::CanHandle(const wxString& fileName) {
 	bool supported = false;
 	if (wxFileName::FileExists(fileName) && fileName.Lower().EndsWith(L".cso")) {
@@ -131,10 +198,6 @@ bool CsoFileReader::InitializeBuffers() {
 		m_readBuffer = new u8[m_frameSize + (1 << m_indexShift)];
 	}
 
-	// This is a buffer for the most recently decompressed frame.
-	m_zlibBuffer = new u8[m_frameSize + (1 << m_indexShift)];
-	m_zlibBufferFrame = numFrames;
-
 	const u32 indexSize = numFrames + 1;
 	m_index = new u32[indexSize];
 	if (fread(m_index, sizeof(u32), indexSize, m_src) != indexSize) {
@@ -142,30 +205,108 @@ bool CsoFileReader::InitializeBuffers() {
 		return false;
 	}
 
-	m_z_stream = new z_stream;
-	m_z_stream->zalloc = Z_NULL;
-	m_z_stream->zfree = Z_NULL;
-	m_z_stream->opaque = Z_NULL;
-	if (inflateInit2(m_z_stream, -15) != Z_OK) {
+	m_z_stream = CreateZStream();
+	if (!m_z_stream) {
 		Console.Error("Unable to initialize zlib for CSO decompression.");
 		return false;
 	}
 
+	// The frame cache holds a power of two number of frames, at least enough for the read ahead.
+	u32 numSlots = 1;
+	while (numSlots < 8 || ((u64)numSlots * 2 * m_frameSize <= CSO_FRAMECACHE_SIZE_KB * 1024 && numSlots * 2 <= numFrames)) {
+		numSlots *= 2;
+	}
+
+	m_cache.SetChunkSize(m_frameSize);
+
+	m_slots = new FrameSlot[numSlots];
+	m_slotMask = numSlots - 1;
+	m_slotBuffer = new u8[(size_t)numSlots * m_frameSize];
+	for (u32 i = 0; i < numSlots; ++i) {
+		m_slots[i].frame = 0;
+		m_slots[i].state = FRAME_EMPTY;
+		m_slots[i].bytes = 0;
+		m_slots[i].readAhead = false;
+		m_slots[i].cached = false;
+		m_slots[i].data = m_slotBuffer + (size_t)i * m_frameSize;
+	}
+
+	StartThreads();
+
 	return true;
 }
 
+void CsoFileReader::StartThreads() {
+	m_quit = false;
+
+	for (uint i = 0; i < CSO_WORKER_THREADS; ++i) {
+		FILE* src = PX_fopen_rb(m_filename);
+		z_stream* z = src ? CreateZStream() : NULL;
+		if (!z) {
+			if (src) {
+				fclose(src);
+			}
+			Console.Warning("CSO: Unable to start worker thread %u, decompressing on fewer threads.", i);
+			break;
+		}
+
+		// Same size as our own read buffer, a frame plus alignment.
+		const u32 readBufferSize = std::max<u32>(CSO_READ_BUFFER_SIZE, m_frameSize + (1 << m_indexShift));
+		m_threads[m_numThreads] = new CsoFrameThread(*this, src, z, readBufferSize, i);
+		m_threads[m_numThreads]->Start();
+		m_numThreads++;
+	}
+}
+
+void CsoFileReader::StopThreads() {
+	if (m_numThreads == 0) {
+		return;
+	}
+
+	{
+		Threading::ScopedLock lock(m_queueLock);
+		m_quit = true;
+		m_queue.clear();
+	}
+	m_queueEvent.Post(m_numThreads);
+
+	for (uint i = 0; i < m_numThreads; ++i) {
+		delete m_threads[i];
+		m_threads[i] = NULL;
+	}
+	m_numThreads = 0;
+}
+
+// Called by the workers, blocks until a frame is queued.  Returns false when the reader closes.
+bool CsoFileReader::PopFrame(u32& frame) {
+	for (;;) {
+		m_queueEvent.WaitWithoutYield();
+
+		Threading::ScopedLock lock(m_queueLock);
+		if (m_quit) {
+			return false;
+		}
+		if (!m_queue.empty()) {
+			frame = m_queue.front();
+			m_queue.pop_front();
+			return true;
+		}
+	}
+}
+
 void CsoFileReader::Close() {
+	PrintStats();
+	StopThreads();
+
 	m_filename.Empty();
-#if CSO_USE_CHUNKSCACHE
+	m_cache.LogStats("CSO cache");
 	m_cache.Clear();
-#endif
-
 	if (m_src) {
 		fclose(m_src);
 		m_src = NULL;
 	}
 	if (m_z_stream) {
-		inflateEnd(m_z_stream);
+		DestroyZStream(m_z_stream);
 		m_z_stream = NULL;
 	}
 
@@ -173,14 +314,46 @@ void CsoFileReader::Close() {
 		delete[] m_readBuffer;
 		m_readBuffer = NULL;
 	}
-	if (m_zlibBuffer) {
-		delete[] m_zlibBuffer;
-		m_zlibBuffer = NULL;
-	}
 	if (m_index) {
 		delete[] m_index;
 		m_index = NULL;
 	}
+	if (m_slots) {
+		delete[] m_slots;
+		m_slots = NULL;
+	}
+	if (m_slotBuffer) {
+		delete[] m_slotBuffer;
+		m_slotBuffer = NULL;
+	}
+
+	m_readBytes = 0;
+	m_sequential = 0;
+}
+
+void CsoFileReader::SetDataOffset(int bytes) {
+	if (bytes != m_dataoffset) {
+		// The frames were read from the old offset.
+		FlushFrames();
+	}
+	m_dataoffset = bytes;
+}
+
+void CsoFileReader::ResetStats() {
+	memzero(m_stats);
+}
+
+void CsoFileReader::PrintStats() {
+	if (m_stats.reads == 0) {
+		return;
+	}
+
+	const double hits = m_stats.hits + m_stats.waits;
+	DevCon.WriteLn("CSO: %u frame reads, %.1f%% cached (%.1f%% still inflating), %u read ahead (%.1f%% used), %u threads",
+		m_stats.reads, hits * 100 / m_stats.reads, m_stats.waits * 100.0 / m_stats.reads,
+		m_stats.readAhead, m_stats.readAhead ? m_stats.readAheadUsed * 100.0 / m_stats.readAhead : 0.0, m_numThreads);
+
+	ResetStats();
 }
 
 int CsoFileReader::ReadSync(void* pBuffer, uint sector, uint count) {
@@ -191,54 +364,53 @@ int CsoFileReader::ReadSync(void* pBuffer, uint sector, uint count) {
 	// Note that, in practice, count will always be 1.  It seems one sector is read
 	// per interrupt, even if multiple are requested by the application.
 
-	u8* dest = (u8*)pBuffer;
 	// We do it this way in case m_blocksize is not well aligned to our frame size.
-	u64 pos = (u64)sector * (u64)m_blocksize;
-	int remaining = count * m_blocksize;
+	const u64 pos = (u64)sector * (u64)m_blocksize;
+	const int bytes = count * m_blocksize;
+
+	RequestFrames(pos, bytes);
+	ReadAhead(sector, count);
+	return CopyFrames((u8*)pBuffer, pos, bytes);
+}
+
+void CsoFileReader::RequestFrames(u64 pos, int bytes) {
+	const u64 end = std::min<u64>(pos + bytes, m_totalSize);
+	for (u64 framePos = pos & ~(u64)(m_frameSize - 1); framePos < end; framePos += m_frameSize) {
+		RequestFrame((u32)(framePos >> m_frameShift), false);
+	}
+}
+
+// Copies the frames once they are inflated, stops short at EOF or on a bad frame.
+int CsoFileReader::CopyFrames(u8* dest, u64 pos, int remaining) {
 	int bytes = 0;
 
-	while (remaining > 0) {
-		int readBytes;
+	while (remaining > 0 && pos < m_totalSize) {
+		const u32 frame = (u32)(pos >> m_frameShift);
+		const u32 offset = (u32)(pos - ((u64)frame << m_frameShift));
 
-#if CSO_USE_CHUNKSCACHE
-		// Try first to read from the cache.
-		readBytes = m_cache.Read(dest + bytes, pos + bytes, remaining);
-#else
-		readBytes = -1;
-#endif
-		if (readBytes < 0) {
-			readBytes = ReadFromFrame(dest + bytes, pos + bytes, remaining);
-			if (readBytes == 0) {
-				// We hit EOF.
-				break;
-			}
+		FrameSlot* slot = WaitFrame(frame);
+		if (!slot || offset >= slot->bytes) {
+			break;
+		}
 
-#if CSO_USE_CHUNKSCACHE
-			// Add the bytes into the cache.  We need to allocate a buffer for it.
-			void *cached = malloc(readBytes);
-			memcpy(cached, dest + bytes, readBytes);
-			m_cache.Take(cached, pos + bytes, readBytes, readBytes);
-#endif
+		if (!slot->cached) {
+			m_cache.Take(slot->data, (u64)frame << m_frameShift, slot->bytes, slot->bytes);
+			slot->cached = true;
 		}
 
+		// This is how many bytes we will actually be reading from this frame.
+		const u32 readBytes = std::min((u32)remaining, slot->bytes - offset);
+		memcpy(dest + bytes, slot->data + offset, readBytes);
+
 		bytes += readBytes;
 		remaining -= readBytes;
+		pos += readBytes;
 	}
 
 	return bytes;
 }
 
-int CsoFileReader::ReadFromFrame(u8 *dest, u64 pos, int maxBytes) {
-	if (pos >= m_totalSize) {
-		// Can't read anything passed the end.
-		return 0;
-	}
-
-	const u32 frame = (u32)(pos >> m_frameShift);
-	const u32 offset = (u32)(pos - (frame << m_frameShift));
-	// This is how many bytes we will actually be reading from this frame.
-	const u32 bytes = (u32)(std::min(m_blocksize, static_cast<uint>(m_frameSize - offset)));
-
+bool CsoFileReader::LoadFrame(FILE* src, z_stream* z, u8* readBuffer, u32 frame, FrameSlot& slot) {
 	// Grab the index data for the frame we're about to read.
 	const bool compressed = (m_index[frame + 0] & 0x80000000) == 0;
 	const u32 index0 = m_index[frame + 0] & 0x7FFFFFFF;
@@ -248,66 +420,210 @@ int CsoFileReader::ReadFromFrame(u8 *dest, u64 pos, int maxBytes) {
 	const u64 frameRawPos = (u64)index0 << m_indexShift;
 	const u64 frameRawSize = (u64)(index1 - index0) << m_indexShift;
 
+	slot.bytes = 0;
+
+	if (PX_fseeko(src, m_dataoffset + frameRawPos, SEEK_SET) != 0) {
+		Console.Error("Unable to seek to CSO data.");
+		return false;
+	}
+
 	if (!compressed) {
-		// Just read directly, easy.
-		if (PX_fseeko(m_src, m_dataoffset + frameRawPos + offset, SEEK_SET) != 0) {
-			Console.Error("Unable to seek to uncompressed CSO data.");
-			return 0;
-		}
-		return fread(dest, 1, bytes, m_src);
+		// Just read directly, easy.  The last frame may be short.
+		const u32 frameBytes = (u32)std::min<u64>(m_frameSize, m_totalSize - ((u64)frame << m_frameShift));
+		slot.bytes = fread(slot.data, 1, frameBytes, src);
+		return slot.bytes > 0;
+	}
+
+	// This might be less bytes than frameRawSize in case of padding on the last frame.
+	// This is because the index positions must be aligned.
+	const u32 readRawBytes = fread(readBuffer, 1, frameRawSize, src);
+
+	z->next_in = readBuffer;
+	z->avail_in = readRawBytes;
+	z->next_out = slot.data;
+	z->avail_out = m_frameSize;
+
+	int status = inflate(z, Z_FINISH);
+	bool success = status == Z_STREAM_END && z->total_out == m_frameSize;
+	if (success) {
+		slot.bytes = m_frameSize;
 	} else {
-		// We don't need to decompress if we already did this same frame last time.
-		if (m_zlibBufferFrame != frame) {
-			if (PX_fseeko(m_src, m_dataoffset + frameRawPos, SEEK_SET) != 0) {
-				Console.Error("Unable to seek to compressed CSO data.");
-				return 0;
+		Console.Error("Unable to decompress CSO frame using zlib.");
+	}
+
+	inflateReset(z);
+	return success;
+}
+
+// Returns the slot of the frame, queuing it for decompression if it is not cached.  Read ahead
+// requests give up instead of waiting when the slot is still busy with another frame.
+CsoFileReader::FrameSlot* CsoFileReader::RequestFrame(u32 frame, bool readAhead) {
+	FrameSlot& slot = m_slots[frame & m_slotMask];
+	int state = slot.state.load(std::memory_order_acquire);
+
+	if (slot.frame.load(std::memory_order_relaxed) == frame && (state == FRAME_READY || state == FRAME_QUEUED)) {
+		if (!readAhead) {
+			m_stats.reads++;
+			if (state == FRAME_READY) {
+				m_stats.hits++;
+			} else {
+				m_stats.waits++;
 			}
-			// This might be less bytes than frameRawSize in case of padding on the last frame.
-			// This is because the index positions must be aligned.
-			const u32 readRawBytes = fread(m_readBuffer, 1, frameRawSize, m_src);
-			if (!DecompressFrame(frame, readRawBytes)) {
-				return 0;
+			if (slot.readAhead) {
+				m_stats.readAheadUsed++;
+				slot.readAhead = false;
 			}
 		}
+		return &slot;
+	}
 
-		// Now we just copy the offset data from the cache.
-		memcpy(dest, m_zlibBuffer + offset, bytes);
+	if (state == FRAME_QUEUED) {
+		if (readAhead) {
+			return NULL;
+		}
+		WaitQueued(slot);
 	}
 
-	return bytes;
+	if (readAhead) {
+		m_stats.readAhead++;
+	} else {
+		m_stats.reads++;
+		m_stats.misses++;
+	}
+
+	slot.frame.store(frame, std::memory_order_relaxed);
+	slot.readAhead = readAhead;
+	slot.cached = false;
+
+	// Inflated before and still in the chunks cache.
+	const int cachedBytes = m_cache.ReadChunk(slot.data, (u64)frame << m_frameShift);
+	if (cachedBytes > 0) {
+		slot.bytes = cachedBytes;
+		slot.cached = true;
+		slot.state.store(FRAME_READY, std::memory_order_release);
+		return &slot;
+	}
+
+	if (m_numThreads == 0) {
+		const bool success = LoadFrame(m_src, m_z_stream, m_readBuffer, frame, slot);
+		slot.state.store(success ? FRAME_READY : FRAME_FAILED, std::memory_order_release);
+		return &slot;
+	}
+
+	slot.state.store(FRAME_QUEUED, std::memory_order_release);
+	{
+		Threading::ScopedLock lock(m_queueLock);
+		if (readAhead) {
+			m_queue.push_back(frame);
+		} else {
+			m_queue.push_front(frame);
+		}
+	}
+	m_queueEvent.Post();
+
+	return &slot;
 }
 
-bool CsoFileReader::DecompressFrame(u32 frame, u32 readBufferSize) {
-	m_z_stream->next_in = m_readBuffer;
-	m_z_stream->avail_in = readBufferSize;
-	m_z_stream->next_out = m_zlibBuffer;
-	m_z_stream->avail_out = m_frameSize;
+void CsoFileReader::WaitQueued(FrameSlot& slot) {
+	while (slot.state.load(std::memory_order_acquire) == FRAME_QUEUED) {
+		m_frameDone.WaitWithoutYield();
+	}
+}
 
-	int status = inflate(m_z_stream, Z_FINISH);
-	bool success = status == Z_STREAM_END && m_z_stream->total_out == m_frameSize;
-	if (success) {
-		// Our buffer now contains this frame.
-		m_zlibBufferFrame = frame;
+// The frame was normally requested already, it is only requested again if read ahead reused its slot.
+CsoFileReader::FrameSlot* CsoFileReader::WaitFrame(u32 frame) {
+	FrameSlot* slot = &m_slots[frame & m_slotMask];
+	const int state = slot->state.load(std::memory_order_acquire);
+	if (slot->frame.load(std::memory_order_relaxed) != frame || (state != FRAME_READY && state != FRAME_QUEUED)) {
+		slot = RequestFrame(frame, false);
+	}
+	WaitQueued(*slot);
+
+	if (slot->state.load(std::memory_order_acquire) != FRAME_READY) {
+		return NULL;
+	}
+	return slot;
+}
+
+void CsoFileReader::FlushFrames() {
+	if (!m_slots) {
+		return;
+	}
+
+	// Frames still in the queue are not owned by any worker, the others finish on their own.
+	{
+		Threading::ScopedLock lock(m_queueLock);
+		for (auto it = m_queue.begin(); it != m_queue.end(); ++it) {
+			m_slots[*it & m_slotMask].state.store(FRAME_EMPTY, std::memory_order_relaxed);
+		}
+		m_queue.clear();
+	}
+
+	for (u32 i = 0; i <= m_slotMask; ++i) {
+		WaitQueued(m_slots[i]);
+		m_slots[i].state.store(FRAME_EMPTY, std::memory_order_relaxed);
+		m_slots[i].readAhead = false;
+	}
+
+	m_cache.Clear();
+}
+
+// Queues the frames following a sequential read, so they are inflated before the game asks.
+void CsoFileReader::ReadAhead(uint sector, uint count) {
+	if (sector == m_lastSector) {
+		m_sequential++;
 	} else {
-		Console.Error("Unable to decompress CSO frame using zlib.");
-		m_zlibBufferFrame = (u32)-1;
+		m_sequential = 0;
 	}
+	m_lastSector = sector + count;
 
-	inflateReset(m_z_stream);
-	return success;
+	if (m_numThreads == 0 || m_sequential < 2) {
+		return;
+	}
+
+	const u64 start = (u64)(sector + count) * m_blocksize;
+	const u64 end = std::min<u64>(start + CSO_READ_AHEAD_KB * 1024, m_totalSize);
+	if (start >= end) {
+		return;
+	}
+
+	const u32 first = (u32)(start >> m_frameShift);
+	const u32 last = std::min((u32)((end - 1) >> m_frameShift), first + m_slotMask / 2);
+	for (u32 frame = first; frame <= last; ++frame) {
+		RequestFrame(frame, true);
+	}
 }
 
 void CsoFileReader::BeginRead(void* pBuffer, uint sector, uint count) {
-	// TODO: No async support yet, implement as sync.
-	m_bytesRead = ReadSync(pBuffer, sector, count);
+	if (!m_src) {
+		m_readBytes = 0;
+		m_bytesRead = 0;
+		return;
+	}
+
+	// Queue the frames of this read now, they are waited for in FinishRead().
+	m_readDest = (u8*)pBuffer;
+	m_readPos = (u64)sector * (u64)m_blocksize;
+	m_readBytes = count * m_blocksize;
+	m_bytesRead = -1;
+
+	RequestFrames(m_readPos, m_readBytes);
+	ReadAhead(sector, count);
 }
 
 int CsoFileReader::FinishRead() {
+	if (m_readBytes > 0) {
+		m_bytesRead = CopyFrames(m_readDest, m_readPos, m_readBytes);
+		m_readBytes = 0;
+	}
+
 	int res = m_bytesRead;
 	m_bytesRead = -1;
 	return res;
 }
 
 void CsoFileReader::CancelRead() {
-	// TODO: No async read support yet.
+	// The queued frames stay in the cache, only forget about the destination.
+	m_readBytes = 0;
+	m_bytesRead = -1;
 }
@@ -15,43 +15,58 @@
 
 #pragma once
 
-// Based on testing, the overhead of using this cache is high.
-//
-// The test was done with CSO files using a block size of 16KB.
-// Cache hit rates were observed in the range of 25%.
-// Cache overhead added 35% to the overall read time.
-//
-// For this reason, it's currently disabled.
-#define CSO_USE_CHUNKSCACHE 0
-
 #include "AsyncFileReader.h"
 #include "ChunksCache.h"
+#include "Utilities/PersistentThread.h"
+#include <atomic>
+#include <deque>
 
 struct CsoHeader;
 typedef struct z_stream_s z_stream;
 
-static const uint CSO_CHUNKCACHE_SIZE_MB = 200;
+// Frames are inflated by a small pool of worker threads into a direct mapped frame cache, so the
+// EE thread only waits in FinishRead for frames that are not ready yet.  While the game reads
+// sectors sequentially, the frames following the current one are decompressed ahead of time.
+// With no worker threads, frames are decompressed synchronously as before.
+//
+// Frames which were read are also kept in a larger ChunksCache, so going back to them costs a
+// copy instead of another inflate.
+static const uint CSO_WORKER_THREADS = 2;
+static const uint CSO_FRAMECACHE_SIZE_KB = 4096;
+static const uint CSO_READ_AHEAD_KB = 256;
+static const uint CSO_CHUNKCACHE_SIZE_MB = 64;
+
+class CsoFrameThread;
 
 class CsoFileReader : public AsyncFileReader
 {
 	DeclareNoncopyableObject(CsoFileReader);
+	friend class CsoFrameThread;
 public:
 	CsoFileReader(void) :
 		m_frameSize(0),
 		m_frameShift(0),
 		m_indexShift(0),
 		m_readBuffer(0),
-		m_zlibBuffer(0),
-		m_zlibBufferFrame(0),
 		m_index(0),
 		m_totalSize(0),
 		m_src(0),
 		m_z_stream(0),
-#if CSO_USE_CHUNKSCACHE
-		m_cache(CSO_CHUNKCACHE_SIZE_MB),
-#endif
+		m_cache(CSO_CHUNKCACHE_SIZE_MB, 2048),
+		m_slots(0),
+		m_slotMask(0),
+		m_slotBuffer(0),
+		m_numThreads(0),
+		m_quit(false),
+		m_lastSector(0),
+		m_sequential(0),
+		m_readDest(0),
+		m_readPos(0),
+		m_readBytes(0),
 		m_bytesRead(0) {
 		m_blocksize = 2048;
+		memzero(m_threads);
+		ResetStats();
 	};
 
 	virtual ~CsoFileReader(void) { Close(); };
@@ -72,30 +87,88 @@ public:
 	};
 
 	virtual void SetBlockSize(uint bytes) { m_blocksize = bytes; }
-	virtual void SetDataOffset(int bytes) { m_dataoffset = bytes; }
+	virtual void SetDataOffset(int bytes);
 
 private:
+	enum FrameState {
+		FRAME_EMPTY,
+		FRAME_QUEUED,
+		FRAME_READY,
+		FRAME_FAILED,
+	};
+
+	// A decompressed frame.  Only the EE thread assigns a slot to a frame, and only while no
+	// worker is filling it, so a ready slot can be read without taking any lock.
+	struct FrameSlot {
+		std::atomic<u32> frame;
+		std::atomic<int> state;
+		u32 bytes;
+		bool readAhead;
+		bool cached;
+		u8* data;
+	};
+
 	static bool ValidateHeader(const CsoHeader& hdr);
 	bool ReadFileHeader();
 	bool InitializeBuffers();
-	int ReadFromFrame(u8 *dest, u64 pos, int maxBytes);
-	bool DecompressFrame(u32 frame, u32 readBufferSize);
+	bool LoadFrame(FILE* src, z_stream* z, u8* readBuffer, u32 frame, FrameSlot& slot);
+	void RequestFrames(u64 pos, int bytes);
+	int CopyFrames(u8* dest, u64 pos, int bytes);
+
+	void StartThreads();
+	void StopThreads();
+	FrameSlot* RequestFrame(u32 frame, bool readAhead);
+	FrameSlot* WaitFrame(u32 frame);
+	void WaitQueued(FrameSlot& slot);
+	void FlushFrames();
+	void ReadAhead(uint sector, uint count);
+	bool PopFrame(u32& frame);
+
+	void ResetStats();
+	void PrintStats();
 
 	u32 m_frameSize;
 	u8 m_frameShift;
 	u8 m_indexShift;
 	u8* m_readBuffer;
-	u8 *m_zlibBuffer;
-	u32 m_zlibBufferFrame;
 	u32 *m_index;
 	u64 m_totalSize;
 	// The actual source cso file handle.
 	FILE* m_src;
 	z_stream* m_z_stream;
 
-#if CSO_USE_CHUNKSCACHE
+	// Only used by the EE thread.
 	ChunksCache m_cache;
-#endif
+
+	FrameSlot* m_slots;
+	u32 m_slotMask;
+	u8* m_slotBuffer;
+
+	// Frames waiting for a worker, demand reads are queued in front of read ahead.
+	CsoFrameThread* m_threads[CSO_WORKER_THREADS ? CSO_WORKER_THREADS : 1];
+	uint m_numThreads;
+	std::deque<u32> m_queue;
+	Threading::Mutex m_queueLock;
+	Threading::Semaphore m_queueEvent;
+	Threading::Semaphore m_frameDone;
+	bool m_quit;
+
+	uint m_lastSector;
+	uint m_sequential;
+
+	// The read started by BeginRead(), completed by FinishRead().
+	u8* m_readDest;
+	u64 m_readPos;
+	int m_readBytes;
+
+	struct {
+		u32 reads;
+		u32 hits;
+		u32 waits;
+		u32 misses;
+		u32 readAhead;
+		u32 readAheadUsed;
+	} m_stats;
 
 	// The result of a read is stored here between BeginRead() and FinishRead().
 	int m_bytesRead;
@@ -22,6 +22,12 @@
 #include "GzippedFileReader.h"
 #include "zlib_indexed.h"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define CLAMP(val, minval, maxval) (std::min(maxval, std::max(minval, val)))
 
 static s64 fsize(const wxString& filename) {
@@ -42,61 +48,107 @@ static s64 fsize(const wxString& filename) {
 // File format is:
 // - [GZIP_ID_LEN] GZIP_ID (no \0)
 // - [sizeof(Access)] index (should be allocated, contains various sizes)
-// - [rest] the indexed data points (should be allocated, index->list should then point to it)
-static Access* ReadIndexFromFile(const wxString& filename) {
+// - [rest] the indexed data points (mapped read only, index->list then points into the mapping)
+bool GzippedFileReader::MapIndex(const wxString& filename) {
 	s64 size = fsize(filename);
 	if (size <= 0) {
 		Console.Error(L"Error: Can't open index file: '%s'", WX_STR(filename));
-		return 0;
+		return false;
+	}
+
+	u8* map = NULL;
+#ifdef _WIN32
+	HANDLE hFile = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+	if (hFile != INVALID_HANDLE_VALUE) {
+		m_indexMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(hFile);
+		if (m_indexMapping)
+			map = (u8*)MapViewOfFile(m_indexMapping, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	int fd = open(PX_wfilename(filename), O_RDONLY);
+	if (fd >= 0) {
+		void* p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (p != MAP_FAILED)
+			map = (u8*)p;
+	}
+#endif
+	if (!map) {
+		Console.Error(L"Error: Can't map index file: '%s'", WX_STR(filename));
+		UnmapIndex();
+		return false;
 	}
-	std::ifstream infile(PX_wfilename(filename), std::ifstream::binary);
+	m_indexMap = map;
+	m_indexMapSize = size;
 
-	char fileId[GZIP_ID_LEN + 1] = { 0 };
-	infile.read(fileId, GZIP_ID_LEN);
-	if (wxString::From8BitData(GZIP_ID) != wxString::From8BitData(fileId)) {
+	if (size < (s64)(GZIP_ID_LEN + sizeof(Access)) || memcmp(map, GZIP_ID, GZIP_ID_LEN)) {
 		Console.Error(L"Error: Incompatible gzip index, please delete it manually: '%s'", WX_STR(filename));
-		infile.close();
-		return 0;
+		UnmapIndex();
+		return false;
 	}
 
 	Access* index = (Access*)malloc(sizeof(Access));
-	infile.read((char*)index, sizeof(Access));
+	memcpy(index, map + GZIP_ID_LEN, sizeof(Access));
 
 	s64 datasize = size - GZIP_ID_LEN - sizeof(Access);
 	if (datasize != (s64)index->have * sizeof(Point)) {
 		Console.Error(L"Error: unexpected size of gzip index, please delete it manually: '%s'.", WX_STR(filename));
-		infile.close();
 		free(index);
-		return 0;
+		UnmapIndex();
+		return false;
 	}
 
-	char* buffer = (char*)malloc(datasize);
-	infile.read(buffer, datasize);
-	infile.close();
-	index->list = (Point*)buffer; // adjust list pointer
-	return index;
+	index->list = (Point*)(map + GZIP_ID_LEN + sizeof(Access)); // adjust list pointer
+	m_pIndex = index;
+	return true;
+}
+
+void GzippedFileReader::UnmapIndex() {
+	if (m_indexMap) {
+#ifdef _WIN32
+		UnmapViewOfFile(m_indexMap);
+#else
+		munmap(m_indexMap, m_indexMapSize);
+#endif
+		m_indexMap = NULL;
+		m_indexMapSize = 0;
+	}
+#ifdef _WIN32
+	if (m_indexMapping) {
+		CloseHandle(m_indexMapping);
+		m_indexMapping = NULL;
+	}
+#endif
 }
 
+// The index is written under a temporary name and renamed once verified, so that an interrupted
+// write never leaves a truncated index which would be picked up on the next boot.
 static void WriteIndexToFile(Access* index, const wxString filename) {
 	if (wxFileName::FileExists(filename)) {
 		Console.Warning(L"WARNING: Won't write index - file name exists (please delete it manually): '%s'", WX_STR(filename));
 		return;
 	}
 
-	std::ofstream outfile(PX_wfilename(filename), std::ofstream::binary);
-	outfile.write(GZIP_ID, GZIP_ID_LEN);
+	wxString tmpname = filename + L".tmp";
+	{
+		std::ofstream outfile(PX_wfilename(tmpname), std::ofstream::binary);
+		outfile.write(GZIP_ID, GZIP_ID_LEN);
 
-	Point* tmp = index->list;
-	index->list = 0; // current pointer is useless on disk, normalize it as 0.
-	outfile.write((char*)index, sizeof(Access));
-	index->list = tmp;
+		Access header = *index;
+		header.list = 0; // current pointer is useless on disk, normalize it as 0.
+		outfile.write((char*)&header, sizeof(Access));
 
-	outfile.write((char*)index->list, sizeof(Point) * index->have);
-	outfile.close();
+		outfile.write((char*)index->list, sizeof(Point) * index->have);
+		outfile.close();
+	}
 
 	// Verify
-	if (fsize(filename) != (s64)GZIP_ID_LEN + sizeof(Access) + sizeof(Point) * index->have) {
+	if (fsize(tmpname) != (s64)GZIP_ID_LEN + sizeof(Access) + sizeof(Point) * index->have
+	    || !wxRenameFile(tmpname, filename, false)) {
 		Console.Warning(L"Warning: Can't write index file to disk: '%s'", WX_STR(filename));
+		if (wxFileName::FileExists(tmpname))
+			wxRemoveFile(tmpname);
 	} else {
 		Console.WriteLn(Color_Green, L"OK: Gzip quick access index file saved to disk: '%s'", WX_STR(filename));
 	}
@@ -177,27 +229,107 @@ static wxString iso2indexname(const wxString& isoname) {
 	return ApplyTemplate(L"gzip index", appRoot, g_Conf->GzipIsoIndexTemplate, isoname, false);
 }
 
+// Builds the index of an image which has none on disk, publishing the access points as it goes.
+class GzipIndexThread : public Threading::pxThread
+{
+	GzippedFileReader& m_reader;
+
+public:
+	GzipIndexThread(GzippedFileReader& reader)
+		: m_reader(reader)
+	{
+		m_name = L"Gzip Indexer";
+	}
+
+	virtual ~GzipIndexThread() throw()
+	{
+		try {
+			if (m_running)
+				Block();
+		}
+		DESTRUCTOR_CATCHALL
+	}
+
+protected:
+	void ExecuteTaskInThread()
+	{
+		m_reader.BuildIndex();
+	}
+};
+
+// Extracts queued chunks into the cache, with its own file handle.
+class GzipExtractThread : public Threading::pxThread
+{
+	GzippedFileReader& m_reader;
+	FILE* m_src;
+	Point* m_point;
+
+public:
+	GzipExtractThread(GzippedFileReader& reader, FILE* src, int id)
+		: m_reader(reader)
+		, m_src(src)
+		, m_point((Point*)malloc(sizeof(Point)))
+	{
+		m_name = wxsFormat(L"Gzip Worker %d", id);
+	}
+
+	virtual ~GzipExtractThread() throw()
+	{
+		try {
+			if (m_running)
+				Block();
+		}
+		DESTRUCTOR_CATCHALL
+		fclose(m_src);
+		free(m_point);
+	}
+
+protected:
+	void ExecuteTaskInThread()
+	{
+		PX_off_t chunkOffset;
+		while (m_reader.PopChunk(chunkOffset))
+			m_reader.ExtractChunk(m_src, m_point, chunkOffset, false);
+	}
+};
+
 GzippedFileReader::GzippedFileReader(void) :
-	mBytesRead(0),
+	m_readBuffer(0),
+	m_readSector(0),
+	m_readCount(0),
 	m_pIndex(0),
 	m_zstates(0),
+	m_zstatesCount(0),
 	m_src(0),
-	m_cache(GZFILE_CACHE_SIZE_MB) {
+	m_point(0),
+	m_cache(GZFILE_CACHE_SIZE_MB, GZFILE_READ_CHUNK_SIZE),
+	m_indexMap(0),
+	m_indexMapSize(0),
+#ifdef _WIN32
+	m_indexMapping(0),
+#endif
+	m_indexThread(0),
+	m_estimatedSize(0),
+	m_indexFailed(false),
+	m_numWorkers(0),
+	m_quit(false) {
 	m_blocksize = 2048;
 	AsyncPrefetchReset();
 };
 
-void GzippedFileReader::InitZstates() {
+void GzippedFileReader::InitZstates(PX_off_t size) {
 	if (m_zstates) {
 		delete[] m_zstates;
 		m_zstates = 0;
 	}
-	if (!m_pIndex)
+	m_zstatesCount = 0;
+	if (size <= 0)
 		return;
 
 	// having another extra element helps avoiding logic for last (so 2+ instead of 1+)
-	int size = 2 + m_pIndex->uncompressed_size / m_pIndex->span;
-	m_zstates = new Czstate[size]();
+	int span = m_pIndex ? m_pIndex->span : GZFILE_SPAN_DEFAULT;
+	m_zstatesCount = 2 + size / span;
+	m_zstates = new Czstate[m_zstatesCount]();
 }
 
 #ifndef _WIN32
@@ -286,68 +418,224 @@ bool GzippedFileReader::OkIndex() {
 	if (m_pIndex)
 		return true;
 
+	if (m_indexThread) {
+		Threading::ScopedLock lock(m_lock);
+		return m_pIndex || !m_indexFailed;
+	}
+
 	// Try to read index from disk
-	wxString indexfile = iso2indexname(m_filename);
-	if (indexfile.length() == 0)
+	m_indexFile = iso2indexname(m_filename);
+	if (m_indexFile.length() == 0)
 		return false; // iso2indexname(...) will print errors if it can't apply the template
 
-	if (wxFileName::FileExists(indexfile) && (m_pIndex = ReadIndexFromFile(indexfile))) {
-		Console.WriteLn(Color_Green, L"OK: Gzip quick access index read from disk: '%s'", WX_STR(indexfile));
+	if (wxFileName::FileExists(m_indexFile) && MapIndex(m_indexFile)) {
+		Console.WriteLn(Color_Green, L"OK: Gzip quick access index read from disk: '%s'", WX_STR(m_indexFile));
 		if (m_pIndex->span != GZFILE_SPAN_DEFAULT) {
 			Console.Warning(L"Note: This index has %1.1f MB intervals, while the current default for new indexes is %1.1f MB.",
 			                (float)m_pIndex->span / 1024 / 1024, (float)GZFILE_SPAN_DEFAULT / 1024 / 1024);
 			Console.Warning(L"It will work fine, but if you want to generate a new index with default intervals, delete this index file.");
 			Console.Warning(L"(smaller intervals mean bigger index file and quicker but more frequent decompressions)");
 		}
-		InitZstates();
+		InitZstates(m_pIndex->uncompressed_size);
 		return true;
 	}
 
-	// No valid index file. Generate an index
-	Console.Warning(L"This may take a while (but only once). Scanning compressed file to generate a quick access index...");
+	// No valid index file. Generate it in the background, the image is usable meanwhile.
+	Console.Warning(L"Scanning compressed file to generate a quick access index (only once), in the background...");
+	StartIndexBuild();
+
+	Threading::ScopedLock lock(m_lock);
+	return m_pIndex || !m_indexFailed;
+}
 
-	Access *index;
+void GzippedFileReader::StartIndexBuild() {
+	m_indexFailed = false;
+	m_indexThread = new GzipIndexThread(*this);
+	m_indexThread->Start();
+
+	// The first access point comes right after the gzip header, reads can start from there.
+	for (;;) {
+		{
+			Threading::ScopedLock lock(m_lock);
+			if (m_pIndex || m_indexFailed || !m_points.empty())
+				break;
+		}
+		Threading::Sleep(1);
+	}
+
+	PX_off_t estimate = EstimateSize();
+	Threading::ScopedLock lock(m_lock);
+	m_estimatedSize = estimate;
+	InitZstates(m_pIndex ? m_pIndex->uncompressed_size : m_estimatedSize);
+}
+
+// Index thread.  m_pIndex is immutable once published, everything else goes through m_points.
+void GzippedFileReader::BuildIndex() {
+	Access* index = 0;
 	FILE* infile = PX_fopen_rb(m_filename);
-	int len = build_index(infile, GZFILE_SPAN_DEFAULT, &index);
+	int len = infile ? build_index(infile, GZFILE_SPAN_DEFAULT, &index, OnIndexProgress, this) : Z_ERRNO;
 	printf("\n"); // build_index prints progress without \n's
-	fclose(infile);
+	if (infile)
+		fclose(infile);
+
+	Threading::ScopedLock lock(m_lock);
+	if (len <= 0 || m_quit) {
+		if (len > 0)
+			free_index(index);
+		else if (!m_quit)
+			Console.Error(L"ERROR (%d): index could not be generated for file '%s'", len, WX_STR(m_filename));
+		m_indexFailed = true;
+		return;
+	}
 
-	if (len >= 0) {
-		m_pIndex = index;
-		WriteIndexToFile((Access*)m_pIndex, indexfile);
-	} else {
-		Console.Error(L"ERROR (%d): index could not be generated for file '%s'", len, WX_STR(m_filename));
-		free_index(index);
-		InitZstates();
-		return false;
+	m_pIndex = index;
+	for (size_t i = 0; i < m_points.size(); i++)
+		free(m_points[i]);
+	m_points.clear();
+	lock.Release();
+
+	WriteIndexToFile(index, m_indexFile);
+}
+
+int GzippedFileReader::OnIndexProgress(void* ctx, Point* added, PX_off_t out) {
+	GzippedFileReader* reader = (GzippedFileReader*)ctx;
+	Point* copy = 0;
+	if (added) {
+		copy = (Point*)malloc(sizeof(Point));
+		memcpy(copy, added, sizeof(Point));
 	}
 
-	InitZstates();
-	return true;
+	Threading::ScopedLock lock(reader->m_lock);
+	if (copy)
+		reader->m_points.push_back(copy);
+	return reader->m_quit; // cancels the build
+}
+
+// Until the index is complete the uncompressed size is unknown.  The gzip trailer has it modulo
+// 4GB, and the volume size of the ISO9660 primary volume descriptor tells how many times it wrapped.
+PX_off_t GzippedFileReader::EstimateSize() {
+	s64 compressed = fsize(m_filename);
+	u32 isize = 0;
+	if (compressed >= 4 && PX_fseeko(m_src, compressed - 4, SEEK_SET) == 0) {
+		u8 trailer[4] = { 0 };
+		if (fread(trailer, 1, 4, m_src) == 4)
+			isize = trailer[0] | trailer[1] << 8 | trailer[2] << 16 | (u32)trailer[3] << 24;
+	}
+
+	// descriptor at sector 16 of 2048 bytes images, and of raw 2352 bytes mode 1 / mode 2 images
+	static const struct { int sectorSize, headerSize; } formats[] = { {2048, 0}, {2352, 16}, {2352, 24} };
+	for (int i = 0; i < (int)ArraySize(formats); i++) {
+		u8 pvd[88];
+		PX_off_t offset = 16 * formats[i].sectorSize + formats[i].headerSize;
+		if (_ReadSync(pvd, offset, sizeof(pvd)) != sizeof(pvd) || pvd[0] != 1 || memcmp(pvd + 1, "CD001", 5))
+			continue;
+
+		PX_off_t volume = (PX_off_t)(pvd[80] | pvd[81] << 8 | pvd[82] << 16 | (u32)pvd[83] << 24) * formats[i].sectorSize;
+		PX_off_t wraps = (volume - isize + (1LL << 31)) >> 32;
+		return isize + (std::max(wraps, (PX_off_t)0) << 32);
+	}
+
+	// Not an ISO9660 image, at least assume the data isn't smaller than its compressed form.
+	PX_off_t estimate = isize;
+	while (estimate < compressed)
+		estimate += 1LL << 32;
+	return estimate;
 }
 
 bool GzippedFileReader::Open(const wxString& fileName) {
 	Close();
 	m_filename = fileName;
+	m_quit = false;
+	m_point = (Point*)malloc(sizeof(Point));
 	if (!(m_src = PX_fopen_rb(m_filename)) || !CanHandle(fileName) || !OkIndex()) {
 		Close();
 		return false;
 	};
 
 	AsyncPrefetchOpen();
+	StartThreads();
 	return true;
 };
 
+void GzippedFileReader::StartThreads() {
+	for (m_numWorkers = 0; m_numWorkers < GZFILE_WORKER_THREADS; m_numWorkers++) {
+		FILE* src = PX_fopen_rb(m_filename);
+		if (!src)
+			break;
+		m_workers[m_numWorkers] = new GzipExtractThread(*this, src, m_numWorkers);
+		m_workers[m_numWorkers]->Start();
+	}
+}
+
+void GzippedFileReader::StopThreads() {
+	{
+		Threading::ScopedLock lock(m_lock);
+		m_quit = true;
+		m_queue.clear();
+	}
+
+	if (m_numWorkers)
+		m_queueEvent.Post(m_numWorkers);
+	for (uint i = 0; i < m_numWorkers; i++)
+		delete m_workers[i];
+	m_numWorkers = 0;
+
+	// The progress callback sees m_quit and cancels the build.
+	if (m_indexThread) {
+		delete m_indexThread;
+		m_indexThread = 0;
+	}
+}
+
+// Demand reads go to the front of the queue, read-ahead to the back.
+void GzippedFileReader::QueueChunk(PX_off_t chunkOffset, bool front) {
+	if (!m_numWorkers)
+		return;
+
+	Threading::ScopedLock lock(m_lock);
+	PX_off_t size = m_pIndex ? m_pIndex->uncompressed_size : m_estimatedSize;
+	if (chunkOffset >= size || m_cache.Contains(chunkOffset) || m_inflight.count(chunkOffset))
+		return;
+	for (size_t i = 0; i < m_queue.size(); i++)
+		if (m_queue[i] == chunkOffset)
+			return;
+
+	if (front)
+		m_queue.push_front(chunkOffset);
+	else
+		m_queue.push_back(chunkOffset);
+	m_queueEvent.Post();
+}
+
+bool GzippedFileReader::PopChunk(PX_off_t& chunkOffset) {
+	for (;;) {
+		m_queueEvent.WaitWithoutYield();
+		Threading::ScopedLock lock(m_lock);
+		if (m_quit)
+			return false;
+		if (m_queue.empty())
+			continue;
+		chunkOffset = m_queue.front();
+		m_queue.pop_front();
+		return true;
+	}
+}
+
 void GzippedFileReader::BeginRead(void* pBuffer, uint sector, uint count) {
-	// No a-sync support yet, implement as sync
-	mBytesRead = ReadSync(pBuffer, sector, count);
-	return;
+	// The workers start on the chunks of this request while the EE thread keeps going,
+	// FinishRead() completes it from the cache or waits for the chunks in flight.
+	m_readBuffer = pBuffer;
+	m_readSector = sector;
+	m_readCount = count;
+
+	PX_off_t offset = (s64)sector * m_blocksize + m_dataoffset;
+	PX_off_t end = offset + (s64)count * m_blocksize;
+	for (PX_off_t chunk = offset / GZFILE_READ_CHUNK_SIZE * GZFILE_READ_CHUNK_SIZE; chunk < end; chunk += GZFILE_READ_CHUNK_SIZE)
+		QueueChunk(chunk, true);
 };
 
 int GzippedFileReader::FinishRead(void) {
-	int res = mBytesRead;
-	mBytesRead = -1;
-	return res;
+	return ReadSync(m_readBuffer, m_readSector, m_readCount);
 };
 
 #define PTT clock_t
@@ -359,16 +647,54 @@ int GzippedFileReader::ReadSync(void* pBuffer, uint sector, uint count) {
 	int res = _ReadSync(pBuffer, offset, bytesToRead);
 	if (res < 0)
 		Console.Error(L"Error: iso-gzip read unsuccessful.");
+	else // read-ahead
+		QueueChunk((offset + bytesToRead) / GZFILE_READ_CHUNK_SIZE * GZFILE_READ_CHUNK_SIZE + GZFILE_READ_CHUNK_SIZE, false);
 	return res;
 }
 
+uint GzippedFileReader::GetBlockCount() const {
+	// type and formula copied from FlatFileReader
+	// FIXME? : Shouldn't it be uint and (size - m_dataoffset) / m_blocksize ?
+	Threading::ScopedLock lock(m_lock);
+	return (int)((m_pIndex ? m_pIndex->uncompressed_size : m_estimatedSize) / m_blocksize);
+}
+
+// Called with m_lock held.  While the index is being built, the closest access point built so far
+// is copied into point, which is wrapped into tmp.  The index thread may free it once it's done.
+Access* GzippedFileReader::GetAccess(PX_off_t offset, Access& tmp, Point* point) {
+	if (m_pIndex)
+		return m_pIndex;
+	if (m_points.empty())
+		return 0;
+
+	size_t lo = 0, hi = m_points.size();
+	while (hi - lo > 1) {
+		size_t mid = (lo + hi) / 2;
+		if (m_points[mid]->out <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	memcpy(point, m_points[lo], sizeof(Point));
+
+	tmp.have = tmp.size = 1;
+	tmp.span = GZFILE_SPAN_DEFAULT;
+	tmp.uncompressed_size = m_estimatedSize;
+	tmp.list = point;
+	return &tmp;
+}
+
+// Called with m_lock held.
 // If we have a valid and adequate zstate for this span, use it, else, use the index
 PX_off_t GzippedFileReader::GetOptimalExtractionStart(PX_off_t offset) {
-	int span = m_pIndex->span;
-	Czstate& cstate = m_zstates[offset / span];
-	PX_off_t stateOffset = cstate.state.isValid ? cstate.state.out_offset : 0;
-	if (stateOffset && stateOffset <= offset)
-		return stateOffset; // state is faster than indexed
+	int span = m_pIndex ? m_pIndex->span : GZFILE_SPAN_DEFAULT;
+	int spanix = offset / span;
+	if (spanix < m_zstatesCount) {
+		Czstate& cstate = m_zstates[spanix];
+		PX_off_t stateOffset = cstate.state.isValid ? cstate.state.out_offset : 0;
+		if (stateOffset && stateOffset <= offset)
+			return stateOffset; // state is faster than indexed
+	}
 
 	// If span is not exact multiples of GZFILE_READ_CHUNK_SIZE (because it was configured badly),
 	// we fallback to always GZFILE_READ_CHUNK_SIZE boundaries
@@ -378,6 +704,100 @@ PX_off_t GzippedFileReader::GetOptimalExtractionStart(PX_off_t offset) {
 	return span * (offset / span); // index direct access boundaries
 }
 
+// Decompresses from the optimal starting point up to and including the chunk at chunkOffset, and
+// caches each chunk.  Only one thread works on a chunk or a span state at a time: the EE thread
+// (wait) waits for the others, the workers leave it to whoever has it.
+int GzippedFileReader::ExtractChunk(FILE* src, Point* point, PX_off_t chunkOffset, bool wait) {
+	Threading::ScopedLock lock(m_lock);
+	int span, spanix;
+	for (;;) {
+		if (m_cache.Contains(chunkOffset))
+			return 0;
+
+		span = m_pIndex ? m_pIndex->span : GZFILE_SPAN_DEFAULT;
+		spanix = chunkOffset / span;
+		bool busy = m_inflight.count(chunkOffset) || (spanix < m_zstatesCount && m_zstates[spanix].busy);
+		if (!busy)
+			break;
+		if (!wait)
+			return 0;
+
+		lock.Release();
+		m_chunkDone.WaitWithoutYield();
+		lock.Acquire();
+	}
+
+	PTT s = NOW();
+	PX_off_t extractOffset = GetOptimalExtractionStart(chunkOffset); // guaranteed in GZFILE_READ_CHUNK_SIZE boundaries
+	Access tmp;
+	Access* index = GetAccess(extractOffset, tmp, point);
+	if (!index)
+		return -1;
+
+	Zstate* state = 0;
+	if (spanix < m_zstatesCount) {
+		m_zstates[spanix].busy = true;
+		state = &m_zstates[spanix].state;
+	}
+	m_inflight.insert(chunkOffset);
+	lock.Release();
+
+	int size = chunkOffset + GZFILE_READ_CHUNK_SIZE - extractOffset;
+	unsigned char* extracted = (unsigned char*)malloc(size);
+
+	if (src == m_src)
+		AsyncPrefetchCancel();
+	int res = extract(src, index, extractOffset, extracted, size, state);
+	if (res >= 0 && state && src == m_src)
+		AsyncPrefetchChunk(getInOffset(state));
+
+	if (res >= 0) {
+		// split into cacheable chunks, the cache copies them into its own buffers (it has its
+		// own locks, and the chunk is still in m_inflight so nobody else extracts it meanwhile)
+		for (int i = 0; i < size; i += GZFILE_READ_CHUNK_SIZE) {
+			int available = CLAMP(res - i, 0, GZFILE_READ_CHUNK_SIZE);
+			m_cache.Take(extracted + i, extractOffset + i, available, std::min(size - i, GZFILE_READ_CHUNK_SIZE));
+		}
+	}
+
+	lock.Acquire();
+	if (res >= 0) {
+		int targetix = (extractOffset + res) / span;
+		if (state && state->isValid && targetix != spanix) {
+			// The state no longer matches this span.
+			// move the state to the appropriate span because it will be faster than using the index,
+			// unless another thread is using that span's state right now.
+			if (targetix < m_zstatesCount && !m_zstates[targetix].busy) {
+				Zstate& target = m_zstates[targetix].state;
+				m_zstates[targetix].Kill();
+				if (inflateCopy(&target.strm, &state->strm) == Z_OK) {
+					target.in_offset = state->in_offset;
+					target.out_offset = state->out_offset;
+					target.isValid = 1;
+				}
+			}
+			m_zstates[spanix].Kill();
+		}
+	}
+	if (state)
+		m_zstates[spanix].busy = false;
+	m_inflight.erase(chunkOffset);
+	lock.Release();
+
+	free(extracted);
+	m_chunkDone.Post();
+
+	int duration = NOW() - s;
+	if (duration > 10)
+		Console.WriteLn(Color_Gray, L"gunzip: chunk #%5d-%2d : %1.2f MB - %d ms",
+		                (int)(chunkOffset / 4 / 1024 / 1024),
+		                (int)(chunkOffset % (4 * 1024 * 1024) / GZFILE_READ_CHUNK_SIZE),
+		                (float)size / 1024 / 1024,
+		                duration);
+
+	return res;
+}
+
 int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRead) {
 	if (!OkIndex())
 		return -1;
@@ -401,76 +821,53 @@ int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRea
 
 	// From here onwards it's guarenteed that the request is inside a single GZFILE_READ_CHUNK_SIZE boundaries
 
-	int res = m_cache.Read(pBuffer, offset, bytesToRead);
-	if (res >= 0)
-		return res;
-
-	// Not available from cache. Decompress from optimal starting
-	// point in GZFILE_READ_CHUNK_SIZE chunks and cache each chunk.
-	PTT s = NOW();
-	PX_off_t extractOffset = GetOptimalExtractionStart(offset); // guaranteed in GZFILE_READ_CHUNK_SIZE boundaries
-	int size = offset + maxInChunk - extractOffset;
-	unsigned char* extracted = (unsigned char*)malloc(size);
-
-	int span = m_pIndex->span;
-	int spanix = extractOffset / span;
-	AsyncPrefetchCancel();
-	res = extract(m_src, m_pIndex, extractOffset, extracted, size, &(m_zstates[spanix].state));
-	if (res < 0) {
-		free(extracted);
-		return res;
-	}
-	AsyncPrefetchChunk(getInOffset(&(m_zstates[spanix].state)));
-
-	int copied = ChunksCache::CopyAvailable(extracted, extractOffset, res, pBuffer, offset, bytesToRead);
-
-	if (m_zstates[spanix].state.isValid && (extractOffset + res) / span != offset / span) {
-		// The state no longer matches this span.
-		// move the state to the appropriate span because it will be faster than using the index
-		int targetix = (extractOffset + res) / span;
-		m_zstates[targetix].Kill();
-		m_zstates[targetix] = m_zstates[spanix]; // We have elements for the entire file, and another one.
-		m_zstates[spanix].state.isValid = 0; // Not killing because we need the state.
+	// Not available from cache: extract it (or wait for the worker extracting it) and retry.
+	// A chunk which still isn't there after that could not be cached at all.
+	PX_off_t chunkOffset = offset / GZFILE_READ_CHUNK_SIZE * GZFILE_READ_CHUNK_SIZE;
+	for (int attempt = 0; attempt < 3; attempt++) {
+		int res = m_cache.Read(pBuffer, offset, bytesToRead);
+		if (res >= 0)
+			return res;
+
+		res = ExtractChunk(m_src, m_point, chunkOffset, true);
+		if (res < 0)
+			return res;
 	}
 
-	if (size <= GZFILE_READ_CHUNK_SIZE)
-		m_cache.Take(extracted, extractOffset, res, size);
-	else { // split into cacheable chunks
-		for (int i = 0; i < size; i += GZFILE_READ_CHUNK_SIZE) {
-			int available = CLAMP(res - i, 0, GZFILE_READ_CHUNK_SIZE);
-			void* chunk = available ? malloc(available) : 0;
-			if (available)
-				memcpy(chunk, extracted + i, available);
-			m_cache.Take(chunk, extractOffset + i, available, std::min(size - i, GZFILE_READ_CHUNK_SIZE));
-		}
-		free(extracted);
-	}
-
-	int duration = NOW() - s;
-	if (duration > 10)
-		Console.WriteLn(Color_Gray, L"gunzip: chunk #%5d-%2d : %1.2f MB - %d ms",
-		                (int)(offset / 4 / 1024 / 1024),
-		                (int)(offset % (4 * 1024 * 1024) / GZFILE_READ_CHUNK_SIZE),
-		                (float)size / 1024 / 1024,
-		                duration);
-
-	return copied;
+	return -1;
 }
 
 void GzippedFileReader::Close() {
+	StopThreads();
 	m_filename.Empty();
 	if (m_pIndex) {
-		free_index((Access*)m_pIndex);
+		if (m_indexMap)
+			free(m_pIndex); // the list is in the mapping
+		else
+			free_index((Access*)m_pIndex);
 		m_pIndex = 0;
 	}
+	UnmapIndex();
 
-	InitZstates(); // results in delete because no index
+	for (size_t i = 0; i < m_points.size(); i++)
+		free(m_points[i]);
+	m_points.clear();
+	m_estimatedSize = 0;
+	m_indexFailed = false;
+	m_inflight.clear();
+
+	InitZstates(0); // results in delete
+	m_cache.LogStats("gzip cache");
 	m_cache.Clear();
 
 	if (m_src) {
 		fclose(m_src);
 		m_src = 0;
 	}
+	if (m_point) {
+		free(m_point);
+		m_point = 0;
+	}
 
 	AsyncPrefetchClose();
 }
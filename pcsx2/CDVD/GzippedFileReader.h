@@ -20,14 +20,27 @@ typedef struct zstate Zstate;
 #include "AsyncFileReader.h"
 #include "ChunksCache.h"
 #include "zlib_indexed.h"
+#include "Utilities/PersistentThread.h"
+#include <deque>
+#include <set>
 
 #define GZFILE_SPAN_DEFAULT (1048576L * 4)   /* distance between direct access points when creating a new index */
 #define GZFILE_READ_CHUNK_SIZE (256 * 1024)  /* zlib extraction chunks size (at 0-based boundaries) */
 #define GZFILE_CACHE_SIZE_MB 200             /* cache size for extracted data. must be at least GZFILE_READ_CHUNK_SIZE (in MB)*/
+#define GZFILE_WORKER_THREADS 2              /* threads extracting chunks ahead of the reads, 0 extracts on the EE thread only */
 
+class GzipIndexThread;
+class GzipExtractThread;
+
+// Without an index file next to the image, the index is built by a background thread while the
+// image is already in use.  Reads which are past the access points built so far inflate from the
+// last one.  Chunks are extracted by worker threads as well as the EE thread, each span has its own
+// inflate state so chunks of different spans are extracted in parallel.
 class GzippedFileReader : public AsyncFileReader
 {
 	DeclareNoncopyableObject(GzippedFileReader);
+	friend class GzipIndexThread;
+	friend class GzipExtractThread;
 public:
 	GzippedFileReader(void);
 
@@ -44,18 +57,14 @@ public:
 
 	virtual void Close(void);
 
-	virtual uint GetBlockCount(void) const {
-		// type and formula copied from FlatFileReader
-		// FIXME? : Shouldn't it be uint and (size - m_dataoffset) / m_blocksize ?
-		return (int)((m_pIndex ? m_pIndex->uncompressed_size : 0) / m_blocksize);
-	};
+	virtual uint GetBlockCount(void) const;
 
 	virtual void SetBlockSize(uint bytes) { m_blocksize = bytes; }
 	virtual void SetDataOffset(int bytes) { m_dataoffset = bytes; }
 private:
 	class Czstate {
 	public:
-		Czstate() { state.isValid = 0; };
+		Czstate() : busy(false) { state.isValid = 0; };
 		~Czstate() { Kill(); };
 		void Kill() {
 			if (state.isValid)
@@ -63,19 +72,58 @@ private:
 			state.isValid = 0;
 		}
 		Zstate state;
+		bool busy; // a thread is extracting with this state
 	};
 
 	bool	OkIndex();  // Verifies that we have an index, or try to create one
+	bool	MapIndex(const wxString& filename);
+	void	UnmapIndex();
+	void	StartIndexBuild();
+	void	BuildIndex();
+	static int OnIndexProgress(void* ctx, Point* added, PX_off_t out);
+	PX_off_t EstimateSize();
+	Access* GetAccess(PX_off_t offset, Access& tmp, Point* point);
 	PX_off_t GetOptimalExtractionStart(PX_off_t offset);
+	int     ExtractChunk(FILE* src, Point* point, PX_off_t chunkOffset, bool wait);
+	void	QueueChunk(PX_off_t chunkOffset, bool front);
+	bool	PopChunk(PX_off_t& chunkOffset);
+	void	StartThreads();
+	void	StopThreads();
 	int     _ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRead);
-	void	InitZstates();
+	void	InitZstates(PX_off_t size);
 
-	int		mBytesRead; // Temp sync read result when simulating async read
-	Access* m_pIndex;   // Quick access index
+	void*	m_readBuffer; // BeginRead() request, completed by FinishRead()
+	uint	m_readSector;
+	uint	m_readCount;
+	Access* m_pIndex;   // Quick access index, complete
 	Czstate* m_zstates;
+	int		m_zstatesCount;
 	FILE*	m_src;
+	Point*	m_point;    // Access point copied from m_points for the EE thread
+
+	ChunksCache m_cache; // Shared with the threads, locks itself
+
+	// Everything below and the states are shared with the threads and guarded by m_lock.
+	Threading::Mutex m_lock;
+	wxString m_indexFile;
+	void*	m_indexMap; // m_pIndex->list points into it if the index was read from disk
+	size_t	m_indexMapSize;
+#ifdef _WIN32
+	HANDLE	m_indexMapping;
+#endif
 
-	ChunksCache m_cache;
+	GzipIndexThread* m_indexThread;
+	std::vector<Point*> m_points; // access points published so far by the index thread
+	PX_off_t m_estimatedSize;
+	bool	m_indexFailed;
+
+	GzipExtractThread* m_workers[GZFILE_WORKER_THREADS ? GZFILE_WORKER_THREADS : 1];
+	uint	m_numWorkers;
+	std::deque<PX_off_t> m_queue;
+	std::set<PX_off_t> m_inflight;
+	Threading::Semaphore m_queueEvent;
+	Threading::Semaphore m_chunkDone;
+	bool	m_quit;
 
 #ifdef _WIN32
 	// Used by async prefetch
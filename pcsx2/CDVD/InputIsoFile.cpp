@@ -157,6 +157,14 @@ int InputIsoFile::FinishRead3(u8* dst, uint mode)
 	return 0;
 }
 
+void InputIsoFile::SeekHint(uint lsn, uint count, bool contiguous)
+{
+	if (lsn >= m_blocks)
+		return;
+
+	m_reader->SeekHint(lsn, std::min(count, m_blocks - lsn), contiguous);
+}
+
 InputIsoFile::InputIsoFile()
 {
 	_init();
@@ -89,6 +89,8 @@ public:
 
 	void BeginRead2(uint lsn);
 	int FinishRead3(u8* dest, uint mode);
+
+	void SeekHint(uint lsn, uint count, bool contiguous);
 	
 protected:
 	void _init();
@@ -49,6 +49,10 @@ Comments) 1950 to 1952 in the files http://tools.ietf.org/html/rfc1950
       (Thanks to Mark Adler for suggesting the approach)
   - build_index(...) - added progress prints
   - CHUNK changed from 16k to 512k
+  - build_index(...) - optional progress callback, which receives every new access point while
+      the index is being built and can cancel it
+  - extract: the state's inflate stream is handed over with inflateCopy instead of a struct copy,
+      zlib keeps a pointer back to the z_stream it was initialized with
  */
 
 /* Illustrate the use of Z_BLOCK, inflatePrime(), and inflateSetDictionary()
@@ -208,6 +212,10 @@ local struct access *addpoint(struct access *index, int bits,
     return index;
 }
 
+/* Called by build_index() with each new access point and with NULL after each input chunk,
+   out is the amount of uncompressed data so far.  Returning non zero cancels the build. */
+typedef int (*build_index_progress)(void *ctx, struct point *added, PX_off_t out);
+
 /* Make one entire pass through the compressed stream and build an index, with
    access points about every span bytes of uncompressed output -- span is
    chosen to balance the speed of random access against the memory requirements
@@ -216,7 +224,8 @@ local struct access *addpoint(struct access *index, int bits,
    returns the number of access points on success (>= 1), Z_MEM_ERROR for out
    of memory, Z_DATA_ERROR for an error in the input file, or Z_ERRNO for a
    file read error.  On success, *built points to the resulting index. */
-local int build_index(FILE *in, PX_off_t span, struct access **built)
+local int build_index(FILE *in, PX_off_t span, struct access **built,
+                      build_index_progress progress = 0, void *ctx = 0)
 {
     int ret;
     PX_off_t totin, totout, totPrinted;     /* our own total counters to avoid 4GB limit */
@@ -295,8 +304,16 @@ local int build_index(FILE *in, PX_off_t span, struct access **built)
                     goto build_index_error;
                 }
                 last = totout;
+                if (progress && progress(ctx, index->list + index->have - 1, totout)) {
+                    ret = Z_ERRNO;
+                    goto build_index_error;
+                }
             }
         } while (strm.avail_in != 0);
+        if (progress && progress(ctx, NULL, totout)) {
+            ret = Z_ERRNO;
+            goto build_index_error;
+        }
         if (totin / (50 * 1024 * 1024) != totPrinted / (50 * 1024 * 1024)) {
             printf("%dMB ", (int)(totin / (1024 * 1024)));
             totPrinted = totin;
@@ -367,8 +384,11 @@ local int extract(FILE *in, struct access *index, PX_off_t offset,
     }
 
     if (state && state->isValid) {
-        strm = state->strm;
+        ret = inflateCopy(&strm, &state->strm);
+        (void)inflateEnd(&state->strm);
         state->isValid = 0; // we took control over strm. revalidate when/if we give it back
+        if (ret != Z_OK)
+            return ret;
         PX_fseeko(in, state->in_offset, SEEK_SET);
         strm.avail_in = 0;
         offset = 0;
@@ -465,12 +485,11 @@ local int extract(FILE *in, struct access *index, PX_off_t offset,
 
     /* clean up and return bytes read or error */
 extract_ret:
-    if (state && ret == len && !isEnd) {
+    if (state && ret == len && !isEnd && inflateCopy(&state->strm, &strm) == Z_OK) {
         state->out_offset += len;
-        state->strm = strm;
         state->isValid = 1;
-    } else
-        (void)inflateEnd(&strm);
+    }
+    (void)inflateEnd(&strm);
 
     return ret;
 }
@@ -26,6 +26,7 @@
 
 #include "GS.h"
 #include "VUmicro.h"
+#include "MTVU.h"
 
 #include "ps2/HwInternal.h"
 
@@ -446,6 +447,7 @@ static __fi void VSyncStart(u32 sCycle)
 
 	CpuVU0->Vsync();
 	CpuVU1->Vsync();
+	vu1Thread.EndTelemetryFrame();
 
 	if (!CSRreg.VSINT)
 	{
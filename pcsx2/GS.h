@@ -267,6 +267,39 @@ struct MTGS_FreezeData
 	s32			retval;		// value returned from the call, valid only after an mtgsWaitGS()
 };
 
+// Ring occupancy buckets: how full the ring was each time the EE queued a packet, as the
+// fraction of the ring it would have fit in (1/64, 1/32 ... 1/2, all of it), and the packets
+// which found it full.  Tells whether RingBufferSizeFactor could go down or should go up.
+static const uint MTGS_OccupancyBuckets = 8;
+
+// --------------------------------------------------------------------------------------
+//  MTGS_Telemetry
+// --------------------------------------------------------------------------------------
+// Handoff statistics between the EE and the MTGS over one frame (EE vsync to EE vsync).
+// Times are in GetCPUTicks() units.
+struct MTGS_Telemetry
+{
+	u64		EEStallTicks;		// EE time spent waiting for ring space
+	u64		EEVsyncTicks;		// EE time spent waiting on the queued frame limit (VsyncQueueSize)
+	u64		GSIdleTicks;		// MTGS time spent waiting for work
+	u32		Stalls;				// packets which had to wait for ring space
+	u32		SpinStalls;			// ... of which were resolved without sleeping the EE
+	u32		Wakeups;			// times the MTGS was woken by SetEvent
+	u32		CoalescedWakeups;	// SetEvent calls folded into a wakeup already on its way
+	u32		EmptyWakeups;		// MTGS wakeups which found nothing to do
+	u32		Occupancy[MTGS_OccupancyBuckets];
+
+	// GIF packet data traffic, in bytes.  GifCopyBytes + GifRealignBytes + RingCopyBytes is
+	// what the GIF paths copied in the frame; GifInPlaceBytes is what the GS plugin read
+	// straight out of the path buffers, and FifoInPlaceBytes what the GIF unit read straight
+	// out of the GIF FIFO (it used to be unwrapped into GIF_Fifo::readdata first).
+	u32		GifCopyBytes;		// copied into the path buffers (DMA, FIFO, VIF and XGKICK transfers)
+	u32		GifRealignBytes;	// moved to the front of a path buffer by RealignPacket
+	u32		RingCopyBytes;		// copied from the path buffers into the ring (COPY_GS_PACKET_TO_MTGS)
+	u32		GifInPlaceBytes;	// handed to the GS plugin in place
+	u32		FifoInPlaceBytes;	// handed from the GIF FIFO to the GIF unit in place
+};
+
 // --------------------------------------------------------------------------------------
 //  SysMtgsThread
 // --------------------------------------------------------------------------------------
@@ -304,6 +337,33 @@ public:
 	Semaphore			m_sem_OpenDone;
 	std::atomic<bool>	m_PluginOpened;
 
+	// Set by SetEvent when it posts m_sem_event, cleared by the MTGS once awake, so that
+	// packets queued in the meantime don't post again (they'll be seen by the same wakeup).
+	std::atomic<bool>	m_WakePending;
+
+	// Spin budget of GenericStall (GetCPUTicks units), learned from how long recent stalls
+	// took to clear.  EE thread only.
+	u64				m_StallSpinTicks;
+
+	// Telemetry counters of the frame in progress, folded into m_LastFrameTelemetry at each
+	// EE vsync.  Relaxed atomics, since they are bumped from the EE, MTVU and MTGS threads.
+	std::atomic<u64>	m_tmStallTicks;
+	std::atomic<u64>	m_tmVsyncTicks;
+	std::atomic<u64>	m_tmIdleTicks;
+	std::atomic<u32>	m_tmStalls;
+	std::atomic<u32>	m_tmSpinStalls;
+	std::atomic<u32>	m_tmWakeups;
+	std::atomic<u32>	m_tmCoalescedWakeups;
+	std::atomic<u32>	m_tmEmptyWakeups;
+	std::atomic<u32>	m_tmOccupancy[MTGS_OccupancyBuckets];
+	std::atomic<u32>	m_tmGifCopyBytes;
+	std::atomic<u32>	m_tmGifRealignBytes;
+	std::atomic<u32>	m_tmRingCopyBytes;
+	std::atomic<u32>	m_tmGifInPlaceBytes;
+	std::atomic<u32>	m_tmFifoInPlaceBytes;
+
+	MTGS_Telemetry		m_LastFrameTelemetry;
+
 	// These vars maintain instance data for sending Data Packets.
 	// Only one data packet can be constructed and uploaded at a time.
 
@@ -340,6 +400,10 @@ public:
 
 	bool IsPluginOpened() const { return m_PluginOpened; }
 
+	// Telemetry of the last complete frame.  Updated by the EE thread at vsync, so reads
+	// from any other thread may see a mix of two frames.
+	const MTGS_Telemetry& GetLastFrameTelemetry() const { return m_LastFrameTelemetry; }
+
 protected:
 	void OpenPlugin();
 	void ClosePlugin();
@@ -353,6 +417,7 @@ protected:
 	void OnCleanupInThread();
 
 	void GenericStall( uint size );
+	void EndTelemetryFrame();
 
 	// Used internally by SendSimplePacket type functions
 	void _FinishSimplePacket();
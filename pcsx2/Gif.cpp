@@ -109,24 +109,20 @@ int GIF_Fifo::read(bool calledFromDMA)
 		return 0;
 	}
 
-	int valueWritePos = 0;
 	uint sizeRead;
-	uint fifoSize = gifRegs.stat.FQC;
-	int oldReadPos = readpos;
+	uint fifoSize  = gifRegs.stat.FQC;
+	uint firstSize = std::min(fifoSize, 16u - (readpos >> 2)); // QWs up to the end of the FIFO
 
-	while (gifRegs.stat.FQC) {
-		CopyQWC(&readdata[valueWritePos], &data[readpos]);
-		readpos = (readpos + 4) & 63;
-		valueWritePos = (valueWritePos + 4) & 63;
-		gifRegs.stat.FQC--;
+	// The GIF unit copies the data into its path 3 buffer anyway, so hand it the FIFO in place
+	// (in two parts when it wraps around) rather than unwrapping it into readdata first.
+	sizeRead = gifUnit.TransferGSPacketData(GIF_TRANS_DMA, (u8*)&data[readpos], firstSize * 16) / 16; //returns the size actually read
+	if (sizeRead == firstSize && fifoSize > firstSize) {
+		sizeRead += gifUnit.TransferGSPacketData(GIF_TRANS_DMA, (u8*)&data[0], (fifoSize - firstSize) * 16) / 16;
 	}
 
-	sizeRead = gifUnit.TransferGSPacketData(GIF_TRANS_DMA, (u8*)&readdata[0], fifoSize * 16) / 16; //returns the size actually read
-
-	if (sizeRead < fifoSize) {
-		readpos = (oldReadPos + (sizeRead * 4)) & 63; //if we read less than what was in the fifo, move the read position back
-		gifRegs.stat.FQC = fifoSize - sizeRead;
-	}
+	readpos = (readpos + (sizeRead * 4)) & 63;
+	gifRegs.stat.FQC = fifoSize - sizeRead;
+	Gif_CountFifoBytes(fifoSize * 16); // The whole FIFO was unwrapped into readdata before
 		
 	if (calledFromDMA == false) {
 		GifDMAInt(sizeRead * BIAS);
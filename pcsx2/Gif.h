@@ -95,7 +95,7 @@ enum gifstate_t {
 struct GIF_Fifo
 {
 	unsigned int data[64]; //16 QW FIFO
-	unsigned int readdata[64]; //16 QW Inline for reading
+	unsigned int readdata[64]; //Unused, kept for the savestate layout
 	int readpos, writepos;
 
 	int write(u32* pMem, int size);
@@ -115,6 +115,7 @@ void Gif_AddCompletedGSPacket(GS_Packet& gsPack, GIF_PATH path) {
 		MemCopy_WrappedDest((u128*)&gifUnit.gifPath[path].buffer[gsPack.offset], RingBuffer.m_Ring, 
 							GetMTGS().m_packet_writepos, RingBufferSize, gsPack.size/16);
 		GetMTGS().SendDataPacket();
+		GetMTGS().m_tmRingCopyBytes.fetch_add(gsPack.size, std::memory_order_relaxed);
 	}
 	else {
 		pxAssertDev(!gsPack.readAmount, "Gif Unit - gsPack.readAmount only valid for MTVU path 1!");
@@ -123,6 +124,19 @@ void Gif_AddCompletedGSPacket(GS_Packet& gsPack, GIF_PATH path) {
 	}
 }
 
+// Copy accounting of the path buffers, see MTGS_Telemetry
+void Gif_CountCopiedBytes(u32 size) {
+	GetMTGS().m_tmGifCopyBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void Gif_CountRealignedBytes(u32 size) {
+	GetMTGS().m_tmGifRealignBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void Gif_CountFifoBytes(u32 size) {
+	GetMTGS().m_tmFifoInPlaceBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
 void Gif_AddBlankGSPacket(u32 size, GIF_PATH path) {
 	//DevCon.WriteLn("Adding Blank Gif Packet [size=%x]", size);
 	gifUnit.gifPath[path].readAmount.fetch_add(size);
@@ -25,6 +25,9 @@ extern bool Gif_HandlerAD_Debug(u8* pMem);
 extern void Gif_AddBlankGSPacket(u32 size, GIF_PATH path);
 extern void Gif_AddGSPacketMTVU     (GS_Packet& gsPack, GIF_PATH path);
 extern void Gif_AddCompletedGSPacket(GS_Packet& gsPack, GIF_PATH path);
+extern void Gif_CountCopiedBytes(u32 size);
+extern void Gif_CountRealignedBytes(u32 size);
+extern void Gif_CountFifoBytes(u32 size);
 extern void Gif_ParsePacket(u8* data, u32 size, GIF_PATH path);
 extern void Gif_ParsePacket(GS_Packet& gsPack, GIF_PATH path);
 
@@ -229,6 +232,7 @@ struct Gif_Path {
 		//DevCon.WriteLn("Realign Packet [%d]", curSize - offset);
 		if (intersect) memmove(buffer, &buffer[offset], curSize - offset);
 		else       memcpy(buffer, &buffer[offset], curSize - offset);
+		Gif_CountRealignedBytes(curSize - offset);
 		curSize      -= offset;
 		curOffset     = gsPack.size;
 		gsPack.offset = 0;
@@ -249,6 +253,7 @@ struct Gif_Path {
 		pxAssertDev(curSize+size<=buffSize, "Gif Path Buffer Overflow!");
 		memcpy (&buffer[curSize], pMem, size);
 		curSize     += size;
+		Gif_CountCopiedBytes(size);
 	}
 
 	// If completed a GS packet (with EOP) then returned GS_Packet.done = 1
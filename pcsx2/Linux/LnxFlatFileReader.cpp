@@ -16,11 +16,576 @@
 #include "PrecompiledHeader.h"
 #include "AsyncFileReader.h"
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#if defined(__has_include)
+#	if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#		include <linux/io_uring.h>
+#		define PCSX2_IO_URING
+#	endif
+#endif
+
+#ifdef PCSX2_IO_URING
+
+#define FLATFILE_URING_ENTRIES 32            /* submission queue size */
+#define FLATFILE_SLOT_SIZE (256 * 1024)      /* read-ahead is done in slots of this size, at multiples of it */
+#define FLATFILE_SLOTS 16                    /* 4MB of read-ahead */
+#define FLATFILE_WINDOW_MIN 1                /* slots read ahead after a random access */
+
+// --------------------------------------------------------------------------------------
+//  FlatFileUring
+// --------------------------------------------------------------------------------------
+// Talks to io_uring through the raw syscalls, so there's no extra library dependency.
+// A demand read which isn't covered by the read-ahead goes straight into the caller's
+// buffer as before.  The read-ahead slots live in one buffer registered with the ring, so
+// the kernel doesn't map them for every read.  Several slots are in flight at once, the
+// window grows while reads are sequential and is sized from the CDVD seek hints otherwise.
+class FlatFileUring
+{
+	DeclareNoncopyableObject( FlatFileUring );
+
+	enum SlotState
+	{
+		SLOT_EMPTY = 0,
+		SLOT_INFLIGHT,
+		SLOT_READY,
+	};
+
+	struct Slot
+	{
+		s64 offset;
+		u32 length;
+		int result;
+		u32 stamp;
+		SlotState state;
+		struct iovec iov;
+	};
+
+	static const u64 DemandTag = ~0ULL;
+
+	int m_fd;
+	int m_ringfd;
+	s64 m_fileSize;
+
+	void* m_sqMap;
+	size_t m_sqMapSize;
+	void* m_cqMap;
+	size_t m_cqMapSize;
+	struct io_uring_sqe* m_sqes;
+	size_t m_sqesSize;
+
+	unsigned* m_sqHead;
+	unsigned* m_sqTail;
+	unsigned m_sqMask;
+	unsigned m_sqEntries;
+	unsigned* m_sqArray;
+	unsigned* m_cqHead;
+	unsigned* m_cqTail;
+	unsigned m_cqMask;
+	struct io_uring_cqe* m_cqes;
+	unsigned m_toSubmit;
+
+	u8* m_pool;
+	bool m_fixed; // m_pool is registered with the ring
+	Slot m_slots[FLATFILE_SLOTS];
+	u32 m_clock;
+
+	// Current request
+	void* m_readBuffer;
+	s64 m_readOffset;
+	u32 m_readBytes;
+	bool m_readFromSlots;
+	bool m_demandInflight;
+	int m_demandResult;
+	struct iovec m_demandIov;
+
+	// Read-ahead window, in slots
+	s64 m_lastEnd;
+	uint m_window;
+	bool m_hinted;
+
+	u32 m_hits;
+	u32 m_misses;
+
+	FlatFileUring(int fd, int ringfd);
+	bool Map(const struct io_uring_params& p);
+
+	struct io_uring_sqe* GetSqe();
+	bool Submit(bool wait);
+	void Complete(u64 tag, int result);
+	bool WaitCompletion();
+	void FailInflight();
+
+	Slot* FindSlot(s64 offset);
+	Slot* GetFreeSlot(s64 keepStart, s64 keepEnd);
+	bool IsCovered(s64 offset, u32 bytes);
+	void ReadAhead(s64 start, uint count);
+
+public:
+	static FlatFileUring* Create(int fd);
+	~FlatFileUring() throw();
+
+	void BeginRead(void* pBuffer, s64 offset, u32 bytes);
+	int FinishRead();
+	void CancelRead();
+	void SeekHint(s64 offset, u32 bytes, bool contiguous);
+};
+
+static int io_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int ringfd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return (int)syscall(__NR_io_uring_enter, ringfd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register(int ringfd, unsigned opcode, const void* arg, unsigned nr_args)
+{
+	return (int)syscall(__NR_io_uring_register, ringfd, opcode, arg, nr_args);
+}
+
+FlatFileUring::FlatFileUring(int fd, int ringfd)
+{
+	m_fd = fd;
+	m_ringfd = ringfd;
+
+	struct stat st;
+	m_fileSize = fstat(fd, &st) == 0 ? st.st_size : 0;
+
+	m_sqMap = m_cqMap = NULL;
+	m_sqMapSize = m_cqMapSize = 0;
+	m_sqes = NULL;
+	m_sqesSize = 0;
+	m_toSubmit = 0;
+
+	m_pool = NULL;
+	m_fixed = false;
+	memzero(m_slots);
+	m_clock = 0;
+
+	m_readBuffer = NULL;
+	m_readOffset = 0;
+	m_readBytes = 0;
+	m_readFromSlots = false;
+	m_demandInflight = false;
+	m_demandResult = 0;
+
+	m_lastEnd = -1;
+	m_window = FLATFILE_WINDOW_MIN;
+	m_hinted = false;
+
+	m_hits = m_misses = 0;
+}
+
+FlatFileUring* FlatFileUring::Create(int fd)
+{
+	struct io_uring_params p;
+	memzero(p);
+
+	int ringfd = io_uring_setup(FLATFILE_URING_ENTRIES, &p);
+	if (ringfd < 0)
+		return NULL;
+
+	FlatFileUring* ring = new FlatFileUring(fd, ringfd);
+	if (!ring->Map(p))
+	{
+		delete ring;
+		return NULL;
+	}
+
+	return ring;
+}
+
+bool FlatFileUring::Map(const struct io_uring_params& p)
+{
+	m_sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	m_cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single)
+		m_sqMapSize = m_cqMapSize = std::max(m_sqMapSize, m_cqMapSize);
+
+	void* sq = mmap(NULL, m_sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringfd, IORING_OFF_SQ_RING);
+	if (sq == MAP_FAILED)
+		return false;
+	m_sqMap = sq;
+
+	void* cq = single ? sq : mmap(NULL, m_cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringfd, IORING_OFF_CQ_RING);
+	if (cq == MAP_FAILED)
+		return false;
+	m_cqMap = cq;
+
+	m_sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+	void* sqes = mmap(NULL, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringfd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+		return false;
+	m_sqes = (struct io_uring_sqe*)sqes;
+
+	u8* sqp = (u8*)sq;
+	m_sqHead = (unsigned*)(sqp + p.sq_off.head);
+	m_sqTail = (unsigned*)(sqp + p.sq_off.tail);
+	m_sqMask = *(unsigned*)(sqp + p.sq_off.ring_mask);
+	m_sqEntries = *(unsigned*)(sqp + p.sq_off.ring_entries);
+	m_sqArray = (unsigned*)(sqp + p.sq_off.array);
+
+	u8* cqp = (u8*)cq;
+	m_cqHead = (unsigned*)(cqp + p.cq_off.head);
+	m_cqTail = (unsigned*)(cqp + p.cq_off.tail);
+	m_cqMask = *(unsigned*)(cqp + p.cq_off.ring_mask);
+	m_cqes = (struct io_uring_cqe*)(cqp + p.cq_off.cqes);
+
+	if (posix_memalign((void**)&m_pool, 4096, FLATFILE_SLOTS * FLATFILE_SLOT_SIZE))
+	{
+		m_pool = NULL;
+		return false;
+	}
+
+	// Registering pins the pool, which can fail with a low RLIMIT_MEMLOCK.  Plain reads work too.
+	struct iovec iov = { m_pool, FLATFILE_SLOTS * FLATFILE_SLOT_SIZE };
+	m_fixed = io_uring_register(m_ringfd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+
+	DevCon.WriteLn("FlatFileReader: io_uring backend, %u KB read-ahead%s.",
+		FLATFILE_SLOTS * FLATFILE_SLOT_SIZE / 1024, m_fixed ? " in registered buffers" : "");
+	return true;
+}
+
+FlatFileUring::~FlatFileUring() throw()
+{
+	// The kernel may still be writing into the slots or the caller's buffer.
+	bool pending;
+	do {
+		pending = m_demandInflight;
+		for (int i = 0; i < FLATFILE_SLOTS; i++)
+			pending |= m_slots[i].state == SLOT_INFLIGHT;
+		if (pending && m_sqes && !WaitCompletion())
+		{
+			FailInflight(); // The ring is broken, no more completions will come
+			break;
+		}
+	} while (pending && m_sqes);
+
+	if (m_hits + m_misses)
+		DevCon.WriteLn("FlatFileReader: %u reads, %.1f%% from read-ahead.",
+			m_hits + m_misses, 100.0 * m_hits / (m_hits + m_misses));
+
+	if (m_sqes)
+		munmap(m_sqes, m_sqesSize);
+	if (m_cqMap && m_cqMap != m_sqMap)
+		munmap(m_cqMap, m_cqMapSize);
+	if (m_sqMap)
+		munmap(m_sqMap, m_sqMapSize);
+	close(m_ringfd); // also unregisters the pool
+	free(m_pool);
+}
+
+struct io_uring_sqe* FlatFileUring::GetSqe()
+{
+	unsigned tail = *m_sqTail;
+	if (tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+		return NULL;
+
+	unsigned index = tail & m_sqMask;
+	struct io_uring_sqe* sqe = &m_sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	m_sqArray[index] = index;
+	__atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+	m_toSubmit++;
+	return sqe;
+}
+
+// Returns false if io_uring_enter failed (other than by a signal).
+bool FlatFileUring::Submit(bool wait)
+{
+	while (m_toSubmit || wait)
+	{
+		int ret = io_uring_enter(m_ringfd, m_toSubmit, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			Console.Error("FlatFileReader: io_uring_enter failed (%d).", errno);
+			return false;
+		}
+		m_toSubmit -= std::min((unsigned)ret, m_toSubmit);
+		wait = false;
+	}
+	return true;
+}
+
+void FlatFileUring::Complete(u64 tag, int result)
+{
+	if (tag == DemandTag)
+	{
+		m_demandInflight = false;
+		m_demandResult = result;
+		return;
+	}
+
+	Slot& slot = m_slots[tag];
+	slot.result = result;
+	slot.state = result == (int)slot.length ? SLOT_READY : SLOT_EMPTY;
+}
+
+// Reaps at least one completion.  Returns false if the wait failed, after which the caller
+// can't count on the requests in flight ever completing.
+bool FlatFileUring::WaitCompletion()
+{
+	unsigned head = *m_cqHead;
+	if (head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE))
+	{
+		if (!Submit(true) && head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE))
+			return false;
+		head = *m_cqHead;
+	}
+
+	unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++)
+	{
+		struct io_uring_cqe* cqe = &m_cqes[head & m_cqMask];
+		Complete(cqe->user_data, cqe->res);
+	}
+	__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+	return true;
+}
+
+// Gives up on the requests in flight once WaitCompletion failed: the demand read fails and
+// the slots fall back to plain reads.
+void FlatFileUring::FailInflight()
+{
+	if (m_demandInflight)
+		Complete(DemandTag, -EIO);
+	for (int i = 0; i < FLATFILE_SLOTS; i++)
+	{
+		if (m_slots[i].state == SLOT_INFLIGHT)
+			Complete(i, -EIO);
+	}
+}
+
+FlatFileUring::Slot* FlatFileUring::FindSlot(s64 offset)
+{
+	for (int i = 0; i < FLATFILE_SLOTS; i++)
+	{
+		if (m_slots[i].state != SLOT_EMPTY && m_slots[i].offset == offset)
+			return &m_slots[i];
+	}
+	return NULL;
+}
+
+// Least recently used slot which isn't in flight and doesn't hold [keepStart, keepEnd).
+FlatFileUring::Slot* FlatFileUring::GetFreeSlot(s64 keepStart, s64 keepEnd)
+{
+	Slot* best = NULL;
+	for (int i = 0; i < FLATFILE_SLOTS; i++)
+	{
+		Slot& slot = m_slots[i];
+		if (slot.state == SLOT_EMPTY)
+			return &slot;
+		if (slot.state == SLOT_INFLIGHT || (slot.offset + slot.length > keepStart && slot.offset < keepEnd))
+			continue;
+		if (!best || (s32)(slot.stamp - best->stamp) < 0)
+			best = &slot;
+	}
+	return best;
+}
+
+bool FlatFileUring::IsCovered(s64 offset, u32 bytes)
+{
+	if (offset + bytes > m_fileSize)
+		return false;
+
+	for (s64 pos = offset / FLATFILE_SLOT_SIZE * FLATFILE_SLOT_SIZE; pos < offset + bytes; pos += FLATFILE_SLOT_SIZE)
+	{
+		if (!FindSlot(pos))
+			return false;
+	}
+	return true;
+}
+
+void FlatFileUring::ReadAhead(s64 start, uint count)
+{
+	s64 end = start + (s64)count * FLATFILE_SLOT_SIZE;
+	s64 keepStart = m_readFromSlots ? m_readOffset : end;
+	s64 keepEnd = m_readFromSlots ? m_readOffset + m_readBytes : end;
+
+	for (s64 pos = start; pos < end && pos < m_fileSize; pos += FLATFILE_SLOT_SIZE)
+	{
+		if (FindSlot(pos))
+			continue;
+
+		Slot* slot = GetFreeSlot(std::min(keepStart, start), std::max(keepEnd, end));
+		if (!slot)
+			break;
+		struct io_uring_sqe* sqe = GetSqe();
+		if (!sqe)
+			break;
+
+		int index = slot - m_slots;
+		slot->offset = pos;
+		slot->length = (u32)std::min((s64)FLATFILE_SLOT_SIZE, m_fileSize - pos);
+		slot->stamp = ++m_clock;
+		slot->state = SLOT_INFLIGHT;
+		slot->iov.iov_base = m_pool + index * FLATFILE_SLOT_SIZE;
+		slot->iov.iov_len = slot->length;
+
+		sqe->fd = m_fd;
+		sqe->off = pos;
+		sqe->user_data = index;
+		if (m_fixed)
+		{
+			sqe->opcode = IORING_OP_READ_FIXED;
+			sqe->addr = (u64)(uptr)slot->iov.iov_base;
+			sqe->len = slot->length;
+			sqe->buf_index = 0;
+		}
+		else
+		{
+			sqe->opcode = IORING_OP_READV;
+			sqe->addr = (u64)(uptr)&slot->iov;
+			sqe->len = 1;
+		}
+	}
+}
+
+void FlatFileUring::BeginRead(void* pBuffer, s64 offset, u32 bytes)
+{
+	if (offset == m_lastEnd)
+		m_window = std::min(m_window * 2, (uint)FLATFILE_SLOTS);
+	else if (!m_hinted)
+		m_window = FLATFILE_WINDOW_MIN;
+	m_hinted = false;
+	m_lastEnd = offset + bytes;
+
+	m_readBuffer = pBuffer;
+	m_readOffset = offset;
+	m_readBytes = bytes;
+	m_readFromSlots = IsCovered(offset, bytes);
+
+	struct io_uring_sqe* sqe = m_readFromSlots ? NULL : GetSqe();
+	if (m_readFromSlots)
+	{
+		m_hits++;
+	}
+	else if (sqe)
+	{
+		m_misses++;
+		m_demandIov.iov_base = pBuffer;
+		m_demandIov.iov_len = bytes;
+		sqe->opcode = IORING_OP_READV;
+		sqe->fd = m_fd;
+		sqe->off = offset;
+		sqe->addr = (u64)(uptr)&m_demandIov;
+		sqe->len = 1;
+		sqe->user_data = DemandTag;
+		m_demandInflight = true;
+	}
+	else
+	{
+		// Can't happen with the slot count below the ring size, but don't lose the read.
+		m_misses++;
+		m_demandResult = pread(m_fd, pBuffer, bytes, offset);
+	}
+
+	// The slot holding the end of this read is the first one the next sequential read needs.
+	ReadAhead(m_lastEnd / FLATFILE_SLOT_SIZE * FLATFILE_SLOT_SIZE, m_window);
+	Submit(false);
+}
+
+int FlatFileUring::FinishRead()
+{
+	if (!m_readFromSlots)
+	{
+		while (m_demandInflight)
+		{
+			if (!WaitCompletion())
+				FailInflight();
+		}
+		return m_demandResult < 0 ? -1 : m_demandResult;
+	}
+
+	u8* dst = (u8*)m_readBuffer;
+	s64 pos = m_readOffset;
+	s64 end = m_readOffset + m_readBytes;
+	while (pos < end)
+	{
+		s64 slotOffset = pos / FLATFILE_SLOT_SIZE * FLATFILE_SLOT_SIZE;
+		Slot* slot = FindSlot(slotOffset);
+		while (slot && slot->state == SLOT_INFLIGHT)
+		{
+			if (!WaitCompletion())
+				FailInflight();
+			slot = FindSlot(slotOffset);
+		}
+
+		u32 count = (u32)(std::min(end, slotOffset + FLATFILE_SLOT_SIZE) - pos);
+		if (slot)
+		{
+			memcpy(dst, m_pool + (slot - m_slots) * FLATFILE_SLOT_SIZE + (pos - slotOffset), count);
+			slot->stamp = ++m_clock;
+		}
+		else if (pread(m_fd, dst, count, pos) != (ssize_t)count)
+		{
+			// The read-ahead failed, and so does a plain read.
+			return -1;
+		}
+
+		dst += count;
+		pos += count;
+	}
+
+	return m_readBytes;
+}
+
+void FlatFileUring::CancelRead()
+{
+	while (m_demandInflight)
+	{
+		if (!WaitCompletion())
+			FailInflight();
+	}
+	m_readFromSlots = false;
+	m_demandResult = -1;
+}
+
+void FlatFileUring::SeekHint(s64 offset, u32 bytes, bool contiguous)
+{
+	uint slots = (bytes + FLATFILE_SLOT_SIZE - 1) / FLATFILE_SLOT_SIZE;
+	if (contiguous)
+		m_window = std::min(m_window * 2, (uint)FLATFILE_SLOTS);
+	else
+		m_window = std::max((uint)FLATFILE_WINDOW_MIN, std::min(slots, (uint)FLATFILE_SLOTS));
+	m_hinted = true;
+
+	// The read itself only comes after the emulated seek time, use it to fetch the target.
+	s64 start = offset / FLATFILE_SLOT_SIZE * FLATFILE_SLOT_SIZE;
+	ReadAhead(start, std::min(m_window, (uint)((offset + bytes - start + FLATFILE_SLOT_SIZE - 1) / FLATFILE_SLOT_SIZE)));
+	Submit(false);
+}
+
+#else
+
+// Without io_uring headers the reader is libaio only.
+class FlatFileUring
+{
+public:
+	static FlatFileUring* Create(int fd) { return NULL; }
+	void BeginRead(void* pBuffer, s64 offset, u32 bytes) {}
+	int FinishRead() { return -1; }
+	void CancelRead() {}
+	void SeekHint(s64 offset, u32 bytes, bool contiguous) {}
+};
+
+#endif
+
 FlatFileReader::FlatFileReader(bool shareWrite) : shareWrite(shareWrite)
 {
 	m_blocksize = 2048;
 	m_fd = -1;
 	m_aio_context = 0;
+	m_uring = NULL;
 }
 
 FlatFileReader::~FlatFileReader(void)
@@ -32,12 +597,24 @@ bool FlatFileReader::Open(const wxString& fileName)
 {
 	m_filename = fileName;
 
-	int err = io_setup(64, &m_aio_context);
-	if (err) return false;
+	m_fd = wxOpen(fileName, O_RDONLY, 0);
+	if (m_fd == -1)
+		return false;
 
-    m_fd = wxOpen(fileName, O_RDONLY, 0);
+	m_uring = FlatFileUring::Create(m_fd);
+	if (m_uring)
+		return true;
+
+	// io_uring needs Linux 5.1 and may be disabled, libaio is always there.
+	int err = io_setup(64, &m_aio_context);
+	if (err)
+	{
+		close(m_fd);
+		m_fd = -1;
+		return false;
+	}
 
-	return (m_fd != -1);
+	return true;
 }
 
 int FlatFileReader::ReadSync(void* pBuffer, uint sector, uint count)
@@ -53,6 +630,12 @@ void FlatFileReader::BeginRead(void* pBuffer, uint sector, uint count)
 
 	u32 bytesToRead = count * m_blocksize;
 
+	if (m_uring)
+	{
+		m_uring->BeginRead(pBuffer, offset, bytesToRead);
+		return;
+	}
+
 	struct iocb iocb;
 	struct iocb* iocbs = &iocb;
 
@@ -62,6 +645,9 @@ void FlatFileReader::BeginRead(void* pBuffer, uint sector, uint count)
 
 int FlatFileReader::FinishRead(void)
 {
+	if (m_uring)
+		return m_uring->FinishRead();
+
 	int min_nr = 1;
 	int max_nr = 1;
 	struct io_event events[max_nr];
@@ -76,18 +662,34 @@ int FlatFileReader::FinishRead(void)
 
 void FlatFileReader::CancelRead(void)
 {
+	if (m_uring)
+	{
+		m_uring->CancelRead();
+		return;
+	}
+
 	// Will be done when m_aio_context context is destroyed
 	// Note: io_cancel exists but need the iocb structure as parameter
 	// int io_cancel(aio_context_t ctx_id, struct iocb *iocb,
 	//                struct io_event *result);
 }
 
+void FlatFileReader::SeekHint(uint sector, uint count, bool contiguous)
+{
+	if (m_uring)
+		m_uring->SeekHint(sector * (s64)m_blocksize + m_dataoffset, count * m_blocksize, contiguous);
+}
+
 void FlatFileReader::Close(void)
 {
+	// Waits for the reads in flight before the file goes away.
+	delete m_uring;
+	m_uring = NULL;
 
 	if (m_fd != -1) close(m_fd);
 
-	io_destroy(m_aio_context);
+	if (m_aio_context)
+		io_destroy(m_aio_context);
 
 	m_fd = -1;
 	m_aio_context = 0;
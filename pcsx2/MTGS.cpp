@@ -28,6 +28,14 @@
 // Uncomment this to enable profiling of the GS RingBufferCopy function.
 //#define PCSX2_GSRING_SAMPLING_STATS
 
+// Uncomment this to log the MTGS telemetry (see MTGS_Telemetry) summed over every 60 frames.
+//#define PCSX2_MTGS_TELEMETRY
+
+// Bounds of the EE's spin on a full ring, in microseconds.  Stalls longer than that are
+// better spent asleep, and the lower bound keeps probing whether stalls got short again.
+static const uint StallSpinMinUs = 2;
+static const uint StallSpinMaxUs = 50;
+
 using namespace Threading;
 
 #if 0 //PCSX2_DEBUG
@@ -77,6 +85,27 @@ void SysMtgsThread::OnStart()
 
 	m_CopyDataTally		= 0;
 
+	m_WakePending		= false;
+	m_StallSpinTicks	= GetTickFrequency() * StallSpinMinUs / 1000000;
+
+	m_tmStallTicks		= 0;
+	m_tmVsyncTicks		= 0;
+	m_tmIdleTicks		= 0;
+	m_tmStalls			= 0;
+	m_tmSpinStalls		= 0;
+	m_tmWakeups			= 0;
+	m_tmCoalescedWakeups = 0;
+	m_tmEmptyWakeups	= 0;
+	m_tmGifCopyBytes	= 0;
+	m_tmGifRealignBytes	= 0;
+	m_tmRingCopyBytes	= 0;
+	m_tmGifInPlaceBytes	= 0;
+	m_tmFifoInPlaceBytes = 0;
+	for (uint i = 0; i < MTGS_OccupancyBuckets; ++i)
+		m_tmOccupancy[i] = 0;
+
+	memzero(m_LastFrameTelemetry);
+
 	_parent::OnStart();
 }
 
@@ -127,6 +156,8 @@ void SysMtgsThread::PostVsyncStart()
 	// 256-byte copy is only a few dozen cycles -- executed 60 times a second -- so probably
 	// not worth the effort or overhead of trying to selectively avoid it.
 
+	EndTelemetryFrame();
+
 	uint packsize = sizeof(RingCmdPacket_Vsync) / 16;
 	PrepDataPacket(GS_RINGTYPE_VSYNC, packsize);
 	MemCopy_WrappedDest( (u128*)PS2MEM_GS, RingBuffer.m_Ring, m_packet_writepos, RingBufferSize, 0xf );
@@ -164,7 +195,71 @@ void SysMtgsThread::PostVsyncStart()
 	// So let's ensure the ring doesn't sleep
 	m_sem_event.Post();
 
+	const u64 vsyncStart = GetCPUTicks();
 	m_sem_Vsync.WaitNoCancel();
+	m_tmVsyncTicks.fetch_add(GetCPUTicks() - vsyncStart, std::memory_order_relaxed);
+}
+
+// Folds the telemetry counters of the frame which just ended into m_LastFrameTelemetry.
+void SysMtgsThread::EndTelemetryFrame()
+{
+	MTGS_Telemetry& tm = m_LastFrameTelemetry;
+
+	tm.EEStallTicks		= m_tmStallTicks.exchange(0, std::memory_order_relaxed);
+	tm.EEVsyncTicks		= m_tmVsyncTicks.exchange(0, std::memory_order_relaxed);
+	tm.GSIdleTicks		= m_tmIdleTicks.exchange(0, std::memory_order_relaxed);
+	tm.Stalls			= m_tmStalls.exchange(0, std::memory_order_relaxed);
+	tm.SpinStalls		= m_tmSpinStalls.exchange(0, std::memory_order_relaxed);
+	tm.Wakeups			= m_tmWakeups.exchange(0, std::memory_order_relaxed);
+	tm.CoalescedWakeups	= m_tmCoalescedWakeups.exchange(0, std::memory_order_relaxed);
+	tm.EmptyWakeups		= m_tmEmptyWakeups.exchange(0, std::memory_order_relaxed);
+	for (uint i = 0; i < MTGS_OccupancyBuckets; ++i)
+		tm.Occupancy[i] = m_tmOccupancy[i].exchange(0, std::memory_order_relaxed);
+	tm.GifCopyBytes		= m_tmGifCopyBytes.exchange(0, std::memory_order_relaxed);
+	tm.GifRealignBytes	= m_tmGifRealignBytes.exchange(0, std::memory_order_relaxed);
+	tm.RingCopyBytes	= m_tmRingCopyBytes.exchange(0, std::memory_order_relaxed);
+	tm.GifInPlaceBytes	= m_tmGifInPlaceBytes.exchange(0, std::memory_order_relaxed);
+	tm.FifoInPlaceBytes	= m_tmFifoInPlaceBytes.exchange(0, std::memory_order_relaxed);
+
+#ifdef PCSX2_MTGS_TELEMETRY
+	static MTGS_Telemetry sum;
+	static uint frames = 0;
+
+	sum.EEStallTicks		+= tm.EEStallTicks;
+	sum.EEVsyncTicks		+= tm.EEVsyncTicks;
+	sum.GSIdleTicks			+= tm.GSIdleTicks;
+	sum.Stalls				+= tm.Stalls;
+	sum.SpinStalls			+= tm.SpinStalls;
+	sum.Wakeups				+= tm.Wakeups;
+	sum.CoalescedWakeups	+= tm.CoalescedWakeups;
+	sum.EmptyWakeups		+= tm.EmptyWakeups;
+	for (uint i = 0; i < MTGS_OccupancyBuckets; ++i)
+		sum.Occupancy[i] += tm.Occupancy[i];
+	sum.GifCopyBytes		+= tm.GifCopyBytes;
+	sum.GifRealignBytes		+= tm.GifRealignBytes;
+	sum.RingCopyBytes		+= tm.RingCopyBytes;
+	sum.GifInPlaceBytes		+= tm.GifInPlaceBytes;
+	sum.FifoInPlaceBytes	+= tm.FifoInPlaceBytes;
+
+	if (++frames < 60) return;
+
+	const double ms = 1000.0 / GetTickFrequency();
+
+	Console.WriteLn( Color_Gray, "MTGS: EE stall %.2f ms (%u stalls, %u spun), vsync wait %.2f ms, GS idle %.2f ms, wakeups %u (%u coalesced, %u empty)",
+		sum.EEStallTicks * ms, sum.Stalls, sum.SpinStalls, sum.EEVsyncTicks * ms, sum.GSIdleTicks * ms,
+		sum.Wakeups, sum.CoalescedWakeups, sum.EmptyWakeups );
+	Console.WriteLn( Color_Gray, "MTGS: ring occupancy 1/64: %u, 1/32: %u, 1/16: %u, 1/8: %u, 1/4: %u, 1/2: %u, all: %u, full: %u",
+		sum.Occupancy[0], sum.Occupancy[1], sum.Occupancy[2], sum.Occupancy[3],
+		sum.Occupancy[4], sum.Occupancy[5], sum.Occupancy[6], sum.Occupancy[7] );
+	Console.WriteLn( Color_Gray, "MTGS: GIF data copied %u KB/frame (path buffers %u, realign %u, ring %u), read in place %u KB/frame (GS %u, GIF FIFO %u)",
+		(sum.GifCopyBytes + sum.GifRealignBytes + sum.RingCopyBytes) / frames / 1024,
+		sum.GifCopyBytes / frames / 1024, sum.GifRealignBytes / frames / 1024, sum.RingCopyBytes / frames / 1024,
+		(sum.GifInPlaceBytes + sum.FifoInPlaceBytes) / frames / 1024,
+		sum.GifInPlaceBytes / frames / 1024, sum.FifoInPlaceBytes / frames / 1024 );
+
+	memzero(sum);
+	frames = 0;
+#endif
 }
 
 union PacketTagType
@@ -289,10 +384,20 @@ void SysMtgsThread::ExecuteTaskInThread()
 		// is very optimized (only 1 instruction test in most cases), so no point in trying
 		// to avoid it.
 
+		const u64 idleStart = GetCPUTicks();
 		m_sem_event.WaitWithoutYield();
+		m_tmIdleTicks.fetch_add(GetCPUTicks() - idleStart, std::memory_order_relaxed);
+
+		// Anything queued from here on is picked up by this wakeup, so SetEvent may post again
+		// (this must come before the m_WritePos load below).
+		m_WakePending.store(false);
+
 		StateCheckInThread();
 		busy.Acquire();
 
+		if (m_ReadPos.load(std::memory_order_relaxed) == m_WritePos.load(std::memory_order_acquire))
+			m_tmEmptyWakeups.fetch_add(1, std::memory_order_relaxed);
+
 		// note: m_ReadPos is intentionally not volatile, because it should only
 		// ever be modified by this thread.
 		while( m_ReadPos.load(std::memory_order_relaxed) != m_WritePos.load(std::memory_order_acquire))
@@ -406,21 +511,27 @@ void SysMtgsThread::ExecuteTaskInThread()
 					Gif_Path& path   = gifUnit.gifPath[tag.data[2]];
 					u32       offset = tag.data[0];
 					u32       size   = tag.data[1];
-					if (offset != ~0u) GSgifTransfer((u32*)&path.buffer[offset], size/16);
+					if (offset != ~0u) {
+						GSgifTransfer((u32*)&path.buffer[offset], size/16);
+						m_tmGifInPlaceBytes.fetch_add(size, std::memory_order_relaxed);
+					}
 					path.readAmount.fetch_sub(size);
 					break;
 				}
 
 				case GS_RINGTYPE_MTVU_GSPACKET: {
 					MTVU_LOG("MTGS - Waiting on semaXGkick!");
-					vu1Thread.KickStart(true);
+					vu1Thread.KickStart();
 					busy.PartialRelease();
 					// Wait for MTVU to complete vu1 program
 					vu1Thread.semaXGkick.WaitWithoutYield();
 					busy.PartialAcquire();
 					Gif_Path& path   = gifUnit.gifPath[GIF_PATH_1];
 					GS_Packet gsPack = path.GetGSPacketMTVU(); // Get vu1 program's xgkick packet(s)
-					if (gsPack.size) GSgifTransfer((u32*)&path.buffer[gsPack.offset], gsPack.size/16);
+					if (gsPack.size) {
+						GSgifTransfer((u32*)&path.buffer[gsPack.offset], gsPack.size/16);
+						m_tmGifInPlaceBytes.fetch_add(gsPack.size, std::memory_order_relaxed);
+					}
 					path.readAmount.fetch_sub(gsPack.size + gsPack.readAmount);
 					path.PopGSPacketMTVU(); // Should be done last, for proper Gif_MTGS_Wait()
 					break;
@@ -642,10 +753,20 @@ void SysMtgsThread::WaitGS(bool syncRegs, bool weakWait, bool isMTVU)
 
 // Sets the gsEvent flag and releases a timeslice.
 // For use in loops that wait on the GS thread to do certain things.
+// Calls made while a previous wakeup hasn't reached the MTGS yet are folded into it, so a
+// burst of packets costs a single semaphore post.
 void SysMtgsThread::SetEvent()
 {
 	if(!m_RingBufferIsBusy.load(std::memory_order_relaxed))
-		m_sem_event.Post();
+	{
+		if(!m_WakePending.exchange(true))
+		{
+			m_sem_event.Post();
+			m_tmWakeups.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+			m_tmCoalescedWakeups.fetch_add(1, std::memory_order_relaxed);
+	}
 
 	m_CopyDataTally = 0;
 }
@@ -685,6 +806,28 @@ void SysMtgsThread::SendDataPacket()
 	//m_PacketLocker.Release();
 }
 
+static __fi uint RingFreeRoom( uint writepos, uint readpos )
+{
+	if (writepos < readpos)
+		return readpos - writepos;
+	else
+		return RingBufferSize - (writepos - readpos);
+}
+
+// Telemetry bucket of a packet of the given size queued with freeroom left in the ring.
+static __fi uint RingOccupancyBucket( uint freeroom, uint size )
+{
+	if (freeroom <= size) return MTGS_OccupancyBuckets - 1;
+
+	const uint used = RingBufferSize - freeroom + size;
+	uint bucket = 0;
+
+	while (bucket < MTGS_OccupancyBuckets - 2 && used > (RingBufferSize >> (MTGS_OccupancyBuckets - 2 - bucket)))
+		++bucket;
+
+	return bucket;
+}
+
 void SysMtgsThread::GenericStall( uint size )
 {
 	// Note on volatiles: m_WritePos is not modified by the GS thread, so there's no need
@@ -702,70 +845,99 @@ void SysMtgsThread::GenericStall( uint size )
 	// the block about to be written (writepos + size)
 
 	uint readpos = m_ReadPos.load(std::memory_order_acquire);
-	uint freeroom;
+	uint freeroom = RingFreeRoom(writepos, readpos);
 
-	if (writepos < readpos)
-		freeroom = readpos - writepos;
-	else
-		freeroom = RingBufferSize - (writepos - readpos);
+	m_tmOccupancy[RingOccupancyBucket(freeroom, size)].fetch_add(1, std::memory_order_relaxed);
 
 	if (freeroom <= size)
 	{
-		// writepos will overlap readpos if we commit the data, so we need to wait until
-		// readpos is out past the end of the future write pos, or until it wraps around
-		// (in which case writepos will be >= readpos).
+		const u64 stallStart = GetCPUTicks();
+		const u64 spinMin = GetTickFrequency() * StallSpinMinUs / 1000000;
+		const u64 spinMax = GetTickFrequency() * StallSpinMaxUs / 1000000;
+		bool slept = false;
 
-		// Ideally though we want to wait longer, because if we just toss in this packet
-		// the next packet will likely stall up too.  So lets set a condition for the MTGS
-		// thread to wake up the EE once there's a sizable chunk of the ringbuffer emptied.
+		// First spin for about as long as the recent stalls took to clear: the MTGS often
+		// frees the room within a few microseconds, much less than a sleep/wake round trip.
 
-		uint somedone	= (RingBufferSize - freeroom) / 4;
-		if( somedone < size+1 ) somedone = size + 1;
+		SetEvent();
 
-		// FMV Optimization: FMVs typically send *very* little data to the GS, in some cases
-		// every other frame is nothing more than a page swap.  Sleeping the EEcore is a
-		// waste of time, and we get better results using a spinwait.
+		bool spun = false;
+		for (u64 now = stallStart; now - stallStart < m_StallSpinTicks; now = GetCPUTicks())
+		{
+			SpinWait();
+			if (RingFreeRoom(writepos, m_ReadPos.load(std::memory_order_acquire)) > size)
+			{
+				spun = true;
+				break;
+			}
+		}
 
-		if( somedone > 0x80 )
+		if (!spun)
 		{
-			pxAssertDev( m_SignalRingEnable == 0, "MTGS Thread Synchronization Error" );
-			m_SignalRingPosition.store(somedone, std::memory_order_release);
+			// writepos will overlap readpos if we commit the data, so we need to wait until
+			// readpos is out past the end of the future write pos, or until it wraps around
+			// (in which case writepos will be >= readpos).
 
-			//Console.WriteLn( Color_Blue, "(EEcore Sleep) PrepDataPacker \tringpos=0x%06x, writepos=0x%06x, signalpos=0x%06x", readpos, writepos, m_SignalRingPosition );
+			// Ideally though we want to wait longer, because if we just toss in this packet
+			// the next packet will likely stall up too.  So lets set a condition for the MTGS
+			// thread to wake up the EE once there's a sizable chunk of the ringbuffer emptied.
 
-			while(true) {
-				m_SignalRingEnable.store(true, std::memory_order_release);
-				SetEvent();
-				m_sem_OnRingReset.WaitWithoutYield();
-				readpos = m_ReadPos.load(std::memory_order_acquire);
-				//Console.WriteLn( Color_Blue, "(EEcore Awake) Report!\tringpos=0x%06x", readpos );
+			uint somedone	= (RingBufferSize - freeroom) / 4;
+			if( somedone < size+1 ) somedone = size + 1;
+
+			// FMV Optimization: FMVs typically send *very* little data to the GS, in some cases
+			// every other frame is nothing more than a page swap.  Sleeping the EEcore is a
+			// waste of time, and we get better results using a spinwait.
+
+			if( somedone > 0x80 )
+			{
+				pxAssertDev( m_SignalRingEnable == 0, "MTGS Thread Synchronization Error" );
+				m_SignalRingPosition.store(somedone, std::memory_order_release);
+
+				//Console.WriteLn( Color_Blue, "(EEcore Sleep) PrepDataPacker \tringpos=0x%06x, writepos=0x%06x, signalpos=0x%06x", readpos, writepos, m_SignalRingPosition );
 
-				if (writepos < readpos)
-					freeroom = readpos - writepos;
-				else
-					freeroom = RingBufferSize - (writepos - readpos);
+				slept = true;
 
-				if (freeroom > size) break;
+				while(true) {
+					m_SignalRingEnable.store(true, std::memory_order_release);
+					SetEvent();
+					m_sem_OnRingReset.WaitWithoutYield();
+					readpos = m_ReadPos.load(std::memory_order_acquire);
+					//Console.WriteLn( Color_Blue, "(EEcore Awake) Report!\tringpos=0x%06x", readpos );
+
+					if (RingFreeRoom(writepos, readpos) > size) break;
+				}
+
+				pxAssertDev( m_SignalRingPosition <= 0, "MTGS Thread Synchronization Error" );
 			}
+			else
+			{
+				//Console.WriteLn( Color_StrongGray, "(EEcore Spin) PrepDataPacket!" );
+				SetEvent();
+				while(true) {
+					SpinWait();
+					readpos = m_ReadPos.load(std::memory_order_acquire);
 
-			pxAssertDev( m_SignalRingPosition <= 0, "MTGS Thread Synchronization Error" );
-		}
-		else
-		{
-			//Console.WriteLn( Color_StrongGray, "(EEcore Spin) PrepDataPacket!" );
-			SetEvent();
-			while(true) {
-				SpinWait();
-				readpos = m_ReadPos.load(std::memory_order_acquire);
-
-				if (writepos < readpos)
-					freeroom = readpos - writepos;
-				else
-					freeroom = RingBufferSize - (writepos - readpos);
-
-				if (freeroom > size) break;
+					if (RingFreeRoom(writepos, readpos) > size) break;
+				}
 			}
 		}
+
+		const u64 waited = GetCPUTicks() - stallStart;
+
+		// Learn the spin budget: follow twice the length of the stalls the spin did clear,
+		// and halve it when it didn't, so long stalls quickly go straight to sleep.
+		if (spun)
+			m_StallSpinTicks = (m_StallSpinTicks * 7 + waited * 2) / 8;
+		else
+			m_StallSpinTicks /= 2;
+
+		m_StallSpinTicks = std::min(std::max(m_StallSpinTicks, spinMin), spinMax);
+
+		m_tmStalls.fetch_add(1, std::memory_order_relaxed);
+		m_tmStallTicks.fetch_add(waited, std::memory_order_relaxed);
+		if (!slept)
+			m_tmSpinStalls.fetch_add(1, std::memory_order_relaxed);
 	}
 }
 
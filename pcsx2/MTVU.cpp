@@ -24,6 +24,9 @@ __aligned16 VU_Thread vu1Thread(CpuVU1, VU1);
 #define MTVU_ALWAYS_KICK 0
 #define MTVU_SYNC_MODE   0
 
+// Uncomment this to log the MTVU telemetry (see MTVU_Telemetry) summed over every 60 frames.
+//#define PCSX2_MTVU_TELEMETRY
+
 // Rounds up a size in bytes for size in u32's
 static __fi u32 size_u32(u32 x) { return (x + 3) >> 2; }
 
@@ -64,6 +67,7 @@ VU_Thread::VU_Thread(BaseVUmicroCPU*& _vuCPU, VURegs& _vuRegs) :
 		vuCPU(_vuCPU), vuRegs(_vuRegs)
 {
 	m_name = L"MTVU";
+	isParked = false;
 	Reset();
 }
 
@@ -84,6 +88,16 @@ void VU_Thread::Reset()
 	read_pos     = 0;
 	isBusy       = false;
 	write_pos    = 0;
+	batchDepth   = 0;
+	batchKick    = false;
+	m_tmStallTicks = 0;
+	m_tmDepthSum   = 0;
+	m_tmStalls     = 0;
+	m_tmPackets    = 0;
+	m_tmPublishes  = 0;
+	m_tmWakeups    = 0;
+	m_tmMaxDepth   = 0;
+	memzero(m_LastFrameTelemetry);
 	memzero(vif);
 	memzero(vifRegs);
 	for (size_t i = 0; i < 4; ++i)
@@ -100,7 +114,15 @@ void VU_Thread::ExecuteTaskInThread()
 void VU_Thread::ExecuteRingBuffer()
 {
 	for(;;) {
-		semaEvent.WaitWithoutYield();
+		// Park before the last look at write_pos, so that a packet published after it is
+		// sure to find isParked set and ring the doorbell (both sides are seq_cst).
+		isParked.store(true);
+		if (read_pos.load(std::memory_order_relaxed) == write_pos.load()) {
+			semaEvent.WaitWithoutYield();
+		}
+		else if (!isParked.exchange(false)) {
+			semaEvent.WaitWithoutYield(); // A doorbell beat us to it, take its post
+		}
 		ScopedLockBool lock(mtxBusy, isBusy);
 		while (read_pos.load(std::memory_order_relaxed) != GetWritePos()) {
 			u32 tag = Read();
@@ -159,32 +181,50 @@ void VU_Thread::ExecuteRingBuffer()
 // Should only be called by ReserveSpace()
 __ri void VU_Thread::WaitOnSize(s32 size)
 {
+	u64 stallStart = 0;
 	for(;;) {
 		s32 readPos  = GetReadPos();
-		if (readPos <= write_pos.load(std::memory_order_relaxed)) break; // MTVU is reading in back of write_pos
-		if (readPos >  write_pos.load(std::memory_order_relaxed) + size) break; // Enough free front space
+		s32 writePos = write_pos.load(std::memory_order_relaxed) + write_offset;
+		if (readPos <= write_pos.load(std::memory_order_relaxed)) { // MTVU is reading in back of write_pos
+			// ...but filling up to the end of the buffer while it is at 0 would look like an empty ring
+			if (readPos > 0 || writePos + size < buffer_size) break;
+		}
+		else if (readPos > writePos + size) break; // Enough free front space
 		if (1) { // Let MTVU run to free up buffer space
+			if (!stallStart) stallStart = GetCPUTicks();
+			Flush();
 			KickStart();
 			if (IsDevBuild) DevCon.WriteLn("WaitOnSize()");
 			ScopedLock lock(mtxBusy);
 		}
 	}
+	if (stallStart) {
+		m_tmStalls.fetch_add(1, std::memory_order_relaxed);
+		m_tmStallTicks.fetch_add(GetCPUTicks() - stallStart, std::memory_order_relaxed);
+	}
 }
 
 // Makes sure theres enough room in the ring buffer
 // to write a continuous 'size * sizeof(u32)' bytes
+// (after the packets of an open batch, if any)
 void VU_Thread::ReserveSpace(s32 size)
 {
 	pxAssert(write_pos < buffer_size);
 	pxAssert(size      < buffer_size);
 	pxAssert(size > 0);
-	pxAssert(write_offset == 0);
+	if (write_pos.load(std::memory_order_relaxed) + write_offset + size > buffer_size) {
+		Flush(); // Wrap with the batch published, it may even end right at the end of the buffer
+	}
 	if (write_pos.load(std::memory_order_relaxed) + size > buffer_size) {
 		pxAssert(write_pos > 0);
-		WaitOnSize(1); // Size of MTVU_NULL_PACKET
+		// The MTVU has to be on this lap of the ring and past position 0, else write_pos 0
+		// would make its unread packets look consumed or overwritable.
+		s32 readPos = GetReadPos();
+		if (readPos == 0 || readPos > write_pos.load(std::memory_order_relaxed)) WaitVU();
 		Write(MTVU_NULL_PACKET);
 		write_offset = 0;
 		write_pos.store(0, std::memory_order_release);
+		m_tmPublishes.fetch_add(1, std::memory_order_relaxed);
 	}
 	WaitOnSize(size);
 }
@@ -210,10 +250,23 @@ __fi void VU_Thread::incReadPos(s32 offset)
 	read_pos.store((read_pos.load(std::memory_order_relaxed) + offset) & buffer_mask, std::memory_order_release);
 }
 __fi void VU_Thread::incWritePos()
-{ // Adds write_offset
+{ // Ends the packet in write_offset, which is published now unless a batch is open
+	m_tmPackets.fetch_add(1, std::memory_order_relaxed);
+	if (!batchDepth) Flush();
+}
+void VU_Thread::Flush()
+{ // Publishes write_offset
+	if (!write_offset) return;
 	s32 temp = (write_pos.load(std::memory_order_relaxed) + write_offset) & buffer_mask;
 	write_offset = 0;
-	write_pos.store(temp, std::memory_order_release);
+	write_pos.store(temp); // seq_cst, must not pass the isParked load of KickStart()
+
+	u32 depth = (temp - GetReadPos()) & buffer_mask;
+	m_tmPublishes.fetch_add(1, std::memory_order_relaxed);
+	m_tmDepthSum.fetch_add(depth, std::memory_order_relaxed);
+	if (depth > m_tmMaxDepth.load(std::memory_order_relaxed))
+		m_tmMaxDepth.store(depth, std::memory_order_relaxed);
+
 	if (MTVU_ALWAYS_KICK) KickStart();
 	if (MTVU_SYNC_MODE)   WaitVU();
 }
@@ -276,10 +329,29 @@ u32 VU_Thread::Get_vuCycles()
 			vuCycles[3].load(std::memory_order_relaxed)) >> 2;
 }
 
-void VU_Thread::KickStart(bool forceKick)
+// The doorbell: wakes the MTVU if it is parked with published packets left to run.
+// The exchange makes sure a parked MTVU gets exactly one post, whoever rings.
+void VU_Thread::KickStart()
+{
+	if (isParked.load() && GetReadPos() != write_pos.load(std::memory_order_relaxed)
+	&&  isParked.exchange(false)) {
+		m_tmWakeups.fetch_add(1, std::memory_order_relaxed);
+		semaEvent.Post();
+	}
+}
+
+void VU_Thread::BeginBatch()
+{
+	batchDepth++;
+}
+
+void VU_Thread::EndBatch()
 {
-	if ((forceKick && !semaEvent.Count())
-	|| (!isBusy.load(std::memory_order_relaxed) && GetReadPos() != write_pos.load(std::memory_order_relaxed))) semaEvent.Post();
+	pxAssert(batchDepth > 0);
+	if (--batchDepth) return;
+	Flush();
+	if (batchKick) KickStart();
+	batchKick = false;
 }
 
 bool VU_Thread::IsDone()
@@ -290,6 +362,9 @@ bool VU_Thread::IsDone()
 void VU_Thread::WaitVU()
 {
 	MTVU_LOG("MTVU - WaitVU!");
+	Flush();
+	if (IsDone()) return;
+	u64 stallStart = GetCPUTicks();
 	for(;;) {
 		if (IsDone()) break;
 		//DevCon.WriteLn("WaitVU()");
@@ -297,6 +372,8 @@ void VU_Thread::WaitVU()
 		KickStart();
 		ScopedLock lock(mtxBusy);
 	}
+	m_tmStalls.fetch_add(1, std::memory_order_relaxed);
+	m_tmStallTicks.fetch_add(GetCPUTicks() - stallStart, std::memory_order_relaxed);
 }
 
 void VU_Thread::ExecuteVU(u32 vu_addr, u32 vif_top, u32 vif_itop)
@@ -308,6 +385,7 @@ void VU_Thread::ExecuteVU(u32 vu_addr, u32 vif_top, u32 vif_itop)
 	Write(vif_top);
 	Write(vif_itop);
 	incWritePos();
+	Flush(); // Even inside a batch, the MTGS will wait on this program's xgkick packets
 	gifUnit.TransferGSPacketData(GIF_TRANS_MTVU, NULL, 0);
 	KickStart();
 	u32 cycles = std::min(Get_vuCycles(), 3000u);
@@ -325,7 +403,8 @@ void VU_Thread::VifUnpack(vifStruct& _vif, VIFregisters& _vifRegs, u8* data, u32
 	Write(size);
 	Write(data, size);
 	incWritePos();
-	KickStart();
+	if (batchDepth) batchKick = true;
+	else            KickStart();
 }
 
 void VU_Thread::WriteMicroMem(u32 vu_micro_addr, void* data, u32 size)
@@ -367,3 +446,41 @@ void VU_Thread::WriteRow(vifStruct& _vif)
 	Write(&_vif.MaskRow, sizeof(_vif.MaskRow));
 	incWritePos();
 }
+
+// Folds the telemetry counters of the frame which just ended into m_LastFrameTelemetry.
+void VU_Thread::EndTelemetryFrame()
+{
+	MTVU_Telemetry& tm = m_LastFrameTelemetry;
+
+	tm.EEStallTicks	= m_tmStallTicks.exchange(0, std::memory_order_relaxed);
+	tm.DepthSum		= m_tmDepthSum.exchange(0, std::memory_order_relaxed);
+	tm.Stalls		= m_tmStalls.exchange(0, std::memory_order_relaxed);
+	tm.Packets		= m_tmPackets.exchange(0, std::memory_order_relaxed);
+	tm.Publishes	= m_tmPublishes.exchange(0, std::memory_order_relaxed);
+	tm.Wakeups		= m_tmWakeups.exchange(0, std::memory_order_relaxed);
+	tm.MaxDepth		= m_tmMaxDepth.exchange(0, std::memory_order_relaxed);
+
+#ifdef PCSX2_MTVU_TELEMETRY
+	static MTVU_Telemetry sum;
+	static uint frames = 0;
+
+	sum.EEStallTicks	+= tm.EEStallTicks;
+	sum.DepthSum		+= tm.DepthSum;
+	sum.Stalls			+= tm.Stalls;
+	sum.Packets			+= tm.Packets;
+	sum.Publishes		+= tm.Publishes;
+	sum.Wakeups			+= tm.Wakeups;
+	sum.MaxDepth		 = std::max(sum.MaxDepth, tm.MaxDepth);
+
+	if (++frames < 60) return;
+
+	const double ms = 1000.0 / GetTickFrequency();
+
+	Console.WriteLn( Color_Gray, "MTVU: EE stall %.2f ms (%u stalls), %u packets in %u publishes, %u wakeups, queue depth avg %u max %u (u32's)",
+		sum.EEStallTicks * ms, sum.Stalls, sum.Packets, sum.Publishes, sum.Wakeups,
+		sum.Publishes ? (u32)(sum.DepthSum / sum.Publishes) : 0, sum.MaxDepth );
+
+	memzero(sum);
+	frames = 0;
+#endif
+}
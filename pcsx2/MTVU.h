@@ -22,23 +22,58 @@
 #define MTVU_LOG(...) do{} while(0)
 //#define MTVU_LOG DevCon.WriteLn
 
+// --------------------------------------------------------------------------------------
+//  MTVU_Telemetry
+// --------------------------------------------------------------------------------------
+// Handoff statistics between the EE and the MTVU over one frame (EE vsync to EE vsync).
+// Times are in GetCPUTicks() units, queue depths in u32's of the ring.
+struct MTVU_Telemetry
+{
+	u64		EEStallTicks;	// EE time spent waiting on the MTVU (ring space or WaitVU)
+	u64		DepthSum;		// queue depth summed over every publish, for the average
+	u32		Stalls;			// times the EE had to wait on the MTVU
+	u32		Packets;		// commands queued
+	u32		Publishes;		// write_pos updates (a batch publishes all its packets at once)
+	u32		Wakeups;		// doorbells which found the MTVU parked
+	u32		MaxDepth;		// deepest the queue was at a publish
+};
+
 // Notes:
 // - This class should only be accessed from the EE thread...
 // - buffer_size must be power of 2
 // - ring-buffer has no complete pending packets when read_pos==write_pos
+// - Packets are only visible to the MTVU once write_pos is published.  Between BeginBatch()
+//   and EndBatch() they accumulate in write_offset and are published together, at the end
+//   of the batch or by the first ExecuteVU (which the MTGS may be waiting on).
+// - The MTVU parks on semaEvent when it runs out of work; KickStart() is the doorbell and
+//   only posts semaEvent while it is parked.
 class VU_Thread : public pxThread {
 	static const s32 buffer_size = (_1mb * 16) / sizeof(s32);
 	static const u32 buffer_mask = buffer_size - 1;
 	__aligned(4) u32 buffer[buffer_size];
 	std::atomic<int> read_pos; // Only modified by VU thread
 	std::atomic<bool> isBusy;   // Is thread processing data?
+	std::atomic<bool> isParked; // Is thread (about to be) waiting on semaEvent?
 	std::atomic<int> write_pos;    // Only modified by EE thread
 	__aligned(4) s32  write_offset; // Only modified by EE thread
+	__aligned(4) s32  batchDepth;   // Only modified by EE thread
+	__aligned(4) bool batchKick;    // Only modified by EE thread, a packet of the batch wants a kick
 	__aligned(4) Mutex     mtxBusy;
 	__aligned(4) Semaphore semaEvent;
 	__aligned(4) BaseVUmicroCPU*& vuCPU;
 	__aligned(4) VURegs&          vuRegs;
 
+	// Telemetry counters of the frame in progress, folded into m_LastFrameTelemetry at each
+	// EE vsync.  Relaxed atomics, the wakeups also come from the MTGS thread.
+	std::atomic<u64> m_tmStallTicks;
+	std::atomic<u64> m_tmDepthSum;
+	std::atomic<u32> m_tmStalls;
+	std::atomic<u32> m_tmPackets;
+	std::atomic<u32> m_tmPublishes;
+	std::atomic<u32> m_tmWakeups;
+	std::atomic<u32> m_tmMaxDepth;
+	MTVU_Telemetry   m_LastFrameTelemetry;
+
 public:
 	__aligned16  vifStruct        vif;
 	__aligned16  VIFregisters     vifRegs;
@@ -51,8 +86,12 @@ public:
 
 	void Reset();
 
-	// Get MTVU to start processing its packets if it isn't already
-	void KickStart(bool forceKick = false);
+	// Get MTVU to start processing its published packets if it isn't already
+	void KickStart();
+
+	// Packets queued until the matching EndBatch() are published together
+	void BeginBatch();
+	void EndBatch();
 
 	// Used for assertions...
 	bool IsDone();
@@ -74,6 +113,10 @@ public:
 
 	void WriteRow(vifStruct& _vif);
 
+	// Telemetry of the last complete frame (EE thread)
+	const MTVU_Telemetry& GetLastFrameTelemetry() const { return m_LastFrameTelemetry; }
+	void EndTelemetryFrame();
+
 protected:
 	void ExecuteTaskInThread();
 
@@ -89,6 +132,7 @@ private:
 
 	void incReadPos(s32 offset);
 	void incWritePos();
+	void Flush();
 
 	u32 Read();
 	void Read(void* dest, u32 size);
@@ -241,3 +241,12 @@ void MultipartFileReader::SetBlockSize(uint bytes)
 	}
 }
 
+void MultipartFileReader::SeekHint(uint sector, uint count, bool contiguous)
+{
+	if (sector >= GetBlockCount())
+		return;
+
+	uint i = GetFirstPart(sector);
+	m_parts[i].reader->SeekHint(sector - m_parts[i].start, std::min(count, m_parts[i].end - sector), contiguous);
+}
+
@@ -17,6 +17,7 @@
 #include "Common.h"
 #include "Vif_Dma.h"
 #include "newVif.h"
+#include "MTVU.h"
 
 //------------------------------------------------------------------
 // VifCode Transfer Interpreter (Vif0/Vif1)
@@ -69,7 +70,9 @@ _vifT static __fi bool vifTransfer(u32 *data, int size, bool TTE) {
 	int transferred = vifX.irqoffset.enabled ? vifX.irqoffset.value : 0;
 	
 	vifX.vifpacketsize = size;
+	if (idx && THREAD_VU1) vu1Thread.BeginBatch(); // Publish the unpacks with the MSCAL that uses them
 	vifTransferLoop<idx>(data);
+	if (idx && THREAD_VU1) vu1Thread.EndBatch();
 
 	transferred += size - vifX.vifpacketsize;
 
@@ -17,32 +17,225 @@
 #include "PrecompiledHeader.h"
 #include "BaseblockEx.h"
 
-BASEBLOCKEX* BaseBlocks::New(u32 startpc, uptr fnptr)
+BaseBlockArray::~BaseBlockArray()
 {
-	std::pair<linkiter_t, linkiter_t> range = links.equal_range(startpc);
-	for (linkiter_t i = range.first; i != range.second; ++i)
-		*(u32*)i->second = fnptr - (i->second + 4);
-	
-	return blocks.insert(startpc, fnptr);;
+	for (size_t r = 0; r < m_regions.size(); r++)
+		delete m_regions[r];
 }
 
-int BaseBlocks::LastIndex(u32 startpc) const
+BASEBLOCKEX* BaseBlockArray::insert(u32 startpc, uptr fnptr)
 {
-	if (0 == blocks.size())
-		return -1;
+	u32 page = startpc >> PageShift;
+	u32 r = page >> RegionShift;
+	u32 p = page & ((1 << RegionShift) - 1);
 
-	int imin = 0, imax = blocks.size() - 1, imid;
+	if (r >= m_regions.size())
+		m_regions.resize(r + 1, NULL);
+	if (!m_regions[r])
+	{
+		m_regions[r] = new Region;
+		memzero(m_regions[r]->used);
+		m_regions[r]->count = 0;
+	}
 
-	while(imin != imax) {
-		imid = (imin+imax+1)>>1;
+	Region& region = *m_regions[r];
+	Bucket& bucket = region.pages[p];
+	if (bucket.empty())
+	{
+		region.used[p / 64] |= 1ULL << (p % 64);
+		region.count++;
+	}
 
-		if (blocks[imid].startpc > startpc)
-			imax = imid - 1;
-		else
-			imin = imid;
+	// Insert the the new BASEBLOCKEX by startpc order
+	Bucket::iterator it = bucket.begin();
+	while (it != bucket.end() && it->startpc <= startpc)
+		++it;
+
+	pxAssert(it == bucket.begin() || (it - 1)->startpc != startpc);
+
+	BASEBLOCKEX block;
+	memzero(block);
+	block.startpc = startpc;
+	block.fnptr = fnptr;
+
+	m_size++;
+	return &*bucket.insert(it, block);
+}
+
+BASEBLOCKEX* BaseBlockArray::erase(BASEBLOCKEX* block)
+{
+	u32 page = block->startpc >> PageShift;
+	Bucket& bucket = *GetBucket(page);
+	size_t idx = block - &bucket[0];
+
+	bucket.erase(bucket.begin() + idx);
+	m_size--;
+
+	if (idx < bucket.size())
+		return &bucket[idx];
+
+	if (bucket.empty())
+	{
+		Region& region = *m_regions[page >> RegionShift];
+		u32 p = page & ((1 << RegionShift) - 1);
+		region.used[p / 64] &= ~(1ULL << (p % 64));
+		region.count--;
+	}
+
+	return FirstAfter(page);
+}
+
+BASEBLOCKEX* BaseBlockArray::last(u32 pc) const
+{
+	u32 page = pc >> PageShift;
+	Bucket* bucket = GetBucket(page);
+
+	if (bucket && !bucket->empty() && (*bucket)[0].startpc <= pc)
+	{
+		int imin = 0, imax = bucket->size() - 1, imid;
+
+		while(imin != imax) {
+			imid = (imin+imax+1)>>1;
+
+			if ((*bucket)[imid].startpc > pc)
+				imax = imid - 1;
+			else
+				imin = imid;
+		}
+
+		return &(*bucket)[imin];
+	}
+
+	return LastBefore(page);
+}
+
+BASEBLOCKEX* BaseBlockArray::first() const
+{
+	Bucket* bucket = GetBucket(0);
+	if (bucket && !bucket->empty())
+		return &(*bucket)[0];
+
+	return FirstAfter(0);
+}
+
+// Last block of the closest non-empty page below page
+BASEBLOCKEX* BaseBlockArray::LastBefore(u32 page) const
+{
+	const s32 mask = (1 << RegionShift) - 1;
+
+	if (page == 0 || m_regions.empty())
+		return NULL;
+
+	u32 from = std::min<u32>(page - 1, (m_regions.size() << RegionShift) - 1);
+
+	for (s32 r = from >> RegionShift; r >= 0; r--)
+	{
+		Region* region = m_regions[r];
+		if (!region || !region->count)
+			continue;
+
+		s32 p = (r == (s32)(from >> RegionShift)) ? (s32)(from & mask) : mask;
+		while (p >= 0)
+		{
+			u64 word = region->used[p / 64] & (~0ULL >> (63 - p % 64));
+			if (!word)
+			{
+				p = (p & ~63) - 1;
+				continue;
+			}
+			while (!(word & (1ULL << (p % 64))))
+				p--;
+			return &region->pages[p].back();
+		}
+	}
+
+	return NULL;
+}
+
+// First block of the closest non-empty page above page
+BASEBLOCKEX* BaseBlockArray::FirstAfter(u32 page) const
+{
+	u32 r = (page + 1) >> RegionShift;
+	u32 p = (page + 1) & ((1 << RegionShift) - 1);
+
+	for (; r < m_regions.size(); r++, p = 0)
+	{
+		Region* region = m_regions[r];
+		if (!region || !region->count)
+			continue;
+
+		for (; p < (1 << RegionShift); p++)
+		{
+			u64 word = region->used[p / 64] & (~0ULL << (p % 64));
+			if (!word)
+			{
+				p |= 63;
+				continue;
+			}
+			while (!(word & (1ULL << (p % 64))))
+				p++;
+			return &region->pages[p][0];
+		}
+	}
+
+	return NULL;
+}
+
+void BaseBlockArray::clear()
+{
+	// Buckets keep their storage, the next run is likely to need about as much.
+	for (size_t r = 0; r < m_regions.size(); r++)
+	{
+		Region* region = m_regions[r];
+		if (!region || !region->count)
+			continue;
+
+		for (int p = 0; p < (1 << RegionShift); p++)
+			region->pages[p].clear();
+		memzero(region->used);
+		region->count = 0;
+	}
+	m_size = 0;
+}
+
+void BaseBlocks::PatchLinks(u32 pc, uptr target)
+{
+	u32 mask = links.size() - 1;
+	for (u32 i = LinkHash(pc); links[i].jumpptr; i = (i + 1) & mask)
+	{
+		if (links[i].pc != pc)
+			continue;
+
+		*(u32*)links[i].jumpptr = target - (links[i].jumpptr + 4);
+		stats.patches++;
 	}
+}
+
+BASEBLOCKEX* BaseBlocks::New(u32 startpc, uptr fnptr)
+{
+	PatchLinks(startpc, fnptr);
+	stats.inserts++;
 
-	return imin;
+	return blocks.insert(startpc, fnptr);
+}
+
+BASEBLOCKEX* BaseBlocks::Remove(BASEBLOCKEX* block)
+{
+	PatchLinks(block->startpc, recompiler);
+	stats.invalidations++;
+
+	if( IsDevBuild )
+	{
+		// Clear the first instruction to 0xcc (breakpoint), as a way to assert if some
+		// static jumps get left behind to this block.  Note: Do not clear more than the
+		// first byte, since this code is called during exception handlers and event handlers
+		// both of which expect to be able to return to the recompiled code.
+
+		memset( (void*)block->fnptr, 0xcc, 1 );
+	}
+
+	// TODO: remove links from this block?
+	return blocks.erase(block);
 }
 
 #if 0
@@ -77,6 +270,40 @@ void BaseBlocks::Link(u32 pc, s32* jumpptr)
 		*jumpptr = (s32)(targetblock->fnptr - (sptr)(jumpptr + 1));
 	else
 		*jumpptr = (s32)(recompiler - (sptr)(jumpptr + 1));
-	links.insert(std::pair<u32, uptr>(pc, (uptr)jumpptr));
+
+	// Keep the table at most half full, so probe runs stay short.
+	if ((linkCount + 1) * 2 > links.size())
+	{
+		std::vector<LinkEntry> old;
+		old.swap(links);
+		links.resize(old.size() * 2);
+		u32 mask = links.size() - 1;
+		for (size_t i = 0; i < old.size(); i++)
+		{
+			if (!old[i].jumpptr)
+				continue;
+			u32 j = LinkHash(old[i].pc);
+			while (links[j].jumpptr)
+				j = (j + 1) & mask;
+			links[j] = old[i];
+		}
+	}
+
+	u32 mask = links.size() - 1;
+	u32 i = LinkHash(pc);
+	while (links[i].jumpptr)
+		i = (i + 1) & mask;
+	links[i].pc = pc;
+	links[i].jumpptr = (uptr)jumpptr;
+	linkCount++;
+	stats.links++;
 }
 
+void BaseBlocks::LogStats(const char* name) const
+{
+	if (!stats.inserts)
+		return;
+
+	DevCon.WriteLn(Color_Gray, "%s blocks: %u inserted, %u invalidated, %u links recorded, %u patched (%u blocks, %u links live)",
+		name, stats.inserts, stats.invalidations, stats.links, stats.patches, blocks.size(), linkCount);
+}
@@ -15,7 +15,7 @@
 
 #pragma once
 
-#include <map>			// used by BaseBlockEx
+#include <vector>		// used by BaseBlockArray
 
 // Every potential jump point in the PS2's addressable memory has a BASEBLOCK
 // associated with it. So that means a BASEBLOCK for every 4 bytes of PS2
@@ -36,125 +36,122 @@ struct BASEBLOCKEX
 	u16  size;	 // The size in dwords (equivalent to the number of instructions)
 	u16  x86size; // The size in byte of the translated x86 instructions
 
-#ifdef PCSX2_DEVBUILD
-	// Could be useful to instrument the block
-	//u32 visited; // number of times called
-	//u64 ltime; // regs it assumes to have set already
-#endif
+	// Blocks move around in their page bucket, so instrumentation counters can't
+	// live here. See eeBlockProfiler (R5900_Profiler.h) for the EE.
+};
 
+// Counters for the block bookkeeping, logged on recompiler resets.
+struct BaseBlockStats
+{
+	u32 inserts;        // blocks added
+	u32 invalidations;  // blocks removed by clears
+	u32 links;          // jump sites recorded by Link
+	u32 patches;        // jump sites rewritten because their target was compiled or cleared
 };
 
-class BaseBlockArray {
-	s32 _Reserved;
-	s32 _Size;
-	BASEBLOCKEX *blocks;
+// Blocks are bucketed by the 4KB page of their startpc and kept sorted inside their bucket,
+// so adding or removing a block only moves the few blocks of its page.  The buckets live in
+// a directory of 1MB regions allocated on first use, with a bitmap of the non-empty pages
+// which the walks from one bucket to the next use to skip over empty memory.
+class BaseBlockArray
+{
+	static const u32 PageShift = 12;
+	static const u32 RegionShift = 8; // pages per region
 
-	__fi void resize(s32 size)
-	{
-		pxAssert(size > 0);
-		BASEBLOCKEX *newMem = new BASEBLOCKEX[size];
-		if(blocks) {
-			memcpy(newMem, blocks, _Reserved * sizeof(BASEBLOCKEX));
-			delete[] blocks;
-		}
-		blocks = newMem;
-		pxAssert(blocks != NULL);
-	}
+	typedef std::vector<BASEBLOCKEX> Bucket;
 
-	void reserve(u32 size)
-	{
-		resize(size);
-		_Reserved = size;
-	}
-public:
-	~BaseBlockArray()
+	struct Region
 	{
-		if(blocks) {
-			delete[] blocks;
-		}
-	}
+		Bucket pages[1 << RegionShift];
+		u64 used[(1 << RegionShift) / 64];
+		u32 count; // non-empty pages
+	};
 
-	BaseBlockArray (s32 size) : _Reserved(0),
-		_Size(0), blocks(NULL)
-	{
-		reserve(size);
-	}
+	std::vector<Region*> m_regions;
+	u32 m_size;
 
-	BASEBLOCKEX *insert(u32 startpc, uptr fnptr)
+	__fi Bucket* GetBucket(u32 page) const
 	{
-		if(_Size + 1 >= _Reserved) {
-			reserve(_Reserved + 0x2000); // some games requires even more!
-		}
-
-		// Insert the the new BASEBLOCKEX by startpc order
-		int imin = 0, imax = _Size, imid;
-
-		while (imin < imax) {
-			imid = (imin+imax)>>1;
-
-			if (blocks[imid].startpc > startpc)
-				imax = imid;
-			else
-				imin = imid + 1;
-		}
-	
-		pxAssert(imin == _Size || blocks[imin].startpc > startpc);
-
-		if(imin < _Size) {
-			// make a hole for a new block.
-			memmove(blocks + imin + 1, blocks + imin, (_Size - imin) * sizeof(BASEBLOCKEX));
-		}
-
-		memset((blocks + imin), 0, sizeof(BASEBLOCKEX));
-		blocks[imin].startpc = startpc;
-		blocks[imin].fnptr = fnptr;
-
-		_Size++;
-		return &blocks[imin];
+		u32 r = page >> RegionShift;
+		if (r >= m_regions.size() || !m_regions[r])
+			return NULL;
+		return &m_regions[r]->pages[page & ((1 << RegionShift) - 1)];
 	}
 
-	__fi BASEBLOCKEX &operator[](int idx) const
+	__fi Bucket& BucketOf(const BASEBLOCKEX* block) const
 	{
-		return *(blocks + idx);
+		return *GetBucket(block->startpc >> PageShift);
 	}
 
-	void clear()
+	BASEBLOCKEX* LastBefore(u32 page) const;
+	BASEBLOCKEX* FirstAfter(u32 page) const;
+
+public:
+	BaseBlockArray() : m_size(0) {}
+	~BaseBlockArray();
+
+	BASEBLOCKEX* insert(u32 startpc, uptr fnptr);
+	BASEBLOCKEX* erase(BASEBLOCKEX* block); // returns the block which followed it
+	BASEBLOCKEX* last(u32 pc) const;        // last block with startpc <= pc
+
+	__fi BASEBLOCKEX* prev(BASEBLOCKEX* block) const
 	{
-		_Size = 0;
+		Bucket& bucket = BucketOf(block);
+		if (block != &bucket[0])
+			return block - 1;
+		return LastBefore(block->startpc >> PageShift);
 	}
 
-	__fi u32 size() const
+	__fi BASEBLOCKEX* next(BASEBLOCKEX* block) const
 	{
-		return _Size;
+		Bucket& bucket = BucketOf(block);
+		if (block != &bucket.back())
+			return block + 1;
+		return FirstAfter(block->startpc >> PageShift);
 	}
 
-	__fi void erase(s32 first, s32 last)
-	{
-		int range = last - first;
+	BASEBLOCKEX* first() const;
 
-		if(last < _Size) {
-			memmove(blocks + first, blocks + last, (_Size - last) * sizeof(BASEBLOCKEX));
-		}
+	void clear();
 
-		_Size -= range;
+	__fi u32 size() const
+	{
+		return m_size;
 	}
 };
 
 class BaseBlocks
 {
 protected:
-	typedef std::multimap<u32, uptr>::iterator linkiter_t;
+	// Jump sites waiting for the block at pc, in an open addressing table with linear probing.
+	// A pc usually has several sites, all of them are in its probe run.  Entries are only
+	// dropped by Reset, like the code they point into.
+	struct LinkEntry
+	{
+		u32 pc;
+		uptr jumpptr; // 0 if free
+	};
 
-	// switch to a hash map later?
-	std::multimap<u32, uptr> links;
+	std::vector<LinkEntry> links;
+	u32 linkCount;
 	uptr recompiler;
 	BaseBlockArray blocks;
+	BaseBlockStats stats;
+
+	__fi u32 LinkHash(u32 pc) const
+	{
+		return ((pc >> 2) * 0x9E3779B1u) & (links.size() - 1);
+	}
+
+	void PatchLinks(u32 pc, uptr target);
 
 public:
 	BaseBlocks() :
-		recompiler(0)
-	,	blocks(0x4000)
+		linkCount(0)
+	,	recompiler(0)
 	{
+		links.resize(0x4000);
+		memzero(stats);
 	}
 
 	void SetJITCompile( void (*recompiler_)() )
@@ -163,68 +160,45 @@ public:
 	}
 
 	BASEBLOCKEX* New(u32 startpc, uptr fnptr);
-	int LastIndex (u32 startpc) const;
-	//BASEBLOCKEX* GetByX86(uptr ip);
 
-	__fi int Index (u32 startpc) const
+	// Last block starting at or before startpc, which doesn't necessarily contain it.
+	__fi BASEBLOCKEX* Last(u32 startpc) const
 	{
-		int idx = LastIndex(startpc);
-
-		if ((idx == -1) || (startpc < blocks[idx].startpc) ||
-			((blocks[idx].size) && (startpc >= blocks[idx].startpc + blocks[idx].size * 4)))
-			return -1;
-		else
-			return idx;
+		return blocks.last(startpc);
 	}
 
-	__fi BASEBLOCKEX* operator[](int idx)
+	// Block containing startpc
+	__fi BASEBLOCKEX* Get(u32 startpc) const
 	{
-		if (idx < 0 || idx >= (int)blocks.size())
-			return 0;
+		BASEBLOCKEX* block = blocks.last(startpc);
 
-		return &blocks[idx];
+		if (!block || ((block->size) && (startpc >= block->startpc + block->size * 4)))
+			return NULL;
+		else
+			return block;
 	}
 
-	__fi BASEBLOCKEX* Get(u32 startpc)
-	{
-		return (*this)[Index(startpc)];
-	}
+	// Neighbours in startpc order, NULL past either end
+	__fi BASEBLOCKEX* Prev(BASEBLOCKEX* block) const { return blocks.prev(block); }
+	__fi BASEBLOCKEX* Next(BASEBLOCKEX* block) const { return blocks.next(block); }
+	__fi BASEBLOCKEX* First() const { return blocks.first(); }
 
-	__fi void Remove(int first, int last)
-	{
-		pxAssert(first <= last);
-		int idx = first;
-		do{
-			pxAssert(idx <= last);
-
-			//u32 startpc = blocks[idx].startpc;
-			std::pair<linkiter_t, linkiter_t> range = links.equal_range(blocks[idx].startpc);
-			for (linkiter_t i = range.first; i != range.second; ++i)
-				*(u32*)i->second = recompiler - (i->second + 4);
-
-			if( IsDevBuild )
-			{
-				// Clear the first instruction to 0xcc (breakpoint), as a way to assert if some
-				// static jumps get left behind to this block.  Note: Do not clear more than the
-				// first byte, since this code is called during exception handlers and event handlers
-				// both of which expect to be able to return to the recompiled code.
-
-				BASEBLOCKEX effu( blocks[idx] );
-				memset( (void*)effu.fnptr, 0xcc, 1 );
-			}
-		}
-		while(idx++ < last);
-
-		// TODO: remove links from this block?
-		blocks.erase(first, last + 1);
-	}
+	// Sends the jumps to the block back to the recompiler and removes it.  Blocks after it in
+	// the same page move down, the block which followed it is returned.  Blocks before it
+	// stay where they are.
+	BASEBLOCKEX* Remove(BASEBLOCKEX* block);
 
 	void Link(u32 pc, s32* jumpptr);
 
+	const BaseBlockStats& GetStats() const { return stats; }
+	void LogStats(const char* name) const;
+
 	__fi void Reset()
 	{
 		blocks.clear();
-		links.clear();
+		std::fill(links.begin(), links.end(), LinkEntry());
+		linkCount = 0;
+		memzero(stats);
 	}
 };
 
@@ -404,6 +404,119 @@ struct eeProfiler {
 };
 #endif
 
+//#define eeProfileBlock
+
+#ifdef eeProfileBlock
+#include <deque>
+#include <unordered_map>
+#include "DebugTools/SymbolMap.h"
+
+using namespace x86Emitter;
+
+// Counts the executions of every recompiled block, and the cycles they are
+// charged. Counters are keyed by the block pc, so they keep accumulating when
+// a block is cleared and recompiled, or when the whole recompiler is reset.
+// Define ProfileWithPerf in Perf.cpp too to annotate the blocks with perf.
+struct eeBlockProfiler {
+	struct Block {
+		u64 visited;     // incremented by the recompiled code
+		u64 cycles;      // cycles of the previous versions of the block
+		u64 visitedBase; // visited count when the current version was compiled
+		u32 startpc;
+		u32 size;        // the current version, in instructions
+		u32 x86size;
+		u32 scaled;      // scaleblockcycles() of the current version
+		u32 compiles;
+
+		u64 TotalCycles() const {
+			return cycles + (visited - visitedBase) * scaled;
+		}
+	};
+
+	// A deque doesn't move its elements, the recompiled code points into it
+	std::deque<Block> blocks;
+	std::unordered_map<u32, Block*> lookup;
+	Block* current;
+
+	void Reset() {
+		blocks.clear();
+		lookup.clear();
+		current = NULL;
+	}
+
+	// Must be emitted at the very start of the block
+	void EmitBlock(u32 startpc) {
+		Block*& b = lookup[startpc];
+		if (!b) {
+			blocks.emplace_back();
+			b = &blocks.back();
+			memzero(*b);
+			b->startpc = startpc;
+		}
+
+		b->cycles     += (b->visited - b->visitedBase) * b->scaled;
+		b->visitedBase = b->visited;
+		b->scaled      = 0;
+		b->compiles++;
+		current = b;
+
+		xADD(ptr32[(u32*)&b->visited], 1);
+		xADC(ptr32[(u32*)&b->visited + 1], 0);
+	}
+
+	void BlockCompiled(u32 size, u32 x86size, u32 scaled) {
+		current->size    = size;
+		current->x86size = x86size;
+		current->scaled  = scaled;
+		current = NULL;
+	}
+
+	void Print() {
+		u64 total = 0;
+		std::vector<std::pair<u64, Block*> > v;
+		for (auto& b : blocks) {
+			u64 cycles = b.TotalCycles();
+			total += cycles;
+			if (b.visited)
+				v.push_back(std::make_pair(cycles, &b));
+		}
+		std::sort(v.begin(), v.end(), [](const std::pair<u64, Block*>& a, const std::pair<u64, Block*>& b) {
+			return a.first > b.first;
+		});
+
+		DevCon.WriteLn("EE Block Profiler: %u blocks, %u executed", (u32)blocks.size(), (u32)v.size());
+		for (u32 i = 0; i < v.size() && i < 100; i++) {
+			const Block& b = *v[i].second;
+			double stat = (double)v[i].first / (double)total * 100.0;
+
+			char symbol[64] = "";
+			u32 func = symbolMap.GetFunctionStart(b.startpc);
+			if (func != SymbolMap::INVALID_ADDRESS) {
+				std::string label = symbolMap.GetLabelString(func);
+				if (func == b.startpc)
+					snprintf(symbol, sizeof(symbol), "%s", label.c_str());
+				else if (!label.empty())
+					snprintf(symbol, sizeof(symbol), "%s+0x%x", label.c_str(), b.startpc - func);
+			}
+
+			DevCon.WriteLn("%08x %-32s - [%3.4f%%][count=%llu][size=%u][x86size=%u][compiles=%u]",
+					b.startpc, symbol, stat, (unsigned long long)b.visited,
+					b.size, b.x86size, b.compiles);
+			if (stat < 0.01)
+				break;
+		}
+	}
+};
+#else
+struct eeBlockProfiler {
+	__fi void Reset() {}
+	__fi void EmitBlock(u32 startpc) {}
+	__fi void BlockCompiled(u32 size, u32 x86size, u32 scaled) {}
+	__fi void Print() {}
+};
+#endif
+
 namespace EE {
 	extern eeProfiler Profiler;
+	extern eeBlockProfiler BlockProfiler;
 }
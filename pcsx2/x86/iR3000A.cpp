@@ -704,6 +704,7 @@ void recResetIOP()
 	if( s_pInstCache )
 		memset( s_pInstCache, 0, sizeof(EEINST)*s_nInstCacheSize );
 
+	recBlocks.LogStats("IOP");
 	recBlocks.Reset();
 	g_psxMaxRecMem = 0;
 
@@ -780,35 +781,31 @@ static __fi u32 psxRecClearMem(u32 pc)
 	pc = HWADDR(pc);
 
 	u32 lowerextent = pc, upperextent = pc + 4;
-	int blockidx = recBlocks.Index(pc);
-	pxAssert(blockidx != -1);
+	BASEBLOCKEX* first = recBlocks.Get(pc);
+	pxAssert(first != NULL);
 
-	while (BASEBLOCKEX* pexblock = recBlocks[blockidx - 1]) {
+	while (BASEBLOCKEX* pexblock = recBlocks.Prev(first)) {
 		if (pexblock->startpc + pexblock->size * 4 <= lowerextent)
 			break;
 
 		lowerextent = std::min(lowerextent, pexblock->startpc);
-		blockidx--;
+		first = pexblock;
 	}
 
-	int toRemoveFirst = blockidx;
-
-	while (BASEBLOCKEX* pexblock = recBlocks[blockidx]) {
+	BASEBLOCKEX* pexblock = first;
+	while (pexblock) {
 		if (pexblock->startpc >= upperextent)
 			break;
 
 		lowerextent = std::min(lowerextent, pexblock->startpc);
 		upperextent = std::max(upperextent, pexblock->startpc + pexblock->size * 4);
 
-		blockidx++;
-	}
-
-	if(toRemoveFirst != blockidx) {
-		recBlocks.Remove(toRemoveFirst, (blockidx - 1));
+		pexblock = recBlocks.Remove(pexblock);
 	}
 
-	blockidx=0;
-	while(BASEBLOCKEX* pexblock = recBlocks[blockidx++])
+	// Blocks are at most 0xffff instructions long, anything containing pc starts within that
+	// distance of it.
+	for (pexblock = recBlocks.Last(pc); pexblock && pexblock->startpc + 0x40000 > pc; pexblock = recBlocks.Prev(pexblock))
 	{
 		if (pc >= pexblock->startpc && pc < pexblock->startpc + pexblock->size * 4) {
 			DevCon.Error("Impossible block clearing failure");
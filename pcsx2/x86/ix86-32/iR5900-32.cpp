@@ -65,6 +65,7 @@ u32 g_cpuHasConstReg = 0, g_cpuFlushedConstReg = 0;
 bool g_cpuFlushedPC, g_cpuFlushedCode, g_recompilingDelaySlot, g_maySignalException;
 
 eeProfiler EE::Profiler;
+eeBlockProfiler EE::BlockProfiler;
 
 ////////////////////////////////////////////////////////////////
 // Static Private Variables - R5900 Dynarec
@@ -595,6 +596,7 @@ static void recResetRaw()
 	if( s_pInstCache )
 		memset( s_pInstCache, 0, sizeof(EEINST)*s_nInstCacheSize );
 
+	recBlocks.LogStats("EE");
 	recBlocks.Reset();
 	mmap_ResetBlockTracking();
 
@@ -622,6 +624,8 @@ static void recShutdown()
 	safe_free( s_pInstCache );
 	s_nInstCacheSize = 0;
 
+	EE::BlockProfiler.Reset();
+
 	// FIXME Warning thread unsafe
 	Perf::dump();
 }
@@ -726,6 +730,7 @@ static void recExecute()
 #endif
 
 	EE::Profiler.Print();
+	EE::BlockProfiler.Print();
 }
 
 ////////////////////////////////////////////////////
@@ -767,29 +772,26 @@ void recClear(u32 addr, u32 size)
 		return;
 	addr = HWADDR(addr);
 
-	int blockidx = recBlocks.LastIndex(addr + size * 4 - 4);
+	BASEBLOCKEX* pexblock = recBlocks.Last(addr + size * 4 - 4);
 
-	if (blockidx == -1)
+	if (!pexblock)
 		return;
 
 	u32 lowerextent = (u32)-1, upperextent = 0, ceiling = (u32)-1;
 
-	BASEBLOCKEX* pexblock = recBlocks[blockidx + 1];
-	if (pexblock)
-		ceiling = pexblock->startpc;
-
-	int toRemoveLast = blockidx;
+	if (BASEBLOCKEX* next = recBlocks.Next(pexblock))
+		ceiling = next->startpc;
 
-	while (pexblock = recBlocks[blockidx]) {
+	while (pexblock) {
 		u32 blockstart = pexblock->startpc;
 		u32 blockend = pexblock->startpc + pexblock->size * 4;
 		BASEBLOCK* pblock = PC_GETBLOCK(blockstart);
 
+		// Removing a block doesn't move the ones before it.
+		BASEBLOCKEX* prev = recBlocks.Prev(pexblock);
+
 		if (pblock == s_pCurBlock) {
-			if(toRemoveLast != blockidx) {
-				recBlocks.Remove((blockidx + 1), toRemoveLast);
-			}
-			toRemoveLast = --blockidx;
+			pexblock = prev;
 			continue;
 		}
 
@@ -804,16 +806,16 @@ void recClear(u32 addr, u32 size)
 		// so set it to recompile now.  This will become JITCompile if we clear it.
 		pblock->SetFnptr((uptr)JITCompileInBlock);
 
-		blockidx--;
-	}
-
-	if(toRemoveLast != blockidx) {
-		recBlocks.Remove((blockidx + 1), toRemoveLast);
+		recBlocks.Remove(pexblock);
+		pexblock = prev;
 	}
 
 	upperextent = std::min(upperextent, ceiling);
 
-	for (int i = 0; pexblock = recBlocks[i]; i++) {
+	// Blocks are at most 0xffff instructions long, anything overlapping the range starts
+	// within that distance of it.
+	u32 checkstart = addr > 0x40000 ? addr - 0x40000 : 0;
+	for (pexblock = recBlocks.Last(addr + size * 4 - 4); pexblock && pexblock->startpc >= checkstart; pexblock = recBlocks.Prev(pexblock)) {
 		if (s_pCurBlock == PC_GETBLOCK(pexblock->startpc))
 			continue;
 		u32 blockend = pexblock->startpc + pexblock->size * 4;
@@ -1647,6 +1649,8 @@ static void __fastcall recRecompile( const u32 startpc )
 
 	pxAssert(s_pCurBlockEx);
 
+	EE::BlockProfiler.EmitBlock(HWADDR(startpc));
+
 	if (HWADDR(startpc) == EELOAD_START) {
 		// The EELOAD _start function is the same across all BIOS versions afaik
 		u32 mainjump = memRead32(EELOAD_START + 0x9c);
@@ -2013,8 +2017,7 @@ StartRecomp:
 		BASEBLOCKEX *oldBlock;
 		int i;
 
-		i = recBlocks.LastIndex(HWADDR(pc) - 4);
-		while (oldBlock = recBlocks[i--]) {
+		for (oldBlock = recBlocks.Last(HWADDR(pc) - 4); oldBlock; oldBlock = recBlocks.Prev(oldBlock)) {
 			if (oldBlock == s_pCurBlockEx)
 				continue;
 			if (oldBlock->startpc >= HWADDR(pc))
@@ -2089,6 +2092,8 @@ StartRecomp:
 	pxAssert(xGetPtr() - recPtr < _64kb);
 	s_pCurBlockEx->x86size = xGetPtr() - recPtr;
 
+	EE::BlockProfiler.BlockCompiled(s_pCurBlockEx->size, s_pCurBlockEx->x86size, scaleblockcycles());
+
 #if 0
 	// Example: Dump both x86/EE code
 	if (startpc == 0x456630) {
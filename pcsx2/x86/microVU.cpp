@@ -68,6 +68,8 @@ void mVUinit(microVU& mVU, uint vuIndex) {
 	memset(mVU.dispCache, 0xcc, mVUdispCacheSize);
 
 	mVU.regAlloc.reset(new microRegAlloc(mVU.index));
+	mVU.progCache.reset(new microProgCache());
+	mVU.progIndex.reset(new microProgIndex());
 }
 
 // Resets Rec Data
@@ -95,6 +97,7 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 	mVU.prog.cur		= NULL;
 	mVU.prog.total		=  0;
 	mVU.prog.curFrame	=  0;
+	mVU.compileDepth	=  0;
 
 	// Setup Dynarec Cache Limits for Each Program
 	u8* z = mVU.cache;
@@ -103,6 +106,11 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 	mVU.prog.x86end		= z + ((mVU.cacheSize - mVUcacheSafeZone) * _1mb);
 	//memset(mVU.prog.x86start, 0xcc, mVU.cacheSize*_1mb);
 
+	mVUcacheMerge(mVU); // Remember the programs before deleting them
+	for(u32 i = 0; i < mProgBuckets; i++) {
+		mVU.progIndex->bucket[i].clear();
+	}
+	memzero(mVU.progIndex->keyWords);
 	for(u32 i = 0; i < (mVU.progSize / 2); i++) {
 		if(!mVU.prog.prog[i]) {
 			mVU.prog.prog[i] = new std::deque<microProgram*>();
@@ -125,6 +133,8 @@ void mVUclose(microVU& mVU) {
 	SafeSysMunmap(mVU.dispCache, mVUdispCacheSize);
 
 	// Delete Programs and Block Managers
+	mVUcacheStore(mVU);
+	mVU.progIndex.reset();
 	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
 		if (!mVU.prog.prog[i]) continue;
 		std::deque<microProgram*>::iterator it(mVU.prog.prog[i]->begin());
@@ -154,6 +164,28 @@ __fi void mVUclear(mV, u32 addr, u32 size) {
 // Finds and Ages/Kills Programs if they haven't been used in a while.
 __ri void mVUvsyncUpdate(mV) {
 	//mVU.prog.curFrame++;
+	if (!mVU.progIndex) return;
+	microSearchStats& st = mVU.progIndex->lastFrame;
+	st.searches		= mVU.progIndex->tmSearches.exchange(0, std::memory_order_relaxed);
+	st.filtered		= mVU.progIndex->tmFiltered.exchange(0, std::memory_order_relaxed);
+	st.compares		= mVU.progIndex->tmCompares.exchange(0, std::memory_order_relaxed);
+	st.recompiles	= mVU.progIndex->tmRecompiles.exchange(0, std::memory_order_relaxed);
+
+	if (doSearchStats) {
+		static microSearchStats sum[2];
+		static uint frames[2];
+		microSearchStats& s = sum[mVU.index];
+		s.searches		+= st.searches;
+		s.filtered		+= st.filtered;
+		s.compares		+= st.compares;
+		s.recompiles	+= st.recompiles;
+		if (++frames[mVU.index] < 60) return;
+		Console.WriteLn(mVU.index ? Color_Orange : Color_Magenta,
+			"microVU%d: %u program searches, %u programs compared (%u skipped by entry key), %u recompiled (60 frames)",
+			mVU.index, s.searches, s.compares, s.filtered, s.recompiles);
+		memzero(s);
+		frames[mVU.index] = 0;
+	}
 }
 
 // Deletes a program
@@ -172,6 +204,7 @@ __ri microProgram* mVUcreateProg(microVU& mVU, int startPC) {
 	prog->idx     = mVU.prog.total++;
 	prog->ranges  = new std::deque<microRange>();
 	prog->startPC = startPC;
+	prog->crc     = ElfCRC;
 	mVUcacheProg(mVU, *prog); // Cache Micro Program
 	double cacheSize = (double)((uptr)mVU.prog.x86end - (uptr)mVU.prog.x86start);
 	double cacheUsed =((double)((uptr)mVU.prog.x86ptr - (uptr)mVU.prog.x86start)) / (double)_1mb;
@@ -249,33 +282,118 @@ __fi bool mVUcmpProg(microVU& mVU, microProgram& prog, const bool cmpWholeProg)
 	return false;
 }
 
+// The entry key of a program hashes the microcode at its startPC, up to mVUentryKeyWords
+// words but only as far as the recompiled range holding startPC goes.  mVUcmpPartial()
+// always compares those words, so a program whose key doesn't match micro memory can't
+// match it either; and as ranges only ever grow, the key stays valid for the program's life.
+static const u32 mVUentryKeyWords = 16;
+
+static __fi u64 mVUentryKey(u32 startPC, const u32* data, u32 words) {
+	u64 hash = 0xcbf29ce484222325ull ^ (startPC | (words << 16));
+	for (u32 i = 0; i < words; i++) {
+		hash = (hash ^ data[startPC * 2 + i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static u32 mVUentryWords(microVU& mVU, microProgram& prog) {
+	s32 pc    = prog.startPC * 8;
+	u32 words = 0;
+	std::deque<microRange>::const_iterator it(prog.ranges->begin());
+	for ( ; it != prog.ranges->end(); ++it) {
+		if ((pc >= it[0].start) && (pc <= it[0].end)) {
+			words = std::max<u32>(words, (it[0].end + 8 - pc) / 4);
+		}
+	}
+	return std::min(std::min(words, mVUentryKeyWords), mVU.progSize - pc / 4);
+}
+
+// Adds a program to the hash index (once its entry block is recompiled)
+__ri void mVUindexProg(microVU& mVU, microProgram& prog) {
+	u32 words = mVUentryWords(mVU, prog);
+	prog.entryKey = mVUentryKey(prog.startPC, prog.data, words);
+	mVU.progIndex->keyWords[prog.startPC] |= 1 << words;
+	mVU.progIndex->bucket[prog.entryKey % mProgBuckets].push_back(&prog);
+}
+
+// Finds the program for startPC matching micro memory through the hash index; only the
+// programs whose entry key matches the microcode are compared.
+__ri microProgram* mVUfindProg(microVU& mVU, u32 startPC) {
+	const u32* micro = (u32*)mVU.regs().Micro;
+	u32 filtered = 0, compares = 0;
+	microProgram* found = NULL;
+	for (u32 words = 0, lens = mVU.progIndex->keyWords[startPC / 8]; lens && !found; words++, lens >>= 1) {
+		if (!(lens & 1)) continue;
+		u64 key = mVUentryKey(startPC / 8, micro, words);
+		std::vector<microProgram*>& bucket = mVU.progIndex->bucket[key % mProgBuckets];
+		std::vector<microProgram*>::iterator it(bucket.begin());
+		for ( ; it != bucket.end(); ++it) {
+			if (it[0]->entryKey != key) { filtered++; continue; }
+			compares++;
+			if (mVUcmpProg(mVU, *it[0], 0)) {
+				found = it[0];
+				std::rotate(bucket.begin(), it, it + 1); // Most recently used first
+				break;
+			}
+		}
+	}
+	mVU.progIndex->tmFiltered.fetch_add(filtered, std::memory_order_relaxed);
+	mVU.progIndex->tmCompares.fetch_add(compares, std::memory_order_relaxed);
+	return found;
+}
+
+// Finds the program for startPC matching micro memory by comparing all of them, in most
+// recently used order (the Scarface gamefix relies on it)
+_mVUt __ri microProgram* mVUscanProg(u32 startPC) {
+	microVU& mVU = mVUx;
+	microProgramList* list = mVU.prog.prog[startPC/8];
+	std::deque<microProgram*>::iterator it(list->begin());
+	for ( ; it != list->end(); ++it) {
+		mVU.progIndex->tmCompares.fetch_add(1, std::memory_order_relaxed);
+		bool b = mVUcmpProg(mVU, *it[0], 0);
+		if (EmuConfig.Gamefixes.ScarfaceIbit) {
+			if (isVU1 && ((((u32*)mVU.regs().Micro)[startPC / 4 + 1]) == 0x80200118) && ((((u32*)mVU.regs().Micro)[startPC / 4 + 3]) == 0x81000062)) {
+				b = true;
+				mVU.prog.cleared = 0;
+				mVU.prog.cur = it[0];
+				mVU.prog.isSame = 1;
+			}
+		}
+		if (b) {
+			microProgram* prog = it[0];
+			list->erase(it);
+			list->push_front(prog);
+			return prog;
+		}
+	}
+	return NULL;
+}
+
 // Searches for Cached Micro Program and sets prog.cur to it (returns entry-point to program)
 _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState) {
 	microVU& mVU = mVUx;
 	microProgramQuick& quick = mVU.prog.quick[startPC/8];
 	microProgramList*  list  = mVU.prog.prog [startPC/8];
 	if(!quick.prog) { // If null, we need to search for new program
-		std::deque<microProgram*>::iterator it(list->begin());
-		for ( ; it != list->end(); ++it) {
-			bool b = mVUcmpProg(mVU, *it[0], 0);
-			if (EmuConfig.Gamefixes.ScarfaceIbit) {
-				if (isVU1 && ((((u32*)mVU.regs().Micro)[startPC / 4 + 1]) == 0x80200118) && ((((u32*)mVU.regs().Micro)[startPC / 4 + 3]) == 0x81000062)) {
-					b = true;
-					mVU.prog.cleared = 0;
-					mVU.prog.cur = it[0];
-					mVU.prog.isSame = 1;
+		mVU.progIndex->tmSearches.fetch_add(1, std::memory_order_relaxed);
+		do {
+			microProgram* prog = EmuConfig.Gamefixes.ScarfaceIbit ? mVUscanProg<vuIndex>(startPC)
+																  : mVUfindProg(mVU, startPC);
+			if (prog) {
+				quick.block = prog->block[startPC/8];
+				quick.prog  = prog;
+				if (prog->prewarm) { // First use of a program recompiled ahead
+					prog->prewarm = false;
+					mVU.progCache->hits++;
+					mVU.progCache->savedTicks += prog->compileTicks;
 				}
-			}
-			if (b) {
-				quick.block = it[0]->block[startPC/8];
-				quick.prog  = it[0];
-				list->erase(it);
-				list->push_front(quick.prog);
 				return mVUentryGet(mVU, quick.block, startPC, pState);
 			}
-		}
+		} while (mVUcachePrewarm(mVU)); // Not found, look again after recompiling the game's cached programs
 
 		// If cleared and program not found, make a new program instance
+		if (mVU.progCache->crc) mVU.progCache->misses++;
+		mVU.progIndex->tmRecompiles.fetch_add(1, std::memory_order_relaxed);
 		mVU.prog.cleared	= 0;
 		mVU.prog.isSame		= 1;
 		mVU.prog.cur		= mVUcreateProg(mVU,  startPC/8);
@@ -283,6 +401,7 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState) {
 		quick.block			= mVU.prog.cur->block[startPC/8];
 		quick.prog			= mVU.prog.cur;
 		list->push_front(mVU.prog.cur);
+		mVUindexProg(mVU, *mVU.prog.cur);
 		//mVUprintUniqueRatio(mVU);
 		return entryPoint;
 	}
@@ -23,6 +23,7 @@ using namespace x86Emitter;
 #include <deque>
 #include <algorithm>
 #include <memory>
+#include <atomic>
 #include "Common.h"
 #include "VU.h"
 #include "MTVU.h"
@@ -30,6 +31,7 @@ using namespace x86Emitter;
 #include "Gif_Unit.h"
 #include "iR5900.h"
 #include "R5900OpcodeTables.h"
+#include "Elfheader.h"
 #include "System/RecTypes.h"
 #include "x86emitter/x86emitter.h"
 #include "microVU_Misc.h"
@@ -117,6 +119,13 @@ public:
 		}
 		return NULL;
 	}
+	// Appends the entry states of all the blocks (used by the program cache)
+	void getStates(std::vector<const microRegInfo*>& states) const {
+		for(microBlockLink* linkI = qBlockList; linkI != NULL; linkI = linkI->next)
+			states.push_back(&linkI->block.pState);
+		for(microBlockLink* linkI = fBlockList; linkI != NULL; linkI = linkI->next)
+			states.push_back(&linkI->block.pState);
+	}
 	void printInfo(int pc, bool printQuick) {
 		int listI = printQuick ? qListI : fListI;
 		if (listI < 7) return;
@@ -142,16 +151,59 @@ struct microRange {
 };
 
 #define mProgSize (0x4000/4)
+#define mProgBuckets 0x1000 // Buckets of the microProgram hash index (see mVUentryKey)
 struct microProgram {
 	u32				   data [mProgSize];   // Holds a copy of the VU microProgram
 	microBlockManager* block[mProgSize/2]; // Array of Block Managers
 	std::deque<microRange>* ranges;			   // The ranges of the microProgram that have already been recompiled
 	u32 startPC; // Start PC of this program
 	int idx;	 // Program index
+	u32 crc;	 // ElfCRC of the game which was running when the program was created
+	u64 compileTicks; // Time spent recompiling the program's blocks
+	bool prewarm;	  // Recompiled ahead by the program cache and not used yet
+	u64 entryKey;	  // Hash of the microcode at startPC, for the hash index (see mVUentryKey)
 };
 
 typedef std::deque<microProgram*> microProgramList;
 
+// A microProgram as remembered by the program cache (microVU_Cache.inl)
+struct microCachedBlock {
+	u32 startPC;						// Start PC of the block
+	u8  pState[sizeof(microRegInfo)];	// Its entry pipeline state (microRegInfo, unaligned)
+};
+
+struct microCachedProg {
+	u32 startPC;	// Index of the program list the program was in (startPC/8)
+	u64 hash;		// Hash of the microcode within the recompiled ranges
+	std::vector<u32>				data;	// The microcode
+	std::vector<microRange>			ranges;	// The ranges which were recompiled
+	std::vector<microCachedBlock>	blocks;	// The blocks which were recompiled
+};
+
+// The microPrograms a game has run, kept on disk across sessions and recompiled ahead of
+// time the next time the game runs (see doProgCache).
+struct microProgCache {
+	u32  crc;		// ElfCRC of the game whose programs are loaded (0 = none)
+	bool prewarmed;	// The loaded programs have been recompiled (once per game load)
+	bool dirty;		// Programs were added since the cache was loaded or saved
+	std::vector<microCachedProg> progs;
+
+	// Stats since the cache was loaded or saved
+	u32  prewarmCount;	// Programs recompiled ahead
+	u64  prewarmTicks;	// ...and the time it took
+	u32  hits;			// Programs which were found recompiled ahead when first used
+	u32  misses;		// Programs which had to be recompiled when first used
+	u64  savedTicks;	// Recompilation time of the hits, taken out of the game's run
+};
+
+// microProgram search stats over one frame (see mVUvsyncUpdate)
+struct microSearchStats {
+	u32 searches;	// Searches for a program (quick reference misses)
+	u32 filtered;	// Programs skipped by their entry key
+	u32 compares;	// Programs compared against micro memory
+	u32 recompiles;	// New programs created since none matched
+};
+
 struct microProgramQuick {
 	microBlockManager*    block; // Quick reference to valid microBlockManager for current startPC
 	microProgram*		  prog;	 // The microProgram who is the owner of 'block'
@@ -172,6 +224,21 @@ struct microProgManager {
 	microRegInfo		lpState;			// Pipeline state from where program left off (useful for continuing execution)
 };
 
+// Hash index of the microPrograms and their search stats (see mVUfindProg).  Not part of
+// microProgManager, which gets memzero'd.
+struct microProgIndex {
+	std::vector<microProgram*> bucket[mProgBuckets]; // All microPrograms, hashed by their entryKey
+	u32 keyWords[mProgSize/2]; // Entry key lengths in use for each startPC (bit n = n words)
+
+	// Search stats of the frame in progress, folded into lastFrame at each vsync.  Relaxed
+	// atomics, the vsync comes from the EE thread while VU1 may be running on the MTVU.
+	std::atomic<u32> tmSearches;
+	std::atomic<u32> tmFiltered;
+	std::atomic<u32> tmCompares;
+	std::atomic<u32> tmRecompiles;
+	microSearchStats lastFrame;
+};
+
 static const uint mVUdispCacheSize	= __pagesize; // Dispatcher Cache Size (in bytes)
 static const uint mVUcacheSafeZone	= 3;		  // Safe-Zone for program recompilation (in megabytes)
 static const uint mVU0cacheReserve	= 64;		  // mVU0 Reserve Cache Size (in megabytes)
@@ -197,6 +264,8 @@ struct microVU {
 	microProfiler					profiler;   // Opcode Profiler
 	std::unique_ptr<microRegAlloc>	regAlloc;	// Reg Alloc Class
 	std::unique_ptr<AsciiFile>		logFile;	// Log File Pointer
+	std::unique_ptr<microProgCache>	progCache;	// Persistent microProgram Cache
+	std::unique_ptr<microProgIndex>	progIndex;	// microProgram Hash Index
 
 	RecompiledCodeReserve* cache_reserve;
 	u8*		cache;		  // Dynarec Cache Start (where we will start writing the recompiled code to)
@@ -217,6 +286,7 @@ struct microVU {
 	u32		q;			  // Holds current Q instance index
 	u32		totalCycles;  // Total Cycles that mVU is expected to run for
 	u32		cycles;		  // Cycles Counter
+	u32		compileDepth; // Nesting of mVUcompile() calls (for timing the outermost one)
 
 	VURegs& regs() const { return ::vuRegs[index]; }
 
@@ -249,6 +319,11 @@ mVUop(mVUopL);
 // Private Functions
 extern void  mVUcacheProg (microVU& mVU, microProgram&  prog);
 extern void  mVUdeleteProg(microVU& mVU, microProgram*& prog);
+extern microProgram* mVUcreateProg(microVU& mVU, int startPC);
+extern void  mVUindexProg (microVU& mVU, microProgram&  prog);
+extern bool  mVUcachePrewarm(microVU& mVU);
+extern void  mVUcacheMerge  (microVU& mVU);
+extern void  mVUcacheStore  (microVU& mVU);
 _mVUt extern void* mVUsearchProg(u32 startPC, uptr pState);
 extern void* __fastcall mVUexecuteVU0(u32 startPC, u32 cycles);
 extern void* __fastcall mVUexecuteVU1(u32 startPC, u32 cycles);
@@ -281,3 +356,4 @@ void sortVector(T& v) {
 #include "microVU_Compile.inl"
 #include "microVU_Execute.inl"
 #include "microVU_Macro.inl"
+#include "microVU_Cache.inl"
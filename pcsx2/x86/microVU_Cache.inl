@@ -0,0 +1,259 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2010  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "AppConfig.h"
+
+//------------------------------------------------------------------
+// Micro VU - Persistent microProgram Cache
+//------------------------------------------------------------------
+// The x86 code itself isn't kept (it points into this session's memory), only what is
+// needed to recompile it: the microcode, the ranges that were recompiled and the entry
+// pipeline state of every block.  One file per game (ElfCRC) and VU:
+//
+//   header: magic, version, vu index, progSize, sizeof(microRegInfo), crc, program count
+//   per program: startPC, hash, range count, block count,
+//                data[progSize], ranges, blocks (startPC + microRegInfo)
+
+static const u32 mVUcacheMagic		= 0x4355566d; // "mVUC"
+static const u32 mVUcacheVersion	= 2;
+static const u32 mVUcacheMaxProgs	= 1024; // Per game and VU, the oldest ones get dropped
+static const u32 mVUcachePrewarmFrac	= 4;	// Recompile ahead into at most 1/4 of the rec cache
+
+static wxString mVUcacheFileName(microVU& mVU, u32 crc) {
+	wxDirName dir(GetSettingsFolder().Combine(wxDirName(L"cache")));
+	return Path::Combine(dir, wxsFormat(L"microVU%d_%08X.bin", mVU.index, crc));
+}
+
+// FNV-1a over the words of the recompiled ranges (the same ones mVUcmpPartial compares)
+static u64 mVUcacheHash(microVU& mVU, const u32* data, const std::vector<microRange>& ranges) {
+	u64 hash = 0xcbf29ce484222325ull;
+	for (size_t r = 0; r < ranges.size(); r++) {
+		u32 end = std::min<u32>((ranges[r].end + 8) / 4, mVU.progSize);
+		for (u32 i = ranges[r].start / 4; i < end; i++) {
+			hash = (hash ^ data[i]) * 0x100000001b3ull;
+		}
+	}
+	return hash;
+}
+
+static bool mVUcacheIsValid(microVU& mVU, const microCachedProg& cp) {
+	if (cp.startPC >= mVU.progSize / 2) return false;
+	for (size_t r = 0; r < cp.ranges.size(); r++) {
+		const microRange& range = cp.ranges[r];
+		if (range.start < 0 || range.end < range.start || (u32)range.end > mVU.microMemSize) return false; // Wrapped ranges end at microMemSize
+	}
+	for (size_t b = 0; b < cp.blocks.size(); b++) {
+		if ((cp.blocks[b].startPC & 7) || cp.blocks[b].startPC > mVU.microMemSize - 8) return false;
+	}
+	return !cp.blocks.empty() && mVUcacheHash(mVU, cp.data.data(), cp.ranges) == cp.hash;
+}
+
+// Loads the programs of the game with the given crc (none for crc 0)
+static void mVUcacheLoad(microVU& mVU, u32 crc) {
+	microProgCache& cache = *mVU.progCache;
+	cache.progs.clear();
+	cache.crc		= crc;
+	cache.prewarmed	= false;
+	cache.dirty		= false;
+	if (!crc) return;
+
+	const wxString fname(mVUcacheFileName(mVU, crc));
+	if (!wxFileExists(fname)) return;
+	wxFFile fp(fname, L"rb");
+	if (!fp.IsOpened()) return;
+
+	u32 header[7];
+	if (fp.Read(header, sizeof(header)) != sizeof(header)
+	||  header[0] != mVUcacheMagic || header[1] != mVUcacheVersion || header[2] != mVU.index
+	||  header[3] != mVU.progSize  || header[4] != sizeof(microRegInfo) || header[5] != crc) {
+		Console.Warning(L"microVU%d: Ignoring outdated program cache %s", mVU.index, WX_STR(fname));
+		return;
+	}
+
+	for (u32 i = 0; i < std::min(header[6], mVUcacheMaxProgs); i++) {
+		microCachedProg cp;
+		u32 counts[2];
+		bool ok = fp.Read(&cp.startPC, sizeof(cp.startPC)) == sizeof(cp.startPC)
+			&& fp.Read(&cp.hash, sizeof(cp.hash)) == sizeof(cp.hash)
+			&& fp.Read(counts, sizeof(counts)) == sizeof(counts)
+			&& counts[0] <= mVU.progSize && counts[1] <= mVU.progSize * 4;
+		if (ok) {
+			cp.data.resize(mVU.progSize);
+			cp.ranges.resize(counts[0]);
+			cp.blocks.resize(counts[1]);
+			ok = fp.Read(cp.data.data(), mVU.microMemSize) == mVU.microMemSize
+				&& fp.Read(cp.ranges.data(), counts[0] * sizeof(microRange)) == counts[0] * sizeof(microRange)
+				&& fp.Read(cp.blocks.data(), counts[1] * sizeof(microCachedBlock)) == counts[1] * sizeof(microCachedBlock)
+				&& mVUcacheIsValid(mVU, cp);
+		}
+		if (!ok) {
+			Console.Warning(L"microVU%d: Program cache %s is damaged, ignoring it", mVU.index, WX_STR(fname));
+			cache.progs.clear();
+			return;
+		}
+		cache.progs.push_back(std::move(cp));
+	}
+	DevCon.WriteLn(mVU.index ? Color_Orange : Color_Magenta, "microVU%d: Loaded %d cached programs for game [%08X]",
+				   mVU.index, (int)cache.progs.size(), crc);
+}
+
+static void mVUcacheSave(microVU& mVU) {
+	microProgCache& cache = *mVU.progCache;
+	wxDirName(GetSettingsFolder().Combine(wxDirName(L"cache"))).Mkdir();
+	const wxString fname(mVUcacheFileName(mVU, cache.crc));
+	wxFFile fp(fname, L"wb");
+	if (!fp.IsOpened()) {
+		Console.Warning(L"microVU%d: Could not write the program cache %s", mVU.index, WX_STR(fname));
+		return;
+	}
+
+	u32 header[7] = { mVUcacheMagic, mVUcacheVersion, mVU.index, mVU.progSize,
+					  sizeof(microRegInfo), cache.crc, (u32)cache.progs.size() };
+	fp.Write(header, sizeof(header));
+	for (size_t i = 0; i < cache.progs.size(); i++) {
+		const microCachedProg& cp = cache.progs[i];
+		u32 counts[2] = { (u32)cp.ranges.size(), (u32)cp.blocks.size() };
+		fp.Write(&cp.startPC, sizeof(cp.startPC));
+		fp.Write(&cp.hash, sizeof(cp.hash));
+		fp.Write(counts, sizeof(counts));
+		fp.Write(cp.data.data(), mVU.microMemSize);
+		fp.Write(cp.ranges.data(), counts[0] * sizeof(microRange));
+		fp.Write(cp.blocks.data(), counts[1] * sizeof(microCachedBlock));
+	}
+}
+
+// Adds the game's programs of this session to the (in memory) cache.  Called before
+// programs are deleted; mid-game resets only get here, the file is written by mVUcacheStore.
+void mVUcacheMerge(microVU& mVU) {
+	if (!doProgCache || !mVU.progCache) return;
+	microProgCache& cache = *mVU.progCache;
+	if (!cache.crc) return;
+
+	for (u32 pc = 0; pc < mVU.progSize / 2; pc++) {
+		microProgramList* list = mVU.prog.prog[pc];
+		if (!list) continue;
+		for (std::deque<microProgram*>::iterator it(list->begin()); it != list->end(); ++it) {
+			microProgram& prog = *it[0];
+			if (prog.crc != cache.crc || prog.prewarm || prog.ranges->empty()) continue;
+
+			microCachedProg cp;
+			cp.startPC		= pc;
+			cp.data.assign(prog.data, prog.data + mVU.progSize);
+			cp.ranges.assign(prog.ranges->begin(), prog.ranges->end());
+			cp.hash			= mVUcacheHash(mVU, prog.data, cp.ranges);
+
+			std::vector<const microRegInfo*> states;
+			for (u32 i = 0; i < mVU.progSize / 2; i++) {
+				if (!prog.block[i]) continue;
+				size_t first = states.size();
+				prog.block[i]->getStates(states);
+				for (size_t j = first; j < states.size(); j++) {
+					microCachedBlock b;
+					b.startPC = i * 8;
+					memcpy(b.pState, states[j], sizeof(microRegInfo));
+					cp.blocks.push_back(b);
+				}
+			}
+			if (cp.blocks.empty()) continue;
+
+			// A program the cache already has only gets replaced if it gained blocks
+			std::vector<microCachedProg>::iterator old = cache.progs.begin();
+			for ( ; old != cache.progs.end(); ++old) {
+				if (old->startPC == cp.startPC && old->hash == cp.hash && old->ranges.size() == cp.ranges.size()) break;
+			}
+			if (old == cache.progs.end()) cache.progs.push_back(std::move(cp));
+			else if (old->blocks.size() < cp.blocks.size()) *old = std::move(cp);
+			else continue;
+			cache.dirty = true;
+		}
+	}
+	if (cache.progs.size() > mVUcacheMaxProgs) {
+		cache.progs.erase(cache.progs.begin(), cache.progs.end() - mVUcacheMaxProgs);
+	}
+}
+
+// Merges the game's programs and saves the cache (if anything changed), and reports how the
+// programs recompiled ahead did.  Called when the rec is closed and when the game changes.
+void mVUcacheStore(microVU& mVU) {
+	if (!doProgCache || !mVU.progCache) return;
+	microProgCache& cache = *mVU.progCache;
+	if (!cache.crc) return;
+
+	mVUcacheMerge(mVU);
+	if (cache.dirty) mVUcacheSave(mVU);
+	cache.dirty = false;
+
+	if (cache.prewarmCount || cache.hits || cache.misses) {
+		const double ms = 1000.0 / GetTickFrequency();
+		u32 uses = cache.hits + cache.misses;
+		Console.WriteLn(mVU.index ? Color_Orange : Color_Magenta,
+			"microVU%d: Program cache [%08X]: %d programs recompiled ahead in %.1f ms, "
+			"%d/%d first uses hit (%.1f%%), %.1f ms of recompilation taken out of the game",
+			mVU.index, cache.crc, cache.prewarmCount, cache.prewarmTicks * ms,
+			cache.hits, uses, uses ? 100.0 * cache.hits / uses : 0.0, cache.savedTicks * ms);
+	}
+	cache.prewarmCount	= 0;
+	cache.prewarmTicks	= 0;
+	cache.hits			= 0;
+	cache.misses		= 0;
+	cache.savedTicks	= 0;
+}
+
+// Recompiles the cached programs of the running game, once per game load (not again after
+// the rec cache fills up and gets reset, that would only fill it up sooner).  Called when a
+// program search came up empty; returns true if there are new programs to search.
+bool mVUcachePrewarm(microVU& mVU) {
+	if (!doProgCache) return false;
+	microProgCache& cache = *mVU.progCache;
+	if (cache.crc != ElfCRC) { // Game changed, keep the previous game's programs and load this one's
+		mVUcacheStore(mVU);
+		mVUcacheLoad (mVU, ElfCRC);
+	}
+	if (cache.prewarmed || cache.progs.empty()) return false;
+	cache.prewarmed = true;
+
+	u64 start = GetCPUTicks();
+	u8* limit = mVU.prog.x86start + (mVU.prog.x86end - mVU.prog.x86start) / mVUcachePrewarmFrac;
+	std::vector<u32> micro((u32*)mVU.regs().Micro, (u32*)mVU.regs().Micro + mVU.progSize);
+	__aligned16 microRegInfo pState;
+	u32 count = 0;
+
+	// Each program is recompiled from its own microcode, swapped into micro memory meanwhile
+	for (size_t i = 0; i < cache.progs.size() && xGetPtr() < limit; i++) {
+		const microCachedProg& cp = cache.progs[i];
+		memcpy(mVU.regs().Micro, cp.data.data(), mVU.microMemSize);
+		mVU.prog.isSame	= 1;
+		mVU.prog.cur	= mVUcreateProg(mVU, cp.startPC);
+		for (size_t b = 0; b < cp.blocks.size(); b++) {
+			memcpy(&pState, cp.blocks[b].pState, sizeof(pState));
+			mVUblockFetch(mVU, cp.blocks[b].startPC, (uptr)&pState);
+		}
+		mVU.prog.cur->prewarm = true;
+		mVU.prog.prog[cp.startPC]->push_back(mVU.prog.cur); // Behind the programs in use
+		mVUindexProg(mVU, *mVU.prog.cur);
+		count++;
+	}
+
+	memcpy(mVU.regs().Micro, micro.data(), mVU.microMemSize);
+	mVU.prog.cur	= NULL;
+	mVU.prog.isSame	= -1;
+	cache.prewarmCount += count;
+	cache.prewarmTicks += GetCPUTicks() - start;
+	DevCon.WriteLn(mVU.index ? Color_Orange : Color_Magenta, "microVU%d: Recompiled %d cached programs ahead [%3.1f ms]",
+				   mVU.index, count, (GetCPUTicks() - start) * 1000.0 / GetTickFrequency());
+	return count > 0;
+}
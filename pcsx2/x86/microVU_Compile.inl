@@ -664,7 +664,10 @@ void* mVUcompile(microVU& mVU, u32 startPC, uptr pState) {
 __fi void* mVUentryGet(microVU& mVU, microBlockManager* block, u32 startPC, uptr pState) {
 	microBlock* pBlock = block->search((microRegInfo*)pState);
 	if (pBlock) return pBlock->x86ptrStart;
-	else	 {  return mVUcompile(mVU, startPC, pState);}
+	u64 start = mVU.compileDepth++ ? 0 : GetCPUTicks();
+	void* entry = mVUcompile(mVU, startPC, pState);
+	if (!--mVU.compileDepth) mVU.prog.cur->compileTicks += GetCPUTicks() - start;
+	return entry;
 }
 
  // Search for Existing Compiled Block (if found, return x86ptr; else, compile and return x86ptr)
@@ -338,6 +338,19 @@ static const bool doDBitHandling = false;
 // need this method of pausing the VU should be using the T-Bit instead, however
 // this could prove useful for VU debugging.
 
+// Persistent microProgram Cache
+static const bool doProgCache = true; // Set to true to keep the microPrograms of games on disk
+// The microcode, recompiled ranges and block entry states of the microPrograms a game
+// runs are saved in the settings folder, and the next time the game runs they are all
+// recompiled when its first microProgram is searched for (usually while it is loading),
+// rather than each of them the first time the game uses it.
+
+// microProgram Search Stats
+static const bool doSearchStats = false; // Set to true to log program search stats every 60 frames
+// Logs how often each VU had to search for a microProgram (after micro memory was
+// written to), how many cached programs were compared against micro memory and how
+// many were skipped by the hash index, and how many programs had to be recompiled.
+
 //------------------------------------------------------------------
 // Speed Hacks (can cause infinite loops, SPS, Black Screens, etc...)
 //------------------------------------------------------------------
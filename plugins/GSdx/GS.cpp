@@ -1525,6 +1525,7 @@ EXPORT_C GSBenchmark(HWND hwnd, HINSTANCE hinst, LPSTR lpszCmdLine, int nCmdShow
 #if defined(__unix__)
 
 #include "GSLzma.h"
+#include <dirent.h>
 
 inline unsigned long timeGetTime()
 {
@@ -1533,6 +1534,66 @@ inline unsigned long timeGetTime()
 	return (unsigned long)(t.tv_sec*1000 + t.tv_nsec/1000000);
 }
 
+static void LoadDumpState(GSDumpPacketStream* stream, uint8* regs)
+{
+	memcpy(regs, stream->GetRegs(), 0x2000);
+
+	GSsetGameCRC(stream->GetCRC(), 0);
+
+	GSFreezeData fd;
+	fd.size = stream->GetState().size();
+	fd.data = (uint8*)stream->GetState().data();
+
+	GSfreeze(FREEZE_LOAD, &fd);
+}
+
+// returns true after a vsync
+
+static bool ReplayPacket(const GSDumpPacket* p, uint8* regs, vector<uint8>& buff)
+{
+	switch(p->type)
+	{
+		case 0:
+
+			switch(p->param)
+			{
+				case 0:
+					// PATH1 reads the 0x4000 bytes vu1 memory window (incomplete packets wrap around it)
+					if(buff.size() < 0x4000) buff.resize(0x4000);
+					memcpy(&buff[p->addr], p->data, p->size);
+					GSgifTransfer1(&buff[0], p->addr);
+					break;
+				case 1: GSgifTransfer2(p->data, p->size / 16); break;
+				case 2: GSgifTransfer3(p->data, p->size / 16); break;
+				case 3: GSgifTransfer(p->data, p->size / 16); break;
+			}
+
+			break;
+
+		case 1:
+
+			GSvsync(p->param);
+
+			return true;
+
+		case 2:
+
+			if(buff.size() < p->size) buff.resize(p->size);
+
+			GSreadFIFO2(&buff[0], p->size / 16);
+
+			break;
+
+		case 3:
+
+			memcpy(regs, p->data, 0x2000);
+
+			break;
+	}
+
+	return false;
+}
+
 // Note
 EXPORT_C GSReplay(char* lpszCmdLine, int renderer)
 {
@@ -1552,9 +1613,6 @@ EXPORT_C GSReplay(char* lpszCmdLine, int renderer)
 		return;
 	}
 
-	struct Packet {uint8 type, param; uint32 size, addr; vector<uint8> buff;};
-
-	list<Packet*> packets;
 	vector<uint8> buff;
 	uint8 regs[0x2000];
 
@@ -1571,173 +1629,704 @@ EXPORT_C GSReplay(char* lpszCmdLine, int renderer)
 	}
 	if (s_gs->m_wnd == NULL) return;
 
-	{ // Read .gs content
-		std::string f(lpszCmdLine);
-#ifdef LZMA_SUPPORTED
-		GSDumpFile* file = (f.size() >= 4) && (f.compare(f.size()-3, 3, ".xz") == 0)
-			? (GSDumpFile*) new GSDumpLzma(lpszCmdLine)
-			: (GSDumpFile*) new GSDumpRaw(lpszCmdLine);
-#else
-		GSDumpFile* file = new GSDumpRaw(lpszCmdLine);
+	// Read .gs content, the packets are decoded in the background while they are replayed
+	GSDumpPacketStream* stream = new GSDumpPacketStream(lpszCmdLine, (size_t)theApp.GetConfigI("linux_replay_memory") << 20);
+
+	LoadDumpState(stream, regs);
+
+	sleep(2);
+
+	//while(IsWindowVisible(hWnd))
+	//FIXME map?
+	int finished = theApp.GetConfigI("linux_replay");
+	if (theApp.GetConfigI("dump")) {
+		fprintf(stderr, "Dump is enabled. Replay will be disabled\n");
+		finished = 1;
+	}
+	unsigned long frame_number = 0;
+
+	// Init vsync stuff
+	GSvsync(1);
+
+	while(finished > 0)
+	{
+		while(const GSDumpPacket* p = stream->Next())
+		{
+			if(ReplayPacket(p, regs, buff))
+			{
+				frame_number++;
+			}
+		}
+
+		if(stream->HasError())
+		{
+			fprintf(stderr, "failed to read %s\n", lpszCmdLine);
+			break;
+		}
+
+		stream->Rewind();
+
+		if (finished >= 200) {
+			; // Nop for Nvidia Profiler
+		} else if (finished > 90) {
+			sleep(1);
+		} else {
+			finished--;
+		}
+	}
+
+	static_cast<GSDeviceOGL*>(s_gs->m_dev)->GenerateProfilerData();
+
+#ifdef ENABLE_OGL_DEBUG_MEM_BW
+	unsigned long total_frame_nb = std::max(1ul, frame_number) << 10;
+	fprintf(stderr, "memory bandwith. T: %f KB/f. V: %f KB/f. U: %f KB/f\n",
+			(float)g_real_texture_upload_byte/(float)total_frame_nb,
+			(float)g_vertex_upload_byte/(float)total_frame_nb,
+			(float)g_uniform_upload_byte/(float)total_frame_nb
+		   );
 #endif
 
-		uint32 crc;
-		file->Read(&crc, 4);
-		GSsetGameCRC(crc, 0);
+	delete stream;
 
-		GSFreezeData fd;
-		file->Read(&fd.size, 4);
-		fd.data = new uint8[fd.size];
-		file->Read(fd.data, fd.size);
+	sleep(2);
 
-		GSfreeze(FREEZE_LOAD, &fd);
-		delete [] fd.data;
+	GSclose();
+	GSshutdown();
+}
+
+// Headless replay of one dump or every .gs/.gs.xz file of a directory with the software renderer
+// and the null device, for catching performance regressions without a gpu. Results go to json
+// (stdout if NULL or empty). Returns the number of dumps that could not be replayed.
+
+static int _GSopenHeadless(int threads)
+{
+	delete s_gs;
+
+	s_gs = new GSRendererSW(threads);
+	s_renderer = GSRendererType::Undefined; // a later GSopen must not reuse it
+	s_renderer_name = " Null";
+	s_renderer_type = " SW";
+
+	s_gs->m_wnd = new GSWndNull();
+
+	s_gs->SetRegsMem(s_basemem);
+	s_gs->SetIrqCallback(s_irq);
+	s_gs->SetVSync(false);
+	s_gs->SetFrameLimit(false);
+
+	if(!s_gs->CreateDevice(new GSDeviceNull()))
+	{
+		GSclose();
+
+		return -1;
+	}
+
+	return 0;
+}
+
+static double GetTimeMs()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec * 1000 + (double)t.tv_nsec / 1000000;
+}
+
+static double GetPercentile(const vector<double>& sorted, double p)
+{
+	if(sorted.empty()) return 0;
 
-		file->Read(regs, 0x2000);
+	size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
 
-		while(!file->IsEof())
+	return sorted[std::min<size_t>(i, sorted.size() - 1)];
+}
+
+static string JsonEscape(const string& s)
+{
+	string r;
+
+	for(size_t i = 0; i < s.size(); i++)
+	{
+		char c = s[i];
+
+		switch(c)
 		{
-			uint8 type;
-			file->Read(&type, 1);
+		case '"': r += "\\\""; break;
+		case '\\': r += "\\\\"; break;
+		case '\n': r += "\\n"; break;
+		case '\r': r += "\\r"; break;
+		case '\t': r += "\\t"; break;
+		default:
+			if((unsigned char)c < 0x20)
+			{
+				char buff[8];
+				sprintf(buff, "\\u%04x", c);
+				r += buff;
+			}
+			else
+			{
+				r += c;
+			}
+			break;
+		}
+	}
 
-			Packet* p = new Packet();
+	return r;
+}
 
-			p->type = type;
+static void GetDumpFiles(const char* path, vector<string>& files)
+{
+	if(DIR* dir = opendir(path))
+	{
+		while(struct dirent* e = readdir(dir))
+		{
+			string f(e->d_name);
 
-			switch(type)
+			if(f.size() > 3 && f.compare(f.size() - 3, 3, ".gs") == 0 || f.size() > 6 && f.compare(f.size() - 6, 6, ".gs.xz") == 0)
 			{
-			case 0:
-				file->Read(&p->param, 1);
-				file->Read(&p->size, 4);
+				files.push_back(string(path) + "/" + f);
+			}
+		}
 
-				switch(p->param)
+		closedir(dir);
+
+		std::sort(files.begin(), files.end());
+	}
+	else
+	{
+		files.push_back(path);
+	}
+}
+
+EXPORT_C_(int) GSReplayBenchmark(char* path, int loops, char* json)
+{
+	GLLoader::in_replayer = true;
+
+	vector<string> files;
+
+	GetDumpFiles(path, files);
+
+	FILE* fp = json != NULL && json[0] != 0 ? fopen(json, "w") : stdout;
+
+	if(fp == NULL)
+	{
+		fprintf(stderr, "GSdx: cannot write %s\n", json);
+
+		return (int)files.size();
+	}
+
+	loops = std::max<int>(loops, 1);
+
+	int threads = theApp.GetConfigI("extrathreads");
+	int workers = std::min<int>(std::max<int>(threads, 1), 16);
+	int failed = 0;
+
+	// dumps that do not fit are streamed, the measured passes then include waiting for the decoder
+
+	size_t memory = (size_t)theApp.GetConfigI("linux_replay_memory") << 20;
+
+	GSinit();
+
+	uint8 regs[0x2000];
+
+	GSsetBaseMem(regs);
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "\t\"threads\": %d,\n", threads);
+	fprintf(fp, "\t\"binning\": %d,\n", theApp.GetConfigI("extrathreads_binning"));
+	fprintf(fp, "\t\"transfer\": %d,\n", theApp.GetConfigI("extrathreads_transfer"));
+	fprintf(fp, "\t\"loops\": %d,\n", loops);
+	fprintf(fp, "\t\"dumps\": [");
+
+	for(size_t n = 0; n < files.size(); n++)
+	{
+		GSDumpPacketStream* stream = NULL;
+		vector<uint8> buff;
+
+		try
+		{
+			stream = new GSDumpPacketStream(files[n].c_str(), memory);
+		}
+		catch(const char*)
+		{
+			fprintf(stderr, "GSdx: cannot read %s\n", files[n].c_str());
+
+			failed++;
+
+			continue;
+		}
+
+		if(_GSopenHeadless(threads) != 0)
+		{
+			fprintf(stderr, "GSdx: headless GSopen failed\n");
+
+			delete stream;
+
+			failed++;
+
+			continue;
+		}
+
+		LoadDumpState(stream, regs);
+
+		GSvsync(1);
+
+		// the first pass compiles the scanline functions and fills the texture cache, it is not measured
+
+		while(const GSDumpPacket* p = stream->Next())
+		{
+			ReplayPacket(p, regs, buff);
+		}
+
+		if(stream->HasError())
+		{
+			fprintf(stderr, "GSdx: cannot read %s\n", files[n].c_str());
+
+			delete stream;
+
+			GSclose();
+
+			failed++;
+
+			continue;
+		}
+
+		GSPerfMon& pm = s_gs->m_perfmon;
+
+		pm.ResetTotals();
+
+		vector<double> frames;
+
+		uint64 start_ticks = __rdtsc();
+		double start = GetTimeMs();
+		double last = start;
+
+		for(int loop = 0; loop < loops; loop++)
+		{
+			stream->Rewind();
+
+			while(const GSDumpPacket* p = stream->Next())
+			{
+				if(ReplayPacket(p, regs, buff))
 				{
-				case 0:
-					p->buff.resize(0x4000);
-					p->addr = 0x4000 - p->size;
-					file->Read(&p->buff[p->addr], p->size);
-					break;
-				case 1:
-				case 2:
-				case 3:
-					p->buff.resize(p->size);
-					file->Read(&p->buff[0], p->size);
-					break;
+					double now = GetTimeMs();
+
+					frames.push_back(now - last);
+
+					last = now;
 				}
+			}
+		}
 
-				break;
+		double total = GetTimeMs() - start;
+		uint64 total_ticks = std::max<uint64>(__rdtsc() - start_ticks, 1);
+
+		vector<double> sorted(frames);
+
+		std::sort(sorted.begin(), sorted.end());
+
+		double avg = frames.empty() ? 0 : total / frames.size();
+
+		fprintf(fp, "%s\n\t\t{\n", n > (size_t)failed ? "," : "");
+		fprintf(fp, "\t\t\t\"file\": \"%s\",\n", JsonEscape(files[n]).c_str());
+		fprintf(fp, "\t\t\t\"crc\": \"%08x\",\n", stream->GetCRC());
+		fprintf(fp, "\t\t\t\"frames\": %d,\n", (int)frames.size());
+		fprintf(fp, "\t\t\t\"time_ms\": %.3f,\n", total);
+		fprintf(fp, "\t\t\t\"resident\": %s,\n", stream->IsResident() ? "true" : "false");
+		fprintf(fp, "\t\t\t\"packet_memory_mb\": %.1f,\n", (double)stream->GetPeakMemory() / (1 << 20));
+		fprintf(fp, "\t\t\t\"fps\": %.2f,\n", avg > 0 ? 1000 / avg : 0);
+		fprintf(fp, "\t\t\t\"frame_ms\": {\"avg\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n",
+			avg, GetPercentile(sorted, 0), GetPercentile(sorted, 0.5), GetPercentile(sorted, 0.9), GetPercentile(sorted, 0.99), GetPercentile(sorted, 1));
+		fprintf(fp, "\t\t\t\"draws\": %.0f,\n", pm.GetTotal(GSPerfMon::Draw));
+		fprintf(fp, "\t\t\t\"prims\": %.0f,\n", pm.GetTotal(GSPerfMon::Prim));
+		fprintf(fp, "\t\t\t\"pixels\": %.0f,\n", pm.GetTotal(GSPerfMon::Fillrate));
+		fprintf(fp, "\t\t\t\"syncs\": %.0f,\n", pm.GetTotal(GSPerfMon::SyncPoint));
+		fprintf(fp, "\t\t\t\"sync_reasons\": {\"full\": %.0f, \"source\": %.0f, \"target\": %.0f, \"upload\": %.0f, \"download\": %.0f},\n",
+			pm.GetTotal(GSPerfMon::SyncFull), pm.GetTotal(GSPerfMon::SyncSource), pm.GetTotal(GSPerfMon::SyncTarget),
+			pm.GetTotal(GSPerfMon::SyncUpload), pm.GetTotal(GSPerfMon::SyncDownload));
+		fprintf(fp, "\t\t\t\"texture_cache\": {\"hits\": %.0f, \"misses\": %.0f, \"evictions\": %.0f},\n",
+			pm.GetTotal(GSPerfMon::TextureHit), pm.GetTotal(GSPerfMon::TextureMiss), pm.GetTotal(GSPerfMon::TextureEvict));
+		fprintf(fp, "\t\t\t\"swizzle_bytes\": %.0f,\n", pm.GetTotal(GSPerfMon::Swizzle));
+		fprintf(fp, "\t\t\t\"unswizzle_bytes\": %.0f,\n", pm.GetTotal(GSPerfMon::Unswizzle));
+		fprintf(fp, "\t\t\t\"async_swizzle_bytes\": %.0f,\n", pm.GetTotal(GSPerfMon::SwizzleAsync));
+		fprintf(fp, "\t\t\t\"async_unswizzle_bytes\": %.0f,\n", pm.GetTotal(GSPerfMon::UnswizzleAsync));
+		fprintf(fp, "\t\t\t\"gs_thread_sync\": %.3f,\n", (double)pm.GetTicks(GSPerfMon::Sync) / total_ticks);
+		fprintf(fp, "\t\t\t\"worker_utilization\": [");
+
+		for(int i = 0; i < workers; i++)
+		{
+			fprintf(fp, "%s%.3f", i > 0 ? ", " : "", (double)pm.GetTicks(GSPerfMon::WorkerDraw0 + i) / total_ticks);
+		}
 
-			case 1:
-				file->Read(&p->param, 1);
+		fprintf(fp, "]\n\t\t}");
 
-				break;
+		fprintf(stderr, "%s: %d frames, %.2f fps, p99 %.3f ms\n", files[n].c_str(), (int)frames.size(), avg > 0 ? 1000 / avg : 0, GetPercentile(sorted, 0.99));
 
-			case 2:
-				file->Read(&p->size, 4);
+		delete stream;
 
-				break;
+		GSclose();
+	}
 
-			case 3:
-				p->buff.resize(0x2000);
+	fprintf(fp, "\n\t]\n}\n");
 
-				file->Read(&p->buff[0], 0x2000);
+	if(fp != stdout) fclose(fp);
 
-				break;
-			}
+	GSshutdown();
 
-			packets.push_back(p);
+	return failed;
+}
+
+// Vertex preprocessing of the software renderer over the draws of the dumps: the trace and the conversion
+// done separately, as for the strip and fan primitives, against the fused pass of the list primitives.
+// Every list primitive draw is run loops times both ways, the two results must match.
+
+EXPORT_C_(int) GSVertexBenchmark(char* path, int loops, char* json)
+{
+	GLLoader::in_replayer = true;
+
+	vector<string> files;
+
+	GetDumpFiles(path, files);
+
+	FILE* fp = json != NULL && json[0] != 0 ? fopen(json, "w") : stdout;
+
+	if(fp == NULL)
+	{
+		fprintf(stderr, "GSdx: cannot write %s\n", json);
+
+		return (int)files.size();
+	}
+
+	loops = std::max<int>(loops, 1);
+
+	int threads = theApp.GetConfigI("extrathreads");
+	int failed = 0;
+	int count = 0;
+
+	size_t memory = (size_t)theApp.GetConfigI("linux_replay_memory") << 20;
+
+	GSinit();
+
+	uint8 regs[0x2000];
+
+	GSsetBaseMem(regs);
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "\t\"sse\": \"%x\",\n", _M_SSE);
+	fprintf(fp, "\t\"vertex_threads\": %d,\n", theApp.GetConfigI("extrathreads_vertex"));
+	fprintf(fp, "\t\"loops\": %d,\n", loops);
+	fprintf(fp, "\t\"dumps\": [");
+
+	for(size_t n = 0; n < files.size(); n++)
+	{
+		GSDumpPacketStream* stream = NULL;
+		vector<uint8> buff;
+
+		try
+		{
+			stream = new GSDumpPacketStream(files[n].c_str(), memory);
+		}
+		catch(const char*)
+		{
+			fprintf(stderr, "GSdx: cannot read %s\n", files[n].c_str());
+
+			failed++;
+
+			continue;
+		}
+
+		if(_GSopenHeadless(threads) != 0)
+		{
+			fprintf(stderr, "GSdx: headless GSopen failed\n");
+
+			delete stream;
+
+			failed++;
+
+			continue;
+		}
+
+		LoadDumpState(stream, regs);
+
+		GSvsync(1);
+
+		GSRendererSW::VertexBenchmark vb;
+
+		memset(&vb, 0, sizeof(vb));
+
+		vb.loops = loops;
+
+		GSRendererSW::s_vertex_benchmark = &vb;
+
+		while(const GSDumpPacket* p = stream->Next())
+		{
+			ReplayPacket(p, regs, buff);
+		}
+
+		GSRendererSW::s_vertex_benchmark = NULL;
+
+		if(stream->HasError())
+		{
+			fprintf(stderr, "GSdx: cannot read %s\n", files[n].c_str());
+
+			delete stream;
+
+			GSclose();
+
+			failed++;
+
+			continue;
+		}
+
+		double vertices = (double)std::max<uint64>(vb.vertices * loops, 1);
+
+		fprintf(fp, "%s\n\t\t{\n", count++ > 0 ? "," : "");
+		fprintf(fp, "\t\t\t\"file\": \"%s\",\n", JsonEscape(files[n]).c_str());
+		fprintf(fp, "\t\t\t\"crc\": \"%08x\",\n", stream->GetCRC());
+		fprintf(fp, "\t\t\t\"draws\": %llu,\n", (unsigned long long)vb.draws);
+		fprintf(fp, "\t\t\t\"vertices\": %llu,\n", (unsigned long long)vb.vertices);
+		fprintf(fp, "\t\t\t\"separate_ticks_per_vertex\": %.3f,\n", vb.separate_ticks / vertices);
+		fprintf(fp, "\t\t\t\"fused_ticks_per_vertex\": %.3f,\n", vb.fused_ticks / vertices);
+		fprintf(fp, "\t\t\t\"speedup\": %.3f,\n", (double)vb.separate_ticks / std::max<uint64>(vb.fused_ticks, 1));
+		fprintf(fp, "\t\t\t\"mismatches\": %llu\n", (unsigned long long)vb.mismatches);
+		fprintf(fp, "\t\t}");
+
+		fprintf(stderr, "%s: %llu draws, %llu vertices, %.3f -> %.3f ticks per vertex, %llu mismatches\n", files[n].c_str(),
+			(unsigned long long)vb.draws, (unsigned long long)vb.vertices, vb.separate_ticks / vertices, vb.fused_ticks / vertices, (unsigned long long)vb.mismatches);
+
+		if(vb.mismatches > 0)
+		{
+			failed++;
 		}
 
-		delete file;
+		delete stream;
+
+		GSclose();
 	}
 
-	sleep(2);
+	fprintf(fp, "\n\t]\n}\n");
 
-	//while(IsWindowVisible(hWnd))
-	//FIXME map?
-	int finished = theApp.GetConfigI("linux_replay");
-	if (theApp.GetConfigI("dump")) {
-		fprintf(stderr, "Dump is enabled. Replay will be disabled\n");
-		finished = 1;
+	if(fp != stdout) fclose(fp);
+
+	GSshutdown();
+
+	return failed;
+}
+
+// Swizzle throughput of the local memory transfers, for every block kernel set the cpu supports.
+
+EXPORT_C_(int) GSMemoryBenchmark(int loops, char* json)
+{
+	FILE* fp = json != NULL && json[0] != 0 ? fopen(json, "w") : stdout;
+
+	if(fp == NULL)
+	{
+		fprintf(stderr, "GSdx: cannot write %s\n", json);
+
+		return 1;
 	}
-	unsigned long frame_number = 0;
 
-	// Init vsync stuff
-	GSvsync(1);
+	loops = std::max<int>(loops, 1);
 
-	while(finished > 0)
+	GSinit();
+
+	static struct {int psm; const char* name;} s_format[] =
 	{
-		for(auto i = packets.begin(); i != packets.end(); i++)
+		{PSM_PSMCT32, "32"},
+		{PSM_PSMCT24, "24"},
+		{PSM_PSMCT16, "16"},
+		{PSM_PSMCT16S, "16S"},
+		{PSM_PSMT8, "8"},
+		{PSM_PSMT4, "4"},
+		{PSM_PSMT8H, "8H"},
+		{PSM_PSMT4HL, "4HL"},
+		{PSM_PSMT4HH, "4HH"},
+		{PSM_PSMZ32, "32Z"},
+		{PSM_PSMZ24, "24Z"},
+		{PSM_PSMZ16, "16Z"},
+		{PSM_PSMZ16S, "16ZS"},
+	};
+
+	// large uploads, uploads not starting on a block (leftover path) and narrow strips like font or clut updates
+
+	static struct {int x, y, w, h; const char* name;} s_shape[] =
+	{
+		{0, 0, 512, 512, "aligned"},
+		{5, 3, 502, 502, "unaligned"},
+		{0, 0, 32, 512, "strip"},
+	};
+
+	GSLocalMemory* mem = new GSLocalMemory();
+
+	const int size = 1024 * 1024 * 4;
+
+	uint8* ptr = (uint8*)_aligned_malloc(size, 32);
+
+	for(int i = 0; i < size; i++) ptr[i] = (uint8)i;
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "\t\"loops\": %d,\n", loops);
+	fprintf(fp, "\t\"kernels\": [");
+
+	int count = 0;
+
+	for(int set = GSBlock::KernelsCompiled; set <= GSBlock::KernelsAVX512; set++)
+	{
+		if(GSBlock::SelectKernels(set) != set)
 		{
-			Packet* p = *i;
+			continue;
+		}
+
+		fprintf(fp, "%s\n\t\t{\n", count++ > 0 ? "," : "");
+		fprintf(fp, "\t\t\t\"set\": \"%s\",\n", GSBlock::GetKernelsName(set));
+		fprintf(fp, "\t\t\t\"results\": [");
 
-			switch(p->type)
+		for(size_t i = 0; i < countof(s_format); i++)
+		{
+			const GSLocalMemory::psm_t& psm = GSLocalMemory::m_psm[s_format[i].psm];
+
+			for(size_t j = 0; j < countof(s_shape); j++)
 			{
-				case 0:
+				int x = s_shape[j].x;
+				int y = s_shape[j].y;
+				int w = s_shape[j].w;
+				int h = s_shape[j].h;
 
-					switch(p->param)
+				int bw = (x + w + 63) / 64;
+
+				GIFRegBITBLTBUF BITBLTBUF;
+
+				BITBLTBUF.SBP = 0;
+				BITBLTBUF.SBW = bw;
+				BITBLTBUF.SPSM = s_format[i].psm;
+				BITBLTBUF.DBP = 0;
+				BITBLTBUF.DBW = bw;
+				BITBLTBUF.DPSM = s_format[i].psm;
+
+				GIFRegTRXPOS TRXPOS;
+
+				TRXPOS.SSAX = x;
+				TRXPOS.SSAY = y;
+				TRXPOS.DSAX = x;
+				TRXPOS.DSAY = y;
+
+				GIFRegTRXREG TRXREG;
+
+				TRXREG.RRW = w;
+				TRXREG.RRH = h;
+
+				GIFRegTEXA TEXA;
+
+				TEXA.TA0 = 0;
+				TEXA.TA1 = 0x80;
+				TEXA.AEM = 0;
+
+				// readTexture works on whole blocks
+
+				GSVector4i r = GSVector4i(x, y, x + w, y + h).ralign<Align_Outside>(psm.bs);
+
+				const GSOffset* off = mem->GetOffset(0, bw, s_format[i].psm);
+
+				int trlen = w * h * psm.trbpp / 8;
+				int len = r.width() * r.height() * 4;
+				int lenP = r.width() * r.height();
+
+				// about 64 MB per measurement and loop
+
+				int n = std::max<int>((64 << 20) / trlen, 1) * loops;
+
+				double t[4] = {0, 0, 0, 0};
+
+				double start = GetTimeMs();
+
+				for(int k = 0; k < n; k++)
+				{
+					int tx = x;
+					int ty = y;
+
+					(mem->*psm.wi)(tx, ty, ptr, trlen, BITBLTBUF, TRXPOS, TRXREG);
+				}
+
+				t[0] = GetTimeMs() - start;
+
+				start = GetTimeMs();
+
+				for(int k = 0; k < n; k++)
+				{
+					int tx = x;
+					int ty = y;
+
+					(mem->*psm.ri)(tx, ty, ptr, trlen, BITBLTBUF, TRXPOS, TRXREG);
+				}
+
+				t[1] = GetTimeMs() - start;
+
+				start = GetTimeMs();
+
+				for(int k = 0; k < n; k++)
+				{
+					(mem->*psm.rtx)(off, r, ptr, r.width() * 4, TEXA);
+				}
+
+				t[2] = GetTimeMs() - start;
+
+				if(psm.pal > 0)
+				{
+					start = GetTimeMs();
+
+					for(int k = 0; k < n; k++)
 					{
-						case 0: GSgifTransfer1(&p->buff[0], p->addr); break;
-						case 1: GSgifTransfer2(&p->buff[0], p->size / 16); break;
-						case 2: GSgifTransfer3(&p->buff[0], p->size / 16); break;
-						case 3: GSgifTransfer(&p->buff[0], p->size / 16); break;
+						(mem->*psm.rtxP)(off, r, ptr, r.width(), TEXA);
 					}
 
-					break;
-
-				case 1:
+					t[3] = GetTimeMs() - start;
+				}
 
-					GSvsync(p->param);
-					frame_number++;
+				// GB/s of source data for the transfers, of written texels for the texture reads
 
-					break;
+				double gbs[4];
 
-				case 2:
+				gbs[0] = t[0] > 0 ? (double)trlen * n / t[0] / 1e6 : 0;
+				gbs[1] = t[1] > 0 ? (double)trlen * n / t[1] / 1e6 : 0;
+				gbs[2] = t[2] > 0 ? (double)len * n / t[2] / 1e6 : 0;
+				gbs[3] = t[3] > 0 ? (double)lenP * n / t[3] / 1e6 : 0;
 
-					if(buff.size() < p->size) buff.resize(p->size);
+				fprintf(fp, "%s\n\t\t\t\t{\"psm\": \"%s\", \"shape\": \"%s\", \"write_gbs\": %.3f, \"read_gbs\": %.3f, \"texture_gbs\": %.3f",
+					i > 0 || j > 0 ? "," : "", s_format[i].name, s_shape[j].name, gbs[0], gbs[1], gbs[2]);
 
-					GSreadFIFO2(&buff[0], p->size / 16);
+				if(psm.pal > 0)
+				{
+					fprintf(fp, ", \"texture_p_gbs\": %.3f", gbs[3]);
+				}
 
-					break;
+				fprintf(fp, "}");
 
-				case 3:
+				fprintf(stderr, "%-8s [%4s] %-9s write %7.3f read %7.3f texture %7.3f", GSBlock::GetKernelsName(set), s_format[i].name, s_shape[j].name, gbs[0], gbs[1], gbs[2]);
 
-					memcpy(regs, &p->buff[0], 0x2000);
+				if(psm.pal > 0)
+				{
+					fprintf(stderr, " texture_p %7.3f", gbs[3]);
+				}
 
-					break;
+				fprintf(stderr, " GB/s\n");
 			}
 		}
 
-		if (finished >= 200) {
-			; // Nop for Nvidia Profiler
-		} else if (finished > 90) {
-			sleep(1);
-		} else {
-			finished--;
-		}
+		fprintf(fp, "\n\t\t\t]\n\t\t}");
 	}
 
-	static_cast<GSDeviceOGL*>(s_gs->m_dev)->GenerateProfilerData();
+	fprintf(fp, "\n\t]\n}\n");
 
-#ifdef ENABLE_OGL_DEBUG_MEM_BW
-	unsigned long total_frame_nb = std::max(1ul, frame_number) << 10;
-	fprintf(stderr, "memory bandwith. T: %f KB/f. V: %f KB/f. U: %f KB/f\n",
-			(float)g_real_texture_upload_byte/(float)total_frame_nb,
-			(float)g_vertex_upload_byte/(float)total_frame_nb,
-			(float)g_uniform_upload_byte/(float)total_frame_nb
-		   );
-#endif
+	if(fp != stdout) fclose(fp);
 
-	for(auto i = packets.begin(); i != packets.end(); i++)
-	{
-		delete *i;
-	}
+	_aligned_free(ptr);
 
-	packets.clear();
+	delete mem;
 
-	sleep(2);
+	GSBlock::SelectKernels(GSBlock::KernelsAVX512);
 
-	GSclose();
 	GSshutdown();
+
+	return 0;
 }
+
 #endif
@@ -52,9 +52,30 @@ class GSBlock
 	static GSVector4i m_uw8hmask2;
 	static GSVector4i m_uw8hmask3;
 
+	// wider than the compiled instruction set, picked at runtime, NULL when the compiled code is as good
+
+	struct Kernels
+	{
+		void (*WriteBlock16)(uint8* RESTRICT dst, const uint8* RESTRICT src, int srcpitch);
+		void (*WriteBlock8)(uint8* RESTRICT dst, const uint8* RESTRICT src, int srcpitch);
+		void (*WriteBlock4)(uint8* RESTRICT dst, const uint8* RESTRICT src, int srcpitch);
+		void (*ReadBlock16)(const uint8* RESTRICT src, uint8* RESTRICT dst, int dstpitch);
+		void (*ReadBlock8)(const uint8* RESTRICT src, uint8* RESTRICT dst, int dstpitch);
+		void (*ReadBlock4)(const uint8* RESTRICT src, uint8* RESTRICT dst, int dstpitch);
+	};
+
+	static Kernels m_kernels;
+
 public:
+	enum {KernelsCompiled, KernelsAVX2, KernelsAVX512};
+
 	static void InitVectors();
 
+	// returns the set actually in use, falls back to narrower ones the cpu does not support (GSBlockKernels.cpp)
+
+	static int SelectKernels(int set);
+	static const char* GetKernelsName(int set);
+
 	template<int i, int alignment, uint32 mask> __forceinline static void WriteColumn32(uint8* RESTRICT dst, const uint8* RESTRICT src, int srcpitch)
 	{
 		const uint8* RESTRICT s0 = &src[srcpitch * 0];
@@ -420,6 +441,13 @@ public:
 
 	template<int alignment> static void WriteBlock16(uint8* RESTRICT dst, const uint8* RESTRICT src, int srcpitch)
 	{
+		if(m_kernels.WriteBlock16)
+		{
+			m_kernels.WriteBlock16(dst, src, srcpitch);
+
+			return;
+		}
+
 		WriteColumn16<0, alignment>(dst, src, srcpitch);
 		src += srcpitch * 2;
 		WriteColumn16<1, alignment>(dst, src, srcpitch);
@@ -431,6 +459,13 @@ public:
 
 	template<int alignment> static void WriteBlock8(uint8* RESTRICT dst, const uint8* RESTRICT src, int srcpitch)
 	{
+		if(m_kernels.WriteBlock8)
+		{
+			m_kernels.WriteBlock8(dst, src, srcpitch);
+
+			return;
+		}
+
 		WriteColumn8<0, alignment>(dst, src, srcpitch);
 		src += srcpitch * 4;
 		WriteColumn8<1, alignment>(dst, src, srcpitch);
@@ -442,6 +477,13 @@ public:
 
 	template<int alignment> static void WriteBlock4(uint8* RESTRICT dst, const uint8* RESTRICT src, int srcpitch)
 	{
+		if(m_kernels.WriteBlock4)
+		{
+			m_kernels.WriteBlock4(dst, src, srcpitch);
+
+			return;
+		}
+
 		WriteColumn4<0, alignment>(dst, src, srcpitch);
 		src += srcpitch * 4;
 		WriteColumn4<1, alignment>(dst, src, srcpitch);
@@ -785,6 +827,13 @@ public:
 
 	static void ReadBlock16(const uint8* RESTRICT src, uint8* RESTRICT dst, int dstpitch)
 	{
+		if(m_kernels.ReadBlock16)
+		{
+			m_kernels.ReadBlock16(src, dst, dstpitch);
+
+			return;
+		}
+
 		ReadColumn16<0>(src, dst, dstpitch);
 		dst += dstpitch * 2;
 		ReadColumn16<1>(src, dst, dstpitch);
@@ -796,6 +845,13 @@ public:
 
 	static void ReadBlock8(const uint8* RESTRICT src, uint8* RESTRICT dst, int dstpitch)
 	{
+		if(m_kernels.ReadBlock8)
+		{
+			m_kernels.ReadBlock8(src, dst, dstpitch);
+
+			return;
+		}
+
 		ReadColumn8<0>(src, dst, dstpitch);
 		dst += dstpitch * 4;
 		ReadColumn8<1>(src, dst, dstpitch);
@@ -807,6 +863,13 @@ public:
 
 	static void ReadBlock4(const uint8* RESTRICT src, uint8* RESTRICT dst, int dstpitch)
 	{
+		if(m_kernels.ReadBlock4)
+		{
+			m_kernels.ReadBlock4(src, dst, dstpitch);
+
+			return;
+		}
+
 		ReadColumn4<0>(src, dst, dstpitch);
 		dst += dstpitch * 4;
 		ReadColumn4<1>(src, dst, dstpitch);
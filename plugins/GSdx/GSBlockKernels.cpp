@@ -0,0 +1,385 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Wider block swizzle kernels, selected at runtime by GSBlock::SelectKernels.
+//
+// The rest of GSdx is built for a single instruction set (_M_SSE), so these functions carry their
+// own target attribute instead and only use raw intrinsics, nothing from GSVector which would be
+// instantiated with the wrong encoding. The AVX-512 permutes are derived from the column tables.
+
+#include "stdafx.h"
+#include "GSBlock.h"
+#include "xbyak/xbyak_util.h"
+
+#if defined(_MSC_VER)
+	#include <immintrin.h>
+#elif _M_SSE < 0x500
+	// stdafx.h only includes the headers of the compiled instruction set and renames __rdtsc
+	#undef __rdtsc
+	#include <immintrin.h>
+	#define __rdtsc _lnx_rdtsc
+#endif
+
+#if defined(_MSC_VER)
+	#define GS_TARGET_AVX2
+	#define GS_TARGET_AVX512
+	#if _MSC_VER >= 1911
+		#define GS_BLOCK_AVX512
+	#endif
+#else
+	#define GS_TARGET_AVX2 __attribute__((target("avx2")))
+	#define GS_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw,avx512vl,avx512vbmi")))
+	#if defined(__clang__) || __GNUC__ >= 5
+		#define GS_BLOCK_AVX512
+	#endif
+#endif
+
+GSBlock::Kernels GSBlock::m_kernels;
+
+// full register permutes (vpermw/vpermb/vpermi2b), [column][even/odd nibble][element]
+
+struct alignas(64) Permute
+{
+	uint8 idx[4][2][64];
+};
+
+static Permute s_read16, s_read8, s_write4, s_read4;
+
+// map[c][k]: column c element k comes from row major element map[c][k] of the 2x16/4x16/4x32 rectangle
+
+static void GetColumnMap(int bpp, int map[4][128], int inv[4][128])
+{
+	int rows = bpp == 16 ? 2 : 4;
+	int width = bpp == 4 ? 32 : 16;
+	int count = rows * width;
+
+	for(int c = 0; c < 4; c++)
+	{
+		for(int y = 0; y < rows; y++)
+		{
+			for(int x = 0; x < width; x++)
+			{
+				int k;
+
+				switch(bpp)
+				{
+				case 16: k = columnTable16[c * rows + y][x]; break;
+				case 8: k = columnTable8[c * rows + y][x]; break;
+				default: k = columnTable4[c * rows + y][x]; break;
+				}
+
+				k -= c * count;
+
+				map[c][k] = y * width + x;
+				inv[c][y * width + x] = k;
+			}
+		}
+	}
+}
+
+static void BuildPermute(Permute& t, const int map[4][128], int bpp)
+{
+	memset(&t, 0, sizeof(t));
+
+	for(int c = 0; c < 4; c++)
+	{
+		switch(bpp)
+		{
+		case 16:
+			for(int k = 0; k < 32; k++) ((uint16*)t.idx[c][0])[k] = (uint16)map[c][k];
+			break;
+		case 8:
+			for(int k = 0; k < 64; k++) t.idx[c][0][k] = (uint8)map[c][k];
+			break;
+		default:
+			// vpermi2b table: bytes 0-63 hold the low nibbles, 64-127 the high nibbles
+			for(int k = 0; k < 128; k++) t.idx[c][k & 1][k >> 1] = (uint8)((map[c][k] & 1) * 64 + (map[c][k] >> 1));
+			break;
+		}
+	}
+}
+
+static void InitTables()
+{
+	static bool init = false;
+
+	if(init) return;
+
+	int map[4][128], inv[4][128];
+
+	GetColumnMap(16, map, inv);
+	BuildPermute(s_read16, inv, 16);
+
+	GetColumnMap(8, map, inv);
+	BuildPermute(s_read8, inv, 8);
+
+	GetColumnMap(4, map, inv);
+	BuildPermute(s_write4, map, 4);
+	BuildPermute(s_read4, inv, 4);
+
+	init = true;
+}
+
+static bool HasAVX512()
+{
+	#ifdef GS_BLOCK_AVX512
+
+	using namespace Xbyak::util;
+
+	Cpu cpu;
+
+	if(!cpu.has(Cpu::tAVX2) || !cpu.has(Cpu::tOSXSAVE))
+	{
+		return false;
+	}
+
+	// opmask, upper zmm0-15 and zmm16-31 state must be enabled by the os
+
+	if((Cpu::getXfeature() & 0xe6) != 0xe6)
+	{
+		return false;
+	}
+
+	unsigned int data[4];
+
+	Cpu::getCpuidEx(7, 0, data);
+
+	const unsigned int f = 1u << 16, bw = 1u << 30, vl = 1u << 31, vbmi = 1u << 1;
+
+	return (data[1] & (f | bw | vl)) == (f | bw | vl) && (data[2] & vbmi) != 0;
+
+	#else
+
+	return false;
+
+	#endif
+}
+
+// AVX2, the same interleaves as the compiled paths but on whole rows
+
+GS_TARGET_AVX2 static __forceinline __m256i Load2x16_AVX2(const uint8* p0, const uint8* p1)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p0)), _mm_loadu_si128((const __m128i*)p1), 1);
+}
+
+GS_TARGET_AVX2 static void WriteBlock16_AVX2(uint8* RESTRICT dst, const uint8* RESTRICT src, int srcpitch)
+{
+	// even dwords to the low lane, then 0 8 1 9 4 12 5 13 per lane, leaving the 32 bit qword interleave
+
+	const __m256i perm = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	const __m256i mask = _mm256_setr_epi8(0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15, 0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+
+	for(int c = 0; c < 4; c++, src += srcpitch * 2)
+	{
+		__m256i r0 = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)&src[0]), perm), mask);
+		__m256i r1 = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)&src[srcpitch]), perm), mask);
+
+		__m256i* d = (__m256i*)&dst[c * 64];
+
+		d[0] = _mm256_unpacklo_epi64(r0, r1);
+		d[1] = _mm256_unpackhi_epi64(r0, r1);
+	}
+}
+
+GS_TARGET_AVX2 static void ReadBlock16_AVX2(const uint8* RESTRICT src, uint8* RESTRICT dst, int dstpitch)
+{
+	const __m256i perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	const __m256i mask = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15, 0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+
+	const __m256i* s = (const __m256i*)src;
+
+	for(int c = 0; c < 4; c++, dst += dstpitch * 2)
+	{
+		__m256i v0 = s[c * 2 + 0];
+		__m256i v1 = s[c * 2 + 1];
+
+		_mm256_store_si256((__m256i*)&dst[0], _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(_mm256_unpacklo_epi64(v0, v1), mask), perm));
+		_mm256_store_si256((__m256i*)&dst[dstpitch], _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(_mm256_unpackhi_epi64(v0, v1), mask), perm));
+	}
+}
+
+GS_TARGET_AVX2 static void WriteBlock8_AVX2(uint8* RESTRICT dst, const uint8* RESTRICT src, int srcpitch)
+{
+	for(int c = 0; c < 4; c++, src += srcpitch * 4)
+	{
+		__m256i v0 = Load2x16_AVX2(&src[srcpitch * 0], &src[srcpitch * 1]);
+		__m256i v1 = Load2x16_AVX2(&src[srcpitch * 2], &src[srcpitch * 3]);
+
+		// every other column swaps the dwords of the first or the second pair of rows
+
+		if((c & 1) == 0)
+		{
+			v1 = _mm256_shuffle_epi32(v1, _MM_SHUFFLE(2, 3, 0, 1));
+		}
+		else
+		{
+			v0 = _mm256_shuffle_epi32(v0, _MM_SHUFFLE(2, 3, 0, 1));
+		}
+
+		__m256i v2 = _mm256_unpacklo_epi8(v0, v1);
+		__m256i v3 = _mm256_unpackhi_epi8(v0, v1);
+
+		__m256i* d = (__m256i*)&dst[c * 64];
+
+		d[0] = _mm256_permute4x64_epi64(_mm256_unpacklo_epi16(v2, v3), 0xd8);
+		d[1] = _mm256_permute4x64_epi64(_mm256_unpackhi_epi16(v2, v3), 0xd8);
+	}
+}
+
+// 32 bit blocks are bound by loads and stores already and the 8 bit read and the 4 bit blocks need more
+// shuffles on 256 bit lanes than the SSSE3 code, these stay on the compiled path
+
+// AVX-512, one permute per column, only where a single vpermw/vpermb/vpermi2b replaces a longer chain
+
+#ifdef GS_BLOCK_AVX512
+
+GS_TARGET_AVX512 static __forceinline __m512i Load4x16_AVX512(const uint8* RESTRICT src, int srcpitch)
+{
+	__m512i v = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)&src[srcpitch * 0]));
+
+	v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)&src[srcpitch * 1]), 1);
+	v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)&src[srcpitch * 2]), 2);
+	v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)&src[srcpitch * 3]), 3);
+
+	return v;
+}
+
+GS_TARGET_AVX512 static __forceinline void Store2x32_AVX512(uint8* RESTRICT dst, int dstpitch, __m512i v)
+{
+	_mm256_store_si256((__m256i*)&dst[0], _mm512_castsi512_si256(v));
+	_mm256_store_si256((__m256i*)&dst[dstpitch], _mm512_extracti64x4_epi64(v, 1));
+}
+
+GS_TARGET_AVX512 static __forceinline void Store4x16_AVX512(uint8* RESTRICT dst, int dstpitch, __m512i v)
+{
+	_mm_store_si128((__m128i*)&dst[dstpitch * 0], _mm512_castsi512_si128(v));
+	_mm_store_si128((__m128i*)&dst[dstpitch * 1], _mm512_extracti32x4_epi32(v, 1));
+	_mm_store_si128((__m128i*)&dst[dstpitch * 2], _mm512_extracti32x4_epi32(v, 2));
+	_mm_store_si128((__m128i*)&dst[dstpitch * 3], _mm512_extracti32x4_epi32(v, 3));
+}
+
+GS_TARGET_AVX512 static __forceinline __m512i PermuteNibbles_AVX512(__m512i v, const uint8 (*idx)[64])
+{
+	const __m512i mask = _mm512_set1_epi8(0x0f);
+
+	__m512i lo = _mm512_and_si512(v, mask);
+	__m512i hi = _mm512_and_si512(_mm512_srli_epi16(v, 4), mask);
+
+	__m512i v0 = _mm512_permutex2var_epi8(lo, _mm512_load_si512(idx[0]), hi);
+	__m512i v1 = _mm512_permutex2var_epi8(lo, _mm512_load_si512(idx[1]), hi);
+
+	return _mm512_or_si512(v0, _mm512_slli_epi16(v1, 4));
+}
+
+GS_TARGET_AVX512 static void WriteBlock4_AVX512(uint8* RESTRICT dst, const uint8* RESTRICT src, int srcpitch)
+{
+	for(int c = 0; c < 4; c++, src += srcpitch * 4)
+	{
+		((__m512i*)dst)[c] = PermuteNibbles_AVX512(Load4x16_AVX512(src, srcpitch), s_write4.idx[c]);
+	}
+}
+
+GS_TARGET_AVX512 static void ReadBlock16_AVX512(const uint8* RESTRICT src, uint8* RESTRICT dst, int dstpitch)
+{
+	for(int c = 0; c < 4; c++, dst += dstpitch * 2)
+	{
+		Store2x32_AVX512(dst, dstpitch, _mm512_permutexvar_epi16(_mm512_load_si512(s_read16.idx[c][0]), ((const __m512i*)src)[c]));
+	}
+}
+
+GS_TARGET_AVX512 static void ReadBlock8_AVX512(const uint8* RESTRICT src, uint8* RESTRICT dst, int dstpitch)
+{
+	for(int c = 0; c < 4; c++, dst += dstpitch * 4)
+	{
+		Store4x16_AVX512(dst, dstpitch, _mm512_permutexvar_epi8(_mm512_load_si512(s_read8.idx[c][0]), ((const __m512i*)src)[c]));
+	}
+}
+
+GS_TARGET_AVX512 static void ReadBlock4_AVX512(const uint8* RESTRICT src, uint8* RESTRICT dst, int dstpitch)
+{
+	for(int c = 0; c < 4; c++, dst += dstpitch * 4)
+	{
+		Store4x16_AVX512(dst, dstpitch, PermuteNibbles_AVX512(((const __m512i*)src)[c], s_read4.idx[c]));
+	}
+}
+
+#endif
+
+int GSBlock::SelectKernels(int set)
+{
+	InitTables();
+
+	memset(&m_kernels, 0, sizeof(m_kernels));
+
+	if(set >= KernelsAVX512 && !HasAVX512())
+	{
+		set = KernelsAVX2;
+	}
+
+	if(set >= KernelsAVX2 && !Xbyak::util::Cpu().has(Xbyak::util::Cpu::tAVX2))
+	{
+		set = KernelsCompiled;
+	}
+
+	#if _M_SSE < 0x501
+
+	if(set >= KernelsAVX2)
+	{
+		m_kernels.WriteBlock16 = WriteBlock16_AVX2;
+		m_kernels.WriteBlock8 = WriteBlock8_AVX2;
+		m_kernels.ReadBlock16 = ReadBlock16_AVX2;
+	}
+
+	#else
+
+	// the compiled paths are already AVX2
+
+	if(set == KernelsAVX2)
+	{
+		set = KernelsCompiled;
+	}
+
+	#endif
+
+	#ifdef GS_BLOCK_AVX512
+
+	if(set >= KernelsAVX512)
+	{
+		m_kernels.WriteBlock4 = WriteBlock4_AVX512;
+		m_kernels.ReadBlock16 = ReadBlock16_AVX512;
+		m_kernels.ReadBlock8 = ReadBlock8_AVX512;
+		m_kernels.ReadBlock4 = ReadBlock4_AVX512;
+	}
+
+	#endif
+
+	return set;
+}
+
+const char* GSBlock::GetKernelsName(int set)
+{
+	switch(set)
+	{
+	case KernelsAVX2: return "avx2";
+	case KernelsAVX512: return "avx512";
+	default: return "compiled";
+	}
+}
@@ -34,7 +34,14 @@ bool GSDeviceNull::Create(GSWnd* wnd)
 
 bool GSDeviceNull::Reset(int w, int h)
 {
-	return GSDevice::Reset(w, h);
+	if(!GSDevice::Reset(w, h))
+		return false;
+
+	// without a backbuffer Present would reset the device (and flush the texture pool) every frame
+
+	m_backbuffer = CreateSurface(GSTexture::RenderTarget, w, h, false, 0);
+
+	return true;
 }
 
 GSTexture* GSDeviceNull::CreateSurface(int type, int w, int h, bool msaa, int format)
@@ -50,6 +50,11 @@ void GSDrawScanline::BeginDraw(const GSRasterizerData* data)
 		m_local.temp.uv_minmax[1] = v.uph32(v);
 	}
 
+	int generation = GSFunctionMapCache::GetInstance().GetGeneration();
+
+	m_sp_map.Prewarm(generation);
+	m_ds_map.Prewarm(generation);
+
 	m_ds = m_ds_map[m_global.sel];
 
 	if(m_global.sel.aa1)
@@ -20,4 +20,215 @@
  */
 
 #include "stdafx.h"
+#include "GSdx.h"
 #include "GSFunctionMap.h"
+#include "GSScanlineEnvironment.h"
+
+#ifdef _WIN32
+#include "svnrev.h"
+#else
+#define SVN_REV 0
+#endif
+
+// bump JIT_CACHE_VERSION whenever the GSScanlineSelector bits or what
+// GSDrawScanlineCodeGenerator/GSSetupPrimCodeGenerator emit for them change
+
+#define JIT_CACHE_MAGIC 0x434a5347 // GSJC
+#define JIT_CACHE_VERSION 2
+
+GSFunctionMapCache::GSFunctionMapCache()
+	: m_crc(0)
+	, m_generation(0)
+	, m_dirty(false)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+GSFunctionMapCache& GSFunctionMapCache::GetInstance()
+{
+	static GSFunctionMapCache cache;
+
+	return cache;
+}
+
+uint32 GSFunctionMapCache::GetHash(const char* name)
+{
+	return crc32(0, (const Bytef*)name, strlen(name));
+}
+
+uint32 GSFunctionMapCache::GetBuildHash()
+{
+	// the generated code addresses these structures directly, JIT_CACHE_VERSION covers the rest
+
+	string s = format("%d %lld %d %d %d", JIT_CACHE_VERSION, (long long)SVN_REV, (int)sizeof(GSScanlineSelector), (int)sizeof(GSScanlineGlobalData), (int)sizeof(GSScanlineLocalData));
+
+	return crc32(0, (const Bytef*)s.c_str(), s.size());
+}
+
+uint32 GSFunctionMapCache::GetIsa()
+{
+	// the code generators pick instructions from both the build target and the host cpu
+
+	Xbyak::util::Cpu cpu;
+
+	uint32 isa = _M_SSE << 16;
+
+	if(cpu.has(Xbyak::util::Cpu::tSSE41)) isa |= 1 << 0;
+	if(cpu.has(Xbyak::util::Cpu::tAVX)) isa |= 1 << 1;
+	if(cpu.has(Xbyak::util::Cpu::tAVX2)) isa |= 1 << 2;
+	if(cpu.has(Xbyak::util::Cpu::tBMI1)) isa |= 1 << 3;
+	if(cpu.has(Xbyak::util::Cpu::tBMI2)) isa |= 1 << 4;
+	if(cpu.has(Xbyak::util::Cpu::tFMA)) isa |= 1 << 5;
+
+	#if defined(_M_AMD64) || defined(_WIN64)
+	isa |= 1 << 15;
+	#endif
+
+	return isa;
+}
+
+void GSFunctionMapCache::Open(uint32 crc)
+{
+	std::lock_guard<std::mutex> l(m_lock);
+
+	if(!m_path.empty() && crc == m_crc) return;
+
+	Save();
+
+	m_keys.clear();
+	m_path.clear();
+	m_crc = crc;
+
+	if(!theApp.GetConfigB("jit_cache")) return;
+
+	m_path = format("%sGSdx_jit_%08x_%08x.cache", theApp.GetConfigDir().c_str(), GetIsa(), crc);
+
+	Load();
+
+	m_generation++;
+}
+
+void GSFunctionMapCache::Close()
+{
+	std::lock_guard<std::mutex> l(m_lock);
+
+	Save();
+
+	if(m_stats.functions > 0)
+	{
+		printf("GSdx: jit cache %d keys, %d functions precompiled in %llu ticks\n", m_stats.keys, m_stats.functions, m_stats.ticks);
+	}
+
+	memset(&m_stats, 0, sizeof(m_stats));
+
+	m_keys.clear();
+	m_path.clear();
+}
+
+void GSFunctionMapCache::Load()
+{
+	FILE* fp = fopen(m_path.c_str(), "rb");
+
+	if(fp == NULL) return;
+
+	uint32 header[6];
+
+	if(fread(header, sizeof(header), 1, fp) == 1
+	&& header[0] == JIT_CACHE_MAGIC
+	&& header[1] == JIT_CACHE_VERSION
+	&& header[2] == GetIsa()
+	&& header[3] == GetBuildHash()
+	&& header[4] == m_crc)
+	{
+		Entry e;
+
+		for(uint32 i = 0; i < header[5] && fread(&e, sizeof(e), 1, fp) == 1; i++)
+		{
+			m_keys.insert(make_pair(e.name, e.key));
+		}
+	}
+
+	fclose(fp);
+
+	m_dirty = false;
+}
+
+void GSFunctionMapCache::Save()
+{
+	if(m_path.empty() || !m_dirty) return;
+
+	// write a temporary file first, a crash half way must not leave a truncated cache behind
+
+	string tmp = m_path + ".tmp";
+
+	FILE* fp = fopen(tmp.c_str(), "wb");
+
+	if(fp == NULL) return;
+
+	uint32 header[6] = {JIT_CACHE_MAGIC, JIT_CACHE_VERSION, GetIsa(), GetBuildHash(), m_crc, (uint32)m_keys.size()};
+
+	bool ok = fwrite(header, sizeof(header), 1, fp) == 1;
+
+	for(auto i = m_keys.begin(); ok && i != m_keys.end(); i++)
+	{
+		Entry e;
+
+		memset(&e, 0, sizeof(e));
+
+		e.name = i->first;
+		e.key = i->second;
+
+		ok = fwrite(&e, sizeof(e), 1, fp) == 1;
+	}
+
+	ok = fclose(fp) == 0 && ok;
+
+	if(ok)
+	{
+		#ifdef _WIN32
+		remove(m_path.c_str());
+		#endif
+
+		ok = rename(tmp.c_str(), m_path.c_str()) == 0;
+	}
+
+	if(!ok)
+	{
+		remove(tmp.c_str());
+	}
+
+	m_dirty = false;
+}
+
+void GSFunctionMapCache::GetKeys(const char* name, vector<uint64>& keys)
+{
+	std::lock_guard<std::mutex> l(m_lock);
+
+	uint32 hash = GetHash(name);
+
+	for(auto i = m_keys.lower_bound(make_pair(hash, (uint64)0)); i != m_keys.end() && i->first == hash; i++)
+	{
+		keys.push_back(i->second);
+	}
+}
+
+void GSFunctionMapCache::Record(const char* name, uint64 key)
+{
+	std::lock_guard<std::mutex> l(m_lock);
+
+	if(m_path.empty()) return;
+
+	if(m_keys.insert(make_pair(GetHash(name), key)).second)
+	{
+		m_dirty = true;
+	}
+}
+
+void GSFunctionMapCache::UpdateStats(int keys, int functions, uint64 ticks)
+{
+	std::lock_guard<std::mutex> l(m_lock);
+
+	m_stats.keys = std::max<int>(m_stats.keys, keys);
+	m_stats.functions += functions;
+	m_stats.ticks += ticks;
+}
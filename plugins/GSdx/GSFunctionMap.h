@@ -142,6 +142,48 @@ public:
 	}
 };
 
+// Generated code embeds absolute addresses of the per-thread scanline data, so it cannot be stored on disk.
+// Instead we remember which keys were compiled, per game, and compile them again before the first draw of
+// the next session. Entries are only valid for the same GSdx build and host cpu features.
+
+class GSFunctionMapCache
+{
+	struct Entry
+	{
+		uint32 name;
+		uint64 key;
+	};
+
+	std::mutex m_lock;
+	std::string m_path;
+	uint32 m_crc;
+	std::atomic<int> m_generation;
+	set<pair<uint32, uint64> > m_keys;
+	bool m_dirty;
+
+	struct {int keys, functions; uint64 ticks;} m_stats;
+
+	GSFunctionMapCache();
+
+	static uint32 GetHash(const char* name);
+	static uint32 GetBuildHash();
+	static uint32 GetIsa();
+
+	void Load();
+	void Save();
+
+public:
+	static GSFunctionMapCache& GetInstance();
+
+	void Open(uint32 crc);
+	void Close();
+
+	int GetGeneration() const {return m_generation;}
+	void GetKeys(const char* name, vector<uint64>& keys);
+	void Record(const char* name, uint64 key);
+	void UpdateStats(int keys, int functions, uint64 ticks);
+};
+
 class GSCodeGenerator : public Xbyak::CodeGenerator
 {
 protected:
@@ -161,6 +203,7 @@ class GSCodeGeneratorFunctionMap : public GSFunctionMap<KEY, VALUE>
 	void* m_param;
 	hash_map<uint64, VALUE> m_cgmap;
 	GSCodeBuffer m_cb;
+	int m_generation;
 
 	enum {MAX_SIZE = 8192};
 
@@ -168,7 +211,37 @@ public:
 	GSCodeGeneratorFunctionMap(const char* name, void* param)
 		: m_name(name)
 		, m_param(param)
+		, m_generation(0)
+	{
+	}
+
+	void Prewarm(int generation)
 	{
+		if(generation == m_generation) return;
+
+		m_generation = generation;
+
+		GSFunctionMapCache& cache = GSFunctionMapCache::GetInstance();
+
+		vector<uint64> keys;
+
+		cache.GetKeys(m_name.c_str(), keys);
+
+		uint64 start = __rdtsc();
+
+		int functions = 0;
+
+		for(auto i = keys.begin(); i != keys.end(); i++)
+		{
+			if(m_cgmap.find((KEY)*i) == m_cgmap.end())
+			{
+				GetDefaultFunction((KEY)*i);
+
+				functions++;
+			}
+		}
+
+		cache.UpdateStats((int)keys.size(), functions, __rdtsc() - start);
 	}
 
 	VALUE GetDefaultFunction(KEY key)
@@ -183,6 +256,8 @@ public:
 		}
 		else
 		{
+			GSFunctionMapCache::GetInstance().Record(m_name.c_str(), key);
+
 			CG* cg = new CG(m_param, key, m_cb.GetBuffer(MAX_SIZE), MAX_SIZE);
 
 			ASSERT(cg->getSize() < MAX_SIZE);
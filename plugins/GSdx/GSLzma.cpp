@@ -158,4 +158,452 @@ void GSDumpRaw::Read(void* ptr, size_t size) {
 	}
 }
 
+/******************************************************************/
+
+static const size_t s_block_size = 4 * 1024 * 1024;
+
+GSDumpPacketStream::GSDumpPacketStream(const char* filename, size_t limit)
+	: m_filename(filename)
+	, m_file(NULL)
+	, m_crc(0)
+	, m_limit(std::max<size_t>(limit, s_block_size * 2))
+	, m_allocated(0)
+	, m_peak(0)
+	, m_done(0)
+	, m_next(0)
+	, m_current(NULL)
+	, m_pos(0)
+	, m_resident(true)
+	, m_eof(false)
+	, m_error(false)
+	, m_restart(false)
+	, m_exit(false)
+{
+	m_file = OpenFile(m_filename);
+
+	try
+	{
+		ReadHeader(false);
+	}
+	catch(const char*)
+	{
+		delete m_file;
+
+		throw;
+	}
+
+	CreateThread();
+}
+
+GSDumpPacketStream::~GSDumpPacketStream()
+{
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		m_exit = true;
+	}
+
+	m_consumed.notify_one();
+
+	CloseThread();
+
+	delete m_file;
+
+	for(auto b : m_ready) m_free.push_back(b);
+
+	for(auto b : m_free)
+	{
+		_aligned_free(b->buff);
+
+		delete b;
+	}
+}
+
+GSDumpFile* GSDumpPacketStream::OpenFile(const string& filename)
+{
+#ifdef LZMA_SUPPORTED
+	return (filename.size() >= 4) && (filename.compare(filename.size()-3, 3, ".xz") == 0)
+		? (GSDumpFile*) new GSDumpLzma((char*)filename.c_str())
+		: (GSDumpFile*) new GSDumpRaw((char*)filename.c_str());
+#else
+	return new GSDumpRaw((char*)filename.c_str());
+#endif
+}
+
+void GSDumpPacketStream::ReadHeader(bool skip_state)
+{
+	uint32 crc;
+	m_file->Read(&crc, 4);
+
+	uint32 size;
+	m_file->Read(&size, 4);
+
+	if(skip_state)
+	{
+		// same content as the first pass, only skip it
+
+		uint8 regs[0x2000];
+
+		for(uint32 i = 0; i < size; i += sizeof(regs))
+		{
+			m_file->Read(regs, std::min<uint32>(size - i, sizeof(regs)));
+		}
+
+		m_file->Read(regs, 0x2000);
+	}
+	else
+	{
+		m_crc = crc;
+		m_state.resize(size);
+		m_file->Read(&m_state[0], size);
+
+		m_file->Read(m_regs, 0x2000);
+	}
+}
+
+// hands the replayed blocks back to the decoder once the dump is too large to stay in memory, called with m_lock held
+
+void GSDumpPacketStream::Recycle()
+{
+	if(m_resident || m_done == 0) return;
+
+	for(; m_done > 0; m_done--, m_next--)
+	{
+		m_free.push_back(m_ready.front());
+
+		m_ready.pop_front();
+	}
+
+	m_consumed.notify_one();
+}
+
+GSDumpPacketStream::Block* GSDumpPacketStream::GetBlock(size_t size)
+{
+	size = std::max<size_t>(size, s_block_size);
+
+	std::unique_lock<std::mutex> l(m_lock);
+
+	while(!m_exit && !m_restart)
+	{
+		for(auto i = m_free.begin(); i != m_free.end(); i++)
+		{
+			Block* b = *i;
+
+			if(b->size >= size)
+			{
+				m_free.erase(i);
+
+				b->used = 0;
+				b->index.clear();
+
+				return b;
+			}
+		}
+
+		if(m_allocated + size <= m_limit || m_ready.empty() && m_free.empty())
+		{
+			Block* b = new Block();
+
+			b->buff = (uint8*)_aligned_malloc(size, 32);
+			b->size = size;
+			b->used = 0;
+
+			m_allocated += size;
+			m_peak = std::max<size_t>(m_peak, m_allocated);
+
+			return b;
+		}
+
+		if(!m_free.empty())
+		{
+			// only blocks too small for this packet are left, make room for a larger one
+
+			for(auto b : m_free)
+			{
+				m_allocated -= b->size;
+
+				_aligned_free(b->buff);
+
+				delete b;
+			}
+
+			m_free.clear();
+
+			continue;
+		}
+
+		// the dump does not fit, from now on the replayed blocks are recycled
+
+		m_resident = false;
+
+		Recycle();
+
+		if(m_free.empty())
+		{
+			m_consumed.wait(l);
+		}
+	}
+
+	return NULL;
+}
+
+bool GSDumpPacketStream::Publish(Block* b)
+{
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		if(m_exit || m_restart)
+		{
+			m_free.push_back(b);
+
+			return false;
+		}
+
+		m_ready.push_back(b);
+	}
+
+	m_produced.notify_one();
+
+	return true;
+}
+
+// returns false if the pass was interrupted by Rewind or the destructor
+
+bool GSDumpPacketStream::Decode()
+{
+	Block* b = NULL;
+
+	try
+	{
+		while(!m_file->IsEof())
+		{
+			GSDumpPacket p;
+
+			m_file->Read(&p.type, 1);
+
+			p.param = 0;
+			p.size = 0;
+			p.addr = 0;
+			p.data = NULL;
+
+			uint32 payload = 0;
+
+			switch(p.type)
+			{
+			case 0:
+				m_file->Read(&p.param, 1);
+				m_file->Read(&p.size, 4);
+
+				if(p.param == 0) p.addr = 0x4000 - p.size;
+
+				payload = p.size;
+
+				break;
+
+			case 1:
+				m_file->Read(&p.param, 1);
+
+				break;
+
+			case 2:
+				m_file->Read(&p.size, 4);
+
+				break;
+
+			case 3:
+				p.size = 0x2000;
+
+				payload = p.size;
+
+				break;
+
+			default:
+				continue; // the last read past the end of a raw dump
+			}
+
+			// payloads stay 32 bytes aligned for the gif packed register loads
+
+			size_t size = (payload + 31) & ~31;
+
+			if(b != NULL && b->used + size > b->size)
+			{
+				if(!Publish(b)) return false;
+
+				b = NULL;
+			}
+
+			if(b == NULL && (b = GetBlock(size)) == NULL)
+			{
+				return false;
+			}
+
+			if(payload > 0)
+			{
+				p.data = b->buff + b->used;
+
+				m_file->Read(p.data, payload);
+
+				b->used += size;
+			}
+
+			b->index.push_back(p);
+		}
+	}
+	catch(const char*)
+	{
+		if(b != NULL)
+		{
+			std::lock_guard<std::mutex> l(m_lock);
+
+			m_free.push_back(b);
+		}
+
+		throw;
+	}
+
+	return b == NULL || Publish(b);
+}
+
+void GSDumpPacketStream::ThreadProc()
+{
+	while(true)
+	{
+		bool done;
+
+		try
+		{
+			done = Decode();
+		}
+		catch(const char*)
+		{
+			std::lock_guard<std::mutex> l(m_lock);
+
+			m_error = true;
+
+			done = true;
+		}
+
+		std::unique_lock<std::mutex> l(m_lock);
+
+		if(done && !m_restart)
+		{
+			m_eof = true;
+
+			m_produced.notify_one();
+		}
+
+		while(!m_exit && !m_restart)
+		{
+			m_consumed.wait(l);
+		}
+
+		if(m_exit) break;
+
+		m_restart = false;
+
+		l.unlock();
+
+		try
+		{
+			delete m_file;
+
+			m_file = NULL;
+			m_file = OpenFile(m_filename);
+
+			ReadHeader(true);
+		}
+		catch(const char*)
+		{
+			l.lock();
+
+			m_error = true;
+			m_eof = true;
+
+			m_produced.notify_one();
+
+			while(!m_exit && !m_restart)
+			{
+				m_consumed.wait(l);
+			}
+
+			if(m_exit) break;
+		}
+	}
+}
+
+const GSDumpPacket* GSDumpPacketStream::NextBlock()
+{
+	std::unique_lock<std::mutex> l(m_lock);
+
+	if(m_current != NULL)
+	{
+		m_current = NULL;
+		m_done = m_next;
+
+		Recycle();
+	}
+
+	while(m_next >= m_ready.size())
+	{
+		if(m_eof || m_exit) return NULL;
+
+		m_produced.wait(l);
+	}
+
+	m_current = m_ready[m_next++];
+	m_pos = 0;
+
+	return m_current->index.empty() ? NULL : &m_current->index[m_pos++];
+}
+
+void GSDumpPacketStream::Rewind()
+{
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		m_current = NULL;
+		m_pos = 0;
+		m_done = 0;
+		m_next = 0;
+
+		if(m_resident && m_eof && !m_error)
+		{
+			return;
+		}
+
+		// decode again from the start, whatever was read ahead is thrown away
+
+		for(auto b : m_ready) m_free.push_back(b);
+
+		m_ready.clear();
+
+		m_eof = false;
+		m_error = false;
+		m_restart = true;
+	}
+
+	m_consumed.notify_one();
+}
+
+bool GSDumpPacketStream::IsResident()
+{
+	std::lock_guard<std::mutex> l(m_lock);
+
+	return m_resident && m_eof;
+}
+
+bool GSDumpPacketStream::HasError()
+{
+	std::lock_guard<std::mutex> l(m_lock);
+
+	return m_error;
+}
+
+size_t GSDumpPacketStream::GetPeakMemory()
+{
+	std::lock_guard<std::mutex> l(m_lock);
+
+	return m_peak;
+}
+
 #endif
@@ -20,6 +20,8 @@
 
 #if defined(__unix__)
 
+#include "GSThread_CXX11.h"
+
 #ifdef LZMA_SUPPORTED
 #include <lzma.h>
 #endif
@@ -81,4 +83,97 @@ class GSDumpRaw : public GSDumpFile {
 	void Read(void* ptr, size_t size);
 };
 
+// A packet of the dump, data points into the block it was decoded to and stays valid until the
+// next call to GSDumpPacketStream::Next. The payload of a PATH1 transfer goes at the end of the
+// 0x4000 bytes vu1 memory window, addr is its offset there (the window itself isn't stored).
+
+struct GSDumpPacket
+{
+	uint8 type, param;
+	uint32 size, addr;
+	uint8* data;
+};
+
+// Decodes the packets of a dump on a background thread into a few large blocks, each with an index
+// of the packets it holds, and hands them out without per packet allocations. A dump that fits in
+// limit bytes stays resident and Rewind replays it from memory, a larger one is streamed through a
+// bounded set of recycled blocks and decoded again on every pass.
+
+class GSDumpPacketStream : public GSThread
+{
+	struct Block
+	{
+		uint8* buff;
+		size_t size;
+		size_t used;
+		vector<GSDumpPacket> index;
+	};
+
+	string m_filename;
+	GSDumpFile* m_file;
+
+	uint32 m_crc;
+	vector<uint8> m_state;
+	uint8 m_regs[0x2000];
+
+	size_t m_limit;
+	size_t m_allocated;
+	size_t m_peak;
+
+	deque<Block*> m_ready; // [0, m_done) replayed, [m_done, m_next) handed out, [m_next, end) decoded ahead
+	vector<Block*> m_free;
+	size_t m_done;
+	size_t m_next;
+
+	Block* m_current;
+	size_t m_pos;
+
+	bool m_resident;
+	bool m_eof;
+	bool m_error;
+	bool m_restart;
+	bool m_exit;
+
+	std::mutex m_lock;
+	std::condition_variable m_produced;
+	std::condition_variable m_consumed;
+
+	static GSDumpFile* OpenFile(const string& filename);
+
+	void ReadHeader(bool skip_state);
+	void Recycle();
+	Block* GetBlock(size_t size);
+	bool Publish(Block* b);
+	bool Decode();
+	const GSDumpPacket* NextBlock();
+
+	void ThreadProc();
+
+public:
+	GSDumpPacketStream(const char* filename, size_t limit);
+	virtual ~GSDumpPacketStream();
+
+	uint32 GetCRC() const {return m_crc;}
+	const vector<uint8>& GetState() const {return m_state;}
+	const uint8* GetRegs() const {return m_regs;}
+
+	// returns NULL at the end of the dump or on a read error
+
+	__forceinline const GSDumpPacket* Next()
+	{
+		if(m_current != NULL && m_pos < m_current->index.size())
+		{
+			return &m_current->index[m_pos++];
+		}
+
+		return NextBlock();
+	}
+
+	void Rewind();
+
+	bool IsResident();
+	bool HasError();
+	size_t GetPeakMemory();
+};
+
 #endif
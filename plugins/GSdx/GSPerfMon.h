@@ -36,13 +36,19 @@ public:
 	enum counter_t 
 	{
 		Frame, Prim, Draw, Swizzle, Unswizzle, Fillrate, Quad, SyncPoint,
+		SyncFull, SyncSource, SyncTarget, SyncUpload, SyncDownload, // requested by the sw renderer, by reason
+		TextureHit, TextureMiss, TextureEvict, // sw texture cache
+		TileJob, TileSteal, TileLoad,
+		SwizzleAsync, UnswizzleAsync, // the part of Swizzle/Unswizzle done by the rasterizer threads
 		CounterLast,
 	};
 
 protected:
 	double m_counters[CounterLast];
 	double m_stats[CounterLast];
+	double m_totals[CounterLast];
 	uint64 m_begin[TimerLast], m_total[TimerLast], m_start[TimerLast];
+	uint64 m_ticks[TimerLast];
 	uint64 m_frame;
 	clock_t m_lastframe;
 	int m_count;
@@ -59,6 +65,12 @@ public:
 	double Get(counter_t c) {return m_stats[c];}
 	void Update();
 
+	// never reset by Update or CPU, for measuring a whole run
+
+	double GetTotal(counter_t c) {return m_totals[c];}
+	uint64 GetTicks(int timer) {return m_ticks[timer];}
+	void ResetTotals();
+
 	void Start(int timer = Main);
 	void Stop(int timer = Main);
 	int CPU(int timer = Main, bool reset = true);
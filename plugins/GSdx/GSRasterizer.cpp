@@ -39,6 +39,18 @@ static int compute_best_thread_height(int threads) {
 		return 4;
 }
 
+static int compute_best_tile_shift() {
+	// - tiles must stay a multiple of 8 pixels wide so aligned sprites keep their notest fast path
+	// - 64x64 gives 256 tiles for a 1024x1024 target, enough to keep 16+ workers busy
+
+	int ts = theApp.GetConfigI("extrathreads_tile");
+
+	if (ts >= 4 && ts <= 8)
+		return ts;
+	else
+		return 6;
+}
+
 GSRasterizer::GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* perfmon)
 	: m_perfmon(perfmon)
 	, m_ds(ds)
@@ -60,7 +72,7 @@ GSRasterizer::GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* pe
 	{
 		for(int i = 0; i < threads; i++, row++)
 		{
-			m_scanline[row] = i == id ? 1 : 0;
+			m_scanline[row] = i == id || threads == 1 ? 1 : 0;
 		}
 	}
 }
@@ -131,31 +143,46 @@ int GSRasterizer::GetPixels(bool reset)
 }
 
 void GSRasterizer::Draw(GSRasterizerData* data)
+{
+	if(data->job)
+	{
+		GSPerfMonAutoTimer pmat(m_perfmon, GSPerfMon::WorkerDraw0 + m_id);
+
+		data->Run(m_id, m_threads);
+
+		return;
+	}
+
+	Draw(data, data->scissor, data->index, data->index_count);
+}
+
+void GSRasterizer::Draw(GSRasterizerData* data, const GSVector4i& scissor, const uint32* index, int index_count)
 {
 	GSPerfMonAutoTimer pmat(m_perfmon, GSPerfMon::WorkerDraw0 + m_id);
 
-	if(data->vertex != NULL && data->vertex_count == 0 || data->index != NULL && data->index_count == 0) return;
+	if(data->vertex != NULL && data->vertex_count == 0 || index != NULL && index_count == 0) return;
 
 	m_pixels.actual = 0;
 	m_pixels.total = 0;
 
 	data->start = __rdtsc();
 
+	data->WaitJobs();
+
 	m_ds->BeginDraw(data);
 
 	const GSVertexSW* vertex = data->vertex;
 	const GSVertexSW* vertex_end = data->vertex + data->vertex_count;
 
-	const uint32* index = data->index;
-	const uint32* index_end = data->index + data->index_count;
+	const uint32* index_end = index + index_count;
 
 	uint32 tmp_index[] = {0, 1, 2};
 
-	bool scissor_test = !data->bbox.eq(data->bbox.rintersect(data->scissor));
+	bool scissor_test = !data->bbox.eq(data->bbox.rintersect(scissor));
 
-	m_scissor = data->scissor;
-	m_fscissor_x = GSVector4(data->scissor).xzxz();
-	m_fscissor_y = GSVector4(data->scissor).ywyw();
+	m_scissor = scissor;
+	m_fscissor_x = GSVector4(scissor).xzxz();
+	m_fscissor_y = GSVector4(scissor).ywyw();
 
 	switch(data->primclass)
 	{
@@ -163,11 +190,11 @@ void GSRasterizer::Draw(GSRasterizerData* data)
 
 		if(scissor_test)
 		{
-			DrawPoint<true>(vertex, data->vertex_count, index, data->index_count);
+			DrawPoint<true>(vertex, data->vertex_count, index, index_count);
 		}
 		else
 		{
-			DrawPoint<false>(vertex, data->vertex_count, index, data->index_count);
+			DrawPoint<false>(vertex, data->vertex_count, index, index_count);
 		}
 
 		break;
@@ -1168,6 +1195,18 @@ GSRasterizerList::~GSRasterizerList()
 
 void GSRasterizerList::Queue(const shared_ptr<GSRasterizerData>& data)
 {
+	if(data->job)
+	{
+		// every worker does its own part
+
+		for(size_t i = 0; i < m_workers.size(); i++)
+		{
+			m_workers[i]->Push(data);
+		}
+
+		return;
+	}
+
 	GSVector4i r = data->bbox.rintersect(data->scissor);
 
 	ASSERT(r.top >= 0 && r.top < 2048 && r.bottom >= 0 && r.bottom < 2048);
@@ -1243,3 +1282,490 @@ void GSRasterizerList::GSWorker::Process(shared_ptr<GSRasterizerData>& item)
 {
 	m_r->Draw(item.get());
 }
+
+// GSRasterizerTileList
+
+GSRasterizerTileList::GSRasterizerTileList(int threads, GSPerfMon* perfmon)
+	: m_perfmon(perfmon)
+	, m_jobs(0)
+	, m_steals(0)
+	, m_exit(false)
+	, m_pending(0)
+{
+	m_tile_shift = compute_best_tile_shift();
+	m_tile_cols = 2048 >> m_tile_shift;
+
+	m_tiles.resize(m_tile_cols * m_tile_cols);
+	m_bin_count.resize(m_tiles.size());
+	m_ready.resize(threads);
+
+	for(size_t i = 0; i < m_tiles.size(); i++)
+	{
+		Tile& t = m_tiles[i];
+
+		int x = (int)i % m_tile_cols;
+		int y = (int)i / m_tile_cols;
+
+		// diagonal stripes, neighbouring tiles have different home workers
+
+		t.home = (x + y) % threads;
+		t.ready = false;
+		t.busy = false;
+		t.pixels = 0;
+		t.jobs = 0;
+		t.total_pixels = 0;
+	}
+}
+
+GSRasterizerTileList::~GSRasterizerTileList()
+{
+	Sync();
+
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		m_exit = true;
+	}
+
+	m_notempty.notify_all();
+
+	for(auto i = m_workers.begin(); i != m_workers.end(); i++)
+	{
+		delete *i;
+	}
+}
+
+GSVector4i GSRasterizerTileList::GetTileRect(int tile) const
+{
+	int x = (tile % m_tile_cols) << m_tile_shift;
+	int y = (tile / m_tile_cols) << m_tile_shift;
+
+	return GSVector4i(x, y, x + (1 << m_tile_shift), y + (1 << m_tile_shift));
+}
+
+// bounding box of a primitive in tile coordinates relative to tr, one pixel extra for the antialiased edges
+
+static __forceinline bool GetPrimTiles(const GSVertexSW* RESTRICT vertex, const uint32* RESTRICT index, int n, const GSVector4i& r, const GSVector4i& tr, int shift, GSVector4i& pr)
+{
+	GSVector4 pmin = vertex[index[0]].p;
+	GSVector4 pmax = pmin;
+
+	for(int j = 1; j < n; j++)
+	{
+		pmin = pmin.min(vertex[index[j]].p);
+		pmax = pmax.max(vertex[index[j]].p);
+	}
+
+	pr = (GSVector4i(pmin.floor().xyxy(pmax.ceil())) + GSVector4i(-1, -1, 2, 2)).rintersect(r);
+
+	if(pr.rempty()) return false;
+
+	pr.left = (pr.left >> shift) - tr.left;
+	pr.top = (pr.top >> shift) - tr.top;
+	pr.right = ((pr.right - 1) >> shift) + 1 - tr.left;
+	pr.bottom = ((pr.bottom - 1) >> shift) + 1 - tr.top;
+
+	return true;
+}
+
+void GSRasterizerTileList::Queue(const shared_ptr<GSRasterizerData>& data)
+{
+	if(data->job)
+	{
+		// tiles are not ordered between each other, wait for all of them and run the job here
+
+		Sync();
+
+		data->Run(0, 1);
+
+		return;
+	}
+
+	GSVector4i r = data->bbox.rintersect(data->scissor);
+
+	ASSERT(r.top >= 0 && r.top < 2048 && r.bottom >= 0 && r.bottom < 2048);
+
+	if(r.rempty()) return;
+
+	int shift = m_tile_shift;
+
+	GSVector4i tr;
+
+	tr.left = r.left >> shift;
+	tr.top = r.top >> shift;
+	tr.right = ((r.right - 1) >> shift) + 1;
+	tr.bottom = ((r.bottom - 1) >> shift) + 1;
+
+	int cols = tr.width();
+	int tiles = cols * tr.height();
+
+	// sort the primitives into the tiles they overlap, keeping their order (counting sort, two passes over the index buffer)
+
+	shared_ptr<vector<uint32> > bins;
+
+	int n = 0;
+
+	switch(data->primclass)
+	{
+	case GS_POINT_CLASS: n = 1; break;
+	case GS_LINE_CLASS: n = 2; break;
+	case GS_TRIANGLE_CLASS: n = 3; break;
+	case GS_SPRITE_CLASS: n = 2; break;
+	default: __assume(0);
+	}
+
+	if(tiles > 1 && data->index != NULL && data->index_count > n)
+	{
+		const GSVertexSW* RESTRICT vertex = data->vertex;
+		const uint32* RESTRICT index = data->index;
+		const uint32* RESTRICT index_end = index + data->index_count;
+
+		int* RESTRICT count = &m_bin_count[0];
+
+		memset(count, 0, sizeof(int) * tiles);
+
+		int total = 0;
+
+		for(; index < index_end; index += n)
+		{
+			GSVector4i pr;
+
+			if(!GetPrimTiles(vertex, index, n, r, tr, shift, pr)) continue;
+
+			for(int y = pr.top; y < pr.bottom; y++)
+			{
+				for(int x = pr.left; x < pr.right; x++)
+				{
+					count[y * cols + x] += n;
+				}
+			}
+
+			total += (pr.right - pr.left) * (pr.bottom - pr.top) * n;
+		}
+
+		// large primitives overlapping many tiles would only multiply the index buffer, let every tile walk all of them instead
+
+		if(total <= data->index_count * 2)
+		{
+			bins = std::make_shared<vector<uint32> >(std::max<int>(total, 1));
+
+			int offset = 0;
+
+			for(int i = 0; i < tiles; i++)
+			{
+				int c = count[i];
+				count[i] = offset;
+				offset += c;
+			}
+
+			uint32* RESTRICT dst = &(*bins)[0];
+
+			for(index = data->index; index < index_end; index += n)
+			{
+				GSVector4i pr;
+
+				if(!GetPrimTiles(vertex, index, n, r, tr, shift, pr)) continue;
+
+				for(int y = pr.top; y < pr.bottom; y++)
+				{
+					for(int x = pr.left; x < pr.right; x++)
+					{
+						uint32* RESTRICT d = &dst[count[y * cols + x]];
+
+						for(int j = 0; j < n; j++) d[j] = index[j];
+
+						count[y * cols + x] += n;
+					}
+				}
+			}
+		}
+	}
+
+	int ready = 0;
+
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		int offset = 0;
+
+		for(int y = tr.top, i = 0; y < tr.bottom; y++)
+		{
+			for(int x = tr.left; x < tr.right; x++, i++)
+			{
+				TileJob job;
+
+				job.data = data;
+
+				if(bins)
+				{
+					// m_bin_count holds the end offset of each bin after the second pass
+
+					int end = m_bin_count[i];
+
+					if(end == offset) continue;
+
+					job.bins = bins;
+					job.index = &(*bins)[offset];
+					job.index_count = end - offset;
+
+					offset = end;
+				}
+				else
+				{
+					job.index = data->index;
+					job.index_count = data->index_count;
+				}
+
+				int tile = y * m_tile_cols + x;
+
+				Tile& t = m_tiles[tile];
+
+				t.queue.push_back(job);
+				t.jobs++;
+
+				m_jobs++;
+
+				if(!t.ready && !t.busy)
+				{
+					t.ready = true;
+
+					m_ready[t.home].push_back(tile);
+
+					m_pending++;
+
+					ready++;
+				}
+			}
+		}
+	}
+
+	if(ready == 1)
+	{
+		m_notempty.notify_one();
+	}
+	else if(ready > 1)
+	{
+		m_notempty.notify_all();
+	}
+}
+
+int GSRasterizerTileList::Acquire(int id)
+{
+	// called with m_lock held
+
+	int tile = -1;
+
+	if(!m_ready[id].empty())
+	{
+		tile = m_ready[id].front();
+
+		m_ready[id].pop_front();
+	}
+	else
+	{
+		for(size_t i = 1; i < m_ready.size(); i++)
+		{
+			std::deque<int>& victim = m_ready[(id + i) % m_ready.size()];
+
+			if(!victim.empty())
+			{
+				tile = victim.back();
+
+				victim.pop_back();
+
+				m_steals++;
+
+				break;
+			}
+		}
+	}
+
+	if(tile >= 0)
+	{
+		m_tiles[tile].ready = false;
+		m_tiles[tile].busy = true;
+	}
+
+	return tile;
+}
+
+void GSRasterizerTileList::Release(int tile)
+{
+	// called with m_lock held
+
+	m_tiles[tile].busy = false;
+
+	if(--m_pending == 0)
+	{
+		m_empty.notify_all();
+	}
+}
+
+void GSRasterizerTileList::Sync()
+{
+	if(!IsSynced())
+	{
+		std::unique_lock<std::mutex> l(m_lock);
+
+		while(m_pending > 0)
+		{
+			m_empty.wait(l);
+		}
+
+		m_perfmon->Put(GSPerfMon::SyncPoint, 1);
+	}
+}
+
+bool GSRasterizerTileList::IsSynced() const
+{
+	return m_pending == 0;
+}
+
+int GSRasterizerTileList::GetPixels(bool reset)
+{
+	int pixels = 0;
+
+	for(size_t i = 0; i < m_workers.size(); i++)
+	{
+		pixels += m_workers[i]->GetPixels(reset);
+	}
+
+	if(reset && m_jobs > 0)
+	{
+		// the busiest tile bounds how well a batch can be spread over the workers
+
+		int max_pixels = 0;
+
+		for(auto i = m_tiles.begin(); i != m_tiles.end(); i++)
+		{
+			max_pixels = std::max<int>(max_pixels, i->pixels);
+
+			i->total_pixels += i->pixels;
+			i->pixels = 0;
+		}
+
+		m_perfmon->Put(GSPerfMon::TileJob, m_jobs);
+		m_perfmon->Put(GSPerfMon::TileSteal, m_steals);
+		m_perfmon->Put(GSPerfMon::TileLoad, max_pixels);
+
+		m_jobs = 0;
+		m_steals = 0;
+	}
+
+	return pixels;
+}
+
+void GSRasterizerTileList::PrintStats()
+{
+	int64 sum = 0;
+
+	for(auto i = m_tiles.begin(); i != m_tiles.end(); i++)
+	{
+		sum += i->total_pixels;
+	}
+
+	if(sum == 0) return;
+
+	printf("tiles %dx%d, pixels per tile in 1/1000 of the total\n", 1 << m_tile_shift, 1 << m_tile_shift);
+
+	for(int y = 0; y < m_tile_cols; y++)
+	{
+		int n = 0;
+
+		for(int x = 0; x < m_tile_cols; x++)
+		{
+			if(m_tiles[y * m_tile_cols + x].jobs > 0) n = x + 1;
+		}
+
+		if(n == 0) continue;
+
+		printf("%4d:", y << m_tile_shift);
+
+		for(int x = 0; x < n; x++)
+		{
+			Tile& t = m_tiles[y * m_tile_cols + x];
+
+			printf(" %3d", (int)(t.total_pixels * 1000 / sum));
+
+			t.jobs = 0;
+			t.total_pixels = 0;
+		}
+
+		printf("\n");
+	}
+}
+
+// GSRasterizerTileList::GSWorker
+
+GSRasterizerTileList::GSWorker::GSWorker(GSRasterizerTileList* parent, GSRasterizer* r, int id)
+	: m_parent(parent)
+	, m_r(r)
+	, m_id(id)
+{
+	CreateThread();
+}
+
+GSRasterizerTileList::GSWorker::~GSWorker()
+{
+	CloseThread();
+
+	delete m_r;
+}
+
+int GSRasterizerTileList::GSWorker::GetPixels(bool reset)
+{
+	return m_r->GetPixels(reset);
+}
+
+void GSRasterizerTileList::GSWorker::ThreadProc()
+{
+	vector<TileJob> jobs;
+
+	std::unique_lock<std::mutex> l(m_parent->m_lock);
+
+	while(true)
+	{
+		int tile = m_parent->Acquire(m_id);
+
+		if(tile < 0)
+		{
+			if(m_parent->m_exit) return;
+
+			m_parent->m_notempty.wait(l);
+
+			continue;
+		}
+
+		Tile& t = m_parent->m_tiles[tile];
+
+		GSVector4i rect = m_parent->GetTileRect(tile);
+
+		// draws queued while we work on the tile are picked up here too, nobody else may touch it until it is released
+
+		while(!t.queue.empty())
+		{
+			jobs.swap(t.queue);
+
+			l.unlock();
+
+			int pixels = m_r->GetPixels(false);
+
+			for(auto i = jobs.begin(); i != jobs.end(); i++)
+			{
+				GSRasterizerData* data = i->data.get();
+
+				m_r->Draw(data, rect.rintersect(data->scissor), i->index, i->index_count);
+			}
+
+			pixels = m_r->GetPixels(false) - pixels;
+
+			jobs.clear();
+
+			l.lock();
+
+			t.pixels += pixels;
+		}
+
+		m_parent->Release(tile);
+	}
+}
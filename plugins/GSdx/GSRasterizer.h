@@ -45,6 +45,7 @@ public:
 	uint64 start;
 	int pixels;
 	int counter;
+	bool job;
 
 	GSRasterizerData() 
 		: scissor(GSVector4i::zero())
@@ -58,6 +59,7 @@ public:
 		, frame(0)
 		, start(0)
 		, pixels(0)
+		, job(false)
 	{
 		counter = s_counter++;
 	}
@@ -66,6 +68,12 @@ public:
 	{
 		if(buff != NULL) _aligned_free(buff);
 	}
+
+	// Jobs are not drawn, they are local memory transfers ordered with the draws. Every rasterizer thread
+	// calls Run with its id instead, and a draw depending on the result of a job waits for it in WaitJobs.
+
+	virtual void Run(int id, int threads) {}
+	virtual void WaitJobs() {}
 };
 
 class IDrawScanline : public GSAlignedClass<32>
@@ -168,6 +176,7 @@ public:
 	__forceinline int FindMyNextScanline(int top) const;
 
 	void Draw(GSRasterizerData* data);
+	void Draw(GSRasterizerData* data, const GSVector4i& scissor, const uint32* index, int index_count);
 
 	// IRasterizer
 
@@ -206,26 +215,85 @@ protected:
 public:
 	virtual ~GSRasterizerList();
 
-	template<class DS> static IRasterizer* Create(int threads, GSPerfMon* perfmon)
+	template<class DS> static IRasterizer* Create(int threads, GSPerfMon* perfmon);
+
+	// IRasterizer
+
+	void Queue(const shared_ptr<GSRasterizerData>& data);
+	void Sync();
+	bool IsSynced() const;
+	int GetPixels(bool reset);
+	void PrintStats() {}
+};
+
+// Alternative to the scanline interleaving of GSRasterizerList: primitives are sorted into
+// 2D screen tiles when queued, and whole tiles are handed to a pool of workers. Each worker
+// drains the tiles assigned to it first and steals pending tiles from the others when idle.
+// Draws touching the same tile are always rasterized by one worker at a time, in order.
+
+class GSRasterizerTileList : public IRasterizer
+{
+protected:
+	struct TileJob
+	{
+		shared_ptr<GSRasterizerData> data;
+		shared_ptr<vector<uint32> > bins; // keeps the binned indices of the draw alive, NULL if index points into data
+		const uint32* index;
+		int index_count;
+	};
+
+	struct Tile
 	{
-		threads = std::max<int>(threads, 0);
+		vector<TileJob> queue;
+		int home;
+		bool ready;
+		bool busy;
+		int pixels; // since last GetPixels, written by the worker owning the tile
+		int jobs; // since last PrintStats
+		int64 total_pixels; // since last PrintStats
+	};
 
-		if(threads == 0)
-		{
-			return new GSRasterizer(new DS(), 0, 1, perfmon);
-		}
-		else
-		{
-			GSRasterizerList* rl = new GSRasterizerList(threads, perfmon);
+	class GSWorker : public GSThread
+	{
+		GSRasterizerTileList* m_parent;
+		GSRasterizer* m_r;
+		int m_id;
 
-			for(int i = 0; i < threads; i++)
-			{
-				rl->m_workers.push_back(new GSWorker(new GSRasterizer(new DS(), i, threads, perfmon)));
-			}
+	protected:
+		void ThreadProc();
 
-			return rl;
-		}
-	}
+	public:
+		GSWorker(GSRasterizerTileList* parent, GSRasterizer* r, int id);
+		virtual ~GSWorker();
+
+		int GetPixels(bool reset);
+	};
+
+	GSPerfMon* m_perfmon;
+	vector<GSWorker*> m_workers;
+	vector<Tile> m_tiles;
+	vector<std::deque<int> > m_ready; // per home worker
+	vector<int> m_bin_count;
+	int m_tile_shift;
+	int m_tile_cols;
+	int m_jobs;
+	int m_steals;
+	bool m_exit;
+	std::atomic<int> m_pending; // tiles either ready or being drawn
+	std::mutex m_lock;
+	std::condition_variable m_notempty;
+	std::condition_variable m_empty;
+
+	GSRasterizerTileList(int threads, GSPerfMon* perfmon);
+
+	int Acquire(int id);
+	void Release(int tile);
+	GSVector4i GetTileRect(int tile) const;
+
+	friend class GSRasterizerList;
+
+public:
+	virtual ~GSRasterizerTileList();
 
 	// IRasterizer
 
@@ -233,5 +301,39 @@ public:
 	void Sync();
 	bool IsSynced() const;
 	int GetPixels(bool reset);
-	void PrintStats() {}
+	void PrintStats();
 };
+
+template<class DS> IRasterizer* GSRasterizerList::Create(int threads, GSPerfMon* perfmon)
+{
+	threads = std::max<int>(threads, 0);
+
+	if(threads == 0)
+	{
+		return new GSRasterizer(new DS(), 0, 1, perfmon);
+	}
+	else if(theApp.GetConfigI("extrathreads_binning") == 1)
+	{
+		GSRasterizerTileList* rl = new GSRasterizerTileList(threads, perfmon);
+
+		for(int i = 0; i < threads; i++)
+		{
+			// every worker may draw any tile, it owns all the scanlines
+
+			rl->m_workers.push_back(new GSRasterizerTileList::GSWorker(rl, new GSRasterizer(new DS(), i, 1, perfmon), i));
+		}
+
+		return rl;
+	}
+	else
+	{
+		GSRasterizerList* rl = new GSRasterizerList(threads, perfmon);
+
+		for(int i = 0; i < threads; i++)
+		{
+			rl->m_workers.push_back(new GSWorker(new GSRasterizer(new DS(), i, threads, perfmon)));
+		}
+
+		return rl;
+	}
+}
@@ -411,6 +411,16 @@ void GSRenderer::VSync(int field)
 				}
 
 				s += format(" | %d%% CPU", sum);
+
+				double tiles = m_perfmon.Get(GSPerfMon::TileJob);
+
+				if(tiles > 0)
+				{
+					s += format(" | %d T/%d St/%.0f%% L",
+						(int)tiles,
+						(int)m_perfmon.Get(GSPerfMon::TileSteal),
+						100 * m_perfmon.Get(GSPerfMon::TileLoad) / fillrate);
+				}
 			}
 		}
 		else
@@ -27,6 +27,7 @@
 static FILE* s_fp = LOG ? fopen("c:\\temp1\\_.txt", "w") : NULL;
 
 GSVector4 GSRendererSW::m_pos_scale;
+GSRendererSW::VertexBenchmark* GSRendererSW::s_vertex_benchmark = NULL;
 #if _M_SSE >= 0x501
 GSVector8 GSRendererSW::m_pos_scale2;
 #endif
@@ -42,9 +43,17 @@ void GSRendererSW::InitVectors()
 
 GSRendererSW::GSRendererSW(int threads)
 	: m_fzb(NULL)
+	, m_pages_waiting(false)
+	, m_vt_deferred(false)
 {
 	m_nativeres = true; // ignore ini, sw is always native
 
+	// with binning the rasterizer has to drain all the tiles before a transfer, it would only add syncs
+
+	m_transfer = threads > 0 && theApp.GetConfigB("extrathreads_transfer") && theApp.GetConfigI("extrathreads_binning") != 1;
+
+	m_vt.SetThreads(theApp.GetConfigI("extrathreads_vertex"));
+
 	m_tc = new GSTextureCacheSW(this);
 
 	memset(m_texture, 0, sizeof(m_texture));
@@ -59,6 +68,7 @@ GSRendererSW::GSRendererSW(int threads)
 	for (uint32 i = 0; i < countof(m_tex_pages); i++) {
 		m_tex_pages[i] = 0;
 	}
+	memset(m_sync_pages, 0, sizeof(m_sync_pages));
 
 	#define InitCVB(P) \
 		m_cvb[P][0][0] = &GSRendererSW::ConvertVertexBuffer<P, 0, 0>; \
@@ -93,6 +103,8 @@ GSRendererSW::~GSRendererSW()
 	delete m_rl;
 
 	_aligned_free(m_output);
+
+	GSFunctionMapCache::GetInstance().Close();
 }
 
 void GSRendererSW::Reset()
@@ -236,6 +248,15 @@ void GSRendererSW::VSync(int field)
 	// if((m_perfmon.GetFrame() & 255) == 0) m_rl->PrintStats();
 }
 
+void GSRendererSW::SetGameCRC(uint32 crc, int options)
+{
+	GSRenderer::SetGameCRC(crc, options);
+
+	// the workers compile the scanline functions recorded for this game before their next draw
+
+	GSFunctionMapCache::GetInstance().Open(crc);
+}
+
 void GSRendererSW::ResetDevice()
 {
 	for(size_t i = 0; i < countof(m_texture); i++)
@@ -357,72 +378,90 @@ void GSRendererSW::ConvertVertexBuffer(GSVertexSW* RESTRICT dst, const GSVertex*
 
 	for(int i = (int)m_vertex.next; i > 0; i--, src++, dst++)
 	{
-		GSVector4 stcq = GSVector4::load<true>(&src->m[0]); // s t rgba q
-
-		#if _M_SSE >= 0x401
-
-		GSVector4i xyzuvf(src->m[1]);
+		GSVertexTrace::ConvertVertex<(GS_PRIM_CLASS)primclass, tme, fst>(dst, src, off, tsize, m_pos_scale);
+	}
 
-		GSVector4i xy = xyzuvf.upl16() - off;
-		GSVector4i zf = xyzuvf.ywww().min_u32(GSVector4i::xffffff00());
+	#endif
+}
 
-		#else
+void GSRendererSW::UpdateVertexTrace()
+{
+	// the index buffer of the list primitives is the identity, their vertices can be traced in the same
+	// pass which converts them, saving a read of the whole vertex buffer on large batches
 
-		uint32 z = src->XYZ.Z;
+	switch(PRIM->PRIM)
+	{
+	case GS_POINTLIST:
+	case GS_LINELIST:
+	case GS_TRIANGLELIST:
+	case GS_SPRITE:
+		if(m_index.tail == m_vertex.next)
+		{
+			if(s_vertex_benchmark)
+			{
+				BenchmarkVertexTrace();
+			}
 
-		GSVector4i xy = GSVector4i::load((int)src->XYZ.u32[0]).upl16() - off;
-		GSVector4i zf = GSVector4i((int)std::min<uint32>(z, 0xffffff00), src->FOG); // NOTE: larger values of z may roll over to 0 when converting back to uint32 later
+			m_vt_deferred = true;
 
-		#endif
+			return;
+		}
+		break;
+	default:
+		break;
+	}
 
-		dst->p = GSVector4(xy).xyxy(GSVector4(zf) + (GSVector4::m_x4f800000 & GSVector4::cast(zf.sra32(31)))) * m_pos_scale;
-		dst->c = GSVector4(GSVector4i::cast(stcq).zzzz().u8to32() << 7);
+	GSRenderer::UpdateVertexTrace();
+}
 
-		GSVector4 t = GSVector4::zero();
+void GSRendererSW::BenchmarkVertexTrace()
+{
+	VertexBenchmark* vb = s_vertex_benchmark;
 
-		if(tme)
-		{
-			if(fst)
-			{
-				#if _M_SSE >= 0x401
+	GS_PRIM_CLASS primclass = GSUtil::GetPrimClass(PRIM->PRIM);
 
-				t = GSVector4(xyzuvf.uph16() << (16 - 4));
-					
-				#else
+	size_t count = m_vertex.next;
 
-				t = GSVector4(GSVector4i::load(src->UV).upl16() << (16 - 4));
+	GSVertexSW* separate = (GSVertexSW*)_aligned_malloc(sizeof(GSVertexSW) * (count + 1), 64);
+	GSVertexSW* fused = (GSVertexSW*)_aligned_malloc(sizeof(GSVertexSW) * (count + 1), 64);
 
-				#endif
-			}
-			else
-			{
-				t = stcq.xyww() * tsize;
-			}
-		}
+	uint64 start = __rdtsc();
 
-		if(primclass == GS_SPRITE_CLASS)
-		{
-			#if _M_SSE >= 0x401
+	for(int i = 0; i < vb->loops; i++)
+	{
+		m_vt.Update(m_vertex.buff, m_index.buff, m_index.tail, primclass);
 
-			t = t.insert32<1, 3>(GSVector4::cast(xyzuvf));
+		(this->*m_cvb[primclass][PRIM->TME][PRIM->FST])(separate, m_vertex.buff, count);
+	}
 
-			#else
+	vb->separate_ticks += __rdtsc() - start;
 
-			t = t.insert32<0, 3>(GSVector4::cast(GSVector4i::load(z)));
+	GSVertexTrace::Vertex min = m_vt.m_min;
+	GSVertexTrace::Vertex max = m_vt.m_max;
+	uint32 eq = m_vt.m_eq.value;
 
-			#endif
-		}
+	start = __rdtsc();
 
-		dst->t = t;
+	for(int i = 0; i < vb->loops; i++)
+	{
+		m_vt.Update(fused, m_vertex.buff, count, primclass);
+	}
 
-		#if 0 //_M_SSE >= 0x501
+	vb->fused_ticks += __rdtsc() - start;
 
-		dst->_pad = GSVector4::zero();
+	bool mismatch = memcmp(&min, &m_vt.m_min, sizeof(min)) != 0 || memcmp(&max, &m_vt.m_max, sizeof(max)) != 0 || eq != m_vt.m_eq.value;
 
-		#endif
+	for(size_t i = 0; i < count && !mismatch; i++)
+	{
+		mismatch = memcmp(&separate[i].p, &fused[i].p, sizeof(GSVector4)) != 0 || memcmp(&separate[i].t, &fused[i].t, sizeof(GSVector4) * 2) != 0;
 	}
 
-	#endif
+	vb->draws++;
+	vb->vertices += count;
+	vb->mismatches += mismatch ? 1 : 0;
+
+	_aligned_free(separate);
+	_aligned_free(fused);
 }
 
 void GSRendererSW::Draw()
@@ -433,14 +472,24 @@ void GSRendererSW::Draw()
 
 	shared_ptr<GSRasterizerData> data(sd);
 
-	sd->primclass = m_vt.m_primclass;
 	sd->buff = (uint8*)_aligned_malloc(sizeof(GSVertexSW) * ((m_vertex.next + 1) & ~1) + sizeof(uint32) * m_index.tail, 64);
 	sd->vertex = (GSVertexSW*)sd->buff;
 	sd->vertex_count = m_vertex.next;
 	sd->index = (uint32*)(sd->buff + sizeof(GSVertexSW) * ((m_vertex.next + 1) & ~1));
 	sd->index_count = m_index.tail;
 
-	(this->*m_cvb[m_vt.m_primclass][PRIM->TME][PRIM->FST])(sd->vertex, m_vertex.buff, m_vertex.next);
+	if(m_vt_deferred)
+	{
+		m_vt_deferred = false;
+
+		m_vt.Update(sd->vertex, m_vertex.buff, m_vertex.next, GSUtil::GetPrimClass(PRIM->PRIM));
+	}
+	else
+	{
+		(this->*m_cvb[m_vt.m_primclass][PRIM->TME][PRIM->FST])(sd->vertex, m_vertex.buff, m_vertex.next);
+	}
+
+	sd->primclass = m_vt.m_primclass;
 
 	memcpy(sd->index, m_index.buff, sizeof(uint32) * m_index.tail);
 
@@ -521,6 +570,17 @@ void GSRendererSW::Draw()
 		sd->m_syncpoint = SharedData::SyncSource;
 	}
 
+	// wait for the queued draws using the conflicting pages, it must be done before this draw holds any of them
+
+	if(sd->m_syncpoint == SharedData::SyncSource)
+	{
+		SyncPages(GSPerfMon::SyncSource, true);
+	}
+	else if(sd->m_syncpoint == SharedData::SyncTarget)
+	{
+		SyncPages(GSPerfMon::SyncTarget, false);
+	}
+
 	// addref source and target pages
 
 	sd->UsePages(fb_pages, m_context->offset.fb->psm, zb_pages, m_context->offset.zb->psm);
@@ -628,18 +688,43 @@ void GSRendererSW::Queue(shared_ptr<GSRasterizerData>& item)
 {
 	SharedData* sd = (SharedData*)item.get();
 
-	if(sd->m_syncpoint == SharedData::SyncSource) 
+	// update previously invalidated parts (conflicting draws have already been waited for in Draw)
+
+	if(m_transfer && !s_dump)
 	{
-		Sync(4);
-	}
+		DecodeJob* job = new DecodeJob();
+
+		shared_ptr<GSRasterizerData> data(job);
 
-	// update previously invalidated parts
+		sd->UpdateSource(job);
 
-	sd->UpdateSource();
+		if(job->m_bytes >= 65536)
+		{
+			m_rl->Queue(data);
+
+			m_decode = std::static_pointer_cast<DecodeJob>(data);
 
-	if(sd->m_syncpoint == SharedData::SyncTarget)
+			m_perfmon.Put(GSPerfMon::UnswizzleAsync, job->m_bytes);
+		}
+		else if(job->m_bytes > 0)
+		{
+			job->Transfer(0, 1);
+		}
+
+		// the draw may read blocks of an earlier job through the texture cache, without decoding anything itself
+
+		if(m_decode && !m_decode->m_complete)
+		{
+			sd->m_decode = m_decode;
+		}
+		else
+		{
+			m_decode.reset();
+		}
+	}
+	else
 	{
-		Sync(5);
+		sd->UpdateSource();
 	}
 
 	if(LOG)
@@ -709,6 +794,78 @@ void GSRendererSW::Sync(int reason)
 	if(LOG) {fprintf(s_fp, "sync n=%d r=%d t=%llu p=%d %c\n", s_n, reason, t, pixels, t > 10000000 ? '*' : ' '); fflush(s_fp);}
 
 	m_perfmon.Put(GSPerfMon::Fillrate, pixels);
+	m_perfmon.Put(GSPerfMon::SyncFull, 1);
+}
+
+// Waits until the queued draws holding any page marked in m_sync_pages are done, the draws queued
+// after them keep running. The scanline workers release draws in queue order, so anything queued
+// before them is finished as well. The tile workers don't, that's why a texture about to be updated
+// also waits for its readers (tex).
+
+void GSRendererSW::SyncPages(GSPerfMon::counter_t reason, bool tex)
+{
+	GSPerfMonAutoTimer pmat(&m_perfmon, GSPerfMon::Sync);
+
+	uint64 t = __rdtsc();
+
+	{
+		std::unique_lock<std::mutex> l(m_pages_lock);
+
+		m_pages_waiting = true;
+
+		while(true)
+		{
+			bool busy = false;
+
+			for(uint32 row = 0; row < countof(m_sync_pages); row++)
+			{
+				uint32 p = m_sync_pages[row];
+
+				unsigned long j;
+
+				while(_BitScanForward(&j, p))
+				{
+					p ^= 1 << j;
+
+					uint32 i = (row << 5) + j;
+
+					if(m_fzb_pages[i] != 0 || tex && m_tex_pages[i] != 0)
+					{
+						busy = true;
+					}
+					else
+					{
+						m_sync_pages[row] &= ~(1 << j); // no need to check it again
+					}
+				}
+			}
+
+			if(!busy) break;
+
+			m_pages_released.wait(l);
+		}
+
+		m_pages_waiting = false;
+	}
+
+	t = __rdtsc() - t;
+
+	if(LOG) {fprintf(s_fp, "sync pages n=%d r=%d t=%llu %c\n", s_n, (int)reason, t, t > 10000000 ? '*' : ' '); fflush(s_fp);}
+
+	m_perfmon.Put(reason, 1);
+}
+
+void GSRendererSW::PagesReleased()
+{
+	// the store of m_pages_waiting and the page counters are ordered, either SyncPages sees the
+	// decremented counters or the notification is sent while it is waiting
+
+	if(m_pages_waiting)
+	{
+		std::lock_guard<std::mutex> l(m_pages_lock);
+
+		m_pages_released.notify_one();
+	}
 }
 
 void GSRendererSW::InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r)
@@ -723,20 +880,84 @@ void GSRendererSW::InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GS
 
 	if(!m_rl->IsSynced())
 	{
+		bool used = false;
+
 		for(uint32* RESTRICT p = m_tmp_pages; *p != GSOffset::EOP; p++)
 		{
 			if(m_fzb_pages[*p] | m_tex_pages[*p])
 			{
-				Sync(6);
+				m_sync_pages[*p >> 5] |= 1 << (*p & 31);
 
-				break;
+				used = true;
 			}
 		}
+
+		if(used)
+		{
+			SyncPages(GSPerfMon::SyncUpload, true);
+		}
 	}
 
 	m_tc->InvalidatePages(m_tmp_pages, off->psm); // if texture update runs on a thread and Sync(5) happens then this must come later
 }
 
+void GSRendererSW::WriteImage(int& tx, int& ty, const uint8* mem, int len, GIFRegBITBLTBUF& BITBLTBUF)
+{
+	const GSLocalMemory::psm_t& psm = GSLocalMemory::m_psm[BITBLTBUF.DPSM];
+
+	int l = (int)m_env.TRXPOS.DSAX;
+	int t = (int)m_env.TRXPOS.DSAY;
+	int w = (int)m_env.TRXREG.RRW;
+	int h = (int)m_env.TRXREG.RRH;
+
+	int pitch = w * psm.trbpp >> 3;
+	int bw = (int)BITBLTBUF.DBW * 64 / psm.pgs.x; // pages per row of pages
+	int rows = (t + h + psm.pgs.y - 1) / psm.pgs.y - t / psm.pgs.y;
+
+	// only a whole transfer can be split into rows of pages, and the rows must not share blocks: the rectangle has
+	// to stay inside the buffer width, and the pages must not wrap around the end of the local memory
+
+	if(!m_transfer || len < 65536 || tx != l || ty != t || (w * psm.trbpp & 7) != 0 || pitch * h != len
+	|| l + w > bw * psm.pgs.x || t + h > 2048 || rows * bw > MAX_PAGES)
+	{
+		GSState::WriteImage(tx, ty, mem, len, BITBLTBUF);
+
+		return;
+	}
+
+	UploadJob* job = new UploadJob(this);
+
+	shared_ptr<GSRasterizerData> data(job);
+
+	job->m_BITBLTBUF = BITBLTBUF;
+	job->m_TRXPOS = m_env.TRXPOS;
+	job->m_TRXREG = m_env.TRXREG;
+	job->m_pitch = pitch;
+
+	// the source is only valid until we return
+
+	job->buff = (uint8*)_aligned_malloc(len, 32);
+
+	memcpy(job->buff, mem, len);
+
+	// the pages count as both frame and z-buffer until the job is done, then any later access has to wait for it:
+	// draws (CheckTargetPages cross-checks the two), textures (CheckSourcePages), clut loads and readbacks
+
+	job->m_pages = m_mem.GetOffset(BITBLTBUF.DBP, BITBLTBUF.DBW, BITBLTBUF.DPSM)->GetPages(GSVector4i(l, t, l + w, t + h));
+
+	UsePages(job->m_pages, 0);
+	UsePages(job->m_pages, 1);
+
+	m_rl->Queue(data);
+
+	// where a complete transfer leaves the position
+
+	tx = l;
+	ty = t + h;
+
+	m_perfmon.Put(GSPerfMon::SwizzleAsync, len);
+}
+
 void GSRendererSW::InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r, bool clut)
 {
 	if(LOG) {fprintf(s_fp, "%s %05x %u %u, %d %d %d %d\n", clut ? "rp" : "r", BITBLTBUF.SBP, BITBLTBUF.SBW, BITBLTBUF.SPSM, r.x, r.y, r.z, r.w); fflush(s_fp);}
@@ -747,15 +968,22 @@ void GSRendererSW::InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GS
 
 		off->GetPages(r, m_tmp_pages);
 
+		bool used = false;
+
 		for(uint32* RESTRICT p = m_tmp_pages; *p != GSOffset::EOP; p++)
 		{
 			if(m_fzb_pages[*p])
 			{
-				Sync(7);
+				m_sync_pages[*p >> 5] |= 1 << (*p & 31);
 
-				break;
+				used = true;
 			}
 		}
+
+		if(used)
+		{
+			SyncPages(GSPerfMon::SyncDownload, false);
+		}
 	}
 }
 
@@ -822,7 +1050,7 @@ bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pag
 
 		memset(m_fzb_cur_pages, 0, sizeof(m_fzb_cur_pages));
 
-		uint32 used = 0;
+		bool used = false;
 
 		for(const uint32* p = fb_pages; *p != GSOffset::EOP; p++)
 		{
@@ -833,7 +1061,12 @@ bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pag
 			
 			m_fzb_cur_pages[row] |= col;
 
-			used |= m_fzb_pages[i];
+			if(m_fzb_pages[i])
+			{
+				m_sync_pages[row] |= col;
+
+				used = true;
+			}
 		}
 
 		for(const uint32* p = zb_pages; *p != GSOffset::EOP; p++)
@@ -845,7 +1078,12 @@ bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pag
 			
 			m_fzb_cur_pages[row] |= col;
 
-			used |= m_fzb_pages[i];
+			if(m_fzb_pages[i])
+			{
+				m_sync_pages[row] |= col;
+
+				used = true;
+			}
 		}
 
 		if(!synced)
@@ -877,7 +1115,7 @@ bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pag
 			if(fb_pages == NULL) fb_pages = m_context->offset.fb->GetPages(r);
 			if(zb_pages == NULL) zb_pages = m_context->offset.zb->GetPages(r);
 
-			uint32 used = 0;
+			bool used = false;
 
 			for(const uint32* p = fb_pages; *p != GSOffset::EOP; p++)
 			{
@@ -890,7 +1128,12 @@ bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pag
 				{
 					m_fzb_cur_pages[row] |= col;
 
-					used |= m_fzb_pages[i];
+					if(m_fzb_pages[i])
+					{
+						m_sync_pages[row] |= col;
+
+						used = true;
+					}
 				}
 			}
 
@@ -905,7 +1148,12 @@ bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pag
 				{
 					m_fzb_cur_pages[row] |= col;
 
-					used |= m_fzb_pages[i];
+					if(m_fzb_pages[i])
+					{
+						m_sync_pages[row] |= col;
+
+						used = true;
+					}
 				}
 			}
 
@@ -925,32 +1173,32 @@ bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pag
 			// chross-check frame and z-buffer pages, they cannot overlap with eachother and with previous batches in queue,
 			// have to be careful when the two buffers are mutually enabled/disabled and alternating (Bully FBP/ZBP = 0x2300)
 
-			if(fb && !res)
+			if(fb)
 			{
 				for(const uint32* p = fb_pages; *p != GSOffset::EOP; p++)
 				{
 					if(m_fzb_pages[*p] & 0xffff0000)
 					{
-						if(LOG) {fprintf(s_fp, "syncpoint 2\n"); fflush(s_fp);}
+						if(LOG && !res) {fprintf(s_fp, "syncpoint 2\n"); fflush(s_fp);}
 
-						res = true;
+						m_sync_pages[*p >> 5] |= 1 << (*p & 31);
 
-						break;
+						res = true;
 					}
 				}
 			}
 
-			if(zb && !res)
+			if(zb)
 			{
 				for(const uint32* p = zb_pages; *p != GSOffset::EOP; p++)
 				{
 					if(m_fzb_pages[*p] & 0x0000ffff)
 					{
-						if(LOG) {fprintf(s_fp, "syncpoint 3\n"); fflush(s_fp);}
+						if(LOG && !res) {fprintf(s_fp, "syncpoint 3\n"); fflush(s_fp);}
 
-						res = true;
+						m_sync_pages[*p >> 5] |= 1 << (*p & 31);
 
-						break;
+						res = true;
 					}
 				}
 			}
@@ -965,6 +1213,8 @@ bool GSRendererSW::CheckTargetPages(const uint32* fb_pages, const uint32* zb_pag
 
 bool GSRendererSW::CheckSourcePages(SharedData* sd)
 {
+	bool res = false;
+
 	if(!m_rl->IsSynced())
 	{
 		for(size_t i = 0; sd->m_tex[i].t != NULL; i++)
@@ -979,13 +1229,15 @@ bool GSRendererSW::CheckSourcePages(SharedData* sd)
 
 				if(m_fzb_pages[*p]) // currently being drawn to? => sync
 				{
-					return true;
+					m_sync_pages[*p >> 5] |= 1 << (*p & 31);
+
+					res = true;
 				}
 			}
 		}
 	}
 
-	return false;
+	return res;
 }
 
 #include "GSTextureSW.h"
@@ -1578,6 +1830,8 @@ void GSRendererSW::SharedData::ReleasePages()
 		{
 			m_parent->ReleasePages(m_tex[i].t->m_pages.n, 2);
 		}
+
+		m_parent->PagesReleased();
 	}
 
 	delete [] m_fb_pages;
@@ -1599,11 +1853,11 @@ void GSRendererSW::SharedData::SetSource(GSTextureCacheSW::Texture* t, const GSV
 	m_tex[level + 1].t = NULL;
 }
 
-void GSRendererSW::SharedData::UpdateSource()
+void GSRendererSW::SharedData::UpdateSource(DecodeJob* job)
 {
 	for(size_t i = 0; m_tex[i].t != NULL; i++)
 	{
-		if(m_tex[i].t->Update(m_tex[i].r))
+		if(m_tex[i].t->Update(m_tex[i].r, job != NULL ? &job->m_pending[i] : NULL))
 		{
 			global.tex[i] = m_tex[i].t->m_buff;
 		}
@@ -1613,6 +1867,16 @@ void GSRendererSW::SharedData::UpdateSource()
 
 			global.sel.tfx = TFX_NONE;
 		}
+
+		if(job != NULL)
+		{
+			job->m_tex[i] = m_tex[i].t;
+			job->m_tex[i + 1] = NULL;
+
+			const GSLocalMemory::psm_t& psm = GSLocalMemory::m_psm[m_tex[i].t->m_TEX0.PSM];
+
+			job->m_bytes += (job->m_pending[i].size() / 2) * (psm.bs.x * psm.bs.y << (psm.pal == 0 ? 2 : 0));
+		}
 	}
 
 	// TODO
@@ -1649,3 +1913,103 @@ void GSRendererSW::SharedData::UpdateSource()
 		}
 	}
 }
+
+void GSRendererSW::SharedData::WaitJobs()
+{
+	if(m_decode)
+	{
+		while(!m_decode->m_complete)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+// GSRendererSW::TransferJob
+
+GSRendererSW::TransferJob::TransferJob()
+	: m_done(0)
+	, m_complete(false)
+{
+	job = true;
+}
+
+void GSRendererSW::TransferJob::Run(int id, int threads)
+{
+	Transfer(id, threads);
+
+	// the last thread to finish publishes the result of all of them
+
+	if(++m_done == threads)
+	{
+		m_complete = true;
+	}
+}
+
+// GSRendererSW::UploadJob
+
+GSRendererSW::UploadJob::UploadJob(GSRendererSW* parent)
+	: m_parent(parent)
+	, m_pitch(0)
+	, m_pages(NULL)
+{
+}
+
+GSRendererSW::UploadJob::~UploadJob()
+{
+	if(m_pages != NULL)
+	{
+		m_parent->ReleasePages(m_pages, 0);
+		m_parent->ReleasePages(m_pages, 1);
+
+		m_parent->PagesReleased();
+
+		delete [] m_pages;
+	}
+}
+
+void GSRendererSW::UploadJob::Transfer(int id, int threads)
+{
+	const GSLocalMemory::psm_t& psm = GSLocalMemory::m_psm[m_BITBLTBUF.DPSM];
+
+	int top = (int)m_TRXPOS.DSAY;
+	int bottom = top + (int)m_TRXREG.RRH;
+
+	// rows of pages are dealt out by their position in memory, the same pages always go to the same thread
+
+	for(int y = top - top % psm.pgs.y; y < bottom; y += psm.pgs.y)
+	{
+		if((y / psm.pgs.y) % threads != id) continue;
+
+		int y0 = std::max<int>(y, top);
+		int y1 = std::min<int>(y + psm.pgs.y, bottom);
+
+		int tx = (int)m_TRXPOS.DSAX;
+		int ty = y0;
+
+		GIFRegBITBLTBUF BITBLTBUF = m_BITBLTBUF;
+		GIFRegTRXPOS TRXPOS = m_TRXPOS;
+		GIFRegTRXREG TRXREG = m_TRXREG;
+
+		(m_parent->m_mem.*psm.wi)(tx, ty, &buff[(y0 - top) * m_pitch], (y1 - y0) * m_pitch, BITBLTBUF, TRXPOS, TRXREG);
+	}
+}
+
+// GSRendererSW::DecodeJob
+
+GSRendererSW::DecodeJob::DecodeJob()
+	: m_bytes(0)
+{
+	m_tex[0] = NULL;
+}
+
+void GSRendererSW::DecodeJob::Transfer(int id, int threads)
+{
+	for(size_t i = 0; m_tex[i] != NULL; i++)
+	{
+		if(!m_pending[i].empty())
+		{
+			m_tex[i]->ReadBlocks(&m_pending[i][0], m_pending[i].size(), id, threads);
+		}
+	}
+}
@@ -32,6 +32,51 @@ class GSRendererSW : public GSRenderer
 	static GSVector8 m_pos_scale2;
 #endif
 
+	// Local memory transfers split by pages and done by the rasterizer threads, see WriteImage and Queue
+
+	class TransferJob : public GSRasterizerData
+	{
+		std::atomic<int> m_done; // threads which have finished their part
+
+	public:
+		std::atomic<bool> m_complete;
+
+		TransferJob();
+
+		void Run(int id, int threads);
+		virtual void Transfer(int id, int threads) = 0;
+	};
+
+	class UploadJob : public TransferJob
+	{
+	public:
+		GSRendererSW* m_parent;
+		GIFRegBITBLTBUF m_BITBLTBUF;
+		GIFRegTRXPOS m_TRXPOS;
+		GIFRegTRXREG m_TRXREG;
+		int m_pitch;
+		uint32* m_pages;
+
+	public:
+		UploadJob(GSRendererSW* parent);
+		virtual ~UploadJob();
+
+		void Transfer(int id, int threads);
+	};
+
+	class DecodeJob : public TransferJob
+	{
+	public:
+		GSTextureCacheSW::Texture* m_tex[7 + 1]; // NULL terminated
+		vector<uint32> m_pending[7];
+		size_t m_bytes;
+
+	public:
+		DecodeJob();
+
+		void Transfer(int id, int threads);
+	};
+
 	class SharedData : public GSDrawScanline::SharedData
 	{
 		struct alignas(16) TextureLevel
@@ -49,6 +94,7 @@ class GSRendererSW : public GSRenderer
 		bool m_using_pages;
 		TextureLevel m_tex[7 + 1]; // NULL terminated
 		enum {SyncNone, SyncSource, SyncTarget} m_syncpoint;
+		shared_ptr<DecodeJob> m_decode; // the last one queued before this draw, it also completes every earlier one
 
 	public:
 		SharedData(GSRendererSW* parent);
@@ -58,7 +104,9 @@ class GSRendererSW : public GSRenderer
 		void ReleasePages();
 
 		void SetSource(GSTextureCacheSW::Texture* t, const GSVector4i& r, int level);
-		void UpdateSource();
+		void UpdateSource(DecodeJob* job = NULL);
+
+		void WaitJobs();
 	};
 
 	typedef void (GSRendererSW::*ConvertVertexBufferPtr)(GSVertexSW* RESTRICT dst, const GSVertex* RESTRICT src, size_t count);
@@ -79,20 +127,33 @@ protected:
 	std::atomic<uint32> m_fzb_pages[512]; // uint16 frame/zbuf pages interleaved
 	std::atomic<uint16> m_tex_pages[512];
 	uint32 m_tmp_pages[512 + 1];
+	uint32 m_sync_pages[16]; // conflicting pages found by the Check* functions
+	std::mutex m_pages_lock;
+	std::condition_variable m_pages_released;
+	std::atomic<bool> m_pages_waiting;
+	bool m_transfer;
+	shared_ptr<DecodeJob> m_decode;
+	bool m_vt_deferred; // list primitives, m_vt is updated by Draw while it converts the vertices
 
 	void Reset();
 	void VSync(int field);
+	void SetGameCRC(uint32 crc, int options);
 	void ResetDevice();
 	GSTexture* GetOutput(int i, int& y_offset);
 
+	void UpdateVertexTrace();
+	void BenchmarkVertexTrace();
 	void Draw();
 	void Queue(shared_ptr<GSRasterizerData>& item);
 	void Sync(int reason);
+	void SyncPages(GSPerfMon::counter_t reason, bool tex);
 	void InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r);
 	void InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r, bool clut = false);
+	void WriteImage(int& tx, int& ty, const uint8* mem, int len, GIFRegBITBLTBUF& BITBLTBUF);
 
 	void UsePages(const uint32* pages, const int type);
 	void ReleasePages(const uint32* pages, const int type);
+	void PagesReleased();
 
 	bool CheckTargetPages(const uint32* fb_pages, const uint32* zb_pages, const GSVector4i& r);
 	bool CheckSourcePages(SharedData* sd);
@@ -100,6 +161,17 @@ protected:
 	bool GetScanlineGlobalData(SharedData* data);
 
 public:
+	// GSVertexBenchmark, every list primitive draw also times the separate and the fused vertex passes
+
+	struct VertexBenchmark
+	{
+		int loops;
+		uint64 draws, vertices, mismatches;
+		uint64 separate_ticks, fused_ticks;
+	};
+
+	static VertexBenchmark* s_vertex_benchmark;
+
 	static void InitVectors();
 
 	GSRendererSW(int threads);
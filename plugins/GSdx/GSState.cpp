@@ -1479,9 +1479,7 @@ void GSState::FlushWrite()
 
 	//int y = m_tr.y;
 
-	GSLocalMemory::writeImage wi = GSLocalMemory::m_psm[m_env.BITBLTBUF.DPSM].wi;
-
-	(m_mem.*wi)(m_tr.x, m_tr.y, &m_tr.buff[m_tr.start], len, m_env.BITBLTBUF, m_env.TRXPOS, m_env.TRXREG);
+	WriteImage(m_tr.x, m_tr.y, &m_tr.buff[m_tr.start], len, m_env.BITBLTBUF);
 
 	m_tr.start += len;
 
@@ -1507,6 +1505,18 @@ void GSState::FlushWrite()
 */
 }
 
+void GSState::WriteImage(int& tx, int& ty, const uint8* mem, int len, GIFRegBITBLTBUF& BITBLTBUF)
+{
+	GSLocalMemory::writeImage wi = GSLocalMemory::m_psm[BITBLTBUF.DPSM].wi;
+
+	(m_mem.*wi)(tx, ty, mem, len, BITBLTBUF, m_env.TRXPOS, m_env.TRXREG);
+}
+
+void GSState::UpdateVertexTrace()
+{
+	m_vt.Update(m_vertex.buff, m_index.buff, m_index.tail, GSUtil::GetPrimClass(PRIM->PRIM));
+}
+
 void GSState::FlushPrim()
 {
 	if(m_index.tail > 0)
@@ -1584,7 +1594,7 @@ void GSState::FlushPrim()
 
 		if(GSLocalMemory::m_psm[m_context->FRAME.PSM].fmt < 3 && GSLocalMemory::m_psm[m_context->ZBUF.PSM].fmt < 3)
 		{
-			m_vt.Update(m_vertex.buff, m_index.buff, m_index.tail, GSUtil::GetPrimClass(PRIM->PRIM));
+			UpdateVertexTrace();
 
 			try {
 				Draw();
@@ -1689,7 +1699,7 @@ void GSState::Write(const uint8* mem, int len)
 
 		InvalidateVideoMem(blit, r);
 
-		(m_mem.*psm.wi)(m_tr.x, m_tr.y, mem, m_tr.total, blit, m_env.TRXPOS, m_env.TRXREG);
+		WriteImage(m_tr.x, m_tr.y, mem, m_tr.total, blit);
 
 		m_tr.start = m_tr.end = m_tr.total;
 
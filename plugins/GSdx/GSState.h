@@ -254,10 +254,12 @@ public:
 	void Flush();
 	void FlushPrim();
 	void FlushWrite();
+	virtual void UpdateVertexTrace();
 	virtual void Draw() = 0;
 	virtual void PurgePool() = 0;
 	virtual void InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r) {}
 	virtual void InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r, bool clut = false) {}
+	virtual void WriteImage(int& tx, int& ty, const uint8* mem, int len, GIFRegBITBLTBUF& BITBLTBUF);
 
 	void Move();
 	void Write(const uint8* mem, int len);
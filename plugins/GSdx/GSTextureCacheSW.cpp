@@ -24,7 +24,11 @@
 
 GSTextureCacheSW::GSTextureCacheSW(GSState* state)
 	: m_state(state)
+	, m_head(NULL)
+	, m_tail(NULL)
+	, m_age(0)
 {
+	memset(m_map, 0, sizeof(m_map));
 }
 
 GSTextureCacheSW::~GSTextureCacheSW()
@@ -32,52 +36,98 @@ GSTextureCacheSW::~GSTextureCacheSW()
 	RemoveAll();
 }
 
-GSTextureCacheSW::Texture* GSTextureCacheSW::Lookup(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, uint32 tw0)
+// Everything Lookup compares goes into the key: TBP0 TBW PSM TW TH (34 bits), the requested
+// width (4 bits) and TEXA when it matters for the format (17 bits).
+
+uint64 GSTextureCacheSW::GetKey(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, uint32 tw0)
 {
 	const GSLocalMemory::psm_t& psm = GSLocalMemory::m_psm[TEX0.PSM];
 
-	Texture* t = NULL;
+	ASSERT(tw0 < 16);
 
-	list<Texture*>& m = m_map[TEX0.TBP0 >> 5];
+	uint64 key = (uint64)TEX0.u32[0] | ((uint64)(TEX0.u32[1] & 3) << 32) | ((uint64)tw0 << 34);
 
-	for(list<Texture*>::iterator i = m.begin(); i != m.end(); ++i)
+	if((psm.trbpp == 16 || psm.trbpp == 24) && TEX0.TCC)
 	{
-		Texture* t2 = *i;
+		key |= (uint64)(TEXA.TA0 | (TEXA.AEM << 8) | (TEXA.TA1 << 9)) << 38;
+	}
 
-		if(((TEX0.u32[0] ^ t2->m_TEX0.u32[0]) | ((TEX0.u32[1] ^ t2->m_TEX0.u32[1]) & 3)) != 0) // TBP0 TBW PSM TW TH
-		{
-			continue;
-		}
+	return key;
+}
 
-		if((psm.trbpp == 16 || psm.trbpp == 24) && TEX0.TCC && TEXA != t2->m_TEXA)
-		{
-			continue;
-		}
+GSTextureCacheSW::Texture* GSTextureCacheSW::Lookup(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, uint32 tw0)
+{
+	uint64 key = GetKey(TEX0, TEXA, tw0);
+
+	Texture* t = NULL;
+
+	hash_map<uint64, Texture*>::iterator i = m_textures.find(key);
 
-		if(tw0 != 0 && t2->m_tw != tw0)
+	if(i != m_textures.end())
+	{
+		t = i->second;
+
+		// move to the front of the age list
+
+		if(t != m_head)
 		{
-			continue;
-		}
+			t->m_prev->m_next = t->m_next;
 
-		m.splice(m.begin(), m, i);
+			if(t->m_next) t->m_next->m_prev = t->m_prev;
+			else m_tail = t->m_prev;
 
-		t = t2;
+			t->m_prev = NULL;
+			t->m_next = m_head;
+			m_head->m_prev = t;
+			m_head = t;
+		}
 
-		t->m_age = 0;
+		t->m_age = m_age;
 
-		break;
+		m_state->m_perfmon.Put(GSPerfMon::TextureHit, 1);
 	}
-
-	if(t == NULL)
+	else
 	{
 		t = new Texture(m_state, tw0, TEX0, TEXA);
 
-		m_textures.insert(t);
+		t->m_key = key;
+		t->m_age = m_age;
+
+		m_textures[key] = t;
+
+		t->m_prev = NULL;
+		t->m_next = m_head;
+
+		if(m_head) m_head->m_prev = t;
+		else m_tail = t;
+
+		m_head = t;
+
+		size_t n = 0;
 
 		for(const uint32* p = t->m_pages.n; *p != GSOffset::EOP; p++)
 		{
-			m_map[*p].push_front(t);
+			n++;
 		}
+
+		t->m_links.resize(n);
+
+		Texture::PageLink* l = t->m_links.data();
+
+		for(const uint32* p = t->m_pages.n; *p != GSOffset::EOP; p++, l++)
+		{
+			Texture::PageLink*& head = m_map[*p];
+
+			l->t = t;
+			l->prev = NULL;
+			l->next = head;
+
+			if(head) head->prev = l;
+
+			head = l;
+		}
+
+		m_state->m_perfmon.Put(GSPerfMon::TextureMiss, 1);
 	}
 
 	return t;
@@ -89,11 +139,9 @@ void GSTextureCacheSW::InvalidatePages(const uint32* pages, uint32 psm)
 	{
 		uint32 page = *p;
 
-		const list<Texture*>& map = m_map[page];
-
-		for(list<Texture*>::const_iterator i = map.begin(); i != map.end(); ++i)
+		for(const Texture::PageLink* i = m_map[page]; i != NULL; i = i->next)
 		{
-			Texture* t = *i;
+			Texture* t = i->t;
 
 			if(GSUtil::HasSharedBits(psm, t->m_sharedbits))
 			{
@@ -119,44 +167,55 @@ void GSTextureCacheSW::InvalidatePages(const uint32* pages, uint32 psm)
 	}
 }
 
-void GSTextureCacheSW::RemoveAll()
+void GSTextureCacheSW::Remove(Texture* t)
 {
-	for_each(m_textures.begin(), m_textures.end(), delete_object());
+	m_textures.erase(t->m_key);
 
-	m_textures.clear();
+	if(t->m_prev) t->m_prev->m_next = t->m_next;
+	else m_head = t->m_next;
+
+	if(t->m_next) t->m_next->m_prev = t->m_prev;
+	else m_tail = t->m_prev;
+
+	Texture::PageLink* l = t->m_links.data();
 
-	for(int i = 0; i < MAX_PAGES; i++)
+	for(const uint32* p = t->m_pages.n; *p != GSOffset::EOP; p++, l++)
 	{
-		m_map[i].clear();
+		if(l->prev) l->prev->next = l->next;
+		else m_map[*p] = l->next;
+
+		if(l->next) l->next->prev = l->prev;
 	}
+
+	delete t;
 }
 
-void GSTextureCacheSW::IncAge()
+void GSTextureCacheSW::RemoveAll()
 {
-	for(hash_set<Texture*>::iterator i = m_textures.begin(); i != m_textures.end(); )
+	for(hash_map<uint64, Texture*>::iterator i = m_textures.begin(); i != m_textures.end(); ++i)
 	{
-		hash_set<Texture*>::iterator j = i++;
+		delete i->second;
+	}
 
-		Texture* t = *j;
+	m_textures.clear();
 
-		if(++t->m_age > 10)
-		{
-			m_textures.erase(j);
+	memset(m_map, 0, sizeof(m_map));
 
-			for(const uint32* p = t->m_pages.n; *p != GSOffset::EOP; p++)
-			{
-				list<Texture*>& m = m_map[*p];
+	m_head = NULL;
+	m_tail = NULL;
+}
 
-				for(list<Texture*>::iterator i = m.begin(); i != m.end(); )
-				{
-					list<Texture*>::iterator j = i++;
+void GSTextureCacheSW::IncAge()
+{
+	m_age++;
 
-					if(*j == t) {m.erase(j); break;}
-				}
-			}
+	// the age list is sorted by last use, only the expired textures at the tail are visited
 
-			delete t;
-		}
+	while(m_tail != NULL && m_age - m_tail->m_age > 10)
+	{
+		Remove(m_tail);
+
+		m_state->m_perfmon.Put(GSPerfMon::TextureEvict, 1);
 	}
 }
 
@@ -167,6 +226,9 @@ GSTextureCacheSW::Texture::Texture(GSState* state, uint32 tw0, const GIFRegTEX0&
 	, m_buff(NULL)
 	, m_tw(tw0)
 	, m_age(0)
+	, m_key(0)
+	, m_prev(NULL)
+	, m_next(NULL)
 	, m_complete(false)
 	, m_p2t(NULL)
 {
@@ -212,7 +274,10 @@ GSTextureCacheSW::Texture::~Texture()
 	}
 }
 
-bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
+// The missing blocks of rect are marked valid and read into m_buff. With pending, only their addresses and
+// offsets in m_buff are collected, ReadBlocks does the reading later on the rasterizer threads.
+
+bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect, vector<uint32>* pending)
 {
 	if(m_complete)
 	{
@@ -289,7 +354,15 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 					{
 						m_valid[row] |= col;
 
-						(mem.*rtxbP)(block, &dst[x << shift], pitch, m_TEXA);
+						if(pending != NULL)
+						{
+							pending->push_back(block);
+							pending->push_back((uint32)(&dst[x << shift] - (uint8*)m_buff));
+						}
+						else
+						{
+							(mem.*rtxbP)(block, &dst[x << shift], pitch, m_TEXA);
+						}
 
 						blocks++;
 					}
@@ -316,7 +389,15 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 					{
 						m_valid[row] |= col;
 
-						(mem.*rtxbP)(block, &dst[x << shift], pitch, m_TEXA);
+						if(pending != NULL)
+						{
+							pending->push_back(block);
+							pending->push_back((uint32)(&dst[x << shift] - (uint8*)m_buff));
+						}
+						else
+						{
+							(mem.*rtxbP)(block, &dst[x << shift], pitch, m_TEXA);
+						}
 
 						blocks++;
 					}
@@ -333,6 +414,31 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 	return true;
 }
 
+// Every thread reads the blocks of its own pages, pending is the list of block and offset pairs made by Update.
+
+void GSTextureCacheSW::Texture::ReadBlocks(const uint32* pending, size_t count, int id, int threads)
+{
+	const GSLocalMemory::psm_t& psm = GSLocalMemory::m_psm[m_TEX0.PSM];
+
+	GSLocalMemory& mem = m_state->m_mem;
+
+	GSLocalMemory::readTextureBlock rtxbP = psm.rtxbP;
+
+	uint32 pitch = (1 << m_tw) << (psm.pal == 0 ? 2 : 0);
+
+	uint8* buff = (uint8*)m_buff;
+
+	for(size_t i = 0; i < count; i += 2)
+	{
+		uint32 block = pending[i];
+
+		if((int)((block >> 5) % threads) == id)
+		{
+			(mem.*rtxbP)(block, &buff[pending[i + 1]], pitch, m_TEXA);
+		}
+	}
+}
+
 #include "GSTextureSW.h"
 
 bool GSTextureCacheSW::Texture::Save(const string& fn, bool dds) const
@@ -29,13 +29,24 @@ public:
 	class Texture
 	{
 	public:
+		struct PageLink
+		{
+			Texture* t;
+			PageLink* prev;
+			PageLink* next;
+		};
+
 		GSState* m_state;
 		GSOffset* m_offset;
 		GIFRegTEX0 m_TEX0;
 		GIFRegTEXA m_TEXA;
 		void* m_buff;
 		uint32 m_tw;
-		uint32 m_age;
+		uint32 m_age; // generation of the last lookup
+		uint64 m_key;
+		Texture* m_prev; // age list, most recently used first
+		Texture* m_next;
+		vector<PageLink> m_links; // one per page of m_pages.n
 		bool m_complete;
 		bool m_repeating;
 		vector<GSVector2i>* m_p2t;
@@ -50,14 +61,22 @@ public:
 		Texture(GSState* state, uint32 tw0, const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA);
 		virtual ~Texture();
 
-		bool Update(const GSVector4i& r);
+		bool Update(const GSVector4i& r, vector<uint32>* pending = NULL);
+		void ReadBlocks(const uint32* pending, size_t count, int id, int threads);
 		bool Save(const string& fn, bool dds = false) const;
 	};
 
 protected:
 	GSState* m_state;
-	hash_set<Texture*> m_textures;
-	list<Texture*> m_map[MAX_PAGES];
+	hash_map<uint64, Texture*> m_textures;
+	Texture::PageLink* m_map[MAX_PAGES];
+	Texture* m_head;
+	Texture* m_tail;
+	uint32 m_age;
+
+	static uint64 GetKey(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, uint32 tw0);
+
+	void Remove(Texture* t);
 
 public:
 	GSTextureCacheSW(GSState* state);
@@ -25,10 +25,12 @@
 #include "GSState.h"
 
 GSVector4 GSVertexTrace::s_minmax;
+GSVector4 GSVertexTrace::s_pos_scale;
 
 void GSVertexTrace::InitVectors()
 {
 	s_minmax = GSVector4(FLT_MAX, -FLT_MAX);
+	s_pos_scale = GSVector4(1.0f / 16, 1.0f / 16, 1.0f, 128.0f);
 }
 
 GSVertexTrace::GSVertexTrace(const GSState* state)
@@ -38,7 +40,8 @@ GSVertexTrace::GSVertexTrace(const GSState* state)
 	memset(&m_alpha, 0, sizeof(m_alpha));
 
 	#define InitUpdate3(P, IIP, TME, FST, COLOR) \
-		m_fmm[COLOR][FST][TME][IIP][P] = &GSVertexTrace::FindMinMax<P, IIP, TME, FST, COLOR>;
+		m_fmm[COLOR][FST][TME][IIP][P] = &GSVertexTrace::FindMinMax<P, IIP, TME, FST, COLOR>; \
+		m_cmm[COLOR][FST][TME][IIP][P] = &GSVertexTrace::ConvertMinMax<P, IIP, TME, FST, COLOR>;
 
 	#define InitUpdate2(P, IIP, TME) \
 		InitUpdate3(P, IIP, TME, 0, 0) \
@@ -58,6 +61,26 @@ GSVertexTrace::GSVertexTrace(const GSState* state)
 	InitUpdate(GS_SPRITE_CLASS);
 }
 
+GSVertexTrace::~GSVertexTrace()
+{
+	SetThreads(0);
+}
+
+void GSVertexTrace::SetThreads(int threads)
+{
+	for(size_t i = 0; i < m_workers.size(); i++)
+	{
+		delete m_workers[i];
+	}
+
+	m_workers.clear();
+
+	for(int i = 0; i < std::min<int>(threads, 16); i++)
+	{
+		m_workers.push_back(new GSWorker());
+	}
+}
+
 void GSVertexTrace::Update(const void* vertex, const uint32* index, int count, GS_PRIM_CLASS primclass)
 {
 	m_primclass = primclass;
@@ -69,6 +92,94 @@ void GSVertexTrace::Update(const void* vertex, const uint32* index, int count, G
 
 	(this->*m_fmm[color][fst][tme][iip][primclass])(vertex, index, count);
 
+	UpdateFilter();
+}
+
+static __forceinline void InitRange(GSVertexTrace::Range& r, const GSVector4& minmax)
+{
+	r.tmin = minmax.xxxx();
+	r.tmax = minmax.yyyy();
+	r.cmin = GSVector4i::xffffffff();
+	r.cmax = GSVector4i::zero();
+
+	#if _M_SSE >= 0x401
+
+	r.pmin = GSVector4i::xffffffff();
+	r.pmax = GSVector4i::zero();
+
+	#else
+
+	r.pmin = minmax.xxxx();
+	r.pmax = minmax.yyyy();
+
+	#endif
+}
+
+static __forceinline void MergeRange(GSVertexTrace::Range& dst, const GSVertexTrace::Range& src)
+{
+	dst.tmin = dst.tmin.min(src.tmin);
+	dst.tmax = dst.tmax.max(src.tmax);
+	dst.cmin = dst.cmin.min_u8(src.cmin);
+	dst.cmax = dst.cmax.max_u8(src.cmax);
+
+	#if _M_SSE >= 0x401
+
+	dst.pmin = dst.pmin.min_u32(src.pmin);
+	dst.pmax = dst.pmax.max_u32(src.pmax);
+
+	#else
+
+	dst.pmin = dst.pmin.min(src.pmin);
+	dst.pmax = dst.pmax.max(src.pmax);
+
+	#endif
+}
+
+void GSVertexTrace::Update(GSVertexSW* RESTRICT dst, const GSVertex* RESTRICT vertex, int count, GS_PRIM_CLASS primclass)
+{
+	m_primclass = primclass;
+
+	uint32 iip = m_state->PRIM->IIP;
+	uint32 tme = m_state->PRIM->TME;
+	uint32 fst = m_state->PRIM->FST;
+	uint32 color = !(m_state->PRIM->TME && m_state->m_context->TEX0.TFX == TFX_DECAL && m_state->m_context->TEX0.TCC);
+
+	ConvertMinMaxPtr cmm = m_cmm[color][fst][tme][iip][primclass];
+
+	Range r[17];
+
+	// split on whole pairs of triangles, every primitive class and the two vertex steps of the avx2 loop divide it
+
+	int workers = count >= 0x8000 ? (int)m_workers.size() : 0;
+	int chunk = count / (workers + 1) / 6 * 6;
+
+	for(int i = 0; i < workers; i++)
+	{
+		InitRange(r[i + 1], s_minmax);
+
+		Job job = {this, cmm, dst, vertex, chunk * i, chunk * (i + 1), &r[i + 1]};
+
+		m_workers[i]->Push(job);
+	}
+
+	InitRange(r[0], s_minmax);
+
+	(this->*cmm)(dst, vertex, chunk * workers, count, r[0]);
+
+	for(int i = 0; i < workers; i++)
+	{
+		m_workers[i]->Wait();
+
+		MergeRange(r[0], r[i + 1]);
+	}
+
+	SetMinMax(r[0], tme, fst, color);
+
+	UpdateFilter();
+}
+
+void GSVertexTrace::UpdateFilter()
+{
 	m_eq.value = (m_min.c == m_max.c).mask() | ((m_min.p == m_max.p).mask() << 16) | ((m_min.t == m_max.t).mask() << 20);
 
 	m_alpha.valid = false;
@@ -119,332 +230,511 @@ void GSVertexTrace::Update(const void* vertex, const uint32* index, int count, G
 }
 
 template<GS_PRIM_CLASS primclass, uint32 iip, uint32 tme, uint32 fst, uint32 color>
-void GSVertexTrace::FindMinMax(const void* vertex, const uint32* index, int count)
+static __forceinline void MinMaxPrim(GSVertexTrace::Range& r, const GSVertex* RESTRICT v0, const GSVertex* RESTRICT v1, const GSVertex* RESTRICT v2)
 {
-	const GSDrawingContext* context = m_state->m_context;
+	if(primclass == GS_POINT_CLASS)
+	{
+		GSVector4i c(v0->m[0]);
 
-	int n = 1;
+		if(color)
+		{
+			r.cmin = r.cmin.min_u8(c);
+			r.cmax = r.cmax.max_u8(c);
+		}
 
-	switch(primclass)
-	{
-	case GS_POINT_CLASS:
-		n = 1;
-		break;
-	case GS_LINE_CLASS:
-	case GS_SPRITE_CLASS:
-		n = 2;
-		break;
-	case GS_TRIANGLE_CLASS:
-		n = 3;
-		break;
-	}
+		if(tme)
+		{
+			if(!fst)
+			{
+				GSVector4 stq = GSVector4::cast(c);
 
-	GSVector4 tmin = s_minmax.xxxx();
-	GSVector4 tmax = s_minmax.yyyy();
-	GSVector4i cmin = GSVector4i::xffffffff();
-	GSVector4i cmax = GSVector4i::zero();
+				GSVector4 q = stq.wwww();
 
-	#if _M_SSE >= 0x401
+				stq = (stq.xyww() * q.rcpnr()).xyww(q);
 
-	GSVector4i pmin = GSVector4i::xffffffff();
-	GSVector4i pmax = GSVector4i::zero();
+				r.tmin = r.tmin.min(stq);
+				r.tmax = r.tmax.max(stq);
+			}
+			else
+			{
+				GSVector4i uv(v0->m[1]);
 
-	#else
+				GSVector4 st = GSVector4(uv.uph16()).xyxy();
 
-	GSVector4 pmin = s_minmax.xxxx();
-	GSVector4 pmax = s_minmax.yyyy();
-	
-	#endif
+				r.tmin = r.tmin.min(st);
+				r.tmax = r.tmax.max(st);
+			}
+		}
 
-	const GSVertex* RESTRICT v = (GSVertex*)vertex;
+		GSVector4i xyzf(v0->m[1]);
 
-	for(int i = 0; i < count; i += n)
+		GSVector4i xy = xyzf.upl16();
+		GSVector4i z = xyzf.yyyy();
+
+		#if _M_SSE >= 0x401
+
+		GSVector4i p = xy.blend16<0xf0>(z.uph32(xyzf));
+
+		r.pmin = r.pmin.min_u32(p);
+		r.pmax = r.pmax.max_u32(p);
+
+		#else
+
+		GSVector4 p = GSVector4(xy.upl64(z.srl32(1).upl32(xyzf.wwww())));
+
+		r.pmin = r.pmin.min(p);
+		r.pmax = r.pmax.max(p);
+
+		#endif
+	}
+	else if(primclass == GS_LINE_CLASS)
 	{
-		if(primclass == GS_POINT_CLASS)
-		{
-			GSVector4i c(v[index[i]].m[0]);
+		GSVector4i c0(v0->m[0]);
+		GSVector4i c1(v1->m[0]);
 
-			if(color)
+		if(color)
+		{
+			if(iip)
+			{
+				r.cmin = r.cmin.min_u8(c0.min_u8(c1));
+				r.cmax = r.cmax.max_u8(c0.max_u8(c1));
+			}
+			else
 			{
-				cmin = cmin.min_u8(c);
-				cmax = cmax.max_u8(c);
+				r.cmin = r.cmin.min_u8(c1);
+				r.cmax = r.cmax.max_u8(c1);
 			}
+		}
 
-			if(tme)
+		if(tme)
+		{
+			if(!fst)
 			{
-				if(!fst)
-				{
-					GSVector4 stq = GSVector4::cast(c);
+				GSVector4 stq0 = GSVector4::cast(c0);
+				GSVector4 stq1 = GSVector4::cast(c1);
 
-					GSVector4 q = stq.wwww();
+				GSVector4 q = stq0.wwww(stq1).rcpnr();
 
-					stq = (stq.xyww() * q.rcpnr()).xyww(q);
+				stq0 = (stq0.xyww() * q.xxxx()).xyww(stq0);
+				stq1 = (stq1.xyww() * q.zzzz()).xyww(stq1);
 
-					tmin = tmin.min(stq);
-					tmax = tmax.max(stq);
-				}
-				else
-				{
-					GSVector4i uv(v[index[i]].m[1]);
+				r.tmin = r.tmin.min(stq0.min(stq1));
+				r.tmax = r.tmax.max(stq0.max(stq1));
+			}
+			else
+			{
+				GSVector4i uv0(v0->m[1]);
+				GSVector4i uv1(v1->m[1]);
 
-					GSVector4 st = GSVector4(uv.uph16()).xyxy();
+				GSVector4 st0 = GSVector4(uv0.uph16()).xyxy();
+				GSVector4 st1 = GSVector4(uv1.uph16()).xyxy();
 
-					tmin = tmin.min(st);
-					tmax = tmax.max(st);
-				}
+				r.tmin = r.tmin.min(st0.min(st1));
+				r.tmax = r.tmax.max(st0.max(st1));
 			}
+		}
 
-			GSVector4i xyzf(v[index[i]].m[1]);
+		GSVector4i xyzf0(v0->m[1]);
+		GSVector4i xyzf1(v1->m[1]);
 
-			GSVector4i xy = xyzf.upl16();
-			GSVector4i z = xyzf.yyyy();
+		GSVector4i xy0 = xyzf0.upl16();
+		GSVector4i z0 = xyzf0.yyyy();
+		GSVector4i xy1 = xyzf1.upl16();
+		GSVector4i z1 = xyzf1.yyyy();
 
-			#if _M_SSE >= 0x401
+		#if _M_SSE >= 0x401
 
-			GSVector4i p = xy.blend16<0xf0>(z.uph32(xyzf));
+		GSVector4i p0 = xy0.blend16<0xf0>(z0.uph32(xyzf0));
+		GSVector4i p1 = xy1.blend16<0xf0>(z1.uph32(xyzf1));
 
-			pmin = pmin.min_u32(p);
-			pmax = pmax.max_u32(p);
+		r.pmin = r.pmin.min_u32(p0.min_u32(p1));
+		r.pmax = r.pmax.max_u32(p0.max_u32(p1));
 
-			#else
+		#else
 
-			GSVector4 p = GSVector4(xy.upl64(z.srl32(1).upl32(xyzf.wwww())));
+		GSVector4 p0 = GSVector4(xy0.upl64(z0.srl32(1).upl32(xyzf0.wwww())));
+		GSVector4 p1 = GSVector4(xy1.upl64(z1.srl32(1).upl32(xyzf1.wwww())));
 
-			pmin = pmin.min(p);
-			pmax = pmax.max(p);
+		r.pmin = r.pmin.min(p0.min(p1));
+		r.pmax = r.pmax.max(p0.max(p1));
 
-			#endif
-		}
-		else if(primclass == GS_LINE_CLASS)
-		{
-			GSVector4i c0(v[index[i + 0]].m[0]);
-			GSVector4i c1(v[index[i + 1]].m[0]);
+		#endif
+	}
+	else if(primclass == GS_TRIANGLE_CLASS)
+	{
+		GSVector4i c0(v0->m[0]);
+		GSVector4i c1(v1->m[0]);
+		GSVector4i c2(v2->m[0]);
 
-			if(color)
+		if(color)
+		{
+			if(iip)
+			{
+				r.cmin = r.cmin.min_u8(c2).min_u8(c0.min_u8(c1));
+				r.cmax = r.cmax.max_u8(c2).max_u8(c0.max_u8(c1));
+			}
+			else
 			{
-				if(iip)
-				{
-					cmin = cmin.min_u8(c0.min_u8(c1));
-					cmax = cmax.max_u8(c0.max_u8(c1));
-				}
-				else
-				{
-					cmin = cmin.min_u8(c1);
-					cmax = cmax.max_u8(c1);
-				}
+				r.cmin = r.cmin.min_u8(c2);
+				r.cmax = r.cmax.max_u8(c2);
 			}
+		}
+
+		if(tme)
+		{
+			if(!fst)
+			{
+				GSVector4 stq0 = GSVector4::cast(c0);
+				GSVector4 stq1 = GSVector4::cast(c1);
+				GSVector4 stq2 = GSVector4::cast(c2);
 
-			if(tme)
+				GSVector4 q = stq0.wwww(stq1).xzww(stq2).rcpnr();
+
+				stq0 = (stq0.xyww() * q.xxxx()).xyww(stq0);
+				stq1 = (stq1.xyww() * q.yyyy()).xyww(stq1);
+				stq2 = (stq2.xyww() * q.zzzz()).xyww(stq2);
+
+				r.tmin = r.tmin.min(stq2).min(stq0.min(stq1));
+				r.tmax = r.tmax.max(stq2).max(stq0.max(stq1));
+			}
+			else
 			{
-				if(!fst)
-				{
-					GSVector4 stq0 = GSVector4::cast(c0);
-					GSVector4 stq1 = GSVector4::cast(c1);
-
-					GSVector4 q = stq0.wwww(stq1).rcpnr();
-
-					stq0 = (stq0.xyww() * q.xxxx()).xyww(stq0);
-					stq1 = (stq1.xyww() * q.zzzz()).xyww(stq1);
-
-					tmin = tmin.min(stq0.min(stq1));
-					tmax = tmax.max(stq0.max(stq1));
-				}
-				else
-				{
-					GSVector4i uv0(v[index[i + 0]].m[1]);
-					GSVector4i uv1(v[index[i + 1]].m[1]);
-
-					GSVector4 st0 = GSVector4(uv0.uph16()).xyxy();
-					GSVector4 st1 = GSVector4(uv1.uph16()).xyxy();
-
-					tmin = tmin.min(st0.min(st1));
-					tmax = tmax.max(st0.max(st1));
-				}
+				GSVector4i uv0(v0->m[1]);
+				GSVector4i uv1(v1->m[1]);
+				GSVector4i uv2(v2->m[1]);
+
+				GSVector4 st0 = GSVector4(uv0.uph16()).xyxy();
+				GSVector4 st1 = GSVector4(uv1.uph16()).xyxy();
+				GSVector4 st2 = GSVector4(uv2.uph16()).xyxy();
+
+				r.tmin = r.tmin.min(st2).min(st0.min(st1));
+				r.tmax = r.tmax.max(st2).max(st0.max(st1));
 			}
+		}
 
-			GSVector4i xyzf0(v[index[i + 0]].m[1]);
-			GSVector4i xyzf1(v[index[i + 1]].m[1]);
+		GSVector4i xyzf0(v0->m[1]);
+		GSVector4i xyzf1(v1->m[1]);
+		GSVector4i xyzf2(v2->m[1]);
 
-			GSVector4i xy0 = xyzf0.upl16();
-			GSVector4i z0 = xyzf0.yyyy();
-			GSVector4i xy1 = xyzf1.upl16();
-			GSVector4i z1 = xyzf1.yyyy();
+		GSVector4i xy0 = xyzf0.upl16();
+		GSVector4i z0 = xyzf0.yyyy();
+		GSVector4i xy1 = xyzf1.upl16();
+		GSVector4i z1 = xyzf1.yyyy();
+		GSVector4i xy2 = xyzf2.upl16();
+		GSVector4i z2 = xyzf2.yyyy();
 
-			#if _M_SSE >= 0x401
+		#if _M_SSE >= 0x401
 
-			GSVector4i p0 = xy0.blend16<0xf0>(z0.uph32(xyzf0));
-			GSVector4i p1 = xy1.blend16<0xf0>(z1.uph32(xyzf1));
+		GSVector4i p0 = xy0.blend16<0xf0>(z0.uph32(xyzf0));
+		GSVector4i p1 = xy1.blend16<0xf0>(z1.uph32(xyzf1));
+		GSVector4i p2 = xy2.blend16<0xf0>(z2.uph32(xyzf2));
 
-			pmin = pmin.min_u32(p0.min_u32(p1));
-			pmax = pmax.max_u32(p0.max_u32(p1));
+		r.pmin = r.pmin.min_u32(p2).min_u32(p0.min_u32(p1));
+		r.pmax = r.pmax.max_u32(p2).max_u32(p0.max_u32(p1));
 
-			#else
+		#else
 
-			GSVector4 p0 = GSVector4(xy0.upl64(z0.srl32(1).upl32(xyzf0.wwww())));
-			GSVector4 p1 = GSVector4(xy1.upl64(z1.srl32(1).upl32(xyzf1.wwww())));
+		GSVector4 p0 = GSVector4(xy0.upl64(z0.srl32(1).upl32(xyzf0.wwww())));
+		GSVector4 p1 = GSVector4(xy1.upl64(z1.srl32(1).upl32(xyzf1.wwww())));
+		GSVector4 p2 = GSVector4(xy2.upl64(z2.srl32(1).upl32(xyzf2.wwww())));
 
-			pmin = pmin.min(p0.min(p1));
-			pmax = pmax.max(p0.max(p1));
+		r.pmin = r.pmin.min(p2).min(p0.min(p1));
+		r.pmax = r.pmax.max(p2).max(p0.max(p1));
 
-			#endif
-		}
-		else if(primclass == GS_TRIANGLE_CLASS)
-		{
-			GSVector4i c0(v[index[i + 0]].m[0]);
-			GSVector4i c1(v[index[i + 1]].m[0]);
-			GSVector4i c2(v[index[i + 2]].m[0]);
+		#endif
+	}
+	else if(primclass == GS_SPRITE_CLASS)
+	{
+		GSVector4i c0(v0->m[0]);
+		GSVector4i c1(v1->m[0]);
 
-			if(color)
+		if(color)
+		{
+			if(iip)
+			{
+				r.cmin = r.cmin.min_u8(c0.min_u8(c1));
+				r.cmax = r.cmax.max_u8(c0.max_u8(c1));
+			}
+			else
 			{
-				if(iip)
-				{
-					cmin = cmin.min_u8(c2).min_u8(c0.min_u8(c1));
-					cmax = cmax.max_u8(c2).max_u8(c0.max_u8(c1));
-				}
-				else
-				{
-					cmin = cmin.min_u8(c2);
-					cmax = cmax.max_u8(c2);
-				}
+				r.cmin = r.cmin.min_u8(c1);
+				r.cmax = r.cmax.max_u8(c1);
 			}
+		}
 
-			if(tme)
+		if(tme)
+		{
+			if(!fst)
 			{
-				if(!fst)
-				{
-					GSVector4 stq0 = GSVector4::cast(c0);
-					GSVector4 stq1 = GSVector4::cast(c1);
-					GSVector4 stq2 = GSVector4::cast(c2);
-
-					GSVector4 q = stq0.wwww(stq1).xzww(stq2).rcpnr();
-
-					stq0 = (stq0.xyww() * q.xxxx()).xyww(stq0);
-					stq1 = (stq1.xyww() * q.yyyy()).xyww(stq1);
-					stq2 = (stq2.xyww() * q.zzzz()).xyww(stq2);
-
-					tmin = tmin.min(stq2).min(stq0.min(stq1));
-					tmax = tmax.max(stq2).max(stq0.max(stq1));
-				}
-				else
-				{
-					GSVector4i uv0(v[index[i + 0]].m[1]);
-					GSVector4i uv1(v[index[i + 1]].m[1]);
-					GSVector4i uv2(v[index[i + 2]].m[1]);
-
-					GSVector4 st0 = GSVector4(uv0.uph16()).xyxy();
-					GSVector4 st1 = GSVector4(uv1.uph16()).xyxy();
-					GSVector4 st2 = GSVector4(uv2.uph16()).xyxy();
-
-					tmin = tmin.min(st2).min(st0.min(st1));
-					tmax = tmax.max(st2).max(st0.max(st1));
-				}
+				GSVector4 stq0 = GSVector4::cast(c0);
+				GSVector4 stq1 = GSVector4::cast(c1);
+
+				GSVector4 q = stq1.wwww().rcpnr();
+
+				stq0 = (stq0.xyww() * q).xyww(stq1);
+				stq1 = (stq1.xyww() * q).xyww(stq1);
+
+				r.tmin = r.tmin.min(stq0.min(stq1));
+				r.tmax = r.tmax.max(stq0.max(stq1));
+			}
+			else
+			{
+				GSVector4i uv0(v0->m[1]);
+				GSVector4i uv1(v1->m[1]);
+
+				GSVector4 st0 = GSVector4(uv0.uph16()).xyxy();
+				GSVector4 st1 = GSVector4(uv1.uph16()).xyxy();
+
+				r.tmin = r.tmin.min(st0.min(st1));
+				r.tmax = r.tmax.max(st0.max(st1));
 			}
+		}
 
-			GSVector4i xyzf0(v[index[i + 0]].m[1]);
-			GSVector4i xyzf1(v[index[i + 1]].m[1]);
-			GSVector4i xyzf2(v[index[i + 2]].m[1]);
+		GSVector4i xyzf0(v0->m[1]);
+		GSVector4i xyzf1(v1->m[1]);
 
-			GSVector4i xy0 = xyzf0.upl16();
-			GSVector4i z0 = xyzf0.yyyy();
-			GSVector4i xy1 = xyzf1.upl16();
-			GSVector4i z1 = xyzf1.yyyy();
-			GSVector4i xy2 = xyzf2.upl16();
-			GSVector4i z2 = xyzf2.yyyy();
+		GSVector4i xy0 = xyzf0.upl16();
+		GSVector4i z0 = xyzf0.yyyy();
+		GSVector4i xy1 = xyzf1.upl16();
+		GSVector4i z1 = xyzf1.yyyy();
 
-			#if _M_SSE >= 0x401
+		#if _M_SSE >= 0x401
 
-			GSVector4i p0 = xy0.blend16<0xf0>(z0.uph32(xyzf0));
-			GSVector4i p1 = xy1.blend16<0xf0>(z1.uph32(xyzf1));
-			GSVector4i p2 = xy2.blend16<0xf0>(z2.uph32(xyzf2));
+		GSVector4i p0 = xy0.blend16<0xf0>(z0.uph32(xyzf1));
+		GSVector4i p1 = xy1.blend16<0xf0>(z1.uph32(xyzf1));
 
-			pmin = pmin.min_u32(p2).min_u32(p0.min_u32(p1));
-			pmax = pmax.max_u32(p2).max_u32(p0.max_u32(p1));
+		r.pmin = r.pmin.min_u32(p0.min_u32(p1));
+		r.pmax = r.pmax.max_u32(p0.max_u32(p1));
 
-			#else
+		#else
 
-			GSVector4 p0 = GSVector4(xy0.upl64(z0.srl32(1).upl32(xyzf0.wwww())));
-			GSVector4 p1 = GSVector4(xy1.upl64(z1.srl32(1).upl32(xyzf1.wwww())));
-			GSVector4 p2 = GSVector4(xy2.upl64(z2.srl32(1).upl32(xyzf2.wwww())));
+		GSVector4 p0 = GSVector4(xy0.upl64(z0.srl32(1).upl32(xyzf1.wwww())));
+		GSVector4 p1 = GSVector4(xy1.upl64(z1.srl32(1).upl32(xyzf1.wwww())));
 
-			pmin = pmin.min(p2).min(p0.min(p1));
-			pmax = pmax.max(p2).max(p0.max(p1));
+		r.pmin = r.pmin.min(p0.min(p1));
+		r.pmax = r.pmax.max(p0.max(p1));
 
-			#endif
+		#endif
+	}
+}
+
+template<GS_PRIM_CLASS primclass, uint32 iip, uint32 tme, uint32 fst, uint32 color>
+void GSVertexTrace::FindMinMax(const void* vertex, const uint32* index, int count)
+{
+	int n = 1;
+
+	switch(primclass)
+	{
+	case GS_POINT_CLASS:
+		n = 1;
+		break;
+	case GS_LINE_CLASS:
+	case GS_SPRITE_CLASS:
+		n = 2;
+		break;
+	case GS_TRIANGLE_CLASS:
+		n = 3;
+		break;
+	}
+
+	Range r;
+
+	InitRange(r, s_minmax);
+
+	const GSVertex* RESTRICT v = (GSVertex*)vertex;
+
+	for(int i = 0; i < count; i += n)
+	{
+		const GSVertex* RESTRICT v0 = &v[index[i + 0]];
+		const GSVertex* RESTRICT v1 = n >= 2 ? &v[index[i + 1]] : v0;
+		const GSVertex* RESTRICT v2 = n >= 3 ? &v[index[i + 2]] : v0;
+
+		MinMaxPrim<primclass, iip, tme, fst, color>(r, v0, v1, v2);
+	}
+
+	SetMinMax(r, tme, fst, color);
+}
+
+#if _M_SSE >= 0x501
+
+struct alignas(32) Range8
+{
+	GSVector8 tmin, tmax;
+	GSVector8i cmin, cmax, pmin, pmax;
+};
+
+// Converts and traces two consecutive vertices, one in each 128-bit lane. The lanes mirror the per
+// vertex code of ConvertVertex and MinMaxPrim. For flat shading only the color of the last vertex
+// of a primitive counts, clanes selects the lanes which hold one (bit 0: first vertex, bit 1: second).
+
+template<GS_PRIM_CLASS primclass, uint32 tme, uint32 fst, uint32 color, int clanes>
+static __forceinline void ConvertMinMax2(GSVertexSW* RESTRICT dst, const GSVertex* RESTRICT src, const GSVector8i& off, const GSVector8& tsize, const GSVector8& scale, Range8& r)
+{
+	GSVector8i v0 = GSVector8i::load<true>(src[0].m);
+	GSVector8i v1 = GSVector8i::load<true>(src[1].m);
+
+	GSVector8i stcq = v0.ac(v1);
+	GSVector8i xyzuvf = v0.bd(v1);
+
+	// convert
+
+	GSVector8i xy = xyzuvf.upl16() - off;
+	GSVector8i zf = xyzuvf.ywww().min_u32(GSVector8i::xffffff00());
+
+	GSVector8 p = GSVector8(xy).xyxy(GSVector8(zf) + (GSVector8::m_x4f800000 & GSVector8::cast(zf.sra32(31)))) * scale;
+	GSVector8 c = GSVector8(stcq.uph8().upl16() << 7);
+
+	GSVector8 t = GSVector8::zero();
+
+	if(tme)
+	{
+		if(fst)
+		{
+			t = GSVector8(xyzuvf.uph16() << (16 - 4));
 		}
-		else if(primclass == GS_SPRITE_CLASS)
+		else
 		{
-			GSVector4i c0(v[index[i + 0]].m[0]);
-			GSVector4i c1(v[index[i + 1]].m[0]);
+			t = GSVector8::cast(stcq).xyww() * tsize;
+		}
+	}
 
-			if(color)
-			{
-				if(iip)
-				{
-					cmin = cmin.min_u8(c0.min_u8(c1));
-					cmax = cmax.max_u8(c0.max_u8(c1));
-				}
-				else
-				{
-					cmin = cmin.min_u8(c1);
-					cmax = cmax.max_u8(c1);
-				}
-			}
+	if(primclass == GS_SPRITE_CLASS)
+	{
+		t = t.insert32<1, 3>(GSVector8::cast(xyzuvf));
+	}
 
-			if(tme)
-			{
-				if(!fst)
-				{
-					GSVector4 stq0 = GSVector4::cast(c0);
-					GSVector4 stq1 = GSVector4::cast(c1);
-
-					GSVector4 q = stq1.wwww().rcpnr();
-
-					stq0 = (stq0.xyww() * q).xyww(stq1);
-					stq1 = (stq1.xyww() * q).xyww(stq1);
-
-					tmin = tmin.min(stq0.min(stq1));
-					tmax = tmax.max(stq0.max(stq1));
-				}
-				else
-				{
-					GSVector4i uv0(v[index[i + 0]].m[1]);
-					GSVector4i uv1(v[index[i + 1]].m[1]);
-
-					GSVector4 st0 = GSVector4(uv0.uph16()).xyxy();
-					GSVector4 st1 = GSVector4(uv1.uph16()).xyxy();
-
-					tmin = tmin.min(st0.min(st1));
-					tmax = tmax.max(st0.max(st1));
-				}
-			}
+	GSVector8::storel(&dst[0].p, p);
+	GSVector8::storeh(&dst[1].p, p);
+	GSVector8::store<true>(&dst[0].t, t.ac(c));
+	GSVector8::store<true>(&dst[1].t, t.bd(c));
+
+	// trace
+
+	if(color && clanes != 0)
+	{
+		GSVector8i rgba = clanes == 1 ? stcq.aa() : clanes == 2 ? stcq.bb() : stcq;
+
+		r.cmin = r.cmin.min_u8(rgba);
+		r.cmax = r.cmax.max_u8(rgba);
+	}
+
+	if(tme)
+	{
+		if(!fst)
+		{
+			GSVector8 stq = GSVector8::cast(stcq);
+
+			// sprites take q from the second vertex
+
+			GSVector8 q = primclass == GS_SPRITE_CLASS ? stq.bb() : stq;
+
+			stq = (stq.xyww() * q.wwww().rcpnr()).xyww(q);
+
+			r.tmin = r.tmin.min(stq);
+			r.tmax = r.tmax.max(stq);
+		}
+		else
+		{
+			GSVector8 st = GSVector8(xyzuvf.uph16()).xyxy();
+
+			r.tmin = r.tmin.min(st);
+			r.tmax = r.tmax.max(st);
+		}
+	}
+
+	// sprites take fog from the second vertex
+
+	GSVector8i f = primclass == GS_SPRITE_CLASS ? xyzuvf.bb() : xyzuvf;
+
+	GSVector8i pos = xyzuvf.upl16().blend16<0xf0>(xyzuvf.yyyy().uph32(f));
+
+	r.pmin = r.pmin.min_u32(pos);
+	r.pmax = r.pmax.max_u32(pos);
+}
+
+#endif
 
-			GSVector4i xyzf0(v[index[i + 0]].m[1]);
-			GSVector4i xyzf1(v[index[i + 1]].m[1]);
+template<GS_PRIM_CLASS primclass, uint32 iip, uint32 tme, uint32 fst, uint32 color>
+void GSVertexTrace::ConvertMinMax(GSVertexSW* RESTRICT dst, const GSVertex* RESTRICT vertex, int start, int end, Range& r)
+{
+	const GSDrawingContext* context = m_state->m_context;
+
+	int n = primclass == GS_POINT_CLASS ? 1 : primclass == GS_TRIANGLE_CLASS ? 3 : 2;
+
+	int i = start;
+
+	#if _M_SSE >= 0x501
+
+	GSVector8i off8((GSVector4i)context->XYOFFSET);
+	GSVector8 tsize8(GSVector4(0x10000 << context->TEX0.TW, 0x10000 << context->TEX0.TH, 1, 0));
+	GSVector8 scale8(s_pos_scale);
+
+	Range8 r8;
 
-			GSVector4i xy0 = xyzf0.upl16();
-			GSVector4i z0 = xyzf0.yyyy();
-			GSVector4i xy1 = xyzf1.upl16();
-			GSVector4i z1 = xyzf1.yyyy();
+	r8.tmin = GSVector8(s_minmax.xxxx());
+	r8.tmax = GSVector8(s_minmax.yyyy());
+	r8.cmin = GSVector8i::xffffffff();
+	r8.cmax = GSVector8i::zero();
+	r8.pmin = GSVector8i::xffffffff();
+	r8.pmax = GSVector8i::zero();
 
-			#if _M_SSE >= 0x401
+	if(primclass == GS_TRIANGLE_CLASS)
+	{
+		// two triangles per step, the flat colors are the third and the sixth vertex
 
-			GSVector4i p0 = xy0.blend16<0xf0>(z0.uph32(xyzf1));
-			GSVector4i p1 = xy1.blend16<0xf0>(z1.uph32(xyzf1));
+		for(; i + 6 <= end; i += 6)
+		{
+			ConvertMinMax2<primclass, tme, fst, color, iip ? 3 : 0>(&dst[i + 0], &vertex[i + 0], off8, tsize8, scale8, r8);
+			ConvertMinMax2<primclass, tme, fst, color, iip ? 3 : 1>(&dst[i + 2], &vertex[i + 2], off8, tsize8, scale8, r8);
+			ConvertMinMax2<primclass, tme, fst, color, iip ? 3 : 2>(&dst[i + 4], &vertex[i + 4], off8, tsize8, scale8, r8);
+		}
+	}
+	else
+	{
+		for(; i + 2 <= end; i += 2)
+		{
+			ConvertMinMax2<primclass, tme, fst, color, primclass == GS_POINT_CLASS || iip ? 3 : 2>(&dst[i], &vertex[i], off8, tsize8, scale8, r8);
+		}
+	}
 
-			pmin = pmin.min_u32(p0.min_u32(p1));
-			pmax = pmax.max_u32(p0.max_u32(p1));
+	r.tmin = r.tmin.min(r8.tmin.extract<0>()).min(r8.tmin.extract<1>());
+	r.tmax = r.tmax.max(r8.tmax.extract<0>()).max(r8.tmax.extract<1>());
+	r.cmin = r.cmin.min_u8(r8.cmin.extract<0>()).min_u8(r8.cmin.extract<1>());
+	r.cmax = r.cmax.max_u8(r8.cmax.extract<0>()).max_u8(r8.cmax.extract<1>());
+	r.pmin = r.pmin.min_u32(r8.pmin.extract<0>()).min_u32(r8.pmin.extract<1>());
+	r.pmax = r.pmax.max_u32(r8.pmax.extract<0>()).max_u32(r8.pmax.extract<1>());
 
-			#else
+	#endif
 
-			GSVector4 p0 = GSVector4(xy0.upl64(z0.srl32(1).upl32(xyzf1.wwww())));
-			GSVector4 p1 = GSVector4(xy1.upl64(z1.srl32(1).upl32(xyzf1.wwww())));
+	GSVector4i off = (GSVector4i)context->XYOFFSET;
+	GSVector4 tsize = GSVector4(0x10000 << context->TEX0.TW, 0x10000 << context->TEX0.TH, 1, 0);
 
-			pmin = pmin.min(p0.min(p1));
-			pmax = pmax.max(p0.max(p1));
+	for(; i < end; i += n)
+	{
+		MinMaxPrim<primclass, iip, tme, fst, color>(r, &vertex[i], &vertex[i + (n >= 2 ? 1 : 0)], &vertex[i + (n >= 3 ? 2 : 0)]);
 
-			#endif
+		for(int j = 0; j < n; j++)
+		{
+			ConvertVertex<primclass, tme, fst>(&dst[i + j], &vertex[i + j], off, tsize, s_pos_scale);
 		}
 	}
+}
+
+void GSVertexTrace::SetMinMax(const Range& r, uint32 tme, uint32 fst, uint32 color)
+{
+	const GSDrawingContext* context = m_state->m_context;
+
+	#if _M_SSE >= 0x401
+
+	GSVector4i pmin = r.pmin;
+	GSVector4i pmax = r.pmax;
+
+	#else
+
+	GSVector4 pmin = r.pmin;
+	GSVector4 pmax = r.pmax;
+
+	#endif
 
 	// FIXME/WARNING. A division by 2 is done on the depth. I suspect to avoid
 	// negative value. However it means that we lost the lsb bit. m_eq.z could
@@ -475,8 +765,8 @@ void GSVertexTrace::FindMinMax(const void* vertex, const uint32* index, int coun
 			s = GSVector4(1 << context->TEX0.TW, 1 << context->TEX0.TH, 1, 1);
 		}
 
-		m_min.t = tmin * s;
-		m_max.t = tmax * s;
+		m_min.t = r.tmin * s;
+		m_max.t = r.tmax * s;
 	}
 	else
 	{
@@ -486,8 +776,8 @@ void GSVertexTrace::FindMinMax(const void* vertex, const uint32* index, int coun
 
 	if(color)
 	{
-		m_min.c = cmin.zzzz().u8to32();
-		m_max.c = cmax.zzzz().u8to32();
+		m_min.c = r.cmin.zzzz().u8to32();
+		m_max.c = r.cmax.zzzz().u8to32();
 	}
 	else
 	{
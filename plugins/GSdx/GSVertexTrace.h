@@ -26,6 +26,7 @@
 #include "GSVertexSW.h"
 #include "GSVertexHW.h"
 #include "GSFunctionMap.h"
+#include "GSThread_CXX11.h"
 
 class GSState;
 
@@ -35,18 +36,61 @@ public:
 	struct Vertex {GSVector4i c; GSVector4 p, t;};
 	struct VertexAlpha {int min, max; bool valid;};
 
+	// the ranges as they are gathered from the vertices, before scaling
+
+	struct alignas(16) Range
+	{
+		GSVector4 tmin, tmax;
+		GSVector4i cmin, cmax;
+		#if _M_SSE >= 0x401
+		GSVector4i pmin, pmax;
+		#else
+		GSVector4 pmin, pmax;
+		#endif
+	};
+
 protected:
 	const GSState* m_state;
 
 	static GSVector4 s_minmax;
+	static GSVector4 s_pos_scale;
 
 	typedef void (GSVertexTrace::*FindMinMaxPtr)(const void* vertex, const uint32* index, int count);
+	typedef void (GSVertexTrace::*ConvertMinMaxPtr)(GSVertexSW* RESTRICT dst, const GSVertex* RESTRICT vertex, int start, int end, Range& r);
 
 	FindMinMaxPtr m_fmm[2][2][2][2][4];
+	ConvertMinMaxPtr m_cmm[2][2][2][2][4];
 
 	template<GS_PRIM_CLASS primclass, uint32 iip, uint32 tme, uint32 fst, uint32 color>
 	void FindMinMax(const void* vertex, const uint32* index, int count);
 
+	template<GS_PRIM_CLASS primclass, uint32 iip, uint32 tme, uint32 fst, uint32 color>
+	void ConvertMinMax(GSVertexSW* RESTRICT dst, const GSVertex* RESTRICT vertex, int start, int end, Range& r);
+
+	void SetMinMax(const Range& r, uint32 tme, uint32 fst, uint32 color);
+	void UpdateFilter();
+
+	// large batches of ConvertMinMax are split between the calling thread and these
+
+	struct Job
+	{
+		GSVertexTrace* parent;
+		ConvertMinMaxPtr cmm;
+		GSVertexSW* dst;
+		const GSVertex* vertex;
+		int start, end;
+		Range* r;
+	};
+
+	class GSWorker : public GSJobQueue<Job, 16>
+	{
+	public:
+		void Process(Job& job) {(job.parent->*job.cmm)(job.dst, job.vertex, job.start, job.end, *job.r);}
+		int GetPixels(bool reset) {return 0;}
+	};
+
+	vector<GSWorker*> m_workers;
+
 public:
 	GS_PRIM_CLASS m_primclass;
 
@@ -72,9 +116,78 @@ public:
 	static void InitVectors();
 
 	GSVertexTrace(const GSState* state);
-	virtual ~GSVertexTrace() {}
+	virtual ~GSVertexTrace();
+
+	void SetThreads(int threads);
 
 	void Update(const void* vertex, const uint32* index, int count, GS_PRIM_CLASS primclass);
 
+	// Same as the above for the software renderer, converting the vertices into dst in the same pass. Only
+	// for the list primitives, their index buffer is always 0, 1, 2, ... count - 1, and it is not read.
+
+	void Update(GSVertexSW* RESTRICT dst, const GSVertex* RESTRICT vertex, int count, GS_PRIM_CLASS primclass);
+
+	template<GS_PRIM_CLASS primclass, uint32 tme, uint32 fst>
+	__forceinline static void ConvertVertex(GSVertexSW* RESTRICT dst, const GSVertex* RESTRICT src, const GSVector4i& off, const GSVector4& tsize, const GSVector4& scale)
+	{
+		GSVector4 stcq = GSVector4::load<true>(&src->m[0]); // s t rgba q
+
+		#if _M_SSE >= 0x401
+
+		GSVector4i xyzuvf(src->m[1]);
+
+		GSVector4i xy = xyzuvf.upl16() - off;
+		GSVector4i zf = xyzuvf.ywww().min_u32(GSVector4i::xffffff00());
+
+		#else
+
+		uint32 z = src->XYZ.Z;
+
+		GSVector4i xy = GSVector4i::load((int)src->XYZ.u32[0]).upl16() - off;
+		GSVector4i zf = GSVector4i((int)std::min<uint32>(z, 0xffffff00), src->FOG); // NOTE: larger values of z may roll over to 0 when converting back to uint32 later
+
+		#endif
+
+		dst->p = GSVector4(xy).xyxy(GSVector4(zf) + (GSVector4::m_x4f800000 & GSVector4::cast(zf.sra32(31)))) * scale;
+		dst->c = GSVector4(GSVector4i::cast(stcq).zzzz().u8to32() << 7);
+
+		GSVector4 t = GSVector4::zero();
+
+		if(tme)
+		{
+			if(fst)
+			{
+				#if _M_SSE >= 0x401
+
+				t = GSVector4(xyzuvf.uph16() << (16 - 4));
+
+				#else
+
+				t = GSVector4(GSVector4i::load(src->UV).upl16() << (16 - 4));
+
+				#endif
+			}
+			else
+			{
+				t = stcq.xyww() * tsize;
+			}
+		}
+
+		if(primclass == GS_SPRITE_CLASS)
+		{
+			#if _M_SSE >= 0x401
+
+			t = t.insert32<1, 3>(GSVector4::cast(xyzuvf));
+
+			#else
+
+			t = t.insert32<0, 3>(GSVector4::cast(GSVector4i::load(z)));
+
+			#endif
+		}
+
+		dst->t = t;
+	}
+
 	bool IsLinear() const {return m_filter.linear;}
 };
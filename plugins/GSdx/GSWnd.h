@@ -56,6 +56,30 @@ public:
 
 };
 
+// stand-in for headless replays, nothing is ever shown
+
+class GSWndNull : public GSWnd
+{
+	int m_width, m_height;
+
+public:
+	GSWndNull(int w = 640, int h = 480) : m_width(w), m_height(h) {}
+	virtual ~GSWndNull() {}
+
+	bool Create(const string& title, int w, int h) {m_width = w; m_height = h; return true;}
+	bool Attach(void* handle, bool managed = true) {return true;}
+	void Detach() {}
+
+	void* GetDisplay() {return NULL;}
+	void* GetHandle() {return NULL;}
+	GSVector4i GetClientRect() {return GSVector4i(0, 0, m_width, m_height);}
+	bool SetWindowText(const char* title) {return true;}
+
+	void Show() {}
+	void Hide() {}
+	void HideFrame() {}
+};
+
 class GSWndGL : public GSWnd
 {
 protected:
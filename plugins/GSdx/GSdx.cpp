@@ -273,6 +273,7 @@ void GSdxApp::Init()
 	m_default_configuration["logz"]                                       = "0";
 #else
 	m_default_configuration["linux_replay"]                               = "1";
+	m_default_configuration["linux_replay_memory"]                        = "1024";
 #endif
 
 	m_default_configuration["aa1"]                                        = "0";
@@ -291,11 +292,16 @@ void GSdxApp::Init()
 	m_default_configuration["debug_opengl"]                               = "0";
 	m_default_configuration["dump"]                                       = "0";
 	m_default_configuration["extrathreads"]                               = "2";
+	m_default_configuration["extrathreads_binning"]                       = "0";
 	m_default_configuration["extrathreads_height"]                        = "4";
+	m_default_configuration["extrathreads_tile"]                          = "6";
+	m_default_configuration["extrathreads_transfer"]                      = "0";
+	m_default_configuration["extrathreads_vertex"]                        = "0";
 	m_default_configuration["filter"]                                     = "2";
 	m_default_configuration["force_texture_clear"]                        = "0";
 	m_default_configuration["fxaa"]                                       = "0";
 	m_default_configuration["interlace"]                                  = "7";
+	m_default_configuration["jit_cache"]                                  = "0";
 	m_default_configuration["large_framebuffer"]                          = "1";
 	m_default_configuration["linear_present"]                             = "1";
 	m_default_configuration["MaxAnisotropy"]                              = "0";
@@ -419,6 +425,13 @@ void GSdxApp::SetConfigDir(const char* dir)
 	}
 }
 
+string GSdxApp::GetConfigDir()
+{
+	size_t pos = m_ini.find_last_of(DIRECTORY_SEPARATOR);
+
+	return pos != string::npos ? m_ini.substr(0, pos + 1) : string();
+}
+
 string GSdxApp::GetConfigS(const char* entry)
 {
 	char buff[4096] = {0};
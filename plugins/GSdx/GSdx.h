@@ -62,6 +62,7 @@ public:
 
 
 	void SetConfigDir(const char* dir);
+	string GetConfigDir();
 
 	vector<GSSetting> m_gs_renderers;
 	vector<GSSetting> m_gs_interlace;
@@ -29,6 +29,15 @@ void help()
 	fprintf(stderr, "ARG1 GSdx plugin\n");
 	fprintf(stderr, "ARG2 .gs file\n");
 	fprintf(stderr, "ARG3 Ini directory\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Headless benchmark (software renderer, null device)\n");
+	fprintf(stderr, "--bench [-n loops] [-o result.json] GSdx_plugin .gs_file_or_directory [ini_directory]\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Vertex preprocessing benchmark (separate against fused trace and conversion, over the draws of the dumps)\n");
+	fprintf(stderr, "--vertexbench [-n loops] [-o result.json] GSdx_plugin .gs_file_or_directory [ini_directory]\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Local memory swizzle benchmark (every block kernel set the cpu supports)\n");
+	fprintf(stderr, "--membench [-n loops] [-o result.json] GSdx_plugin\n");
 	if (handle) {
 		dlclose(handle);
 	}
@@ -44,9 +53,104 @@ char* read_env(const char* var) {
 	return v;
 }
 
+int bench(int argc, char* argv[], const char* entry, int loops)
+{
+	char* json = NULL;
+
+	int i = 2;
+
+	for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+		if (strcmp(argv[i], "-n") == 0)
+			loops = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-o") == 0)
+			json = argv[i + 1];
+		else
+			help();
+	}
+
+	if (argc - i < 2) help();
+
+	char* plugin = argv[i];
+	char* gs = argv[i + 1];
+
+	handle = dlopen(plugin, RTLD_LAZY|RTLD_GLOBAL);
+	if (handle == NULL) {
+		fprintf(stderr, "Failed to dlopen plugin %s\n", plugin);
+		help();
+	}
+
+	__attribute__((stdcall)) void (*GSsetSettingsDir_ptr)(const char*);
+	__attribute__((stdcall)) int (*GSReplayBenchmark_ptr)(char*, int, char*);
+
+	*(void**)(&GSsetSettingsDir_ptr) = dlsym(handle, "GSsetSettingsDir");
+	*(void**)(&GSReplayBenchmark_ptr) = dlsym(handle, entry);
+
+	if (GSReplayBenchmark_ptr == NULL) {
+		fprintf(stderr, "%s doesn't support %s\n", plugin, entry);
+		help();
+	}
+
+	if (argc - i > 2)
+		GSsetSettingsDir_ptr(argv[i + 2]);
+	else if (getenv("GSDUMP_CONF"))
+		GSsetSettingsDir_ptr(getenv("GSDUMP_CONF"));
+
+	int failed = GSReplayBenchmark_ptr(gs, loops, json);
+
+	dlclose(handle);
+
+	return failed == 0 ? 0 : 1;
+}
+
+int membench(int argc, char* argv[])
+{
+	int loops = 1;
+	char* json = NULL;
+
+	int i = 2;
+
+	for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+		if (strcmp(argv[i], "-n") == 0)
+			loops = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-o") == 0)
+			json = argv[i + 1];
+		else
+			help();
+	}
+
+	if (argc - i < 1) help();
+
+	char* plugin = argv[i];
+
+	handle = dlopen(plugin, RTLD_LAZY|RTLD_GLOBAL);
+	if (handle == NULL) {
+		fprintf(stderr, "Failed to dlopen plugin %s\n", plugin);
+		help();
+	}
+
+	__attribute__((stdcall)) int (*GSMemoryBenchmark_ptr)(int, char*);
+
+	*(void**)(&GSMemoryBenchmark_ptr) = dlsym(handle, "GSMemoryBenchmark");
+
+	if (GSMemoryBenchmark_ptr == NULL) {
+		fprintf(stderr, "%s doesn't support the memory benchmark\n", plugin);
+		help();
+	}
+
+	int failed = GSMemoryBenchmark_ptr(loops, json);
+
+	dlclose(handle);
+
+	return failed == 0 ? 0 : 1;
+}
+
 int main ( int argc, char *argv[] )
 {
-	if (argc < 1) help();
+	if (argc < 2) help();
+
+	if (strcmp(argv[1], "--bench") == 0) return bench(argc, argv, "GSReplayBenchmark", 3);
+	if (strcmp(argv[1], "--vertexbench") == 0) return bench(argc, argv, "GSVertexBenchmark", 10);
+	if (strcmp(argv[1], "--membench") == 0) return membench(argc, argv);
 
 	char* plugin;
 	char* gs;
@@ -95,6 +95,7 @@ extern void SysMessage(const wchar_t *fmt, ...);
 
 #include "Utilities/Exceptions.h"
 #include "Utilities/SafeArray.h"
+#include "Utilities/General.h"
 
 #include "defs.h"
 #include "regs.h"
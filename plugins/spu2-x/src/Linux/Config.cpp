@@ -30,7 +30,8 @@ static const int LATENCY_MAX = 3000;
 static const int LATENCY_MAX = 750;
 #endif
 
-static const int LATENCY_MIN = 15;
+static const int LATENCY_MIN = 3;
+static const int LATENCY_MIN_TS = 15;
 
 int AutoDMAPlayRate[2] = {0,0};
 
@@ -161,7 +162,7 @@ void ReadSettings()
 	// Sanity Checks
 	// -------------
 
-	Clampify( SndOutLatencyMS, LATENCY_MIN, LATENCY_MAX );
+	Clampify( SndOutLatencyMS, (SynchMode == 0) ? LATENCY_MIN_TS : LATENCY_MIN, LATENCY_MAX ); // can't use low-latency with timestretcher atm
 
 	WriteSettings();
 	spuConfig->Flush();
@@ -404,6 +405,8 @@ void DisplayDialog()
     	
     	if (gtk_combo_box_get_active(GTK_COMBO_BOX(sync_box)) != -1)
 			SynchMode = gtk_combo_box_get_active(GTK_COMBO_BOX(sync_box));
+
+		Clampify( SndOutLatencyMS, (SynchMode == 0) ? LATENCY_MIN_TS : LATENCY_MIN, LATENCY_MAX ); // can't use low-latency with timestretcher atm
     }
 
     gtk_widget_destroy (dialog);
@@ -16,12 +16,17 @@
  */
 
 #include "Global.h"
+#include "MixerSIMD.h"
 
 // Games have turned out to be surprisingly sensitive to whether a parked, silent voice is being fully emulated.
 // With Silent Hill: Shattered Memories requiring full processing for no obvious reason, we've decided to
 // disable the optimisation until we can tie it to the game database.
 #define NEVER_SKIP_VOICES 1
 
+// Runs the interpolation, ADSR and volume stages of a core's voices a lane group at a time
+// (see MixerSIMD.h).  Everything else still goes voice by voice in the usual order.
+#define VECTOR_VOICE_MIX 1
+
 void ADMAOutLogWrite(void *lpData, u32 ulSize);
 
 static const s32 tbl_XA_Factor[16][2] =
@@ -52,6 +57,11 @@ static __forceinline s32 MulShr32( s32 srcval, s32 mulval )
 	return (s64)srcval * mulval >> 32;
 }
 
+static __forceinline VoiceVec MulShr32( const VoiceVec& srcval, const VoiceVec& mulval )
+{
+	return srcval.MulHi( mulval );
+}
+
 __forceinline s32 clamp_mix( s32 x, u8 bitshift )
 {
 	return GetClamped( x, -0x8000<<bitshift, 0x7fff<<bitshift );
@@ -140,6 +150,13 @@ int g_counter_cache_hits = 0;
 int g_counter_cache_misses = 0;
 int g_counter_cache_ignores = 0;
 
+int g_counter_mix_blocks = 0;
+int g_counter_mix_block_samples = 0;
+u64 g_counter_mix_block_ticks = 0;
+
+bool MixProfiling = false;
+u64 MixStageTicks[MixStage_Count];
+
 // LOOP/END sets the ENDX bit and sets NAX to LSA, and the voice is muted if LOOP is not set
 // LOOP seems to only have any effect on the block with LOOP/END set, where it prevents muting the voice
 // (the documented requirement that every block in a loop has the LOOP bit set is nonsense according to tests)
@@ -225,6 +242,7 @@ static __forceinline s32 GetNextDataBuffered( V_Core& thiscore, uint voiceidx )
 					g_counter_cache_misses++;
 			}
 
+			ScopedMixStage stage( MixStage_Decode );
 			XA_decode_block( vc.SBuffer, memptr, vc.Prev1, vc.Prev2 );
 		}
 	}
@@ -302,6 +320,11 @@ static __forceinline s32 ApplyVolume(s32 data, s32 volume)
 	return MulShr32( data<<1, volume );
 }
 
+static __forceinline VoiceVec ApplyVolume(const VoiceVec& data, const VoiceVec& volume)
+{
+	return MulShr32( data<<1, volume );
+}
+
 static __forceinline StereoOut32 ApplyVolume( const StereoOut32& data, const V_VolumeLR& volume )
 {
 	return StereoOut32(
@@ -361,38 +384,39 @@ static __forceinline void CalculateADSR( V_Core& thiscore, uint voiceidx )
 /*
    Tension: 65535 is high, 32768 is normal, 0 is low
 */
-template<s32 i_tension>
+template<s32 i_tension, typename T>
  __forceinline
-static s32 HermiteInterpolate(
-	s32 y0, // 16.0
-	s32 y1, // 16.0
-	s32 y2, // 16.0
-	s32 y3, // 16.0
-	s32 mu  //  0.12
+static T HermiteInterpolate(
+	const T& y0, // 16.0
+	const T& y1, // 16.0
+	const T& y2, // 16.0
+	const T& y3, // 16.0
+	const T& mu  //  0.12
 	)
 {
-	s32 m00 = ((y1-y0)*i_tension) >> 16; // 16.0
-	s32 m01 = ((y2-y1)*i_tension) >> 16; // 16.0
-	s32 m0  = m00 + m01;
+	T m00 = ((y1-y0)*i_tension) >> 16; // 16.0
+	T m01 = ((y2-y1)*i_tension) >> 16; // 16.0
+	T m0  = m00 + m01;
 
-	s32 m10 = ((y2-y1)*i_tension) >> 16; // 16.0
-	s32 m11 = ((y3-y2)*i_tension) >> 16; // 16.0
-	s32 m1  = m10 + m11;
+	T m10 = ((y2-y1)*i_tension) >> 16; // 16.0
+	T m11 = ((y3-y2)*i_tension) >> 16; // 16.0
+	T m1  = m10 + m11;
 
-	s32 val = ((  2*y1 +   m0 + m1 - 2*y2) * mu) >> 12; // 16.0
+	T val = ((  2*y1 +   m0 + m1 - 2*y2) * mu) >> 12; // 16.0
 	val = ((val - 3*y1 - 2*m0 - m1 + 3*y2) * mu) >> 12; // 16.0
 	val = ((val        +   m0            ) * mu) >> 11; // 16.0
 
 	return(val + (y1<<1));
 }
 
+template< typename T >
 __forceinline
-static s32 CatmullRomInterpolate(
-	s32 y0, // 16.0
-	s32 y1, // 16.0
-	s32 y2, // 16.0
-	s32 y3, // 16.0
-	s32 mu  //  0.12
+static T CatmullRomInterpolate(
+	const T& y0, // 16.0
+	const T& y1, // 16.0
+	const T& y2, // 16.0
+	const T& y3, // 16.0
+	const T& mu  //  0.12
 	)
 {
 	//q(t) = 0.5 *(    	(2 * P1) +
@@ -400,43 +424,42 @@ static s32 CatmullRomInterpolate(
 	//	(2*P0 - 5*P1 + 4*P2 - P3) * t2 +
 	//	(-P0 + 3*P1- 3*P2 + P3) * t3)
 
-	s32 a3 = (-  y0 + 3*y1 - 3*y2 + y3);
-	s32 a2 = ( 2*y0 - 5*y1 + 4*y2 - y3);
-	s32 a1 = (-  y0        +   y2     );
-	s32 a0 = (        2*y1            );
+	T a3 = (-  y0 + 3*y1 - 3*y2 + y3);
+	T a2 = ( 2*y0 - 5*y1 + 4*y2 - y3);
+	T a1 = (-  y0        +   y2     );
+	T a0 = (        2*y1            );
 
-	s32 val = ((a3  ) * mu) >> 12;
+	T val = ((a3  ) * mu) >> 12;
 	val = ((a2 + val) * mu) >> 12;
 	val = ((a1 + val) * mu) >> 12;
 
 	return (a0 + val);
 }
 
+template< typename T >
 __forceinline
-static s32 CubicInterpolate(
-	s32 y0, // 16.0
-	s32 y1, // 16.0
-	s32 y2, // 16.0
-	s32 y3, // 16.0
-	s32 mu  //  0.12
+static T CubicInterpolate(
+	const T& y0, // 16.0
+	const T& y1, // 16.0
+	const T& y2, // 16.0
+	const T& y3, // 16.0
+	const T& mu  //  0.12
 	)
 {
-	const s32 a0 = y3 - y2 - y0 + y1;
-	const s32 a1 = y0 - y1 - a0;
-	const s32 a2 = y2 - y0;
+	const T a0 = y3 - y2 - y0 + y1;
+	const T a1 = y0 - y1 - a0;
+	const T a2 = y2 - y0;
 
-	s32 val = ((  a0) * mu) >> 12;
+	T val = ((  a0) * mu) >> 12;
 	val = ((val + a1) * mu) >> 12;
 	val = ((val + a2) * mu) >> 11;
 
 	return(val + (y1<<1));
 }
 
-// Returns a 16 bit result in Value.
-// Uses standard template-style optimization techniques to statically generate five different
-// versions of this function (one for each type of interpolation).
+// Pulls decoded samples into the interpolation history until the sample pointer catches up.
 template< int InterpType >
-static __forceinline s32 GetVoiceValues( V_Core& thiscore, uint voiceidx )
+static __forceinline void GetVoiceData( V_Core& thiscore, uint voiceidx )
 {
 	V_Voice& vc( thiscore.Voices[voiceidx] );
 
@@ -451,22 +474,30 @@ static __forceinline s32 GetVoiceValues( V_Core& thiscore, uint voiceidx )
 		vc.PV1 = GetNextDataBuffered( thiscore, voiceidx );
 		vc.SP -= 4096;
 	}
+}
 
-	const s32 mu = vc.SP + 4096;
+// Returns a 16 bit result in Value.
+// Uses standard template-style optimization techniques to statically generate five different
+// versions of this function (one for each type of interpolation), for single voices (s32) and
+// for a lane group of voices (VoiceVec).
+template< int InterpType, typename T >
+static __forceinline T GetVoiceValues( const T& PV4, const T& PV3, const T& PV2, const T& PV1, const T& SP )
+{
+	const T mu = SP + T( 4096 );
 
 	switch( InterpType )
 	{
-		case 0: return vc.PV1<<1;
-		case 1: return (vc.PV1<<1) - (( (vc.PV2 - vc.PV1) * vc.SP)>>11);
+		case 0: return PV1<<1;
+		case 1: return (PV1<<1) - (( (PV2 - PV1) * SP)>>11);
 
-		case 2: return CubicInterpolate				(vc.PV4, vc.PV3, vc.PV2, vc.PV1, mu);
-		case 3: return HermiteInterpolate<16384>	(vc.PV4, vc.PV3, vc.PV2, vc.PV1, mu);
-		case 4: return CatmullRomInterpolate		(vc.PV4, vc.PV3, vc.PV2, vc.PV1, mu);
+		case 2: return CubicInterpolate				(PV4, PV3, PV2, PV1, mu);
+		case 3: return HermiteInterpolate<16384>	(PV4, PV3, PV2, PV1, mu);
+		case 4: return CatmullRomInterpolate		(PV4, PV3, PV2, PV1, mu);
 
 		jNO_DEFAULT;
 	}
 
-	return 0;		// technically unreachable!
+	return T( 0 );		// technically unreachable!
 }
 
 // Noise values need to be mixed without going through interpolation, since it
@@ -517,7 +548,12 @@ static __forceinline void spu2M_WriteFast( u32 addr, s16 value )
 }
 
 
-static __forceinline StereoOut32 MixVoice( uint coreidx, uint voiceidx )
+// Runs everything of a voice's sample which has to happen in voice order: volume slides, pitch
+// (modulated by the previous voice's crest), ADPCM fetch, noise, ADSR, and the crest and raw
+// voice write-back.  The voice's interpolation inputs are left in PV1..PV4 and SP (or Noise for
+// noise voices).  Returns false when the voice is off, in which case its output is silent.
+template< int InterpType >
+static __forceinline bool UpdateVoice( uint coreidx, uint voiceidx, s32& Noise )
 {
 	V_Core& thiscore( Cores[coreidx] );
 	V_Voice& vc( thiscore.Voices[voiceidx] );
@@ -540,36 +576,19 @@ static __forceinline StereoOut32 MixVoice( uint coreidx, uint voiceidx )
 	{
 		UpdatePitch( coreidx, voiceidx );
 
-		s32 Value = 0;
-
 		if( vc.Noise )
-			Value = GetNoiseValues( thiscore, voiceidx );
+			Noise = GetNoiseValues( thiscore, voiceidx );
 		else
-		{
-			// Optimization : Forceinline'd Templated Dispatch Table.  Any halfwit compiler will
-			// turn this into a clever jump dispatch table (no call/rets, no compares, uber-efficient!)
+			GetVoiceData<InterpType>( thiscore, voiceidx );
 
-			switch( Interpolation )
-			{
-				case 0: Value = GetVoiceValues<0>( thiscore, voiceidx ); break;
-				case 1: Value = GetVoiceValues<1>( thiscore, voiceidx ); break;
-				case 2: Value = GetVoiceValues<2>( thiscore, voiceidx ); break;
-				case 3: Value = GetVoiceValues<3>( thiscore, voiceidx ); break;
-				case 4: Value = GetVoiceValues<4>( thiscore, voiceidx ); break;
-
-				jNO_DEFAULT;
-			}
-		}
-
-		// Update and Apply ADSR  (applies to normal and noise sources)
+		// Update ADSR  (applies to normal and noise sources)
 		//
 		// Note!  It's very important that ADSR stay as accurate as possible.  By the way
 		// it is used, various sound effects can end prematurely if we truncate more than
 		// one or two bits.  Best result comes from no truncation at all, which is why we
-		// use a full 64-bit multiply/result here.
+		// use a full 64-bit multiply/result when applying it.
 
 		CalculateADSR( thiscore, voiceidx );
-		Value	= MulShr32( Value, vc.ADSR.Value );
 		
 		// Store Value for eventual modulation later
 		// Pseudonym's Crest calculation idea. Actually calculates a crest, unlike the old code which was just peak.
@@ -590,8 +609,8 @@ static __forceinline StereoOut32 MixVoice( uint coreidx, uint voiceidx )
 
 		if (voiceidx==1)      spu2M_WriteFast( ( (0==coreidx) ? 0x400 : 0xc00 ) + OutPos, vc.OutX );
 		else if (voiceidx==3) spu2M_WriteFast( ( (0==coreidx) ? 0x600 : 0xe00 ) + OutPos, vc.OutX );
-			
-		return ApplyVolume( StereoOut32( Value, Value ), vc.Volume );
+
+		return true;
 	}
 	else
 	{
@@ -612,19 +631,120 @@ static __forceinline StereoOut32 MixVoice( uint coreidx, uint voiceidx )
 		if (voiceidx==1)      spu2M_WriteFast( ( (0==coreidx) ? 0x400 : 0xc00 ) + OutPos, 0 );
 		else if (voiceidx==3) spu2M_WriteFast( ( (0==coreidx) ? 0x600 : 0xe00 ) + OutPos, 0 );
 
+		return false;
+	}
+}
+
+template< int InterpType >
+static __forceinline StereoOut32 MixVoice( uint coreidx, uint voiceidx )
+{
+	V_Voice& vc( Cores[coreidx].Voices[voiceidx] );
+	s32 Value = 0;
+
+	if( !UpdateVoice<InterpType>( coreidx, voiceidx, Value ) )
 		return StereoOut32( 0, 0 );
+
+	if( !vc.Noise )
+		Value = GetVoiceValues<InterpType>( vc.PV4, vc.PV3, vc.PV2, vc.PV1, vc.SP );
+
+	Value = MulShr32( Value, vc.ADSR.Value );
+
+	return ApplyVolume( StereoOut32( Value, Value ), vc.Volume );
+}
+
+// Mixes the voices staged in lanes, VoiceVec::Lanes voices at a time.  Off voices have a zero
+// ADSR in their lane which silences them the same way the scalar path skips them.
+template< int InterpType >
+static __forceinline void MixVoiceLanes( VoiceMixSet& dest, const VoiceLanes& lanes )
+{
+	VoiceVec DryL( VoiceVec::Zero() ), DryR( VoiceVec::Zero() );
+	VoiceVec WetL( VoiceVec::Zero() ), WetR( VoiceVec::Zero() );
+
+	for( uint i=0; i<V_Core::NumVoices; i+=VoiceVec::Lanes )
+	{
+		VoiceVec Value( GetVoiceValues<InterpType>(
+			VoiceVec::Load( &lanes.PV4[i] ), VoiceVec::Load( &lanes.PV3[i] ),
+			VoiceVec::Load( &lanes.PV2[i] ), VoiceVec::Load( &lanes.PV1[i] ),
+			VoiceVec::Load( &lanes.SP[i] ) ) );
+
+		Value = VoiceVec::Select( VoiceVec::Load( &lanes.NoiseMask[i] ), Value, VoiceVec::Load( &lanes.Noise[i] ) );
+		Value = MulShr32( Value, VoiceVec::Load( &lanes.ADSR[i] ) );
+
+		const VoiceVec Left( ApplyVolume( Value, VoiceVec::Load( &lanes.VolL[i] ) ) );
+		const VoiceVec Right( ApplyVolume( Value, VoiceVec::Load( &lanes.VolR[i] ) ) );
+
+		DryL += Left	& VoiceVec::Load( &lanes.DryL[i] );
+		DryR += Right	& VoiceVec::Load( &lanes.DryR[i] );
+		WetL += Left	& VoiceVec::Load( &lanes.WetL[i] );
+		WetR += Right	& VoiceVec::Load( &lanes.WetR[i] );
+	}
+
+	// Integer adds wrap, so summing per lane first still matches the voice order sum of the scalar path.
+	dest.Dry.Left	+= DryL.Sum();
+	dest.Dry.Right	+= DryR.Sum();
+	dest.Wet.Left	+= WetL.Sum();
+	dest.Wet.Right	+= WetR.Sum();
+
+	if( IsDebugBuild )
+	{
+		VoiceMixSet check( VoiceMixSet::Empty );
+
+		for( uint i=0; i<V_Core::NumVoices; ++i )
+		{
+			s32 Value = lanes.NoiseMask[i] ? lanes.Noise[i] :
+				GetVoiceValues<InterpType>( lanes.PV4[i], lanes.PV3[i], lanes.PV2[i], lanes.PV1[i], lanes.SP[i] );
+
+			Value = MulShr32( Value, lanes.ADSR[i] );
+
+			check.Dry.Left	+= ApplyVolume( Value, lanes.VolL[i] ) & lanes.DryL[i];
+			check.Dry.Right	+= ApplyVolume( Value, lanes.VolR[i] ) & lanes.DryR[i];
+			check.Wet.Left	+= ApplyVolume( Value, lanes.VolL[i] ) & lanes.WetL[i];
+			check.Wet.Right	+= ApplyVolume( Value, lanes.VolR[i] ) & lanes.WetR[i];
+		}
+
+		pxAssertMsg( check.Dry.Left == DryL.Sum() && check.Dry.Right == DryR.Sum() &&
+			check.Wet.Left == WetL.Sum() && check.Wet.Right == WetR.Sum(), "Vector voice mix doesn't match the scalar mix" );
 	}
 }
 
 const VoiceMixSet VoiceMixSet::Empty( (StereoOut32()), (StereoOut32()) );	// Don't use SteroOut32::Empty because C++ doesn't make any dep/order checks on global initializers.
 
+template< int InterpType >
 static __forceinline void MixCoreVoices( VoiceMixSet& dest, const uint coreidx )
 {
 	V_Core& thiscore( Cores[coreidx] );
 
+#if VECTOR_VOICE_MIX
+	VoiceLanes lanes;
+
+	for( uint voiceidx=0; voiceidx<V_Core::NumVoices; ++voiceidx )
+	{
+		const V_Voice& vc( thiscore.Voices[voiceidx] );
+		s32 Noise = 0;
+
+		const bool on = UpdateVoice<InterpType>( coreidx, voiceidx, Noise );
+
+		lanes.PV4[voiceidx]			= vc.PV4;
+		lanes.PV3[voiceidx]			= vc.PV3;
+		lanes.PV2[voiceidx]			= vc.PV2;
+		lanes.PV1[voiceidx]			= vc.PV1;
+		lanes.SP[voiceidx]			= vc.SP;
+		lanes.Noise[voiceidx]		= Noise;
+		lanes.NoiseMask[voiceidx]	= vc.Noise ? -1 : 0;
+		lanes.ADSR[voiceidx]		= on ? vc.ADSR.Value : 0;
+		lanes.VolL[voiceidx]		= vc.Volume.Left.Value;
+		lanes.VolR[voiceidx]		= vc.Volume.Right.Value;
+		lanes.DryL[voiceidx]		= thiscore.VoiceGates[voiceidx].DryL;
+		lanes.DryR[voiceidx]		= thiscore.VoiceGates[voiceidx].DryR;
+		lanes.WetL[voiceidx]		= thiscore.VoiceGates[voiceidx].WetL;
+		lanes.WetR[voiceidx]		= thiscore.VoiceGates[voiceidx].WetR;
+	}
+
+	MixVoiceLanes<InterpType>( dest, lanes );
+#else
 	for( uint voiceidx=0; voiceidx<V_Core::NumVoices; ++voiceidx )
 	{
-		StereoOut32 VVal( MixVoice( coreidx, voiceidx ) );
+		StereoOut32 VVal( MixVoice<InterpType>( coreidx, voiceidx ) );
 
 		// Note: Results from MixVoice are ranged at 16 bits.
 
@@ -633,6 +753,24 @@ static __forceinline void MixCoreVoices( VoiceMixSet& dest, const uint coreidx )
 		dest.Wet.Left	+= VVal.Left	& thiscore.VoiceGates[voiceidx].WetL;
 		dest.Wet.Right	+= VVal.Right	& thiscore.VoiceGates[voiceidx].WetR;
 	}
+#endif
+}
+
+static __forceinline void MixCoreVoices( VoiceMixSet& dest, const uint coreidx )
+{
+	// Optimization : Forceinline'd Templated Dispatch Table.  Any halfwit compiler will
+	// turn this into a clever jump dispatch table (no call/rets, no compares, uber-efficient!)
+
+	switch( Interpolation )
+	{
+		case 0: MixCoreVoices<0>( dest, coreidx ); break;
+		case 1: MixCoreVoices<1>( dest, coreidx ); break;
+		case 2: MixCoreVoices<2>( dest, coreidx ); break;
+		case 3: MixCoreVoices<3>( dest, coreidx ); break;
+		case 4: MixCoreVoices<4>( dest, coreidx ); break;
+
+		jNO_DEFAULT;
+	}
 }
 
 StereoOut32 V_Core::Mix( const VoiceMixSet& inVoices, const StereoOut32& Input, const StereoOut32& Ext )
@@ -710,7 +848,11 @@ StereoOut32 V_Core::Mix( const VoiceMixSet& inVoices, const StereoOut32& Input,
 
 	WaveDump::WriteCore( Index, CoreSrc_PreReverb, TW );
 
-	StereoOut32 RV = DoReverb( TW );
+	StereoOut32 RV;
+	{
+		ScopedMixStage stage( MixStage_Reverb );
+		RV = DoReverb( TW );
+	}
 
 	WaveDump::WriteCore( Index, CoreSrc_PostReverb, RV );
 
@@ -796,12 +938,9 @@ StereoOut32 Apply_Dealias_Filter(StereoOut32 &SoundStream)
 // used to throttle the output rate of cache stat reports
 static int p_cachestat_counter=0;
 
-// Gcc does not want to inline it when lto is enabled because some functions growth too much.
-// The function is big enought to see any speed impact. -- Gregory
-#ifndef __POSIX__
-__forceinline
-#endif
-void Mix()
+// Mixes one sample of both cores and advances the output position; the result still has to
+// be handed to SndBuffer.
+static __forceinline StereoOut32 MixSample()
 {
 	// Note: Playmode 4 is SPDIF, which overrides other inputs.
 	StereoOut32 InputData[2] =
@@ -881,8 +1020,6 @@ void Mix()
 	// Configurable output volume
 	Out.Left *= FinalVolume;
 	Out.Right *= FinalVolume;
-	
-	SndBuffer::Write( Out );
 
 	// Update AutoDMA output positioning
 	OutPos++;
@@ -899,11 +1036,74 @@ void Mix()
 				g_counter_cache_misses,
 				g_counter_cache_ignores );
 
+			if( MsgToConsole() && g_counter_mix_blocks ) ConLog( " * SPU2 > MixStats > Blocks: %d  Samples: %d  Avg: %d us/block\n",
+				g_counter_mix_blocks,
+				g_counter_mix_block_samples,
+				(int)(g_counter_mix_block_ticks * 1000000 / GetTickFrequency() / g_counter_mix_blocks) );
+
+			if( MsgOverruns() )
+			{
+				SndBufferStats stats;
+				SndBuffer::GetStats( stats, true );
+
+				ConLog( " * SPU2 > BufferStats > Underruns: %u  Overruns: %u  Latency (ms) <1: %u  <2: %u  <4: %u  <8: %u  <16: %u  <32: %u  <64: %u  <128: %u  <256: %u  more: %u\n",
+					stats.Underruns, stats.Overruns,
+					stats.Latency[0], stats.Latency[1], stats.Latency[2], stats.Latency[3], stats.Latency[4],
+					stats.Latency[5], stats.Latency[6], stats.Latency[7], stats.Latency[8], stats.Latency[9] );
+			}
+
 			g_counter_cache_hits =
 			g_counter_cache_misses =
 			g_counter_cache_ignores = 0;
+
+			g_counter_mix_blocks =
+			g_counter_mix_block_samples = 0;
+			g_counter_mix_block_ticks = 0;
 		}
 	}
+
+	return Out;
+}
+
+// Gcc does not want to inline it when lto is enabled because some functions growth too much.
+// The function is big enought to see any speed impact. -- Gregory
+#ifndef __POSIX__
+__forceinline
+#endif
+void Mix()
+{
+	ScopedMixStage stage( MixStage_Total );
+	SndBuffer::Write( MixSample() );
+}
+
+// Mixes up to count samples back to back (advancing Cycles for each, as TimeUpdate does) and
+// hands them to the output buffer in one go.  Stops right after a sample which raised an IRQ so
+// that the caller can deliver it before the next sample, exactly like per-sample stepping.
+// Returns the number of samples mixed.
+uint MixBlock( uint count )
+{
+	pxAssume( count <= MixBlockSize );
+
+	ScopedMixStage stage( MixStage_Total );
+	StereoOut32 Out[MixBlockSize];
+	const u64 start = GetCPUTicks();
+	uint mixed = 0;
+
+	while( mixed < count )
+	{
+		Cycles++;
+		Out[mixed++] = MixSample();
+
+		if( has_to_call_irq ) break;
+	}
+
+	SndBuffer::Write( Out, mixed );
+
+	g_counter_mix_blocks++;
+	g_counter_mix_block_samples += mixed;
+	g_counter_mix_block_ticks += GetCPUTicks() - start;
+
+	return mixed;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -132,7 +132,51 @@ struct FrequencyResponseFilter
 
 };
 
+// Samples mixed in one go by MixBlock while no IRQ, DMA interrupt or key on is due in between
+// (set to 1 to step every sample through TimeUpdate again).
+static const uint MixBlockSize = 64;
+
 extern void	Mix();
+extern uint	MixBlock( uint count );
+
+// Block mixer counters (mix time in GetCPUTicks units), dev builds report them with the cache stats.
+extern int	g_counter_mix_blocks;
+extern int	g_counter_mix_block_samples;
+extern u64	g_counter_mix_block_ticks;
+
+// Per stage mixer timing (GetCPUTicks units), only sampled while MixProfiling is set.  Total
+// spans Mix/MixBlock including the output buffer write, so it contains the other three.
+enum MixStageType
+{
+	MixStage_Total,
+	MixStage_Decode,
+	MixStage_Reverb,
+	MixStage_TimeStretch,
+	MixStage_Count
+};
+
+extern bool	MixProfiling;
+extern u64	MixStageTicks[MixStage_Count];
+
+class ScopedMixStage
+{
+protected:
+	MixStageType m_stage;
+	u64 m_start;
+
+public:
+	__forceinline ScopedMixStage( MixStageType stage )
+		: m_stage( stage )
+		, m_start( MixProfiling ? GetCPUTicks() : 0 )
+	{
+	}
+
+	__forceinline ~ScopedMixStage()
+	{
+		if( MixProfiling ) MixStageTicks[m_stage] += GetCPUTicks() - m_start;
+	}
+};
+
 extern s32	clamp_mix( s32 x, u8 bitshift=0 );
 
 extern StereoOut32 clamp_mix( const StereoOut32& sample, u8 bitshift=0 );
@@ -0,0 +1,193 @@
+/* SPU2-X, A plugin for Emulating the Sound Processing Unit of the Playstation 2
+ * Developed and maintained by the Pcsx2 Development Team.
+ *
+ * SPU2-X is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Found-
+ * ation, either version 3 of the License, or (at your option) any later version.
+ *
+ * SPU2-X is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with SPU2-X.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <emmintrin.h>
+#if defined(__SSE4_1__) || defined(__AVX2__)
+#include <smmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Four or eight s32 samples (one per voice or reverb channel) processed side by side.
+//
+// Every operator wraps exactly like the s32 arithmetic of the scalar mixer, so the interpolators,
+// volume and reverb code can be instantiated on either type and give bit-identical results.
+struct SampleVec4
+{
+	static const uint Lanes = 4;
+	__m128i m;
+
+	SampleVec4() {}
+	SampleVec4( __m128i v ) : m( v ) {}
+	explicit SampleVec4( s32 v ) : m( _mm_set1_epi32( v ) ) {}
+	SampleVec4( s32 x, s32 y, s32 z, s32 w ) : m( _mm_setr_epi32( x, y, z, w ) ) {}
+
+	static __forceinline SampleVec4 Load( const s32* src ) { return _mm_load_si128( (const __m128i*)src ); }
+	static __forceinline SampleVec4 LoadU( const s32* src ) { return _mm_loadu_si128( (const __m128i*)src ); }
+	static __forceinline SampleVec4 Zero() { return _mm_setzero_si128(); }
+	__forceinline void Store( s32* dst ) const { _mm_store_si128( (__m128i*)dst, m ); }
+
+	__forceinline SampleVec4 operator+( const SampleVec4& v ) const { return _mm_add_epi32( m, v.m ); }
+	__forceinline SampleVec4 operator-( const SampleVec4& v ) const { return _mm_sub_epi32( m, v.m ); }
+	__forceinline SampleVec4 operator-() const { return _mm_sub_epi32( _mm_setzero_si128(), m ); }
+	__forceinline SampleVec4 operator&( const SampleVec4& v ) const { return _mm_and_si128( m, v.m ); }
+	__forceinline SampleVec4 operator<<( int i ) const { return _mm_slli_epi32( m, i ); }
+	__forceinline SampleVec4 operator>>( int i ) const { return _mm_srai_epi32( m, i ); }
+
+	// Same as clamp_mix: saturates to the s16 range.
+	__forceinline SampleVec4 Clamp16() const
+	{
+		__m128i v = _mm_packs_epi32( m, m );
+
+		return _mm_srai_epi32( _mm_unpacklo_epi16( v, v ), 16 );
+	}
+
+#ifdef __SSE4_1__
+	__forceinline SampleVec4 operator*( const SampleVec4& v ) const { return _mm_mullo_epi32( m, v.m ); }
+
+	// High 32 bits of the signed 64 bit products.
+	__forceinline SampleVec4 MulHi( const SampleVec4& v ) const
+	{
+		__m128i even = _mm_srli_epi64( _mm_mul_epi32( m, v.m ), 32 );
+		__m128i odd = _mm_mul_epi32( _mm_srli_epi64( m, 32 ), _mm_srli_epi64( v.m, 32 ) );
+
+		return _mm_blend_epi16( even, odd, 0xcc );
+	}
+
+	// Picks b where mask is set, a elsewhere.
+	static __forceinline SampleVec4 Select( const SampleVec4& mask, const SampleVec4& a, const SampleVec4& b )
+	{
+		return _mm_blendv_epi8( a.m, b.m, mask.m );
+	}
+#else
+	// SSE2 only has the unsigned even lane multiply, the low halves don't care about the sign.
+	__forceinline SampleVec4 operator*( const SampleVec4& v ) const
+	{
+		__m128i even = _mm_mul_epu32( m, v.m );
+		__m128i odd = _mm_mul_epu32( _mm_srli_epi64( m, 32 ), _mm_srli_epi64( v.m, 32 ) );
+
+		return _mm_unpacklo_epi32(
+			_mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+			_mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+	}
+
+	// The signed high half is the unsigned one minus b where a is negative and a where b is negative.
+	__forceinline SampleVec4 MulHi( const SampleVec4& v ) const
+	{
+		__m128i even = _mm_srli_epi64( _mm_mul_epu32( m, v.m ), 32 );
+		__m128i odd = _mm_mul_epu32( _mm_srli_epi64( m, 32 ), _mm_srli_epi64( v.m, 32 ) );
+		__m128i hi = _mm_or_si128( even, _mm_and_si128( odd, _mm_set_epi32( -1, 0, -1, 0 ) ) );
+		__m128i fix = _mm_add_epi32(
+			_mm_and_si128( _mm_srai_epi32( m, 31 ), v.m ),
+			_mm_and_si128( _mm_srai_epi32( v.m, 31 ), m ) );
+
+		return _mm_sub_epi32( hi, fix );
+	}
+
+	static __forceinline SampleVec4 Select( const SampleVec4& mask, const SampleVec4& a, const SampleVec4& b )
+	{
+		return _mm_or_si128( _mm_andnot_si128( mask.m, a.m ), _mm_and_si128( mask.m, b.m ) );
+	}
+#endif
+
+	__forceinline s32 Sum() const
+	{
+		__m128i v = _mm_add_epi32( m, _mm_shuffle_epi32( m, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+
+		v = _mm_add_epi32( v, _mm_shuffle_epi32( v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+
+		return _mm_cvtsi128_si32( v );
+	}
+
+	__forceinline SampleVec4& operator+=( const SampleVec4& v ) { return *this = *this + v; }
+	__forceinline SampleVec4 operator*( s32 i ) const { return *this * SampleVec4( i ); }
+};
+
+__forceinline SampleVec4 operator*( s32 i, const SampleVec4& v ) { return SampleVec4( i ) * v; }
+
+#ifdef __AVX2__
+struct SampleVec8
+{
+	static const uint Lanes = 8;
+	__m256i m;
+
+	SampleVec8() {}
+	SampleVec8( __m256i v ) : m( v ) {}
+	explicit SampleVec8( s32 v ) : m( _mm256_set1_epi32( v ) ) {}
+
+	static __forceinline SampleVec8 Load( const s32* src ) { return _mm256_load_si256( (const __m256i*)src ); }
+	static __forceinline SampleVec8 Zero() { return _mm256_setzero_si256(); }
+
+	__forceinline SampleVec8 operator+( const SampleVec8& v ) const { return _mm256_add_epi32( m, v.m ); }
+	__forceinline SampleVec8 operator-( const SampleVec8& v ) const { return _mm256_sub_epi32( m, v.m ); }
+	__forceinline SampleVec8 operator-() const { return _mm256_sub_epi32( _mm256_setzero_si256(), m ); }
+	__forceinline SampleVec8 operator&( const SampleVec8& v ) const { return _mm256_and_si256( m, v.m ); }
+	__forceinline SampleVec8 operator*( const SampleVec8& v ) const { return _mm256_mullo_epi32( m, v.m ); }
+	__forceinline SampleVec8 operator<<( int i ) const { return _mm256_slli_epi32( m, i ); }
+	__forceinline SampleVec8 operator>>( int i ) const { return _mm256_srai_epi32( m, i ); }
+
+	__forceinline SampleVec8 MulHi( const SampleVec8& v ) const
+	{
+		__m256i even = _mm256_srli_epi64( _mm256_mul_epi32( m, v.m ), 32 );
+		__m256i odd = _mm256_mul_epi32( _mm256_srli_epi64( m, 32 ), _mm256_srli_epi64( v.m, 32 ) );
+
+		return _mm256_blend_epi32( even, odd, 0xaa );
+	}
+
+	static __forceinline SampleVec8 Select( const SampleVec8& mask, const SampleVec8& a, const SampleVec8& b )
+	{
+		return _mm256_blendv_epi8( a.m, b.m, mask.m );
+	}
+
+	__forceinline s32 Sum() const
+	{
+		return SampleVec4( _mm_add_epi32( _mm256_castsi256_si128( m ), _mm256_extracti128_si256( m, 1 ) ) ).Sum();
+	}
+
+	__forceinline SampleVec8& operator+=( const SampleVec8& v ) { return *this = *this + v; }
+	__forceinline SampleVec8 operator*( s32 i ) const { return *this * SampleVec8( i ); }
+};
+
+__forceinline SampleVec8 operator*( s32 i, const SampleVec8& v ) { return SampleVec8( i ) * v; }
+
+typedef SampleVec8 VoiceVec;
+#else
+typedef SampleVec4 VoiceVec;
+#endif
+
+// The scalar mixer state of one core's voices, staged one array per field so that the
+// interpolation, ADSR and volume math can run across voices.
+struct __aligned32 VoiceLanes
+{
+	s32 PV4[V_Core::NumVoices];
+	s32 PV3[V_Core::NumVoices];
+	s32 PV2[V_Core::NumVoices];
+	s32 PV1[V_Core::NumVoices];
+	s32 SP[V_Core::NumVoices];
+	s32 Noise[V_Core::NumVoices];
+	s32 NoiseMask[V_Core::NumVoices];
+	s32 ADSR[V_Core::NumVoices];		// zero for voices which are off
+	s32 VolL[V_Core::NumVoices];
+	s32 VolR[V_Core::NumVoices];
+	s32 DryL[V_Core::NumVoices];
+	s32 DryR[V_Core::NumVoices];
+	s32 WetL[V_Core::NumVoices];
+	s32 WetR[V_Core::NumVoices];
+};
+
+static_assert( (V_Core::NumVoices % VoiceVec::Lanes) == 0, "Voices don't fill the mixer lanes" );
@@ -17,6 +17,11 @@
 
 #include "Global.h"
 #include "Lowpass.h"
+#include "MixerSIMD.h"
+
+// Runs the four parallel channels of the reverb network (A0/A1/B0/B1) in SIMD lanes, with the
+// buffer indexers of each group of four taps wrapped at once.
+#define VECTOR_REVERB 1
 
 // Low pass filters: Change these to 32 for a speedup (benchmarks needed to see if
 // the speed gain is worth the quality drop)
@@ -53,6 +58,126 @@ void V_Core::Reverb_AdvanceBuffer()
 	}
 }
 
+// The reverb buffer indexers are laid out in groups of four so that they can be loaded straight
+// into lanes (FB_SRC comes as A0/B0/A1/B1, the others as A0/A1/B0/B1 or C0/C1/D0/D1).
+static_assert( offsetof(V_ReverbBuffers, IIR_SRC_A0) == offsetof(V_ReverbBuffers, FB_SRC_A0) + 16 &&
+	offsetof(V_ReverbBuffers, IIR_DEST_A0) == offsetof(V_ReverbBuffers, IIR_SRC_A0) + 16 &&
+	offsetof(V_ReverbBuffers, ACC_SRC_A0) == offsetof(V_ReverbBuffers, IIR_DEST_A0) + 16 &&
+	offsetof(V_ReverbBuffers, ACC_SRC_C0) == offsetof(V_ReverbBuffers, ACC_SRC_A0) + 16 &&
+	offsetof(V_ReverbBuffers, MIX_DEST_A0) == offsetof(V_ReverbBuffers, ACC_SRC_C0) + 16,
+	"Reverb buffer indexers must be grouped by four" );
+
+// RevbGetIndexer for four taps at once.
+static __forceinline SampleVec4 RevbGetIndexers( const V_Core& core, const s32* offsets, s32 extra = 0 )
+{
+	const __m128i sign = _mm_set1_epi32( 0x80000000 );
+	const SampleVec4 pos( SampleVec4::LoadU( offsets ) + SampleVec4( (s32)core.ReverbX + extra ) );
+
+	// unsigned pos > EffectsEndA
+	const SampleVec4 wrap( _mm_cmpgt_epi32( _mm_xor_si128( pos.m, sign ), _mm_set1_epi32( core.EffectsEndA ^ 0x80000000 ) ) );
+
+	return pos - (wrap & SampleVec4( core.EffectsEndA + 1 - core.EffectsStartA ));
+}
+
+static __forceinline SampleVec4 RevbRead( const s32* addr )
+{
+	return SampleVec4( _spu2mem[addr[0]], _spu2mem[addr[1]], _spu2mem[addr[2]], _spu2mem[addr[3]] );
+}
+
+static __forceinline void RevbWrite( const s32* addr, const SampleVec4& value )
+{
+	__aligned16 s32 v[4];
+
+	value.Store( v );
+
+	// in channel order, so overlapping taps end up like in the scalar code
+	for( int i=0; i<4; ++i )
+		_spu2mem[addr[i]] = v[i];
+}
+
+// One 24khz step of the reverb network, with the four channels side by side.  Same math,
+// memory access order and IRQ tests as the scalar code in DoReverb.
+static __forceinline StereoOut32 DoReverbVector( V_Core& core, s32 input_L, s32 input_R )
+{
+	const V_ReverbBuffers& rb( core.RevBuffers );
+	const V_Reverb& Revb( core.Revb );
+
+	__aligned16 s32 fb_src[4], src[4], dest[4], dest2[4], acc_src[8], mix_dest[4];
+
+	const SampleVec4 fb_src_v( RevbGetIndexers( core, &rb.FB_SRC_A0 ) );
+	const SampleVec4 src_v( RevbGetIndexers( core, &rb.IIR_SRC_A0 ) );
+	const SampleVec4 dest_v( RevbGetIndexers( core, &rb.IIR_DEST_A0 ) );
+	const SampleVec4 dest2_v( RevbGetIndexers( core, &rb.IIR_DEST_A0, 1 ) );
+	const SampleVec4 acc_src_ab( RevbGetIndexers( core, &rb.ACC_SRC_A0 ) );
+	const SampleVec4 acc_src_cd( RevbGetIndexers( core, &rb.ACC_SRC_C0 ) );
+	const SampleVec4 mix_dest_v( RevbGetIndexers( core, &rb.MIX_DEST_A0 ) );
+
+	fb_src_v.Store( fb_src );
+	src_v.Store( src );
+	dest_v.Store( dest );
+	dest2_v.Store( dest2 );
+	acc_src_ab.Store( &acc_src[0] );
+	acc_src_cd.Store( &acc_src[4] );
+	mix_dest_v.Store( mix_dest );
+
+	// Optimized IRQ Testing, see the scalar version.
+	for( int i=0; i<2; i++ )
+	{
+		if( Cores[i].IRQEnable && ((Cores[i].IRQA >= core.EffectsStartA) && (Cores[i].IRQA <= core.EffectsEndA)) )
+		{
+			const __m128i irqa = _mm_set1_epi32( Cores[i].IRQA );
+			__m128i hit = _mm_or_si128( _mm_cmpeq_epi32( irqa, src_v.m ), _mm_cmpeq_epi32( irqa, dest_v.m ) );
+
+			hit = _mm_or_si128( hit, _mm_cmpeq_epi32( irqa, dest2_v.m ) );
+			hit = _mm_or_si128( hit, _mm_cmpeq_epi32( irqa, acc_src_ab.m ) );
+			hit = _mm_or_si128( hit, _mm_cmpeq_epi32( irqa, acc_src_cd.m ) );
+			hit = _mm_or_si128( hit, _mm_cmpeq_epi32( irqa, fb_src_v.m ) );
+			hit = _mm_or_si128( hit, _mm_cmpeq_epi32( irqa, mix_dest_v.m ) );
+
+			if( _mm_movemask_epi8( hit ) )
+				SetIrqCall(i);
+		}
+	}
+
+	const SampleVec4 input( input_L, input_L, input_R, input_R );
+
+	const SampleVec4 IIR_INPUT( (((RevbRead( src ) * Revb.IIR_COEF) + input) >> 15).Clamp16() );
+	const SampleVec4 src_dest( RevbRead( dest ) );
+	const SampleVec4 IIR( src_dest + (((IIR_INPUT - src_dest) * Revb.IIR_ALPHA) >> 15) );
+
+	RevbWrite( dest2, IIR.Clamp16() );
+
+	// [A0+C0, A1+C1, B0+D0, B1+D1], then fold the B/D half onto A/C for [ACC0, ACC1, ACC0, ACC1]
+	SampleVec4 ACC(
+		((RevbRead( &acc_src[0] ) * SampleVec4( Revb.ACC_COEF_A, Revb.ACC_COEF_A, Revb.ACC_COEF_B, Revb.ACC_COEF_B )) >> 15) +
+		((RevbRead( &acc_src[4] ) * SampleVec4( Revb.ACC_COEF_C, Revb.ACC_COEF_C, Revb.ACC_COEF_D, Revb.ACC_COEF_D )) >> 15) );
+
+	ACC = (ACC + SampleVec4( _mm_shuffle_epi32( ACC.m, _MM_SHUFFLE( 1, 0, 3, 2 ) ) )).Clamp16();
+
+	const s32 FB_A0 = _spu2mem[fb_src[0]];
+	const s32 FB_B0 = _spu2mem[fb_src[1]];
+	const s32 FB_A1 = _spu2mem[fb_src[2]];
+	const s32 FB_B1 = _spu2mem[fb_src[3]];
+
+	const SampleVec4 FB_A( FB_A0, FB_A1, FB_A0, FB_A1 );
+	const SampleVec4 FB_B( FB_B0, FB_B1, FB_B0, FB_B1 );
+
+	const SampleVec4 mix_a( ACC - ((FB_A * Revb.FB_ALPHA) >> 15) );
+	const SampleVec4 mix_b( FB_A + (((ACC - FB_A) * Revb.FB_ALPHA - FB_B * Revb.FB_X) >> 15) );
+	const SampleVec4 mix( SampleVec4( _mm_unpacklo_epi64( mix_a.m, mix_b.m ) ).Clamp16() );
+
+	RevbWrite( mix_dest, mix );
+
+	__aligned16 s32 out[4];
+
+	mix.Store( out );
+
+	return clamp_mix( StereoOut32(
+		out[0] + out[2],	// left
+		out[1] + out[3]		// right
+	) );
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 
 StereoOut32 V_Core::DoReverb( const StereoOut32& Input )
@@ -93,6 +218,23 @@ StereoOut32 V_Core::DoReverb( const StereoOut32& Input )
 			return StereoOut32::Empty;
 		}
 
+		StereoOut32 INPUT_SAMPLE;
+
+		for( int x=0; x<8; ++x )
+		{
+			INPUT_SAMPLE.Left += (downbuf[(dbpos+x)&7].Left * downcoeffs[x]);
+			INPUT_SAMPLE.Right += (downbuf[(dbpos+x)&7].Right * downcoeffs[x]);
+		}
+
+		INPUT_SAMPLE.Left  >>= 16;
+		INPUT_SAMPLE.Right >>= 16;
+
+		s32 input_L = INPUT_SAMPLE.Left * Revb.IN_COEF_L;
+		s32 input_R = INPUT_SAMPLE.Right * Revb.IN_COEF_R;
+
+#if VECTOR_REVERB
+		upbuf[ubpos] = DoReverbVector( *this, input_L, input_R );
+#else
 		// Advance the current reverb buffer pointer, and cache the read/write addresses we'll be
 		// needing for this session of reverb.
 
@@ -174,20 +316,6 @@ StereoOut32 V_Core::DoReverb( const StereoOut32& Input )
 		//         Begin Reverb Processing !
 		// -----------------------------------------
 
-		StereoOut32 INPUT_SAMPLE;
-
-		for( int x=0; x<8; ++x )
-		{
-			INPUT_SAMPLE.Left += (downbuf[(dbpos+x)&7].Left * downcoeffs[x]);
-			INPUT_SAMPLE.Right += (downbuf[(dbpos+x)&7].Right * downcoeffs[x]);
-		}
-
-		INPUT_SAMPLE.Left  >>= 16;
-		INPUT_SAMPLE.Right >>= 16;
-
-		s32 input_L = INPUT_SAMPLE.Left * Revb.IN_COEF_L;
-		s32 input_R = INPUT_SAMPLE.Right * Revb.IN_COEF_R;
-
 		const s32 IIR_INPUT_A0 = clamp_mix((((s32)_spu2mem[src_a0] * Revb.IIR_COEF) + input_L)>>15);
 		const s32 IIR_INPUT_A1 = clamp_mix((((s32)_spu2mem[src_a1] * Revb.IIR_COEF) + input_L)>>15);
 		const s32 IIR_INPUT_B0 = clamp_mix((((s32)_spu2mem[src_b0] * Revb.IIR_COEF) + input_R)>>15);
@@ -245,6 +373,7 @@ StereoOut32 V_Core::DoReverb( const StereoOut32& Input )
 			mix_a0 + mix_b0,	// left
 			mix_a1 + mix_b1		// right
 		) );
+#endif
 	}
 
 	StereoOut32 retval;
@@ -16,6 +16,7 @@
  */
 
 #include "Global.h"
+#include "Spu2replay.h"
 
 
 StereoOut32 StereoOut32::Empty( 0, 0 );
@@ -115,8 +116,13 @@ int FindOutputModuleById( const wchar_t* omodid )
 
 StereoOut32 *SndBuffer::m_buffer;
 s32 SndBuffer::m_size;
-__aligned(4) volatile s32 SndBuffer::m_rpos;
-__aligned(4) volatile s32 SndBuffer::m_wpos;
+SndRingIndex SndBuffer::m_rpos;
+SndRingIndex SndBuffer::m_wpos;
+s32 SndBuffer::m_wpos_pending;
+
+std::atomic<u32> SndBuffer::m_underruns;
+std::atomic<u32> SndBuffer::m_overruns;
+std::atomic<u32> SndBuffer::m_latency[SndLatencyBuckets];
 
 bool SndBuffer::m_underrun_freeze;
 StereoOut32* SndBuffer::sndTempBuffer = NULL;
@@ -135,6 +141,12 @@ bool SndBuffer::CheckUnderrunStatus( int& nSamples, int& quietSampleCount )
 	quietSampleCount = 0;
 
 	int data = _GetApproximateDataInBuffer();
+
+	int bucket = 0;
+	for( int ms = data * 1000 / SampleRate; ms > 0 && bucket < SndLatencyBuckets-1; ms >>= 1 )
+		bucket++;
+	m_latency[bucket].fetch_add( 1, std::memory_order_relaxed );
+
 	if( m_underrun_freeze )
 	{
 		int toFill = m_size / ( (SynchMode == 2) ? 32 : 400); // TimeStretch and Async off?
@@ -158,6 +170,7 @@ bool SndBuffer::CheckUnderrunStatus( int& nSamples, int& quietSampleCount )
 		nSamples = data;
 		quietSampleCount = SndOutPacketSize - data;
 		m_underrun_freeze = true;
+		m_underruns.fetch_add( 1, std::memory_order_relaxed );
 
 		if( SynchMode == 0 ) // TimeStrech on
 			timeStretchUnderrun();
@@ -179,7 +192,9 @@ void SndBuffer::_InitFail()
 int SndBuffer::_GetApproximateDataInBuffer()
 {
 	// WARNING: not necessarily 100% up to date by the time it's used, but it will have to do.
-	return (m_wpos + m_size - m_rpos) % m_size;
+	// Only counts published samples, and acquiring both ends makes them (and the buffer
+	// space the reader is done with) visible to whichever side calls this.
+	return (m_wpos.pos.load( std::memory_order_acquire ) + m_size - m_rpos.pos.load( std::memory_order_acquire )) % m_size;
 }
 
 void SndBuffer::_WriteSamples_Internal(StereoOut32 *bData, int nSamples)
@@ -187,29 +202,36 @@ void SndBuffer::_WriteSamples_Internal(StereoOut32 *bData, int nSamples)
 	// WARNING: This assumes the write will NOT wrap around,
 	// and also assumes there's enough free space in the buffer.
 
-	memcpy(m_buffer + m_wpos, bData, nSamples * sizeof(StereoOut32));
-	m_wpos = (m_wpos + nSamples) % m_size;
+	memcpy(m_buffer + m_wpos_pending, bData, nSamples * sizeof(StereoOut32));
+	m_wpos_pending = (m_wpos_pending + nSamples) % m_size;
+}
+
+// Makes everything written since the last call visible to the output module at once.
+void SndBuffer::_PublishWrite()
+{
+	m_wpos.pos.store( m_wpos_pending, std::memory_order_release );
 }
 
 void SndBuffer::_DropSamples_Internal(int nSamples)
 {
-	m_rpos = (m_rpos + nSamples) % m_size;
+	// Releases the space to the mixer only after the samples have been copied out.
+	m_rpos.pos.store( (m_rpos.pos.load( std::memory_order_relaxed ) + nSamples) % m_size, std::memory_order_release );
 }
 
 void SndBuffer::_ReadSamples_Internal(StereoOut32 *bData, int nSamples)
 {
 	// WARNING: This assumes the read will NOT wrap around,
 	// and also assumes there's enough data in the buffer.
-	memcpy(bData, m_buffer + m_rpos, nSamples * sizeof(StereoOut32));
+	memcpy(bData, m_buffer + m_rpos.pos.load( std::memory_order_relaxed ), nSamples * sizeof(StereoOut32));
 	_DropSamples_Internal(nSamples);
 }
 
 void SndBuffer::_WriteSamples_Safe(StereoOut32 *bData, int nSamples)
 {
 	// WARNING: This code assumes there's only ONE writing process.
-	if( (m_size - m_wpos) < nSamples)
+	if( (m_size - m_wpos_pending) < nSamples)
 	{
-		int b1 = m_size - m_wpos;
+		int b1 = m_size - m_wpos_pending;
 		int b2 = nSamples - b1;
 
 		_WriteSamples_Internal(bData, b1);
@@ -224,9 +246,11 @@ void SndBuffer::_WriteSamples_Safe(StereoOut32 *bData, int nSamples)
 void SndBuffer::_ReadSamples_Safe(StereoOut32* bData, int nSamples)
 {
 	// WARNING: This code assumes there's only ONE reading process.
-	if( (m_size - m_rpos) < nSamples)
+	const s32 rpos = m_rpos.pos.load( std::memory_order_relaxed );
+
+	if( (m_size - rpos) < nSamples)
 	{
-		int b1 = m_size - m_rpos;
+		int b1 = m_size - rpos;
 		int b2 = nSamples - b1;
 
 		_ReadSamples_Internal(bData, b1);
@@ -265,7 +289,8 @@ template<typename T> void SndBuffer::ReadSamples(T* bData)
 		pxAssume( nSamples <= SndOutPacketSize );
 
 		// WARNING: This code assumes there's only ONE reading process.
-		int b1 = m_size - m_rpos;
+		const s32 rpos = m_rpos.pos.load( std::memory_order_relaxed );
+		int b1 = m_size - rpos;
 
 		if(b1 > nSamples)
 			b1 = nSamples;
@@ -274,7 +299,7 @@ template<typename T> void SndBuffer::ReadSamples(T* bData)
 		{
 			// First part
 			for (int i = 0; i < b1; i++)
-				bData[i].AdjustFrom(m_buffer[i + m_rpos]);
+				bData[i].AdjustFrom(m_buffer[i + rpos]);
 
 			// Second part
 			int b2 = nSamples - b1;
@@ -285,7 +310,7 @@ template<typename T> void SndBuffer::ReadSamples(T* bData)
 		{
 			// First part
 			for (int i = 0; i < b1; i++)
-				bData[i].ResampleFrom(m_buffer[i + m_rpos]);
+				bData[i].ResampleFrom(m_buffer[i + rpos]);
 
 			// Second part
 			int b2 = nSamples - b1;
@@ -338,7 +363,9 @@ void SndBuffer::_WriteSamples(StereoOut32 *bData, int nSamples)
 	//  The older portion of the buffer is discarded rather than incoming data,
 	//  so that the overall audio synchronization is better.
 
-	int free = m_size - _GetApproximateDataInBuffer(); // -1, but the <= handles that
+	// Counts the samples written but not published yet, they're in the buffer all the same.
+	int data = (m_wpos_pending + m_size - m_rpos.pos.load( std::memory_order_acquire )) % m_size;
+	int free = m_size - data; // -1, but the <= handles that
 	if( free <= nSamples )
 	{
 		// Disabled since the lock-free queue can't handle changing the read end from the write thread
@@ -366,6 +393,7 @@ void SndBuffer::_WriteSamples(StereoOut32 *bData, int nSamples)
 			ConLog(" * SPU2 > Overrun Compensation (%d packets tossed)\n", comp / SndOutPacketSize );
 		lastPct = 0.0;		// normalize the timestretcher
 #else
+		m_overruns.fetch_add( 1, std::memory_order_relaxed );
 		if( MsgOverruns() )
 			ConLog(" * SPU2 > Overrun! 1 packet tossed)\n");
 		lastPct = 0.0;		// normalize the timestretcher
@@ -388,8 +416,9 @@ void SndBuffer::Init()
 	// Buffer actually attempts to run ~50%, so allocate near double what
 	// the requested latency is:
 	
-	m_rpos = 0;
-	m_wpos = 0;
+	m_rpos.pos = 0;
+	m_wpos.pos = 0;
+	m_wpos_pending = 0;
 
 	try
 	{
@@ -452,13 +481,54 @@ void SndBuffer::Write( const StereoOut32& Sample )
 
 	if( WavRecordEnabled ) RecordWrite( Sample.DownSample() );
 
-	if(mods[OutputModule] == &NullOut) // null output doesn't need buffering or stretching! :p
+	// null output doesn't need buffering or stretching! :p  (except when replaying, which measures them)
+	if(mods[OutputModule] == &NullOut && !replay_mode)
 		return;
 
 	sndTempBuffer[sndTempProgress++] = Sample;
 
 	// If we haven't accumulated a full packet yet, do nothing more:
 	if(sndTempProgress < SndOutPacketSize) return;
+
+	_WritePacket();
+	_PublishWrite();
+}
+
+void SndBuffer::Write( const StereoOut32* Samples, uint count )
+{
+	for( uint i=0; i<count; ++i )
+	{
+		// Log final output to wavefile.
+		WaveDump::WriteCore( 1, CoreSrc_External, Samples[i].DownSample() );
+
+		if( WavRecordEnabled ) RecordWrite( Samples[i].DownSample() );
+	}
+
+	// null output doesn't need buffering or stretching! :p  (except when replaying, which measures them)
+	if(mods[OutputModule] == &NullOut && !replay_mode)
+		return;
+
+	while( count > 0 )
+	{
+		const uint copy = std::min<uint>( count, SndOutPacketSize - sndTempProgress );
+
+		memcpy( &sndTempBuffer[sndTempProgress], Samples, sizeof(StereoOut32) * copy );
+		sndTempProgress += copy;
+		Samples += copy;
+		count -= copy;
+
+		if(sndTempProgress < SndOutPacketSize) break;
+
+		_WritePacket();
+	}
+
+	// one release for however many packets the block filled
+	_PublishWrite();
+}
+
+// Sends a full sndTempBuffer through the DSP/timestretcher to the output buffer.
+void SndBuffer::_WritePacket()
+{
 	sndTempProgress = 0;
 
 	//Don't play anything directly after loading a savestate, avoids static killing your speakers.
@@ -508,6 +578,25 @@ void SndBuffer::Write( const StereoOut32& Sample )
 	}
 }
 
+void SndBuffer::GetStats( SndBufferStats& stats, bool reset )
+{
+	// Each counter only has the one writer, but the reset can come from any thread.
+	if( reset )
+	{
+		stats.Underruns = m_underruns.exchange( 0, std::memory_order_relaxed );
+		stats.Overruns = m_overruns.exchange( 0, std::memory_order_relaxed );
+		for( int i=0; i<SndLatencyBuckets; ++i )
+			stats.Latency[i] = m_latency[i].exchange( 0, std::memory_order_relaxed );
+	}
+	else
+	{
+		stats.Underruns = m_underruns.load( std::memory_order_relaxed );
+		stats.Overruns = m_overruns.load( std::memory_order_relaxed );
+		for( int i=0; i<SndLatencyBuckets; ++i )
+			stats.Latency[i] = m_latency[i].load( std::memory_order_relaxed );
+	}
+}
+
 s32 SndBuffer::Test()
 {
 	if( mods[OutputModule] == NULL )
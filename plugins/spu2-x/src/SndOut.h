@@ -561,7 +561,32 @@ struct Stereo51Out32
 	}
 };
 
+// Buckets of the output latency histogram: <1ms, <2ms, <4ms ... <256ms, and 256ms or more.
+static const int SndLatencyBuckets = 10;
+
+// Health of the output buffer, for picking the latency setting and the backends' own buffer
+// sizes.  Latency is the amount of audio buffered each time the output module takes a packet.
+struct SndBufferStats
+{
+	u32 Underruns;		// times the output module ran dry and got silence
+	u32 Overruns;		// packets tossed by the mixer for want of space
+	u32 Latency[SndLatencyBuckets];
+};
+
+// A ring index alone on its cache line, so the mixer and the output module's thread don't
+// keep stealing each other's line.
+struct __aligned(64) SndRingIndex
+{
+	std::atomic<s32> pos;
+	char pad[64 - sizeof(std::atomic<s32>)];
+};
+
 // Developer Note: This is a static class only (all static members).
+//
+// The buffer is a single producer (the mixer) single consumer (the output module) ring: each
+// side only ever advances its own index, publishing it with release semantics and reading
+// the other one with acquire semantics.  The mixer copies packets in at m_wpos_pending and
+// publishes them in batches.
 class SndBuffer
 {
 private:
@@ -581,8 +606,13 @@ private:
 	static StereoOut32 *m_buffer;
 	static s32 m_size;
 
-	static __aligned(4) volatile s32 m_rpos;
-	static __aligned(4) volatile s32 m_wpos;
+	static SndRingIndex m_rpos;
+	static SndRingIndex m_wpos;
+	static s32 m_wpos_pending;
+
+	static std::atomic<u32> m_underruns;
+	static std::atomic<u32> m_overruns;
+	static std::atomic<u32> m_latency[SndLatencyBuckets];
 	
 	static float lastEmergencyAdj;
 	static float cTempo;
@@ -604,7 +634,9 @@ private:
 	static void UpdateTempoChangeSoundTouch();
 	static void UpdateTempoChangeSoundTouch2();
 
+	static void _WritePacket();
 	static void _WriteSamples(StereoOut32* bData, int nSamples);
+	static void _PublishWrite();
 		
 	static void _WriteSamples_Safe(StereoOut32* bData, int nSamples);
 	static void _ReadSamples_Safe(StereoOut32* bData, int nSamples);
@@ -620,8 +652,10 @@ public:
 	static void Init();
 	static void Cleanup();
 	static void Write( const StereoOut32& Sample );
+	static void Write( const StereoOut32* Samples, uint count );
 	static s32 Test();
 	static void ClearContents();
+	static void GetStats( SndBufferStats& stats, bool reset=false );
 
 	// Note: When using with 32 bit output buffers, the user of this function is responsible
 	// for shifting the values to where they need to be manually.  The fixed point depth of
@@ -687,7 +721,7 @@ extern SndOutModule* mods[];
 
 extern bool WavRecordEnabled;
 
-extern void RecordStart();
+extern void RecordStart( const char* filename = "recording.wav" );
 extern void RecordStop();
 extern void RecordWrite( const StereoOut16& sample );
 
@@ -36,8 +36,9 @@ namespace {
 	/* SDL2 supports s32 audio */
 	/* Samples should vary from [512,8192] according to SDL spec. Take note this is the desired
 	 * sample count and SDL may provide otherwise. Pulseaudio will cut this value in half if
-	 * PA_STREAM_ADJUST_LATENCY is set in the backened, for example. */
-	const Uint16 desiredSamples = 2048;
+	 * PA_STREAM_ADJUST_LATENCY is set in the backened, for example. Configurable through
+	 * [SDL] Samples, the SPU2 buffer stats tell how low it can go before underrunning. */
+	Uint16 desiredSamples = 2048;
 	const Uint16 format = AUDIO_S16SYS;
 
 	Uint16 samples = desiredSamples;
@@ -77,6 +78,7 @@ struct SDLAudioMod : public SndOutModule {
 		/* SDL backends will mangle the AudioSpec and change the sample count. If we reopen
 		 * the audio backend, we need to make sure we keep our desired samples in the spec */
 		spec.samples = desiredSamples;
+		samples = desiredSamples;
 
 		// Mandatory otherwise, init will be redone in SDL_OpenAudio
 		if (SDL_Init(SDL_INIT_AUDIO) < 0) {
@@ -105,9 +107,8 @@ struct SDLAudioMod : public SndOutModule {
 		std::cerr << "Opened SDL audio driver: " << SDL_GetCurrentAudioDriver() << std::endl;
 #endif
 
-		/* This is so ugly. It is hilariously ugly. I didn't use a vector to save reallocs. */
-		if(samples != spec.samples || buffer == NULL)
-			buffer = std::unique_ptr<StereoOut_SDL[]>(new StereoOut_SDL[spec.samples]);
+		/* The desired count may have changed with the settings, so size the buffer on every init. */
+		buffer = std::unique_ptr<StereoOut_SDL[]>(new StereoOut_SDL[spec.samples]);
 		if(samples != spec.samples) {
 			fprintf(stderr, "SPU2-X: SDL failed to get desired samples (%d) got %d samples instead\n", samples, spec.samples);
 
@@ -138,10 +139,16 @@ struct SDLAudioMod : public SndOutModule {
 		wxString api(L"EMPTYEMPTYEMPTY");
 		CfgReadStr(L"SDL", L"HostApi", api, L"pulseaudio");
 		SetApiSettings(api);
+
+		// Number of samples must be a multiple of packet size.
+		int desired = CfgReadInt(L"SDL", L"Samples", 2048);
+		Clampify(desired, 512, 8192);
+		desiredSamples = desired & ~(SndOutPacketSize - 1);
 	}
 
 	void WriteSettings() const {
 		CfgWriteStr(L"SDL", L"HostApi", wxString(m_api.c_str(), wxConvUTF8));
+		CfgWriteInt(L"SDL", L"Samples", desiredSamples);
 	};
 
 	void SetApiSettings(wxString api) {
@@ -108,6 +108,24 @@ double HighResScale;
 
 bool Running = false;
 
+void dummy1()
+{
+}
+
+void dummy4()
+{
+#ifndef ENABLE_NEW_IOPDMA_SPU2
+	SPU2interruptDMA4();
+#endif
+}
+
+void dummy7()
+{
+#ifndef ENABLE_NEW_IOPDMA_SPU2
+	SPU2interruptDMA7();
+#endif
+}
+
 #ifdef _MSC_VER
 
 int conprintf(const char* fmt, ...)
@@ -138,24 +156,6 @@ int conprintf(const char* fmt, ...)
 #endif
 }
 
-void dummy1()
-{
-}
-
-void dummy4()
-{
-#ifndef ENABLE_NEW_IOPDMA_SPU2
-	SPU2interruptDMA4();
-#endif
-}
-
-void dummy7()
-{
-#ifndef ENABLE_NEW_IOPDMA_SPU2
-	SPU2interruptDMA7();
-#endif
-}
-
 u64 HighResFrequency()
 {
 	u64 freq;
@@ -332,3 +332,304 @@ Finish:
 #endif
 }
 #endif
+
+///////////////////////////////////////////////////////////////
+// headless replay benchmark
+
+// Longest stretch of emulated time between two SPU2async calls, well inside TimeUpdate's
+// sanity interval so that gaps between events are mixed rather than skipped.
+static const u32 ReplayStepCycles = IOPCiclesPerMS * 10;
+
+struct s2r_reader
+{
+	const u8* pos;
+	const u8* end;
+
+	bool Read( void* dest, size_t size )
+	{
+		if( (size_t)(end - pos) < size ) return false;
+		memcpy( dest, pos, size );
+		pos += size;
+		return true;
+	}
+};
+
+static bool s2r_load( const char* filename, std::vector<u8>& data )
+{
+	FILE* file = fopen( filename, "rb" );
+	if( !file ) return false;
+
+	fseek( file, 0, SEEK_END );
+	long size = ftell( file );
+	fseek( file, 0, SEEK_SET );
+
+	data.resize( size > 0 ? size : 0 );
+	bool ok = size >= 4 && fread( &data[0], 1, size, file ) == (size_t)size;
+
+	fclose( file );
+	return ok;
+}
+
+// Reads the samples of a 16 bit stereo PCM wav, as written by RecordStart.
+static bool s2r_load_wav( const char* filename, std::vector<s16>& samples )
+{
+	std::vector<u8> data;
+	if( !s2r_load( filename, data ) || data.size() < 12 ) return false;
+	if( memcmp( &data[0], "RIFF", 4 ) || memcmp( &data[8], "WAVE", 4 ) ) return false;
+
+	bool pcm16 = false;
+
+	for( size_t pos = 12; pos + 8 <= data.size(); )
+	{
+		u32 size;
+		memcpy( &size, &data[pos + 4], 4 );
+
+		const u8* chunk = &data[pos + 8];
+		size_t avail = data.size() - pos - 8;
+
+		if( !memcmp( &data[pos], "fmt ", 4 ) && size >= 16 && avail >= 16 )
+		{
+			u16 format, channels, bits;
+			memcpy( &format, chunk, 2 );
+			memcpy( &channels, chunk + 2, 2 );
+			memcpy( &bits, chunk + 14, 2 );
+			pcm16 = format == 1 && channels == 2 && bits == 16;
+		}
+		else if( !memcmp( &data[pos], "data", 4 ) )
+		{
+			if( !pcm16 ) return false;
+
+			// a recording that was never closed has no size filled in, take whatever is there
+			if( size == 0 || size > avail ) size = (u32)avail;
+
+			samples.resize( size / 2 );
+			if( !samples.empty() ) memcpy( &samples[0], chunk, samples.size() * 2 );
+			return true;
+		}
+
+		pos += 8 + (((size_t)size + 1) & ~(size_t)1);
+	}
+
+	return false;
+}
+
+// Compares the recorded output against a reference recording, returns the number of
+// differing samples (a length mismatch counts as a difference too).
+static uint s2r_compare_wav( const char* wav, const char* reference )
+{
+	std::vector<s16> out, ref;
+
+	if( !s2r_load_wav( wav, out ) )
+	{
+		fprintf( stderr, "SPU2-X: cannot read %s\n", wav );
+		return 1;
+	}
+
+	if( !s2r_load_wav( reference, ref ) )
+	{
+		fprintf( stderr, "SPU2-X: cannot read reference %s\n", reference );
+		return 1;
+	}
+
+	const size_t count = std::min( out.size(), ref.size() );
+	uint diffs = 0;
+	int maxdiff = 0;
+	size_t first = 0;
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		if( out[i] == ref[i] ) continue;
+		if( diffs++ == 0 ) first = i;
+		maxdiff = std::max( maxdiff, abs( out[i] - ref[i] ) );
+	}
+
+	printf( "reference: %s, %u of %u samples differ", reference, diffs, (uint)count );
+	if( diffs ) printf( " (max %d, first at frame %u)", maxdiff, (uint)(first / 2) );
+	printf( "\n" );
+
+	if( out.size() != ref.size() )
+	{
+		printf( "reference: length mismatch, %u frames recorded against %u\n", (uint)(out.size() / 2), (uint)(ref.size() / 2) );
+		diffs++;
+	}
+
+	return diffs;
+}
+
+// Replays one capture from start to end as fast as possible, with the output buffer drained at
+// the rate samples get mixed.  Returns the number of samples mixed, or -1 on a truncated file.
+static s64 s2r_run( const std::vector<u8>& capture, uint& events, const char* wav )
+{
+	s2r_reader file = { &capture[0], &capture[0] + capture.size() };
+	u32 start = 0;
+
+	file.Read( &start, 4 );
+
+	SPU2init();
+
+	// whatever the ini says, no device, and timestretching so that its cost shows up
+	OutputModule = FindOutputModuleById( L"nullout" );
+	SynchMode = 0;
+
+	// start at the capture's first tick, it was recorded from SPU2init on
+	Cycles = start;
+	OutPos = 0;
+	CurrentIOPCycle = start * 768;
+
+	SPU2irqCallback( dummy1, dummy4, dummy7 );
+	SPU2setClockPtr( &CurrentIOPCycle );
+
+	if( SPU2open( NULL ) != 0 )
+	{
+		SPU2shutdown();
+		return -1;
+	}
+
+	if( wav ) RecordStart( wav );
+
+	StereoOut16 packet[SndOutPacketSize];
+	u32 drained = Cycles;
+	bool truncated = false;
+
+	events = 0;
+
+	while( file.pos < file.end )
+	{
+		u32 ccycle, sval, evid;
+		u16 tval;
+
+		if( !file.Read( &ccycle, 4 ) || !file.Read( &sval, 4 ) )
+		{
+			truncated = true;
+			break;
+		}
+
+		evid = sval >> 29;
+		sval &= 0x1FFFFFFF;
+
+		const u32 TargetCycle = ccycle * 768;
+
+		while( (s32)(TargetCycle - CurrentIOPCycle) > 0 )
+		{
+			CurrentIOPCycle += std::min( TargetCycle - CurrentIOPCycle, ReplayStepCycles );
+			SPU2async( 0 );
+
+			for( ; Cycles - drained >= SndOutPacketSize; drained += SndOutPacketSize )
+				SndBuffer::ReadSamples( packet );
+		}
+
+		switch( evid )
+		{
+			case 0:
+				SPU2read( sval );
+				break;
+
+			case 1:
+				if( !file.Read( &tval, 2 ) ) truncated = true;
+				else SPU2write( sval, tval );
+				break;
+
+			case 2:
+			case 3:
+				if( sval > ArraySize( dmabuffer ) || !file.Read( dmabuffer, sval * 2 ) ) truncated = true;
+				else if( evid == 2 ) SPU2writeDMA4Mem( dmabuffer, sval );
+				else SPU2writeDMA7Mem( dmabuffer, sval );
+				break;
+
+			default:
+				truncated = true;
+				break;
+		}
+
+		if( truncated ) break;
+
+		events++;
+	}
+
+	const s64 mixed = (u32)(Cycles - start);
+
+	if( wav ) RecordStop();
+
+	SPU2close();
+	SPU2shutdown();
+
+	return truncated ? -1 : mixed;
+}
+
+// Headless replay of an .s2r capture (recorded by a build with S2R_ENABLE) for mixer
+// profiling: reports samples/sec and the time spent per mixer stage over the given number of
+// loops.  The first loop is recorded to wav when given, and compared against reference when
+// that is given too.  Returns non-zero on failure or when the output differs.
+EXPORT_C_(int) SPU2ReplayBenchmark( char* filename, int loops, char* wav, char* reference )
+{
+	std::vector<u8> capture;
+
+	if( !s2r_load( filename, capture ) )
+	{
+		fprintf( stderr, "SPU2-X: cannot read %s\n", filename );
+		return 1;
+	}
+
+	if( reference && !wav )
+		wav = (char*)"replay.wav";
+
+	loops = std::max( loops, 1 );
+
+	replay_mode = true;
+	MixProfiling = true;
+
+	u64 stages[MixStage_Count] = {};
+	u64 ticks = 0;
+	s64 samples = 0;
+	uint events = 0;
+	int failed = 0;
+
+	for( int i = 0; i < loops; ++i )
+	{
+		memset( MixStageTicks, 0, sizeof(MixStageTicks) );
+
+		const u64 start = GetCPUTicks();
+		const s64 mixed = s2r_run( capture, events, i == 0 ? wav : NULL );
+		const u64 elapsed = GetCPUTicks() - start;
+
+		if( mixed < 0 )
+		{
+			fprintf( stderr, "SPU2-X: %s is truncated or corrupt (after %u events)\n", filename, events );
+			failed = 1;
+			break;
+		}
+
+		printf( "loop %d: %.3f s, %.0f samples/s (%.1fx realtime)\n", i,
+			(double)elapsed / GetTickFrequency(),
+			(double)mixed * GetTickFrequency() / std::max<u64>( elapsed, 1 ),
+			(double)mixed * GetTickFrequency() / std::max<u64>( elapsed, 1 ) / 48000 );
+
+		for( int s = 0; s < MixStage_Count; ++s )
+			stages[s] += MixStageTicks[s];
+
+		ticks += elapsed;
+		samples += mixed;
+	}
+
+	MixProfiling = false;
+	replay_mode = false;
+
+	if( failed ) return failed;
+
+	const double freq = (double)GetTickFrequency() * loops;
+	const u64 mix = stages[MixStage_Total] - stages[MixStage_Decode] - stages[MixStage_Reverb] - stages[MixStage_TimeStretch];
+
+	printf( "%s: %u events, %u samples (%.2f s of audio)\n", filename, events, (uint)(samples / loops), (double)samples / loops / 48000 );
+	printf( "average: %.3f s, %.0f samples/s\n", ticks / freq, (double)samples * GetTickFrequency() / std::max<u64>( ticks, 1 ) );
+	printf( "stages: mix %.3f s, decode %.3f s, reverb %.3f s, timestretch %.3f s, other %.3f s\n",
+		mix / freq,
+		stages[MixStage_Decode] / freq,
+		stages[MixStage_Reverb] / freq,
+		stages[MixStage_TimeStretch] / freq,
+		(ticks - stages[MixStage_Total]) / freq );
+
+	if( reference && s2r_compare_wav( wav, reference ) != 0 )
+		failed = 1;
+
+	return failed;
+}
@@ -469,6 +469,8 @@ static void CvtPacketToInt( StereoOut32* srcdest, uint size )
 
 void SndBuffer::timeStretchWrite()
 {
+	ScopedMixStage stage( MixStage_TimeStretch );
+
 	// data prediction helps keep the tempo adjustments more accurate.
 	// The timestretcher returns packets in belated "clump" form.
 	// Meaning that most of the time we'll get nothing back, and then
@@ -491,6 +493,9 @@ void SndBuffer::timeStretchWrite()
 		_WriteSamples( sndTempBuffer, tempProgress );
 	}
 
+	// the tempo update below looks at the buffer, so publish the stretched chunks first
+	_PublishWrite();
+
 #ifdef SPU2X_USE_OLD_STRETCHER
 	UpdateTempoChangeSoundTouch();
 #else
@@ -0,0 +1,88 @@
+/* SPU2-X, A plugin for Emulating the Sound Processing Unit of the Playstation 2
+ * Developed and maintained by the Pcsx2 Development Team.
+ *
+ * SPU2-X is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Found-
+ * ation, either version 3 of the License, or (at your option) any later version.
+ *
+ * SPU2-X is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with SPU2-X.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+static void* handle;
+
+void help()
+{
+	fprintf(stderr, "Headless s2r replay (null output, as fast as possible)\n");
+	fprintf(stderr, "[-n loops] [-o output.wav] [-r reference.wav] SPU2-X_plugin .s2r_file [ini_directory]\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Reports samples/s and the time spent decoding, mixing, in reverb and timestretching.\n");
+	fprintf(stderr, "The first loop is recorded to the output wav (replay.wav when only -r is given)\n");
+	fprintf(stderr, "and compared against the reference, the exit code is non-zero when they differ.\n");
+	if (handle) {
+		dlclose(handle);
+	}
+	exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+	int loops = 3;
+	char* wav = NULL;
+	char* reference = NULL;
+
+	int i = 1;
+
+	for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+		if (strcmp(argv[i], "-n") == 0)
+			loops = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-o") == 0)
+			wav = argv[i + 1];
+		else if (strcmp(argv[i], "-r") == 0)
+			reference = argv[i + 1];
+		else
+			help();
+	}
+
+	if (argc - i < 2) help();
+
+	char* plugin = argv[i];
+	char* s2r = argv[i + 1];
+
+	handle = dlopen(plugin, RTLD_LAZY|RTLD_GLOBAL);
+	if (handle == NULL) {
+		fprintf(stderr, "Failed to dlopen plugin %s: %s\n", plugin, dlerror());
+		help();
+	}
+
+	__attribute__((stdcall)) void (*SPU2setSettingsDir_ptr)(const char*);
+	__attribute__((stdcall)) int (*SPU2ReplayBenchmark_ptr)(char*, int, char*, char*);
+
+	*(void**)(&SPU2setSettingsDir_ptr) = dlsym(handle, "SPU2setSettingsDir");
+	*(void**)(&SPU2ReplayBenchmark_ptr) = dlsym(handle, "SPU2ReplayBenchmark");
+
+	if (SPU2ReplayBenchmark_ptr == NULL) {
+		fprintf(stderr, "%s doesn't support the replay benchmark\n", plugin);
+		help();
+	}
+
+	if (argc - i > 2)
+		SPU2setSettingsDir_ptr(argv[i + 2]);
+	else if (getenv("SPU2_CONF"))
+		SPU2setSettingsDir_ptr(getenv("SPU2_CONF"));
+
+	int failed = SPU2ReplayBenchmark_ptr(s2r, loops, wav, reference);
+
+	dlclose(handle);
+
+	return failed == 0 ? 0 : 1;
+}
@@ -387,6 +387,23 @@ __forceinline void TimeUpdate(u32 cClocks)
 	//Update Mixing Progress
 	while(dClocks>=TickInterval)
 	{
+		// Nothing outside the mixer can change between the ticks of one TimeUpdate (register
+		// writes and DMAs come in through their own TimeUpdate call), so as long as there's no IRQ
+		// to deliver, DMA interrupt counting down or voice waiting to key on, mix a whole block of
+		// samples at once.  MixBlock ends the block early on IRQs raised while mixing.
+		if( MixBlockSize > 1 && !has_to_call_irq && !Cores[0].KeyOn && !Cores[1].KeyOn
+#ifndef ENABLE_NEW_IOPDMA_SPU2
+			&& Cores[0].DMAICounter <= 0 && Cores[1].DMAICounter <= 0
+#endif
+			)
+		{
+			const uint mixed = MixBlock( std::min<u32>( dClocks / TickInterval, MixBlockSize ) );
+
+			dClocks -= mixed * TickInterval;
+			lClocks += mixed * TickInterval;
+			continue;
+		}
+
 		if(has_to_call_irq)
 		{
 			//ConLog("* SPU2-X: Irq Called (%04x) at cycle %d.\n", Spdif.Info, Cycles);